@@ -26,35 +26,78 @@
 #ifndef __AUDIOMODEM_H__
 #define __AUDIOMODEM_H__
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "srcfft.h"
+#include "pkt.h"
+
+//Define AUDIOMODEM_NO_BUILTINS to leave the bundled modems out of the 
+//registry (and this translation unit), and register your own engines
+#ifndef AUDIOMODEM_NO_BUILTINS
 #include "fskclk.h"
 #include "fsk.h"
 #include "ook.h"
 #include "pskclk.h"
 #include "corr.h"
-#include "pkt.h"
+#include "ofdm.h"
+#include "psk.h"
+#include "qam.h"
+#include "ncfsk.h"
+#include "cpfsk.h"
+#include "css.h"
+#endif
+
+#define AUDIOMODEM_MAX_OPS 32
+
+//Parameters handed to an engine's init; each engine uses the ones it needs
+typedef struct {
+	size_t samplerate;
+	size_t bitrate;
+	size_t bandwidth;
+	double freq;
+	size_t symbol_count;
+} audiomodem_config_t;
 
-typedef enum {
-	COMPAT_NONE,
-	COMPAT_FSKCLK,
-	COMPAT_FSK,
-	COMPAT_OOK,
-	COMPAT_PSKCLK,
-	COMPAT_CORR,
-} audiomodem_type_t;
+//Function table for a modem engine.  The handle is the engine's own 
+//modem object (fsk_t, corr_t, ...) returned by init.
+typedef struct {
+	const char *name;
+	void *(*init)(audiomodem_config_t *config);
+	void  (*destroy)(void *handle);
+	int   (*set_thresh)(void *handle, double thresh);
+	int   (*set_verbose)(void *handle, int verbose);
+	void  (*printinfo)(void *handle);
+	int   (*modulate)(void *handle, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+	int   (*demodulate)(void *handle, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+	//Optional, for engines built on srcfft: the srcfft whose resampling and 
+	//FFT size a shared front-end must match, and a demodulate that starts 
+	//from that front-end's spectra (see multidemod.h)
+	srcfft_t *(*frontend)(void *handle);
+	int   (*demodulate_fft)(void *handle, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen);
+	//Optional: raised cosine symbol shaping with the given roll-off (0 for
+	//the engine's default envelope), along with the matching receive window
+	int   (*set_pulse)(void *handle, double rolloff);
+	//Optional: keep a confidence for every demodulated bit, and fetch the 
+	//ones for the bytes the last demodulate returned (see bitstream_t)
+	int   (*set_soft)(void *handle, int on);
+	int   (*soft)(void *handle, int8_t **soft, size_t *softlen);
+} audiomodem_ops_t;
 
 typedef struct {
-	audiomodem_type_t type;
-	union {
-		fskclk_t *fskclk;
-		fsk_t    *fsk;
-		ook_t    *ook;
-		pskclk_t    *pskclk;
-		corr_t   *corr;
-	};
-	pkt_t *pkt;
+	const audiomodem_ops_t *ops;
+	void    *handle;
+	pkt_t   *pkt;
 	uint8_t *rxdata;
 } audiomodem_t;
 
+int                     audiomodem_register(const audiomodem_ops_t *ops);
+const audiomodem_ops_t *audiomodem_lookup(const char *name);
+size_t                  audiomodem_registered(const audiomodem_ops_t ***ops);
+audiomodem_t           *audiomodem_init(const char *name, audiomodem_config_t *config);
+audiomodem_t           *audiomodem_ops_init(const audiomodem_ops_t *ops, audiomodem_config_t *config);
+
 audiomodem_t *audiomodem_fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count);
 audiomodem_t *audiomodem_fsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count);
 audiomodem_t *audiomodem_ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq);
@@ -66,104 +109,301 @@ int           audiomodem_pkt_init(audiomodem_t *modem);
 void          audiomodem_destroy(audiomodem_t *modem);
 int           audiomodem_set_thresh(audiomodem_t *modem, double thresh);
 int           audiomodem_set_verbose(audiomodem_t *modem, int verbose);
+int           audiomodem_set_pulse(audiomodem_t *modem, double rolloff);
+int           audiomodem_set_soft(audiomodem_t *modem, int on);
+int           audiomodem_soft(audiomodem_t *modem, int8_t **soft, size_t *softlen);
 void          audiomodem_printinfo(audiomodem_t *modem);
 int           audiomodem_modulate(audiomodem_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
 int           audiomodem_demodulate(audiomodem_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+int           audiomodem_demodulate_pkts(audiomodem_t *modem, pktdata_t **pkts, size_t *pktslen, double *samples, size_t sampleslen);
+int           audiomodem_demodulate_fft(audiomodem_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen);
 
 #endif //__AUDIOMODEM_H__
 
 #ifdef AUDIOMODEM_IMPLEMENTATION
 #undef AUDIOMODEM_IMPLEMENTATION
 
-audiomodem_t *audiomodem_fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
-	audiomodem_t *modem;
+static const audiomodem_ops_t *audiomodem_registry[AUDIOMODEM_MAX_OPS];
+static size_t audiomodem_registrylen = 0;
+static int audiomodem_builtins_done = 0;
+
+#ifndef AUDIOMODEM_NO_BUILTINS
+
+//Thin adapters from the void handle to each bundled modem
+
+#define AUDIOMODEM_ADAPT(prefix,type) \
+static void audiomodem_##prefix##_destroy(void *handle) { prefix##_destroy((type*)handle); } \
+static int  audiomodem_##prefix##_set_thresh(void *handle, double thresh) { return prefix##_set_thresh((type*)handle,thresh); } \
+static int  audiomodem_##prefix##_set_verbose(void *handle, int verbose) { return prefix##_set_verbose((type*)handle,verbose); } \
+static void audiomodem_##prefix##_printinfo(void *handle) { prefix##_printinfo((type*)handle); } \
+static int  audiomodem_##prefix##_modulate(void *handle, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) { \
+	return prefix##_modulate((type*)handle,samples,sampleslen,data,datalen); \
+} \
+static int  audiomodem_##prefix##_demodulate(void *handle, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) { \
+	return prefix##_demodulate((type*)handle,data,datalen,samples,sampleslen); \
+} \
+static int  audiomodem_##prefix##_set_soft(void *handle, int on) { return prefix##_set_soft((type*)handle,on); } \
+static int  audiomodem_##prefix##_soft(void *handle, int8_t **soft, size_t *softlen) { \
+	return prefix##_soft((type*)handle,soft,softlen); \
+}
+
+#define AUDIOMODEM_ADAPT_SRCFFT(prefix,type) \
+static srcfft_t *audiomodem_##prefix##_frontend(void *handle) { return ((type*)handle)->srcfft; }
+
+#define AUDIOMODEM_ADAPT_FFT(prefix,type) \
+static int  audiomodem_##prefix##_demodulate_fft(void *handle, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen) { \
+	return prefix##_demodulate_fft((type*)handle,data,datalen,spectra,spectralen); \
+} \
+static int  audiomodem_##prefix##_set_pulse(void *handle, double rolloff) { return prefix##_set_pulse((type*)handle,rolloff); }
+
+#define AUDIOMODEM_OPS(name,init,prefix) { \
+	name, init, \
+	audiomodem_##prefix##_destroy, \
+	audiomodem_##prefix##_set_thresh, \
+	audiomodem_##prefix##_set_verbose, \
+	audiomodem_##prefix##_printinfo, \
+	audiomodem_##prefix##_modulate, \
+	audiomodem_##prefix##_demodulate, \
+	0, 0, 0, \
+	audiomodem_##prefix##_set_soft, \
+	audiomodem_##prefix##_soft, \
+}
+
+#define AUDIOMODEM_OPS_FFT(name,init,prefix) { \
+	name, init, \
+	audiomodem_##prefix##_destroy, \
+	audiomodem_##prefix##_set_thresh, \
+	audiomodem_##prefix##_set_verbose, \
+	audiomodem_##prefix##_printinfo, \
+	audiomodem_##prefix##_modulate, \
+	audiomodem_##prefix##_demodulate, \
+	audiomodem_##prefix##_frontend, \
+	audiomodem_##prefix##_demodulate_fft, \
+	audiomodem_##prefix##_set_pulse, \
+	audiomodem_##prefix##_set_soft, \
+	audiomodem_##prefix##_soft, \
+}
+
+AUDIOMODEM_ADAPT(fskclk,fskclk_t)
+AUDIOMODEM_ADAPT(fsk,fsk_t)
+AUDIOMODEM_ADAPT(ook,ook_t)
+AUDIOMODEM_ADAPT(pskclk,pskclk_t)
+AUDIOMODEM_ADAPT(corr,corr_t)
+AUDIOMODEM_ADAPT(ofdm,ofdm_t)
+AUDIOMODEM_ADAPT(psk,psk_t)
+AUDIOMODEM_ADAPT(qam,qam_t)
+AUDIOMODEM_ADAPT(ncfsk,ncfsk_t)
+AUDIOMODEM_ADAPT(cpfsk,cpfsk_t)
+AUDIOMODEM_ADAPT(css,css_t)
+AUDIOMODEM_ADAPT_SRCFFT(fskclk,fskclk_t)
+AUDIOMODEM_ADAPT_SRCFFT(fsk,fsk_t)
+AUDIOMODEM_ADAPT_SRCFFT(pskclk,pskclk_t)
+AUDIOMODEM_ADAPT_FFT(fskclk,fskclk_t)
+AUDIOMODEM_ADAPT_FFT(fsk,fsk_t)
+AUDIOMODEM_ADAPT_FFT(ook,ook_t)
+AUDIOMODEM_ADAPT_FFT(pskclk,pskclk_t)
+
+//ook only creates its srcfft once a front-end asks for it
+static srcfft_t *audiomodem_ook_frontend(void *handle) { return ook_frontend((ook_t*)handle); }
+
+static void *audiomodem_fskclk_new(audiomodem_config_t *c) {
+	return fskclk_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count);
+}
+static void *audiomodem_mfsk_new(audiomodem_config_t *c) {
+	//Two of the symbol_count data tones at once
+	return fskclk_mfsk_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count,2);
+}
+static void *audiomodem_fsk_new(audiomodem_config_t *c) {
+	return fsk_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count);
+}
+static void *audiomodem_ook_new(audiomodem_config_t *c) {
+	return ook_init(c->samplerate,c->bitrate,c->bandwidth,c->freq);
+}
+static void *audiomodem_ookrll_new(audiomodem_config_t *c) {
+	return ook_rll_init(c->samplerate,c->bitrate,c->bandwidth,c->freq);
+}
+static void *audiomodem_pskclk_new(audiomodem_config_t *c) {
+	return pskclk_init(c->samplerate,c->bitrate,c->bandwidth,c->freq,c->symbol_count);
+}
+static void *audiomodem_dpsk_new(audiomodem_config_t *c) {
+	return pskclk_dpsk_init(c->samplerate,c->bitrate,c->bandwidth,c->freq,c->symbol_count);
+}
+static void *audiomodem_tcmpsk_new(audiomodem_config_t *c) {
+	return pskclk_tcm_init(c->samplerate,c->bitrate,c->bandwidth,c->freq,c->symbol_count);
+}
+static void *audiomodem_corrfsk_new(audiomodem_config_t *c) {
+	return corr_fsk_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count);
+}
+static void *audiomodem_corrpsk_new(audiomodem_config_t *c) {
+	return corr_psk_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+static void *audiomodem_corrfpsk_new(audiomodem_config_t *c) {
+	return corr_fpsk_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count);
+}
+static void *audiomodem_corrtcmfpsk_new(audiomodem_config_t *c) {
+	return corr_fpsk_tcm_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count);
+}
+static void *audiomodem_corrdsss_new(audiomodem_config_t *c) {
+	//symbol_count is the number of chips per bit
+	return corr_dsss_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+static void *audiomodem_ofdm_new(audiomodem_config_t *c) {
+	return ofdm_init(c->samplerate,c->bitrate,c->bandwidth,c->symbol_count);
+}
+static void *audiomodem_psk_new(audiomodem_config_t *c) {
+	return psk_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+static void *audiomodem_qam_new(audiomodem_config_t *c) {
+	return qam_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+static void *audiomodem_ncfsk_new(audiomodem_config_t *c) {
+	return ncfsk_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+static void *audiomodem_msk_new(audiomodem_config_t *c) {
+	return cpfsk_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+static void *audiomodem_gfsk_new(audiomodem_config_t *c) {
+	//GFSK is binary, whatever the symbol count
+	return cpfsk_gfsk_init(c->samplerate,c->bitrate,c->freq,2);
+}
+static void *audiomodem_css_new(audiomodem_config_t *c) {
+	return css_init(c->samplerate,c->bitrate,c->freq,c->symbol_count);
+}
+
+//The demonstration programs take these names as options (-name)
+static const audiomodem_ops_t audiomodem_builtin_ops[] = {
+	AUDIOMODEM_OPS_FFT("fskclk",audiomodem_fskclk_new,fskclk),
+	AUDIOMODEM_OPS_FFT("mfsk",audiomodem_mfsk_new,fskclk),
+	AUDIOMODEM_OPS_FFT("fsk",audiomodem_fsk_new,fsk),
+	AUDIOMODEM_OPS_FFT("ook",audiomodem_ook_new,ook),
+	AUDIOMODEM_OPS_FFT("ookrll",audiomodem_ookrll_new,ook),
+	AUDIOMODEM_OPS_FFT("pskclk",audiomodem_pskclk_new,pskclk),
+	AUDIOMODEM_OPS_FFT("dpsk",audiomodem_dpsk_new,pskclk),
+	AUDIOMODEM_OPS_FFT("tcmpsk",audiomodem_tcmpsk_new,pskclk),
+	AUDIOMODEM_OPS("cfsk",audiomodem_corrfsk_new,corr),
+	AUDIOMODEM_OPS("cpsk",audiomodem_corrpsk_new,corr),
+	AUDIOMODEM_OPS("cfpsk",audiomodem_corrfpsk_new,corr),
+	AUDIOMODEM_OPS("tcmfpsk",audiomodem_corrtcmfpsk_new,corr),
+	AUDIOMODEM_OPS("dsss",audiomodem_corrdsss_new,corr),
+	AUDIOMODEM_OPS("ofdm",audiomodem_ofdm_new,ofdm),
+	AUDIOMODEM_OPS("psk",audiomodem_psk_new,psk),
+	AUDIOMODEM_OPS("qam",audiomodem_qam_new,qam),
+	AUDIOMODEM_OPS("ncfsk",audiomodem_ncfsk_new,ncfsk),
+	AUDIOMODEM_OPS("msk",audiomodem_msk_new,cpfsk),
+	AUDIOMODEM_OPS("gfsk",audiomodem_gfsk_new,cpfsk),
+	AUDIOMODEM_OPS("css",audiomodem_css_new,css),
+};
+
+#endif //AUDIOMODEM_NO_BUILTINS
+
+static void audiomodem_register_builtins(void) {
+	if( audiomodem_builtins_done ) { return; }
+	audiomodem_builtins_done = 1;
+#ifndef AUDIOMODEM_NO_BUILTINS
+	size_t i;
+	for( i=0; i<sizeof(audiomodem_builtin_ops)/sizeof(audiomodem_builtin_ops[0]); i++ ) {
+		audiomodem_registry[audiomodem_registrylen++] = &audiomodem_builtin_ops[i];
+	}
+#endif
+}
+
+int audiomodem_register(const audiomodem_ops_t *ops) {
+	//Adds an engine to the registry.  An engine with the same name as 
+	//one already registered replaces it.
+	size_t i;
 	
-	modem = malloc(sizeof(audiomodem_t));
-	if( !modem ) { return 0; }
-	memset(modem,0,sizeof(audiomodem_t));
+	if( !ops ) { return -1; }
+	if( !ops->name || !ops->init || !ops->destroy ) { return -1; }
+	if( !ops->modulate || !ops->demodulate ) { return -1; }
 	
-	modem->type = COMPAT_FSKCLK;
-	modem->fskclk = fskclk_init(samplerate,bitrate,bandwidth,symbol_count);
-	if( !modem->fskclk ) { audiomodem_destroy(modem); return 0; }
-	return modem;
+	audiomodem_register_builtins();
+	for( i=0; i<audiomodem_registrylen; i++ ) {
+		if( !strcmp(audiomodem_registry[i]->name,ops->name) ) {
+			audiomodem_registry[i] = ops;
+			return 0;
+		}
+	}
+	if( audiomodem_registrylen >= AUDIOMODEM_MAX_OPS ) { return -1; }
+	audiomodem_registry[audiomodem_registrylen++] = ops;
+	return 0;
 }
 
-audiomodem_t *audiomodem_fsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
-	audiomodem_t *modem;
-	
-	modem = malloc(sizeof(audiomodem_t));
-	if( !modem ) { return 0; }
-	memset(modem,0,sizeof(audiomodem_t));
+const audiomodem_ops_t *audiomodem_lookup(const char *name) {
+	size_t i;
 	
-	modem->type = COMPAT_FSK;
-	modem->fsk = fsk_init(samplerate,bitrate,bandwidth,symbol_count);
-	if( !modem->fsk ) { audiomodem_destroy(modem); return 0; }
-	return modem;
+	if( !name ) { return 0; }
+	audiomodem_register_builtins();
+	for( i=0; i<audiomodem_registrylen; i++ ) {
+		if( !strcmp(audiomodem_registry[i]->name,name) ) {
+			return audiomodem_registry[i];
+		}
+	}
+	return 0;
 }
 
-audiomodem_t *audiomodem_ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq) {
+size_t audiomodem_registered(const audiomodem_ops_t ***ops) {
+	audiomodem_register_builtins();
+	if( ops ) { *ops = audiomodem_registry; }
+	return audiomodem_registrylen;
+}
+
+audiomodem_t *audiomodem_init(const char *name, audiomodem_config_t *config) {
+	return audiomodem_ops_init(audiomodem_lookup(name),config);
+}
+
+audiomodem_t *audiomodem_ops_init(const audiomodem_ops_t *ops, audiomodem_config_t *config) {
 	audiomodem_t *modem;
 	
+	if( !ops ) { return 0; }
+	if( !config ) { return 0; }
+	
 	modem = malloc(sizeof(audiomodem_t));
 	if( !modem ) { return 0; }
 	memset(modem,0,sizeof(audiomodem_t));
 	
-	modem->type = COMPAT_OOK;
-	modem->ook = ook_init(samplerate,bitrate,bandwidth,freq);
-	if( !modem->ook ) { audiomodem_destroy(modem); return 0; }
+	modem->ops = ops;
+	modem->handle = ops->init(config);
+	if( !modem->handle ) { audiomodem_destroy(modem); return 0; }
 	return modem;
 }
 
-audiomodem_t *audiomodem_pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq, size_t symbol_count) {
-	audiomodem_t *modem;
-	
-	modem = malloc(sizeof(audiomodem_t));
-	if( !modem ) { return 0; }
-	memset(modem,0,sizeof(audiomodem_t));
+static audiomodem_t *audiomodem_named_init(const char *name, size_t samplerate, size_t bitrate, size_t bandwidth, double freq, size_t symbol_count) {
+	audiomodem_config_t config;
 	
-	modem->type = COMPAT_PSKCLK;
-	modem->pskclk = pskclk_init(samplerate,bitrate,bandwidth,freq,symbol_count);
-	if( !modem->ook ) { audiomodem_destroy(modem); return 0; }
-	return modem;
+	config.samplerate = samplerate;
+	config.bitrate = bitrate;
+	config.bandwidth = bandwidth;
+	config.freq = freq;
+	config.symbol_count = symbol_count;
+	return audiomodem_init(name,&config);
+}
+
+audiomodem_t *audiomodem_fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
+	return audiomodem_named_init("fskclk",samplerate,bitrate,bandwidth,0.0,symbol_count);
+}
+
+audiomodem_t *audiomodem_fsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
+	return audiomodem_named_init("fsk",samplerate,bitrate,bandwidth,0.0,symbol_count);
+}
+
+audiomodem_t *audiomodem_ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq) {
+	return audiomodem_named_init("ook",samplerate,bitrate,bandwidth,freq,0);
+}
+
+audiomodem_t *audiomodem_pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq, size_t symbol_count) {
+	return audiomodem_named_init("pskclk",samplerate,bitrate,bandwidth,freq,symbol_count);
 }
 
 audiomodem_t *audiomodem_corrfsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
-	audiomodem_t *modem;
-	
-	modem = malloc(sizeof(audiomodem_t));
-	if( !modem ) { return 0; }
-	memset(modem,0,sizeof(audiomodem_t));
-	
-	modem->type = COMPAT_CORR;
-	modem->corr = corr_fsk_init(samplerate,bitrate,bandwidth,symbol_count);
-	if( !modem->corr ) { audiomodem_destroy(modem); return 0; }
-	return modem;
+	return audiomodem_named_init("cfsk",samplerate,bitrate,bandwidth,0.0,symbol_count);
 }
 
 audiomodem_t *audiomodem_corrpsk_init(size_t samplerate, size_t bitrate, double freq, size_t symbol_count) {
-	audiomodem_t *modem;
-	
-	modem = malloc(sizeof(audiomodem_t));
-	if( !modem ) { return 0; }
-	memset(modem,0,sizeof(audiomodem_t));
-	
-	modem->type = COMPAT_CORR;
-	modem->corr = corr_psk_init(samplerate,bitrate,freq,symbol_count);
-	if( !modem->corr ) { audiomodem_destroy(modem); return 0; }
-	return modem;
+	return audiomodem_named_init("cpsk",samplerate,bitrate,0,freq,symbol_count);
 }
 
 audiomodem_t *audiomodem_corrfpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
-	audiomodem_t *modem;
-	
-	modem = malloc(sizeof(audiomodem_t));
-	if( !modem ) { return 0; }
-	memset(modem,0,sizeof(audiomodem_t));
-	
-	modem->type = COMPAT_CORR;
-	modem->corr = corr_fpsk_init(samplerate,bitrate,bandwidth,symbol_count);
-	if( !modem->corr ) { audiomodem_destroy(modem); return 0; }
-	return modem;
+	return audiomodem_named_init("cfpsk",samplerate,bitrate,bandwidth,0.0,symbol_count);
 }
 
 int audiomodem_pkt_init(audiomodem_t *modem) {
@@ -175,20 +415,8 @@ int audiomodem_pkt_init(audiomodem_t *modem) {
 
 void audiomodem_destroy(audiomodem_t *modem) {
 	if( modem ) {
-		if( modem->type == COMPAT_FSKCLK ) {
-			fskclk_destroy(modem->fskclk);
-		}
-		else if( modem->type == COMPAT_FSK ) {
-			fsk_destroy(modem->fsk);
-		}
-		else if( modem->type == COMPAT_OOK ) {
-			ook_destroy(modem->ook);
-		}
-		else if( modem->type == COMPAT_PSKCLK ) {
-			pskclk_destroy(modem->pskclk);
-		}
-		else if( modem->type == COMPAT_CORR ) {
-			corr_destroy(modem->corr);
+		if( modem->handle ) {
+			modem->ops->destroy(modem->handle);
 		}
 		if( modem->pkt ) {
 			pkt_destroy(modem->pkt);
@@ -203,56 +431,17 @@ void audiomodem_destroy(audiomodem_t *modem) {
 
 int audiomodem_set_thresh(audiomodem_t *modem, double thresh) {
 	if( !modem ) { return -1; }
-	if( modem->type == COMPAT_FSKCLK ) {
-		return fskclk_set_thresh(modem->fskclk,thresh);
-	}
-	else if( modem->type == COMPAT_FSK ) {
-		return fsk_set_thresh(modem->fsk,thresh);
-	}
-	else if( modem->type == COMPAT_OOK ) {
-		return ook_set_thresh(modem->ook,thresh);
-	}
-	else if( modem->type == COMPAT_PSKCLK ) {
-		return pskclk_set_thresh(modem->pskclk,thresh);
-	}
-	else if( modem->type == COMPAT_CORR ) {
-		return corr_set_thresh(modem->corr,thresh);
-	}
-	else {
-		return -1;
-	}
+	if( !modem->ops->set_thresh ) { return -1; }
+	return modem->ops->set_thresh(modem->handle,thresh);
 }
 
 int audiomodem_set_verbose(audiomodem_t *modem, int verbose) {
 	if( !modem ) { return -1; }
-	if( modem->type == COMPAT_FSKCLK ) {
-		if( fskclk_set_verbose(modem->fskclk,verbose) ) {
+	if( modem->ops->set_verbose ) {
+		if( modem->ops->set_verbose(modem->handle,verbose) ) {
 			return -1;
 		}
 	}
-	else if( modem->type == COMPAT_FSK ) {
-		if( fsk_set_verbose(modem->fsk,verbose) ) { 
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_OOK ) {
-		if( ook_set_verbose(modem->ook,verbose) ) { 
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_PSKCLK ) {
-		if( pskclk_set_verbose(modem->pskclk,verbose) ) { 
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_CORR ) {
-		if( corr_set_verbose(modem->corr,verbose) ) {
-			return -1;
-		}
-	}
-	else {
-		return -1;
-	}
 	if( modem->pkt ) {
 		if( pkt_set_verbose(modem->pkt,verbose) ) {
 			return -1;
@@ -261,23 +450,29 @@ int audiomodem_set_verbose(audiomodem_t *modem, int verbose) {
 	return 0;
 }
 
+int audiomodem_set_pulse(audiomodem_t *modem, double rolloff) {
+	if( !modem ) { return -1; }
+	if( !modem->ops->set_pulse ) { return -1; }
+	return modem->ops->set_pulse(modem->handle,rolloff);
+}
+
+int audiomodem_set_soft(audiomodem_t *modem, int on) {
+	if( !modem ) { return -1; }
+	if( !modem->ops->set_soft ) { return -1; }
+	return modem->ops->set_soft(modem->handle,on);
+}
+
+int audiomodem_soft(audiomodem_t *modem, int8_t **soft, size_t *softlen) {
+	//Confidences of the raw demodulated bits behind the last demodulate 
+	//(before any packet framing), one per bit
+	if( !modem ) { return -1; }
+	if( !modem->ops->soft ) { return -1; }
+	return modem->ops->soft(modem->handle,soft,softlen);
+}
+
 void audiomodem_printinfo(audiomodem_t *modem) {
-	if( modem ) {
-		if( modem->type == COMPAT_FSKCLK ) {
-			fskclk_printinfo(modem->fskclk);
-		}
-		else if( modem->type == COMPAT_FSK ) {
-			fsk_printinfo(modem->fsk);
-		}
-		else if( modem->type == COMPAT_OOK ) {
-			ook_printinfo(modem->ook);
-		}
-		else if( modem->type == COMPAT_PSKCLK ) {
-			pskclk_printinfo(modem->pskclk);
-		}
-		else if( modem->type == COMPAT_CORR ) {
-			corr_printinfo(modem->corr);
-		}
+	if( modem && modem->ops->printinfo ) {
+		modem->ops->printinfo(modem->handle);
 	}
 }
 
@@ -296,97 +491,101 @@ int audiomodem_modulate(audiomodem_t *modem, double **samples, size_t *samplesle
 		mod_datalen = datalen;
 	}
 	
-	if( modem->type == COMPAT_FSKCLK ) {
-		return fskclk_modulate(modem->fskclk,samples,sampleslen,mod_data,mod_datalen);
+	return modem->ops->modulate(modem->handle,samples,sampleslen,mod_data,mod_datalen);
+}
+
+static int audiomodem_pkt_rx(audiomodem_t *modem, pktdata_t **pkts, size_t *pktslen, uint8_t *demod_data, size_t demod_datalen) {
+	//Frame the raw bytes, combining redundant copies by their confidence
+	//when the modem has soft output turned on
+	int8_t *soft;
+	size_t  softlen;
+	
+	if( audiomodem_soft(modem,&soft,&softlen) == 0 && softlen == demod_datalen*8 ) {
+		return pkt_rx_soft(modem->pkt,pkts,pktslen,demod_data,demod_datalen,soft,softlen);
 	}
-	else if( modem->type == COMPAT_FSK ) {
-		return fsk_modulate(modem->fsk,samples,sampleslen,mod_data,mod_datalen);
+	return pkt_rx(modem->pkt,pkts,pktslen,demod_data,demod_datalen);
+}
+
+static int audiomodem_rx(audiomodem_t *modem, uint8_t **data, size_t *datalen, uint8_t *demod_data, size_t demod_datalen) {
+	//Pass raw demodulated bytes through the packet framer (if any)
+	pktdata_t *pkts;
+	size_t     pktslen;
+	size_t     i,j;
+	uint8_t   *tmp;
+	size_t     rxdatalen = 0;
+	
+	if( !modem->pkt ) {
+		*data = demod_data;
+		*datalen = demod_datalen;
+		return 0;
 	}
-	else if( modem->type == COMPAT_OOK ) {
-		return ook_modulate(modem->ook,samples,sampleslen,mod_data,mod_datalen);
+	if( audiomodem_pkt_rx(modem,&pkts,&pktslen,demod_data,demod_datalen) ) {
+		return -1;
 	}
-	else if( modem->type == COMPAT_PSKCLK ) {
-		return pskclk_modulate(modem->pskclk,samples,sampleslen,mod_data,mod_datalen);
+	if( pktslen == 0 ) {
+		*data = 0;
+		*datalen = 0;
 	}
-	else if( modem->type == COMPAT_CORR ) {
-		return corr_modulate(modem->corr,samples,sampleslen,mod_data,mod_datalen);
+	else if( pktslen == 1 ) {
+		*data = pkts[0].data;
+		*datalen = pkts[0].len;
 	}
 	else {
-		return -1;
+		for( i=0; i<pktslen; i++ ) {
+			tmp = (uint8_t*)realloc(modem->rxdata,sizeof(uint8_t)*(rxdatalen+pkts[i].len));
+			if( !tmp ) {
+				return -1;
+			}
+			modem->rxdata = tmp;
+			for( j=0; j<pkts[i].len; j++ ) {
+				modem->rxdata[rxdatalen++] = pkts[i].data[j];
+			}
+		}
+		*data = modem->rxdata;
+		*datalen = rxdatalen;
 	}
+	return 0;
 }
 
 int audiomodem_demodulate(audiomodem_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
 	uint8_t   *demod_data;
 	size_t     demod_datalen;
-	pktdata_t *pkts;
-	size_t     pktslen;
-	size_t     i,j;
-	uint8_t   *tmp;
-	size_t     rxdatalen = 0;
 	
 	if( !modem ) { return -1; }
 	
-	if( modem->type == COMPAT_FSKCLK ) {
-		if( fskclk_demodulate(modem->fskclk,&demod_data,&demod_datalen,samples,sampleslen) ) {
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_FSK ) {
-		if( fsk_demodulate(modem->fsk,&demod_data,&demod_datalen,samples,sampleslen) ) {
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_OOK ) {
-		if( ook_demodulate(modem->ook,&demod_data,&demod_datalen,samples,sampleslen) ) {
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_PSKCLK ) {
-		if( pskclk_demodulate(modem->pskclk,&demod_data,&demod_datalen,samples,sampleslen) ) {
-			return -1;
-		}
-	}
-	else if( modem->type == COMPAT_CORR ) {
-		if( corr_demodulate(modem->corr,&demod_data,&demod_datalen,samples,sampleslen) ) {
-			return -1;
-		}
+	if( modem->ops->demodulate(modem->handle,&demod_data,&demod_datalen,samples,sampleslen) ) {
+		return -1;
 	}
-	else {
+	return audiomodem_rx(modem,data,datalen,demod_data,demod_datalen);
+}
+
+int audiomodem_demodulate_pkts(audiomodem_t *modem, pktdata_t **pkts, size_t *pktslen, double *samples, size_t sampleslen) {
+	//Same as audiomodem_demodulate, but keeps the packet boundaries
+	uint8_t   *demod_data;
+	size_t     demod_datalen;
+	
+	if( !modem ) { return -1; }
+	if( !modem->pkt ) { return -1; }
+	
+	if( modem->ops->demodulate(modem->handle,&demod_data,&demod_datalen,samples,sampleslen) ) {
 		return -1;
 	}
+	return audiomodem_pkt_rx(modem,pkts,pktslen,demod_data,demod_datalen);
+}
+
+int audiomodem_demodulate_fft(audiomodem_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen) {
+	//Same as audiomodem_demodulate, but from spectra produced by a shared 
+	//front-end that matches ops->frontend
+	uint8_t   *demod_data;
+	size_t     demod_datalen;
 	
-	if( modem->pkt ) {
-		if( pkt_rx(modem->pkt,&pkts,&pktslen,demod_data,demod_datalen) ) {
-			return -1;
-		}
-		if( pktslen == 0 ) {
-			*data = 0;
-			*datalen = 0;
-		}
-		else if( pktslen == 1 ) {
-			*data = pkts[0].data;
-			*datalen = pkts[0].len;
-		}
-		else {
-			for( i=0; i<pktslen; i++ ) {
-				tmp = (uint8_t*)realloc(modem->rxdata,sizeof(uint8_t)*(rxdatalen+pkts[i].len));
-				if( !tmp ) {
-					return -1;
-				}
-				modem->rxdata = tmp;
-				for( j=0; j<pkts[i].len; j++ ) {
-					modem->rxdata[rxdatalen++] = pkts[i].data[j];
-				}
-			}
-			*data = modem->rxdata;
-			*datalen = rxdatalen;
-		}
-	} else {
-		*data = demod_data;
-		*datalen = demod_datalen;
+	if( !modem ) { return -1; }
+	if( !modem->ops->demodulate_fft ) { return -1; }
+	
+	if( modem->ops->demodulate_fft(modem->handle,&demod_data,&demod_datalen,spectra,spectralen) ) {
+		return -1;
 	}
-	return 0;
+	return audiomodem_rx(modem,data,datalen,demod_data,demod_datalen);
 }
 
 #endif //AUDIOMODEM_IMPLEMENTATION
\ No newline at end of file
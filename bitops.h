@@ -26,10 +26,68 @@
 #ifndef __BITOPS_H__
 #define __BITOPS_H__
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
 int  getbits(uint8_t *data, size_t datalen, size_t bit_idx, size_t bit_count);
 void putbits(uint8_t *data, size_t datalen, size_t bit_idx, size_t bit_count, int bits);
 void shiftbits(uint8_t *data, size_t datatlen, size_t left_shift);
 
+//Sequential MSB first bit cursor over a byte buffer.  Bits move through a 
+//64-bit accumulator so that the buffer is touched a byte at a time rather 
+//than a bit at a time.  Reads past the end return zeros (like getbits).  
+//Writes overwrite whole bytes (unlike putbits), and a stream set up with 
+//bitstream_init_alloc owns its buffer and grows it as bytes are written.
+//
+//A stream can also keep a signed confidence for every bit written (soft, 
+//positive for a one, BITSTREAM_SOFT_MAX for a plain bitstream_write and 0 
+//for the padding added by a flush), lined up with the bits in data.
+typedef struct {
+	uint8_t *data;
+	size_t   datalen;
+	size_t   byte_idx;
+	uint64_t acc;
+	size_t   acc_bits;
+	int      owned;
+	int8_t  *soft;
+	size_t   softalloc;
+	int      softon;
+} bitstream_t;
+
+#define BITSTREAM_SOFT_MAX 127
+
+void bitstream_init(bitstream_t *bs, uint8_t *data, size_t datalen);
+void bitstream_init_alloc(bitstream_t *bs);
+void bitstream_destroy(bitstream_t *bs);
+void bitstream_rewind(bitstream_t *bs);
+int  bitstream_read(bitstream_t *bs, size_t bit_count);
+int  bitstream_write(bitstream_t *bs, size_t bit_count, int bits);
+int  bitstream_write_soft(bitstream_t *bs, size_t bit_count, int bits, const double *llr);
+int  bitstream_drain(bitstream_t *bs);
+int  bitstream_flush(bitstream_t *bs);
+int  bitstream_soft_enable(bitstream_t *bs, int on);
+int  bitstream_soft_output(bitstream_t *bs, int8_t **soft, size_t *softlen);
+void bitstream_soft_demap(const double *metric, size_t metriclen, size_t bit_count, double scale, double *llr);
+
+//Shift register correlator for bit patterns of up to 64 bits that 
+//matches when the last bits seen are within tolerance bit errors
+typedef struct {
+	uint64_t pattern;
+	uint64_t mask;
+	size_t   bits;
+	size_t   tolerance;
+	uint64_t reg;
+	size_t   filled;
+} bitcorr_t;
+
+int  bitcount64(uint64_t x);
+int  bitcorr_set(bitcorr_t *corr, uint8_t *pattern, size_t bits, size_t tolerance);
+void bitcorr_reset(bitcorr_t *corr);
+int  bitcorr_push(bitcorr_t *corr, int bit);
+int  bitcorr_scan(bitcorr_t *corr, uint8_t *data, size_t datalen, size_t *bit_idx);
+
 #endif //__BITOPS_H__
 
 #ifdef BITOPS_IMPLEMENTATION
@@ -73,22 +131,347 @@ void putbits(uint8_t *data, size_t datalen, size_t bit_idx, size_t bit_count, in
 	}
 }
 
+static uint64_t bitops_load64(uint8_t *data) {
+	return ((uint64_t)data[0] << 56) | ((uint64_t)data[1] << 48) |
+	       ((uint64_t)data[2] << 40) | ((uint64_t)data[3] << 32) |
+	       ((uint64_t)data[4] << 24) | ((uint64_t)data[5] << 16) |
+	       ((uint64_t)data[6] <<  8) | ((uint64_t)data[7]);
+}
+
+static void bitops_store64(uint8_t *data, uint64_t word) {
+	size_t i;
+	for( i=0; i<8; i++ ) {
+		data[i] = (uint8_t)(word >> (56-i*8));
+	}
+}
+
 void shiftbits(uint8_t *data, size_t datalen, size_t left_shift) {
+	size_t bytes = left_shift / 8;
+	size_t bits  = left_shift % 8;
+	size_t i;
+	
+	if( !datalen ) { return; }
+	if( bytes >= datalen ) {
+		memset(data,0,datalen);
+		return;
+	}
+	if( bytes ) {
+		memmove(data,data+bytes,datalen-bytes);
+		memset(data+datalen-bytes,0,bytes);
+	}
+	if( bits ) {
+		//Eight bytes at a time, borrowing the top of the byte that follows
+		for( i=0; i+8<datalen; i+=8 ) {
+			bitops_store64(data+i,(bitops_load64(data+i) << bits) | (data[i+8] >> (8-bits)));
+		}
+		for( ; i<datalen-1; i++ ) {
+			data[i] = (data[i] << bits) | (data[i+1] >> (8-bits));
+		}
+		data[i] = data[i] << bits;
+	}
+}
+
+void bitstream_init(bitstream_t *bs, uint8_t *data, size_t datalen) {
+	bs->data = data;
+	bs->datalen = datalen;
+	bs->byte_idx = 0;
+	bs->acc = 0;
+	bs->acc_bits = 0;
+	bs->owned = 0;
+	bs->soft = NULL;
+	bs->softalloc = 0;
+	bs->softon = 0;
+}
+
+void bitstream_init_alloc(bitstream_t *bs) {
+	bitstream_init(bs,NULL,0);
+	bs->owned = 1;
+}
+
+void bitstream_destroy(bitstream_t *bs) {
+	if( bs->owned && bs->data ) { free(bs->data); }
+	if( bs->soft ) { free(bs->soft); }
+	bitstream_init(bs,NULL,0);
+}
+
+void bitstream_rewind(bitstream_t *bs) {
+	//Start over at the front of the buffer, keeping any pending bits
+	if( bs->softon && bs->byte_idx ) {
+		memmove(bs->soft,bs->soft+bs->byte_idx*8,bs->acc_bits);
+	}
+	bs->byte_idx = 0;
+}
+
+int bitstream_read(bitstream_t *bs, size_t bit_count) {
+	//Returns the next bit_count (up to 32) bits
+	int bits;
+	
+	if( bit_count == 0 || bit_count > 32 ) { return 0; }
+	if( bs->acc_bits < bit_count ) {
+		if( bs->acc_bits == 0 && bs->byte_idx+8 <= bs->datalen ) {
+			bs->acc = bitops_load64(bs->data+bs->byte_idx);
+			bs->byte_idx = bs->byte_idx + 8;
+			bs->acc_bits = 64;
+		}
+		else {
+			while( bs->acc_bits <= 56 ) {
+				if( bs->byte_idx < bs->datalen ) {
+					bs->acc = bs->acc | ((uint64_t)bs->data[bs->byte_idx] << (56-bs->acc_bits));
+				}
+				bs->byte_idx++;
+				bs->acc_bits = bs->acc_bits + 8;
+			}
+		}
+	}
+	bits = (int)(bs->acc >> (64-bit_count));
+	bs->acc = bs->acc << bit_count;
+	bs->acc_bits = bs->acc_bits - bit_count;
+	return bits;
+}
+
+static int bitstream_soft_reserve(bitstream_t *bs, size_t len) {
+	int8_t *tmp;
+	size_t  alloc;
+	
+	if( len > bs->softalloc ) {
+		alloc = bs->softalloc ? bs->softalloc : 512;
+		while( alloc < len ) {
+			alloc = alloc*2;
+		}
+		tmp = (int8_t*)realloc(bs->soft,alloc);
+		if( !tmp ) { return -1; }
+		bs->soft = tmp;
+		bs->softalloc = alloc;
+	}
+	return 0;
+}
+
+static int bitstream_soft_put(bitstream_t *bs, size_t bit_count, int bits, const double *llr) {
+	//Records the confidence of the bit_count bits about to be added to the 
+	//accumulator.  The sign always follows the bit that was written.
+	size_t pos = bs->byte_idx*8 + bs->acc_bits;
+	size_t i;
+	double v;
+	
+	if( bitstream_soft_reserve(bs,pos+bit_count) ) { return -1; }
+	for( i=0; i<bit_count; i++ ) {
+		v = BITSTREAM_SOFT_MAX;
+		if( llr ) {
+			v = fabs(llr[i])*BITSTREAM_SOFT_MAX;
+			if( v > BITSTREAM_SOFT_MAX ) { v = BITSTREAM_SOFT_MAX; }
+		}
+		if( (bits >> (bit_count-i-1)) & 1 ) {
+			bs->soft[pos+i] = (int8_t)(v+0.5);
+		}
+		else {
+			bs->soft[pos+i] = (int8_t)-(v+0.5);
+		}
+	}
+	return 0;
+}
+
+int bitstream_write(bitstream_t *bs, size_t bit_count, int bits) {
+	//Appends the low bit_count (up to 32) bits of bits.  Whole bytes are 
+	//only moved to the buffer once the accumulator fills up or on a drain.
+	return bitstream_write_soft(bs,bit_count,bits,NULL);
+}
+
+int bitstream_write_soft(bitstream_t *bs, size_t bit_count, int bits, const double *llr) {
+	//Same as bitstream_write, with a confidence for each bit (MSB first, 
+	//1.0 being certain) kept when soft output is on.  Only the magnitude 
+	//of llr is used; the bits written are always the hard decision.
+	int rtn = 0;
+	
+	if( bit_count == 0 ) { return 0; }
+	if( bit_count > 32 ) { return -1; }
+	if( bs->acc_bits+bit_count > 64 ) {
+		rtn = bitstream_drain(bs);
+	}
+	if( bs->softon ) {
+		if( bitstream_soft_put(bs,bit_count,bits,llr) ) { rtn = -1; }
+	}
+	bs->acc = bs->acc | (((uint64_t)bits & ((1ULL << bit_count)-1)) << (64-bs->acc_bits-bit_count));
+	bs->acc_bits = bs->acc_bits + bit_count;
+	return rtn;
+}
+
+int bitstream_drain(bitstream_t *bs) {
+	//Moves all of the whole bytes out of the accumulator.  Returns -1 if 
+	//they did not fit (or the buffer could not grow); they are dropped.
+	uint8_t *tmp;
+	size_t bytes = bs->acc_bits / 8;
+	size_t alloc;
 	size_t i;
-	while( left_shift >= 8 ) {
-		for( i=0; i<datalen-1; i++ ) {
-			data[i] = data[i+1];
+	int rtn = 0;
+	
+	if( bs->byte_idx+bytes > bs->datalen && bs->owned ) {
+		alloc = bs->datalen ? bs->datalen : 64;
+		while( alloc < bs->byte_idx+bytes ) {
+			alloc = alloc*2;
+		}
+		tmp = (uint8_t*)realloc(bs->data,alloc);
+		if( tmp ) {
+			bs->data = tmp;
+			bs->datalen = alloc;
 		}
-		data[datalen-1] = 0;
-		left_shift = left_shift-8;
 	}
-	if( left_shift ) {
-		for( i=0; i<datalen-1; i++ ) {
-			data[i] = data[i] << left_shift;
-			data[i] = data[i] | (data[i+1] >> (8-left_shift));
+	for( i=0; i<bytes; i++ ) {
+		if( bs->byte_idx < bs->datalen ) {
+			bs->data[bs->byte_idx++] = (uint8_t)(bs->acc >> 56);
+		}
+		else {
+			rtn = -1;
+		}
+		bs->acc = bs->acc << 8;
+	}
+	bs->acc_bits = bs->acc_bits - bytes*8;
+	return rtn;
+}
+
+int bitstream_flush(bitstream_t *bs) {
+	//Drains the accumulator, padding a trailing partial byte with zeros 
+	//(which carry no confidence at all)
+	size_t pad;
+	
+	if( bs->acc_bits % 8 ) {
+		pad = 8 - bs->acc_bits%8;
+		if( bs->softon ) {
+			if( bitstream_soft_reserve(bs,bs->byte_idx*8+bs->acc_bits+pad) ) { return -1; }
+			memset(bs->soft+bs->byte_idx*8+bs->acc_bits,0,pad);
+		}
+		bs->acc_bits = bs->acc_bits + pad;
+	}
+	return bitstream_drain(bs);
+}
+
+int bitstream_soft_enable(bitstream_t *bs, int on) {
+	//Starts (or stops) keeping a confidence for each bit written.  Bits 
+	//written before soft output was turned on have a confidence of 0.
+	size_t len;
+	
+	if( !bs ) { return -1; }
+	if( on && !bs->softon ) {
+		len = bs->byte_idx*8 + bs->acc_bits;
+		if( bitstream_soft_reserve(bs,len) ) { return -1; }
+		if( len ) { memset(bs->soft,0,len); }
+	}
+	bs->softon = on ? 1 : 0;
+	return 0;
+}
+
+int bitstream_soft_output(bitstream_t *bs, int8_t **soft, size_t *softlen) {
+	//The confidences of the bits in data[0..byte_idx), one per bit
+	if( !bs ) { return -1; }
+	if( !soft ) { return -1; }
+	if( !softlen ) { return -1; }
+	if( !bs->softon ) { return -1; }
+	*soft = bs->soft;
+	*softlen = bs->byte_idx*8;
+	return 0;
+}
+
+void bitstream_soft_demap(const double *metric, size_t metriclen, size_t bit_count, double scale, double *llr) {
+	//Max-log bit confidences from a metric per symbol (larger meaning more 
+	//likely, such as tone magnitudes), symbol i carrying the bit_count bits 
+	//of i MSB first.  Each is the gap between the best symbol with the bit 
+	//set and the best with it clear, over scale (the gap a clean symbol 
+	//has to its nearest neighbour).
+	double best0, best1;
+	size_t i, b;
+	
+	for( b=0; b<bit_count; b++ ) {
+		best0 = -HUGE_VAL;
+		best1 = -HUGE_VAL;
+		for( i=0; i<metriclen; i++ ) {
+			if( (i >> (bit_count-b-1)) & 1 ) {
+				if( metric[i] > best1 ) { best1 = metric[i]; }
+			}
+			else if( metric[i] > best0 ) {
+				best0 = metric[i];
+			}
+		}
+		if( best0 == -HUGE_VAL || best1 == -HUGE_VAL ) {
+			//Only one value of this bit is ever sent
+			llr[b] = 1.0;
+		}
+		else {
+			llr[b] = scale > 0.0 ? (best1-best0)/scale : 0.0;
+		}
+	}
+}
+
+int bitcount64(uint64_t x) {
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+int bitcorr_set(bitcorr_t *corr, uint8_t *pattern, size_t bits, size_t tolerance) {
+	size_t i;
+	
+	if( !corr ) { return -1; }
+	if( !pattern ) { return -1; }
+	if( bits == 0 || bits > 64 ) { return -1; }
+	if( tolerance >= bits ) { return -1; }
+	
+	corr->pattern = 0;
+	for( i=0; i<bits; i++ ) {
+		corr->pattern = (corr->pattern << 1) | getbits(pattern,(bits+7)/8,i,1);
+	}
+	corr->mask = bits == 64 ? ~0ULL : ((1ULL << bits)-1);
+	corr->bits = bits;
+	corr->tolerance = tolerance;
+	bitcorr_reset(corr);
+	return 0;
+}
+
+void bitcorr_reset(bitcorr_t *corr) {
+	corr->reg = 0;
+	corr->filled = 0;
+}
+
+int bitcorr_push(bitcorr_t *corr, int bit) {
+	corr->reg = (corr->reg << 1) | (bit & 1);
+	if( corr->filled < corr->bits ) {
+		corr->filled++;
+		if( corr->filled < corr->bits ) { return 0; }
+	}
+	return bitcount64((corr->reg ^ corr->pattern) & corr->mask) <= corr->tolerance;
+}
+
+int bitcorr_scan(bitcorr_t *corr, uint8_t *data, size_t datalen, size_t *bit_idx) {
+	//Push bits from *bit_idx until the pattern matches (returns 1 with 
+	//*bit_idx just past the matching bit) or the data runs out (returns 0).
+	//Whole bytes are handled by checking all eight windows that end inside 
+	//the byte straight from the register, without shifting bit by bit.
+	uint64_t win;
+	uint8_t byte;
+	size_t k;
+	
+	while( *bit_idx < datalen*8 ) {
+		if( *bit_idx % 8 == 0 && corr->filled >= corr->bits ) {
+			byte = data[*bit_idx/8];
+			for( k=1; k<=8; k++ ) {
+				win = (corr->reg << k) | (byte >> (8-k));
+				if( bitcount64((win ^ corr->pattern) & corr->mask) <= corr->tolerance ) {
+					corr->reg = win;
+					*bit_idx = *bit_idx + k;
+					return 1;
+				}
+			}
+			corr->reg = (corr->reg << 8) | byte;
+			*bit_idx = *bit_idx + 8;
+		}
+		else {
+			if( bitcorr_push(corr,getbits(data,datalen,*bit_idx,1)) ) {
+				*bit_idx = *bit_idx + 1;
+				return 1;
+			}
+			*bit_idx = *bit_idx + 1;
 		}
-		data[i] = data[i] << left_shift;
 	}
+	return 0;
 }
 
 #endif //BITOPS_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __CHAN_H__
+#define __CHAN_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fftw3.h>
+
+//Polyphase DFT filter-bank channelizer.  The band from DC to samplerate/2 
+//is split into channel_count sub-bands of width samplerate/(2*channel_count).
+//chan_split turns wideband samples into one real signal per sub-band at 
+//samplerate/channel_count, with the sub-band moved down to DC, so that an 
+//ordinary modem (initialized with chan_samplerate and chan_bandwidth) can 
+//demodulate it.  chan_combine does the reverse for modulation.
+//
+//The filter bank has 2*channel_count bins offset by half a bin (so that 
+//channel k covers k*bandwidth to (k+1)*bandwidth) and is decimated by 
+//channel_count, two times oversampled.  Signals should keep a little away 
+//from the edges of their sub-band, where the prototype filter rolls off.
+
+#define CHAN_TAPS_PER_PHASE 32
+
+typedef struct {
+	size_t        samplerate;
+	size_t        channel_count;
+	size_t        bins;
+	size_t        decim;
+	size_t        taps;
+	
+	//Prototype filter with the bin offset and phase signs folded in
+	double       *proto_re;
+	double       *proto_im;
+	
+	//Carrier rotation that makes split and combine pure delays
+	double        rot_re;
+	double        rot_im;
+	
+	fftw_plan     fftplan;
+	fftw_complex *fftin;
+	fftw_complex *fftout;
+	
+	//Analysis (split) state
+	double       *rx_hist;
+	size_t        rx_fill;
+	size_t        rx_frame;
+	double      **rx_out;
+	size_t        rx_outalloc;
+	
+	//Synthesis (combine) state
+	double       *tx_acc;
+	size_t        tx_frame;
+	double       *tx_out;
+	size_t        tx_outalloc;
+} chan_t;
+
+chan_t *chan_init(size_t samplerate, size_t channel_count);
+void    chan_destroy(chan_t *chan);
+size_t  chan_samplerate(chan_t *chan);
+size_t  chan_bandwidth(chan_t *chan);
+void    chan_printinfo(chan_t *chan);
+int     chan_split(chan_t *chan, double ***channels, size_t *channelslen, double *samples, size_t sampleslen);
+int     chan_combine(chan_t *chan, double **samples, size_t *sampleslen, double **channels, size_t channelslen);
+
+#endif //__CHAN_H__
+
+#ifdef CHAN_IMPLEMENTATION
+#undef CHAN_IMPLEMENTATION
+
+#include <stdio.h>
+#include <math.h>
+
+chan_t *chan_init(size_t samplerate, size_t channel_count) {
+	chan_t *chan = 0;
+	double sum;
+	double x;
+	double w;
+	double h;
+	size_t len;
+	size_t l;
+	
+	if( channel_count < 2 ) { goto chan_init_error; }
+	if( samplerate % (channel_count*2) ) { goto chan_init_error; }
+	
+	chan = (chan_t*)malloc(sizeof(chan_t));
+	if( !chan ) { goto chan_init_error; }
+	memset(chan,0,sizeof(chan_t));
+	
+	chan->samplerate = samplerate;
+	chan->channel_count = channel_count;
+	chan->bins = channel_count*2;
+	chan->decim = channel_count;
+	chan->taps = chan->bins*CHAN_TAPS_PER_PHASE;
+	
+	chan->proto_re = (double*)malloc(sizeof(double)*chan->taps);
+	if( !chan->proto_re ) { goto chan_init_error; }
+	chan->proto_im = (double*)malloc(sizeof(double)*chan->taps);
+	if( !chan->proto_im ) { goto chan_init_error; }
+	
+	//Blackman windowed sinc low pass with a cutoff of half a bin.  It is 
+	//decim-1 taps short of the full length so that a split after a 
+	//combine delays the channels by a whole number of channel samples.
+	len = chan->taps-chan->decim+1;
+	sum = 0.0;
+	for( l=0; l<chan->taps; l++ ) {
+		h = 0.0;
+		w = 0.0;
+		if( l < len ) {
+			x = (double)l - (double)(len-1)/2.0;
+			w = 0.42 - 0.5*cos(2*M_PI*l/(len-1)) + 0.08*cos(4*M_PI*l/(len-1));
+			if( x == 0.0 ) {
+				h = 1.0/chan->bins;
+			}
+			else {
+				h = sin(M_PI*x/chan->bins)/(M_PI*x);
+			}
+		}
+		chan->proto_re[l] = h*w;
+		sum = sum + h*w;
+	}
+	for( l=0; l<chan->taps; l++ ) {
+		//Normalize to unity gain, then rotate by the half bin offset.  The 
+		//whole bin part of the offset flips the sign of every other phase.
+		h = chan->proto_re[l] / sum;
+		if( (l/chan->bins) & 1 ) {
+			h = -h;
+		}
+		chan->proto_re[l] = h*cos(M_PI*(double)(l%chan->bins)/(double)chan->bins);
+		chan->proto_im[l] = h*sin(M_PI*(double)(l%chan->bins)/(double)chan->bins);
+	}
+	
+	//The prototype delays by (len-1)/2 input samples, but the channel 
+	//carriers are referenced to absolute time.  Rotating by the carrier 
+	//phase of that delay keeps each side a pure delay.
+	w = -M_PI*(double)(len-1)/(double)(4*chan->decim);
+	chan->rot_re = cos(w);
+	chan->rot_im = sin(w);
+	
+	chan->fftin = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*chan->bins);
+	if( !chan->fftin ) { goto chan_init_error; }
+	chan->fftout = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*chan->bins);
+	if( !chan->fftout ) { goto chan_init_error; }
+	chan->fftplan = fftw_plan_dft_1d(chan->bins,chan->fftin,chan->fftout,FFTW_BACKWARD,FFTW_MEASURE);
+	if( !chan->fftplan ) { goto chan_init_error; }
+	
+	chan->rx_hist = (double*)malloc(sizeof(double)*chan->taps);
+	if( !chan->rx_hist ) { goto chan_init_error; }
+	memset(chan->rx_hist,0,sizeof(double)*chan->taps);
+	//Frames fall on input samples 0, decim, 2*decim, ... so that the 
+	//channel phases line up with the combiner's
+	chan->rx_fill = chan->decim-1;
+	chan->rx_out = (double**)malloc(sizeof(double*)*channel_count);
+	if( !chan->rx_out ) { goto chan_init_error; }
+	memset(chan->rx_out,0,sizeof(double*)*channel_count);
+	
+	chan->tx_acc = (double*)malloc(sizeof(double)*chan->taps);
+	if( !chan->tx_acc ) { goto chan_init_error; }
+	memset(chan->tx_acc,0,sizeof(double)*chan->taps);
+	
+	return chan;
+	
+	chan_init_error:
+	chan_destroy(chan);
+	return 0;
+}
+
+void chan_destroy(chan_t *chan) {
+	size_t k;
+	
+	if( chan ) {
+		if( chan->proto_re ) { free(chan->proto_re); }
+		if( chan->proto_im ) { free(chan->proto_im); }
+		if( chan->fftplan ) { fftw_destroy_plan(chan->fftplan); }
+		if( chan->fftin ) { fftw_free(chan->fftin); }
+		if( chan->fftout ) { fftw_free(chan->fftout); }
+		if( chan->rx_hist ) { free(chan->rx_hist); }
+		if( chan->rx_out ) {
+			for( k=0; k<chan->channel_count; k++ ) {
+				if( chan->rx_out[k] ) { free(chan->rx_out[k]); }
+			}
+			free(chan->rx_out);
+		}
+		if( chan->tx_acc ) { free(chan->tx_acc); }
+		if( chan->tx_out ) { free(chan->tx_out); }
+		memset(chan,0,sizeof(chan_t));
+		free(chan);
+	}
+}
+
+size_t chan_samplerate(chan_t *chan) {
+	//Samplerate of each channel's signal
+	return chan->samplerate / chan->decim;
+}
+
+size_t chan_bandwidth(chan_t *chan) {
+	//Width of each sub-band
+	return chan->samplerate / chan->bins;
+}
+
+void chan_printinfo(chan_t *chan) {
+	size_t k;
+	
+	if( chan ) {
+		printf("Channelizer\n");
+		printf("  Samplerate: %zu\n",chan->samplerate);
+		printf("  Channels: %zu x %zu Hz at %zu samples/sec\n",chan->channel_count,chan_bandwidth(chan),chan_samplerate(chan));
+		printf("  Filter taps: %zu\n",chan->taps);
+		for( k=0; k<chan->channel_count; k++ ) {
+			printf("    [%zu] %zu - %zu Hz\n",k,k*chan_bandwidth(chan),(k+1)*chan_bandwidth(chan));
+		}
+	}
+}
+
+static int chan_reserve(double **buf, size_t *alloc, size_t len) {
+	double *tmp;
+	
+	if( *alloc >= len ) { return 0; }
+	tmp = (double*)realloc(*buf,sizeof(double)*len);
+	if( !tmp ) { return -1; }
+	*buf = tmp;
+	*alloc = len;
+	return 0;
+}
+
+int chan_split(chan_t *chan, double ***channels, size_t *channelslen, double *samples, size_t sampleslen) {
+	//channels[k] gets channelslen samples of channel k (valid until the 
+	//next call).  Leftover input samples are kept for the next call.
+	size_t outlen;
+	size_t alloc;
+	size_t ii;
+	size_t k;
+	size_t l;
+	size_t r;
+	double re;
+	double im;
+	double x;
+	
+	if( !chan ) { return -1; }
+	if( !channels ) { return -1; }
+	if( !channelslen ) { return -1; }
+	if( !samples && sampleslen ) { return -1; }
+	
+	outlen = (chan->rx_fill+sampleslen)/chan->decim;
+	if( outlen > chan->rx_outalloc ) {
+		for( k=0; k<chan->channel_count; k++ ) {
+			alloc = chan->rx_outalloc;
+			if( chan_reserve(&chan->rx_out[k],&alloc,outlen) ) { return -1; }
+		}
+		chan->rx_outalloc = outlen;
+	}
+	
+	outlen = 0;
+	for( ii=0; ii<sampleslen; ii++ ) {
+		//Newest sample goes at the end of the history
+		chan->rx_hist[chan->taps-chan->decim+chan->rx_fill] = samples[ii];
+		chan->rx_fill++;
+		if( chan->rx_fill < chan->decim ) {
+			continue;
+		}
+		chan->rx_fill = 0;
+		
+		//Fold the history through the prototype into one block per bin
+		for( r=0; r<chan->bins; r++ ) {
+			re = 0.0;
+			im = 0.0;
+			for( l=r; l<chan->taps; l+=chan->bins ) {
+				x = chan->rx_hist[chan->taps-1-l];
+				re = re + chan->proto_re[l]*x;
+				im = im + chan->proto_im[l]*x;
+			}
+			chan->fftin[r][0] = re;
+			chan->fftin[r][1] = im;
+		}
+		fftw_execute(chan->fftplan);
+		
+		//With half rate decimation the remaining phase rotation per frame 
+		//is a sign flip for odd channels, plus a quarter turn that moves 
+		//the channel center to bandwidth/2 when taking the real part.
+		for( k=0; k<chan->channel_count; k++ ) {
+			x = 2.0*(chan->fftout[k][0]*chan->rot_re - chan->fftout[k][1]*chan->rot_im);
+			if( (k & chan->rx_frame) & 1 ) {
+				x = -x;
+			}
+			chan->rx_out[k][outlen] = x;
+		}
+		outlen++;
+		chan->rx_frame++;
+		
+		memmove(chan->rx_hist,chan->rx_hist+chan->decim,sizeof(double)*(chan->taps-chan->decim));
+	}
+	
+	*channels = chan->rx_out;
+	*channelslen = outlen;
+	return 0;
+}
+
+int chan_combine(chan_t *chan, double **samples, size_t *sampleslen, double **channels, size_t channelslen) {
+	//channels[k] holds channelslen samples for channel k (or is NULL for 
+	//a silent channel).  Produces channelslen*channel_count samples; the 
+	//filter tail is carried over into the next call.
+	size_t outlen;
+	size_t m;
+	size_t k;
+	size_t l;
+	size_t r;
+	double gain;
+	double x;
+	
+	if( !chan ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !channels ) { return -1; }
+	
+	outlen = channelslen*chan->decim;
+	if( chan_reserve(&chan->tx_out,&chan->tx_outalloc,outlen) ) { return -1; }
+	
+	//Undo the zero stuffing loss and the real part halving
+	gain = 2.0*chan->decim;
+	for( m=0; m<channelslen; m++ ) {
+		for( k=0; k<chan->bins; k++ ) {
+			x = 0.0;
+			if( k < chan->channel_count && channels[k] ) {
+				x = channels[k][m];
+				if( (k & chan->tx_frame) & 1 ) {
+					x = -x;
+				}
+			}
+			chan->fftin[k][0] = x*chan->rot_re;
+			chan->fftin[k][1] = x*chan->rot_im;
+		}
+		fftw_execute(chan->fftplan);
+		
+		for( l=0; l<chan->taps; l++ ) {
+			r = l % chan->bins;
+			chan->tx_acc[l] = chan->tx_acc[l] + gain*(chan->proto_re[l]*chan->fftout[r][0] - 
+			                                          chan->proto_im[l]*chan->fftout[r][1]);
+		}
+		memcpy(chan->tx_out+m*chan->decim,chan->tx_acc,sizeof(double)*chan->decim);
+		memmove(chan->tx_acc,chan->tx_acc+chan->decim,sizeof(double)*(chan->taps-chan->decim));
+		memset(chan->tx_acc+chan->taps-chan->decim,0,sizeof(double)*chan->decim);
+		chan->tx_frame++;
+	}
+	
+	*samples = chan->tx_out;
+	*sampleslen = outlen;
+	return 0;
+}
+
+#endif //CHAN_IMPLEMENTATION
\ No newline at end of file
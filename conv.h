@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __CONV_H__
+#define __CONV_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitops.h"
+
+//Rate 1/2, constraint length 7 code (generators 171,133 octal)
+#define CONV_K          7
+#define CONV_STATES     64
+#define CONV_POLY_0     0x79
+#define CONV_POLY_1     0x5B
+
+typedef enum {
+	CONV_RATE_1_2,
+	CONV_RATE_2_3,
+	CONV_RATE_3_4,
+} conv_rate_t;
+
+typedef struct {
+	uint8_t   outputs[1<<CONV_K];
+	uint64_t *decisions;
+	size_t    decisionsalloc;
+} conv_t;
+
+conv_t *conv_init();
+void    conv_destroy(conv_t *conv);
+size_t  conv_coded_bits(conv_rate_t rate, size_t data_bits);
+int     conv_encode(conv_rate_t rate, uint8_t *coded, size_t codedlen, uint8_t *data, size_t datalen);
+int     conv_decode(conv_t *conv, conv_rate_t rate, uint8_t *data, size_t datalen, int8_t *coded, size_t codedlen);
+
+#endif //__CONV_H__
+
+#ifdef CONV_IMPLEMENTATION
+#undef CONV_IMPLEMENTATION
+
+//Puncturing patterns, read as pairs of (output 0, output 1) per input bit
+static const uint8_t conv_punct_1_2[] = { 1,1 };
+static const uint8_t conv_punct_2_3[] = { 1,1, 1,0 };
+static const uint8_t conv_punct_3_4[] = { 1,1, 1,0, 0,1 };
+
+static void conv_pattern(conv_rate_t rate, const uint8_t **pattern, size_t *patternlen) {
+	if( rate == CONV_RATE_2_3 ) {
+		*pattern = conv_punct_2_3;
+		*patternlen = sizeof(conv_punct_2_3);
+	}
+	else if( rate == CONV_RATE_3_4 ) {
+		*pattern = conv_punct_3_4;
+		*patternlen = sizeof(conv_punct_3_4);
+	}
+	else {
+		*pattern = conv_punct_1_2;
+		*patternlen = sizeof(conv_punct_1_2);
+	}
+}
+
+static int conv_parity(unsigned int x) {
+	x = x ^ (x >> 4);
+	x = x ^ (x >> 2);
+	x = x ^ (x >> 1);
+	return x & 1;
+}
+
+conv_t *conv_init() {
+	conv_t *conv;
+	unsigned int i;
+	
+	conv = (conv_t*)malloc(sizeof(conv_t));
+	if( !conv ) { return 0; }
+	memset(conv,0,sizeof(conv_t));
+	
+	//Encoder output pair for every value of the shift register
+	for( i=0; i<(1<<CONV_K); i++ ) {
+		conv->outputs[i] = (conv_parity(i & CONV_POLY_0) << 1) | conv_parity(i & CONV_POLY_1);
+	}
+	return conv;
+}
+
+void conv_destroy(conv_t *conv) {
+	if( conv ) {
+		if( conv->decisions ) { free(conv->decisions); }
+		memset(conv,0,sizeof(conv_t));
+		free(conv);
+	}
+}
+
+size_t conv_coded_bits(conv_rate_t rate, size_t data_bits) {
+	const uint8_t *pattern;
+	size_t patternlen;
+	size_t i;
+	size_t coded_bits = 0;
+	
+	//The encoder is flushed with K-1 zero bits, so the
+	//decoder always finishes in state 0
+	conv_pattern(rate,&pattern,&patternlen);
+	for( i=0; i<(data_bits+CONV_K-1)*2; i++ ) {
+		coded_bits = coded_bits + pattern[i%patternlen];
+	}
+	return coded_bits;
+}
+
+int conv_encode(conv_rate_t rate, uint8_t *coded, size_t codedlen, uint8_t *data, size_t datalen) {
+	const uint8_t *pattern;
+	size_t patternlen;
+	size_t i;
+	bitstream_t in;
+	bitstream_t out;
+	size_t punct;
+	unsigned int reg;
+	int bit;
+	
+	if( !coded ) { return -1; }
+	if( !data && datalen ) { return -1; }
+	if( codedlen*8 < conv_coded_bits(rate,datalen*8) ) { return -1; }
+	
+	conv_pattern(rate,&pattern,&patternlen);
+	
+	bitstream_init(&in,data,datalen);
+	bitstream_init(&out,coded,codedlen);
+	reg = 0;
+	punct = 0;
+	for( i=0; i<datalen*8+CONV_K-1; i++ ) {
+		//Reads past the end give the zero tail bits
+		bit = bitstream_read(&in,1);
+		reg = ((reg << 1) | bit) & ((1<<CONV_K)-1);
+		if( pattern[punct++] ) {
+			bitstream_write(&out,1,conv_parity(reg & CONV_POLY_0));
+		}
+		if( pattern[punct++] ) {
+			bitstream_write(&out,1,conv_parity(reg & CONV_POLY_1));
+		}
+		if( punct >= patternlen ) { punct = 0; }
+	}
+	bitstream_flush(&out);
+	memset(coded+out.byte_idx,0,codedlen-out.byte_idx);
+	return 0;
+}
+
+int conv_decode(conv_t *conv, conv_rate_t rate, uint8_t *data, size_t datalen, int8_t *coded, size_t codedlen) {
+	const uint8_t *pattern;
+	size_t patternlen;
+	size_t steps;
+	size_t step;
+	size_t src;
+	size_t punct;
+	size_t i;
+	int32_t metric[CONV_STATES];
+	int32_t next[CONV_STATES];
+	int32_t branch[4];
+	int32_t m0,m1;
+	int8_t  r0,r1;
+	uint64_t dec;
+	unsigned int state;
+	unsigned int ns;
+	void *tmp;
+	
+	if( !conv ) { return -1; }
+	if( !data && datalen ) { return -1; }
+	if( !coded && codedlen ) { return -1; }
+	if( codedlen < conv_coded_bits(rate,datalen*8) ) { return -1; }
+	
+	steps = datalen*8 + CONV_K-1;
+	if( conv->decisionsalloc < steps ) {
+		tmp = realloc(conv->decisions,sizeof(uint64_t)*steps);
+		if( !tmp ) { return -1; }
+		conv->decisions = (uint64_t*)tmp;
+		conv->decisionsalloc = steps;
+	}
+	
+	conv_pattern(rate,&pattern,&patternlen);
+	
+	//Always start in state 0
+	for( i=0; i<CONV_STATES; i++ ) {
+		metric[i] = -0x10000000;
+	}
+	metric[0] = 0;
+	
+	src = 0;
+	punct = 0;
+	for( step=0; step<steps; step++ ) {
+		//Depuncture (missing symbols are erasures with no weight)
+		r0 = 0;
+		r1 = 0;
+		if( pattern[punct++] ) { r0 = coded[src++]; }
+		if( pattern[punct++] ) { r1 = coded[src++]; }
+		if( punct >= patternlen ) { punct = 0; }
+		
+		//Correlation metric for each of the four possible output pairs
+		branch[0] = -r0 - r1;
+		branch[1] = -r0 + r1;
+		branch[2] =  r0 - r1;
+		branch[3] =  r0 + r1;
+		
+		//Add-Compare-Select over all of the butterflies.  The loop body
+		//is branch free with fixed strides so that the compiler can
+		//vectorize it.
+		dec = 0;
+		for( ns=0; ns<CONV_STATES; ns++ ) {
+			m0 = metric[ns>>1]                    + branch[conv->outputs[ns]];
+			m1 = metric[(ns>>1)|(CONV_STATES>>1)] + branch[conv->outputs[ns|CONV_STATES]];
+			next[ns] = m1 > m0 ? m1 : m0;
+			dec = dec | ((uint64_t)(m1 > m0) << ns);
+		}
+		conv->decisions[step] = dec;
+		
+		//Keep the metrics from drifting out of range
+		m0 = next[0];
+		for( ns=0; ns<CONV_STATES; ns++ ) {
+			metric[ns] = next[ns] - m0;
+		}
+	}
+	
+	//Traceback from state 0 (the tail has flushed the encoder)
+	memset(data,0,datalen);
+	state = 0;
+	for( step=steps; step>0; step-- ) {
+		dec = (conv->decisions[step-1] >> state) & 1;
+		if( step-1 < datalen*8 ) {
+			putbits(data,datalen,step-1,1,state&1);
+		}
+		state = (state >> 1) | ((unsigned int)dec << (CONV_K-2));
+	}
+	return 0;
+}
+
+#endif //CONV_IMPLEMENTATION
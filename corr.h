@@ -30,8 +30,12 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <fftw3.h>
 
 #include "bitops.h"
+#include "symsync.h"
+#include "tcm.h"
 
 #define CORR_DEFAULT_VERBOSE     0
 #define CORR_DEFAULT_THRESH      0.90
@@ -47,6 +51,58 @@ typedef struct {
 	size_t  len;
 } corr_sym_t;
 
+typedef enum{
+	CORR_DSSS_SEARCH,
+	CORR_DSSS_SYNC,
+	CORR_DSSS_HEADER,
+	CORR_DSSS_DATA,
+} corr_dsss_state_t;
+
+//Direct sequence spread spectrum (corr_dsss_init).  The two symbols are 
+//the carrier BPSK modulated by a PN code and its inverse, one code period
+//per bit.  Rather than correlating every sample against both templates, 
+//the receiver finds the code phase with an FFT over one code period and 
+//then follows it with an early-late delay locked loop, correlating once 
+//per chip.  A transmission starts with CORR_DSSS_PREAMBLE_LEN one bits for
+//the acquisition, then the sync word and byte count header of symsync.
+typedef struct {
+	size_t        samplerate;
+	double        frequency;
+	size_t        chips;
+	double       *code;
+	double        samp_per_chip;
+	double        samp_per_bit;
+	double        detect;
+	
+	//Circular correlation of half chips against the code
+	size_t        acq_len;
+	fftw_complex *acq_in;
+	fftw_complex *acq_out;
+	fftw_complex *acq_ref;
+	fftw_plan     acq_fwd;
+	fftw_plan     acq_inv;
+	
+	//Running sums of the mixed down samples, so any chip is one difference
+	double       *sum_re;
+	double       *sum_im;
+	size_t        bufferalloc;
+	size_t        bufferlen;
+	double        mix;
+	
+	corr_dsss_state_t state;
+	double        search;
+	size_t        found;
+	double        found_at;
+	double        symbol;
+	double        phase;
+	double        freq;
+	double        amp;
+	double        sync[SYMSYNC_BARKER_LEN];
+	size_t        bitcount;
+	uint64_t      header;
+	size_t        bitsleft;
+} corr_dsss_t;
+
 typedef struct {
 	int         verbose;
 	corr_sym_t *symbols;
@@ -62,19 +118,32 @@ typedef struct {
 	size_t      demod_bufferalloc;
 	size_t      demod_bufferoff;
 	
-	uint8_t     demod_bytes[2];
-	uint8_t     demod_bit_count;
-	uint8_t    *demod_data;
-	size_t      demod_datalen;
+	corr_dsss_t *dsss;
+	double     *demod_norm;
+	double     *demod_peak;
+	int         demod_held;
+	double      demod_heldnorm;
+	size_t      demod_heldoff;
+	size_t      demod_heldage;
+	
+	int         tcm;
+	tcm_t       demod_tcm;
+	size_t      demod_idle;
+	bitstream_t demod_bits;
 } corr_t;
 
 
 corr_t *corr_init(corr_sym_t *symbols, size_t symbol_count);
 corr_t *corr_fsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone_count);
 corr_t *corr_psk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count);
+corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count);
+corr_t *corr_fpsk_tcm_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count);
+corr_t *corr_dsss_init(size_t samplerate, size_t bitrate, double frequency, size_t chip_count);
 void   corr_destroy(corr_t *modem);
 int    corr_set_thresh(corr_t *modem, double thresh);
 int    corr_set_verbose(corr_t *modem, int verbose);
+int    corr_set_soft(corr_t *modem, int on);
+int    corr_soft(corr_t *modem, int8_t **soft, size_t *softlen);
 void   corr_printinfo(corr_t *modem);
 int    corr_modulate(corr_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
 int    corr_demodulate(corr_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
@@ -87,6 +156,19 @@ int    corr_demodulate(corr_t *modem, uint8_t **data, size_t *datalen, double *s
 
 #define corr_OVERSAMPLE 4
 
+#define CORR_DSSS_PREAMBLE_LEN 16
+//Code periods summed for each acquisition, all within the preamble
+#define CORR_DSSS_ACQ_PERIODS  4
+//Acquisition windows in a row with the same code phase
+#define CORR_DSSS_ACQUIRE_MIN  2
+//Acquisition peak over the average, in multiples of ln(half chips) and
+//of the threshold (noise alone reaches about ln(half chips))
+#define CORR_DSSS_DETECT       2.5
+//Fraction of the early-late timing error corrected every bit
+#define CORR_DSSS_DLL_GAIN     0.1
+//Carrier loop noise bandwidth, times the bitrate
+#define CORR_DSSS_LOOP_BW      0.02
+
 corr_t *corr_init(corr_sym_t *symbols, size_t symbol_count) {
 	corr_t *modem;
 	size_t i;
@@ -98,6 +180,7 @@ corr_t *corr_init(corr_sym_t *symbols, size_t symbol_count) {
 	modem = (corr_t*)malloc(sizeof(corr_t));
 	if( !modem ) { goto corr_init_error; }
 	memset(modem,0,sizeof(corr_t));
+	bitstream_init_alloc(&modem->demod_bits);
 	
 	modem->verbose = CORR_DEFAULT_VERBOSE;
 	modem->symbols = symbols;
@@ -110,6 +193,11 @@ corr_t *corr_init(corr_sym_t *symbols, size_t symbol_count) {
 	
 	modem->symbol_thresh = (double*)malloc(sizeof(double)*modem->symbol_count);
 	if( !modem->symbol_thresh ) { goto corr_init_error; }
+	modem->demod_norm = (double*)malloc(sizeof(double)*modem->symbol_count);
+	if( !modem->demod_norm ) { goto corr_init_error; }
+	modem->demod_peak = (double*)malloc(sizeof(double)*modem->symbol_count);
+	if( !modem->demod_peak ) { goto corr_init_error; }
+	modem->demod_held = -1;
 	
 	if( corr_set_thresh(modem,CORR_DEFAULT_THRESH) ) {
 		goto corr_init_error;
@@ -235,8 +323,14 @@ corr_t *corr_psk_init(size_t samplerate, size_t bitrate, double frequency, size_
 	return 0;
 }
 
-corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
+//The trellis coded (TCM) fpsk mode keeps the templates and symbol rate of
+//the uncoded set half the size, and sends one bit per symbol fewer than 
+//the templates hold (see tcm.h).  Tones are orthogonal and the phases of 
+//a tone are furthest apart, so numbering the phases of a tone every 
+//tone_count symbols puts the opposite phases of a tone in the same subset.
+static corr_t *corr_fpsk_init_mode(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count, int tcm) {
 	corr_sym_t *symbols = 0;
+	corr_t *modem;
 	size_t ii;
 	size_t j,k;
 	size_t bit_per_sym;
@@ -251,7 +345,7 @@ corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size
 	size_t sym;
 		
 	if( samplerate < bandwidth*2 ) { return 0; }
-	if( symbol_count < 2 ) { return 0; }
+	if( symbol_count < (tcm ? 4 : 2) ) { return 0; }
 	
 	symbols = (corr_sym_t*)malloc(sizeof(corr_sym_t)*symbol_count);
 	if( !symbols ) { goto corr_fpsk_init_error; }
@@ -273,7 +367,7 @@ corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size
 	}
 	tone_count = symbol_count / ang_count;
 	
-	sym_freq = ((double)bitrate / (double)bit_per_sym) / 2;
+	sym_freq = ((double)bitrate / (double)(bit_per_sym-tcm)) / 2;
 	samp_per_sym = (double)samplerate / sym_freq;
 	
 	freq_step = bandwidth/tone_count;
@@ -299,7 +393,15 @@ corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size
 		ang = ang + ang_step;
 	}
 	
-	return corr_init(symbols,symbol_count);
+	modem = corr_init(symbols,symbol_count);
+	if( modem && tcm ) {
+		modem->tcm = 1;
+		if( tcm_init(&modem->demod_tcm,symbol_count) ) {
+			corr_destroy(modem);
+			return 0;
+		}
+	}
+	return modem;
 	
 	corr_fpsk_init_error:
 	if( symbols ) { 
@@ -307,13 +409,145 @@ corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size
 	return 0;
 }
 
+corr_t *corr_fpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
+	return corr_fpsk_init_mode(samplerate,bitrate,bandwidth,symbol_count,0);
+}
+
+corr_t *corr_fpsk_tcm_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
+	return corr_fpsk_init_mode(samplerate,bitrate,bandwidth,symbol_count,1);
+}
+
+static void corr_dsss_destroy(corr_dsss_t *dsss) {
+	if( dsss ) {
+		if( dsss->code ) { free(dsss->code); }
+		if( dsss->acq_fwd ) { fftw_destroy_plan(dsss->acq_fwd); }
+		if( dsss->acq_inv ) { fftw_destroy_plan(dsss->acq_inv); }
+		if( dsss->acq_in ) { fftw_free(dsss->acq_in); }
+		if( dsss->acq_out ) { fftw_free(dsss->acq_out); }
+		if( dsss->acq_ref ) { fftw_free(dsss->acq_ref); }
+		if( dsss->sum_re ) { free(dsss->sum_re); }
+		if( dsss->sum_im ) { free(dsss->sum_im); }
+		memset(dsss,0,sizeof(corr_dsss_t));
+		free(dsss);
+	}
+}
+
+corr_t *corr_dsss_init(size_t samplerate, size_t bitrate, double frequency, size_t chip_count) {
+	//Maximal length sequences (Galois feedback masks) for 7 to 1023 chips
+	static const uint32_t masks[] = { 0x6, 0xC, 0x14, 0x30, 0x60, 0xB8, 0x110, 0x240 };
+	corr_sym_t *symbols = 0;
+	corr_dsss_t *dsss = 0;
+	corr_t *modem;
+	size_t degree;
+	size_t ii;
+	size_t j;
+	uint32_t lfsr;
+	
+	if( !bitrate ) { return 0; }
+	
+	dsss = (corr_dsss_t*)malloc(sizeof(corr_dsss_t));
+	if( !dsss ) { goto corr_dsss_init_error; }
+	memset(dsss,0,sizeof(corr_dsss_t));
+	
+	degree = 3;
+	while( ((size_t)1 << degree)-1 < chip_count && degree < 10 ) {
+		degree++;
+	}
+	dsss->chips = ((size_t)1 << degree)-1;
+	dsss->samplerate = samplerate;
+	dsss->frequency = frequency;
+	dsss->samp_per_chip = (double)samplerate / ((double)bitrate*dsss->chips);
+	dsss->samp_per_bit = dsss->samp_per_chip*dsss->chips;
+	if( dsss->samp_per_chip < 2.0 ) { goto corr_dsss_init_error; }
+	if( frequency*2 >= samplerate ) { goto corr_dsss_init_error; }
+	
+	dsss->code = (double*)malloc(sizeof(double)*dsss->chips);
+	if( !dsss->code ) { goto corr_dsss_init_error; }
+	lfsr = 1;
+	for( j=0; j<dsss->chips; j++ ) {
+		dsss->code[j] = (lfsr & 1) ? 1.0 : -1.0;
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & masks[degree-3]);
+	}
+	
+	//Half chip resolution, so the code phase is never more than a quarter
+	//chip off after acquisition
+	dsss->acq_len = 2*dsss->chips;
+	dsss->acq_in = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*dsss->acq_len);
+	if( !dsss->acq_in ) { goto corr_dsss_init_error; }
+	dsss->acq_out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*dsss->acq_len);
+	if( !dsss->acq_out ) { goto corr_dsss_init_error; }
+	dsss->acq_ref = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*dsss->acq_len);
+	if( !dsss->acq_ref ) { goto corr_dsss_init_error; }
+	dsss->acq_fwd = fftw_plan_dft_1d(dsss->acq_len,dsss->acq_in,dsss->acq_out,FFTW_FORWARD,FFTW_MEASURE);
+	if( !dsss->acq_fwd ) { goto corr_dsss_init_error; }
+	dsss->acq_inv = fftw_plan_dft_1d(dsss->acq_len,dsss->acq_out,dsss->acq_in,FFTW_BACKWARD,FFTW_MEASURE);
+	if( !dsss->acq_inv ) { goto corr_dsss_init_error; }
+	for( j=0; j<dsss->acq_len; j++ ) {
+		dsss->acq_in[j][0] = dsss->code[j/2];
+		dsss->acq_in[j][1] = 0.0;
+	}
+	fftw_execute(dsss->acq_fwd);
+	for( j=0; j<dsss->acq_len; j++ ) {
+		dsss->acq_ref[j][0] = dsss->acq_out[j][0];
+		dsss->acq_ref[j][1] = -dsss->acq_out[j][1];
+	}
+	
+	dsss->bufferalloc = (CORR_DSSS_ACQ_PERIODS+3)*((size_t)ceil(dsss->samp_per_bit)+1);
+	dsss->sum_re = (double*)malloc(sizeof(double)*(dsss->bufferalloc+1));
+	if( !dsss->sum_re ) { goto corr_dsss_init_error; }
+	dsss->sum_im = (double*)malloc(sizeof(double)*(dsss->bufferalloc+1));
+	if( !dsss->sum_im ) { goto corr_dsss_init_error; }
+	dsss->sum_re[0] = 0.0;
+	dsss->sum_im[0] = 0.0;
+	dsss->state = CORR_DSSS_SEARCH;
+	
+	//The templates: bit 0 is the inverted code, bit 1 the code
+	symbols = (corr_sym_t*)malloc(sizeof(corr_sym_t)*2);
+	if( !symbols ) { goto corr_dsss_init_error; }
+	memset(symbols,0,sizeof(corr_sym_t)*2);
+	for( j=0; j<2; j++ ) {
+		symbols[j].len = (size_t)dsss->samp_per_bit;
+		symbols[j].samples = (double*)malloc(sizeof(double)*symbols[j].len);
+		if( !symbols[j].samples ) {
+			goto corr_dsss_init_error;
+		}
+		for( ii=0; ii<symbols[j].len; ii++ ) {
+			symbols[j].samples[ii] = (j ? 1.0 : -1.0) * dsss->code[(size_t)(ii/dsss->samp_per_chip)] *
+			                         sin(2*M_PI*frequency*ii/samplerate);
+		}
+	}
+	
+	modem = corr_init(symbols,2);
+	if( !modem ) { goto corr_dsss_init_error; }
+	modem->dsss = dsss;
+	//Scale the acquisition threshold with the modem's
+	if( corr_set_thresh(modem,CORR_DEFAULT_THRESH) ) {
+		corr_destroy(modem);
+		return 0;
+	}
+	return modem;
+	
+	corr_dsss_init_error:
+	if( symbols ) {
+		if( symbols[0].samples ) { free(symbols[0].samples); }
+		if( symbols[1].samples ) { free(symbols[1].samples); }
+		free(symbols);
+	}
+	corr_dsss_destroy(dsss);
+	return 0;
+}
+
 void corr_destroy(corr_t *modem) {
 	if( modem ) {
 		if( modem->symbols ) { free(modem->symbols); }
 		if( modem->symbol_thresh ) { free(modem->symbol_thresh); }
+		if( modem->demod_norm ) { free(modem->demod_norm); }
+		if( modem->demod_peak ) { free(modem->demod_peak); }
 		if( modem->mod_samples ) { free(modem->mod_samples); }
 		if( modem->demod_buffer ) { free(modem->demod_buffer); }
-		if( modem->demod_data ) { free(modem->demod_data); }
+		corr_dsss_destroy(modem->dsss);
+		tcm_destroy(&modem->demod_tcm);
+		bitstream_destroy(&modem->demod_bits);
 		memset(modem,0,sizeof(corr_t));
 		free(modem);
 	}
@@ -334,6 +568,9 @@ int corr_set_thresh(corr_t *modem, double thresh) {
 		}
 		modem->symbol_thresh[i] = corr * thresh;
 	}
+	if( modem->dsss ) {
+		modem->dsss->detect = CORR_DSSS_DETECT*thresh*log((double)modem->dsss->acq_len);
+	}
 	
 	return 0;
 }
@@ -344,6 +581,16 @@ int corr_set_verbose(corr_t *modem, int verbose) {
 	return 0;
 }
 
+int corr_set_soft(corr_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int corr_soft(corr_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
 void corr_printinfo(corr_t *modem) {
 	size_t i;
 	printf("Generic Corrleation Modem:\n");
@@ -353,17 +600,88 @@ void corr_printinfo(corr_t *modem) {
 	for( i=0; i<modem->symbol_count; i++ ) {
 		printf("    0x%02lx: %zu samples\n",i,modem->symbols[i].len);
 	}
+	if( modem->tcm ) {
+		printf("  Trellis Coded   : %zu bits per symbol\n",modem->bit_per_sym-1);
+	}
+	if( modem->dsss ) {
+		printf("  DSSS Chips      : %zu\n",modem->dsss->chips);
+		printf("  Chip Rate       : %0.1lf\n",modem->dsss->samplerate/modem->dsss->samp_per_chip);
+		printf("  Frequency       : %0.1lf Hz\n",modem->dsss->frequency);
+	}
+}
+
+static int corr_dsss_frame_bit(size_t datalen, uint8_t *data, size_t idx) {
+	//Bit idx of a DSSS transmission
+	if( idx < CORR_DSSS_PREAMBLE_LEN ) {
+		return 1;
+	}
+	idx = idx - CORR_DSSS_PREAMBLE_LEN;
+	if( idx < SYMSYNC_BARKER_LEN ) {
+		return symsync_sync_bit(SYMSYNC_PREAMBLE_LEN+idx);
+	}
+	idx = idx - SYMSYNC_BARKER_LEN;
+	if( idx < SYMSYNC_HEADER_LEN ) {
+		return symsync_header_bit(datalen,idx);
+	}
+	idx = idx - SYMSYNC_HEADER_LEN;
+	return (data[idx/8] >> (7-(idx%8))) & 1;
+}
+
+static int corr_dsss_modulate(corr_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	//Chips are keyed against one continuous carrier, rather than pasting
+	//the templates, so the receiver's carrier loop sees no phase steps
+	corr_dsss_t *dsss = modem->dsss;
+	size_t bitcount;
+	size_t chip;
+	size_t ii;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	int bit;
+	
+	if( !datalen || datalen >= (1 << SYMSYNC_HEADER_BITS) ) { goto corr_dsss_modulate_error; }
+	
+	bitcount = CORR_DSSS_PREAMBLE_LEN + SYMSYNC_BARKER_LEN + SYMSYNC_HEADER_LEN + datalen*8;
+	if( modem->verbose ) {
+		printf("  Bit count: %zu\n",bitcount);
+	}
+	mod_sampleslen = (size_t)ceil(dsss->samp_per_bit*bitcount);
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto corr_dsss_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	
+	for( ii=0; ii<mod_sampleslen; ii++ ) {
+		chip = (size_t)(ii/dsss->samp_per_chip);
+		if( chip >= bitcount*dsss->chips ) {
+			chip = bitcount*dsss->chips-1;
+		}
+		bit = corr_dsss_frame_bit(datalen,data,chip/dsss->chips);
+		mod_samples[ii] = (bit ? 1.0 : -1.0) * dsss->code[chip%dsss->chips] *
+		                  sin(2*M_PI*fmod(dsss->frequency*ii,dsss->samplerate)/dsss->samplerate);
+	}
+	
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+	
+	corr_dsss_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
 }
 
 int corr_modulate(corr_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
 	size_t symbol_idx;
 	size_t symbol_count;
 	int    sym;
-	size_t bit_idx;
+	bitstream_t bits;
 	size_t ii;
 	size_t jj;
 	size_t mod_sampleslen;
 	double *mod_samples;
+	unsigned int state;
 	
 	if( !modem ) { return -1; }
 	if( !samples ) { return -1; }
@@ -377,10 +695,18 @@ int corr_modulate(corr_t *modem, double **samples, size_t *sampleslen, uint8_t *
 			printf("%02x ",data[ii]);
 		}
 	}
+	if( modem->dsss ) {
+		return corr_dsss_modulate(modem,samples,sampleslen,data,datalen);
+	}
 	
-	symbol_count = (datalen*8) / modem->bit_per_sym;
-	if( (datalen*8) % (modem->bit_per_sym) ) {
-		symbol_count++;
+	if( modem->tcm ) {
+		symbol_count = tcm_symbol_count(datalen*8,modem->bit_per_sym);
+	}
+	else {
+		symbol_count = (datalen*8) / modem->bit_per_sym;
+		if( (datalen*8) % (modem->bit_per_sym) ) {
+			symbol_count++;
+		}
 	}
 	
 	if( modem->verbose ) {
@@ -388,15 +714,19 @@ int corr_modulate(corr_t *modem, double **samples, size_t *sampleslen, uint8_t *
 	}
 	
 	ii = 0;
-	bit_idx = 0;
+	state = 0;
+	bitstream_init(&bits, data, datalen);
+	mod_samples = 0;
 	mod_sampleslen = 0;
 	for( symbol_idx=0; symbol_idx<symbol_count; symbol_idx++ ) {
-		//Get the next symbol bits
-		sym = getbits(data, datalen, bit_idx, modem->bit_per_sym);
+		//Get the next symbol bits (reads past the end give the TCM tail)
+		sym = bitstream_read(&bits, modem->bit_per_sym - modem->tcm);
+		if( modem->tcm ) {
+			sym = tcm_encode(&state, modem->bit_per_sym, sym);
+		}
 		if( modem->verbose ) {
 			printf("  Symbol[%zu]=0x%02x modulated to %zu samples\n",symbol_idx,sym,modem->symbols[sym].len);
 		}
-		bit_idx = bit_idx + modem->bit_per_sym;
 		
 		//Allocate enough space for the next symbol
 		mod_sampleslen = mod_sampleslen + modem->symbols[sym].len;
@@ -424,17 +754,296 @@ int corr_modulate(corr_t *modem, double **samples, size_t *sampleslen, uint8_t *
 	return -1;
 }
 
+static void corr_dsss_chips(corr_dsss_t *dsss, double t, double *z) {
+	//Despread one code period starting at buffer position t
+	double t1;
+	size_t c0;
+	size_t c1;
+	size_t g;
+	
+	z[0] = 0.0;
+	z[1] = 0.0;
+	t1 = t;
+	c1 = (size_t)ceil(t1);
+	for( g=0; g<dsss->chips; g++ ) {
+		c0 = c1;
+		t1 = t + (g+1)*dsss->samp_per_chip;
+		c1 = (size_t)ceil(t1);
+		z[0] = z[0] + dsss->code[g]*(dsss->sum_re[c1] - dsss->sum_re[c0]);
+		z[1] = z[1] + dsss->code[g]*(dsss->sum_im[c1] - dsss->sum_im[c0]);
+	}
+}
+
+static int corr_dsss_acquire(corr_dsss_t *dsss, double t, double *start) {
+	//Circular correlation of CORR_DSSS_ACQ_PERIODS code periods of half 
+	//chips at t, folded onto one, against the code for every code phase at
+	//once.  The preamble repeats the same bit, so the periods add up 
+	//coherently while the noise does not
+	double half = dsss->samp_per_chip/2.0;
+	double mag[3];
+	double peak;
+	double avg;
+	double delta;
+	double m;
+	size_t c0;
+	size_t c1;
+	size_t best;
+	size_t n = dsss->acq_len;
+	size_t j;
+	
+	for( j=0; j<n; j++ ) {
+		dsss->acq_in[j][0] = 0.0;
+		dsss->acq_in[j][1] = 0.0;
+	}
+	c1 = (size_t)ceil(t);
+	for( j=0; j<n*CORR_DSSS_ACQ_PERIODS; j++ ) {
+		c0 = c1;
+		c1 = (size_t)ceil(t + (j+1)*half);
+		dsss->acq_in[j%n][0] = dsss->acq_in[j%n][0] + dsss->sum_re[c1] - dsss->sum_re[c0];
+		dsss->acq_in[j%n][1] = dsss->acq_in[j%n][1] + dsss->sum_im[c1] - dsss->sum_im[c0];
+	}
+	fftw_execute(dsss->acq_fwd);
+	for( j=0; j<n; j++ ) {
+		m = dsss->acq_out[j][0];
+		dsss->acq_out[j][0] = m*dsss->acq_ref[j][0] - dsss->acq_out[j][1]*dsss->acq_ref[j][1];
+		dsss->acq_out[j][1] = m*dsss->acq_ref[j][1] + dsss->acq_out[j][1]*dsss->acq_ref[j][0];
+	}
+	fftw_execute(dsss->acq_inv);
+	
+	best = 0;
+	peak = 0.0;
+	avg = 0.0;
+	for( j=0; j<n; j++ ) {
+		m = dsss->acq_in[j][0]*dsss->acq_in[j][0] + dsss->acq_in[j][1]*dsss->acq_in[j][1];
+		avg = avg + m;
+		if( m > peak ) {
+			peak = m;
+			best = j;
+		}
+	}
+	avg = avg / n;
+	if( avg <= 0.0 || peak < dsss->detect*avg ) {
+		return -1;
+	}
+	
+	//Parabolic refinement of the peak between half chips
+	for( j=0; j<3; j++ ) {
+		c0 = (best+n+j-1) % n;
+		mag[j] = sqrt(dsss->acq_in[c0][0]*dsss->acq_in[c0][0] + dsss->acq_in[c0][1]*dsss->acq_in[c0][1]);
+	}
+	delta = 0.0;
+	m = mag[0] - 2*mag[1] + mag[2];
+	if( m < 0.0 ) {
+		delta = 0.5*(mag[0] - mag[2]) / m;
+	}
+	*start = t + (best+delta)*half;
+	return 0;
+}
+
+static int corr_dsss_bit(corr_t *modem, double *z) {
+	//One despread bit through the frame state machine
+	corr_dsss_t *dsss = modem->dsss;
+	double soft;
+	double corr;
+	double err;
+	double kp;
+	double ki;
+	double d[2];
+	size_t datalen;
+	int bit;
+	
+	d[0] = z[0]*cos(dsss->phase) + z[1]*sin(dsss->phase);
+	d[1] = z[1]*cos(dsss->phase) - z[0]*sin(dsss->phase);
+	dsss->amp = 0.9*dsss->amp + 0.1*sqrt(z[0]*z[0] + z[1]*z[1]);
+	if( dsss->amp <= 0.0 ) {
+		dsss->state = CORR_DSSS_SEARCH;
+		return 0;
+	}
+	soft = d[0] / dsss->amp;
+	bit = soft > 0.0;
+	
+	//Decision directed carrier loop
+	err = (bit ? d[1] : -d[1]) / dsss->amp;
+	symsync_loop_gains(CORR_DSSS_LOOP_BW,&kp,&ki);
+	dsss->freq = dsss->freq + ki*err;
+	dsss->phase = fmod(dsss->phase + kp*err + dsss->freq,2*M_PI);
+	dsss->bitcount++;
+	
+	switch( dsss->state ) {
+		case CORR_DSSS_SYNC:
+			//Limited, so a few strong bits cannot make up a sync word
+			corr = symsync_barker_corr(dsss->sync,soft > 1.0 ? 1.0 : (soft < -1.0 ? -1.0 : soft));
+			if( dsss->bitcount >= SYMSYNC_BARKER_LEN && fabs(corr) >= SYMSYNC_SYNC_MIN*SYMSYNC_BARKER_LEN ) {
+				if( modem->verbose ) {
+					printf("  Sync (%0.1lf) after %zu bits\n",corr,dsss->bitcount);
+				}
+				//The carrier phase was taken from the first bit, which
+				//the sync word says was either right or inverted
+				if( corr < 0.0 ) {
+					dsss->phase = dsss->phase + M_PI;
+				}
+				dsss->state = CORR_DSSS_HEADER;
+				dsss->bitcount = 0;
+				dsss->header = 0;
+			}
+			else if( dsss->bitcount > CORR_DSSS_PREAMBLE_LEN + 2*SYMSYNC_BARKER_LEN ) {
+				dsss->state = CORR_DSSS_SEARCH;
+			}
+			break;
+		case CORR_DSSS_HEADER:
+			dsss->header = (dsss->header << 1) | bit;
+			if( dsss->bitcount < SYMSYNC_HEADER_LEN ) {
+				break;
+			}
+			if( symsync_header_check(dsss->header,&datalen) ) {
+				if( modem->verbose ) {
+					printf("  Bad header 0x%012llx\n",(unsigned long long)dsss->header);
+				}
+				dsss->state = CORR_DSSS_SEARCH;
+				break;
+			}
+			if( modem->verbose ) {
+				printf("  Header: %zu bytes\n",datalen);
+			}
+			//Start every frame on a byte boundary
+			if( bitstream_flush(&modem->demod_bits) ) { return -1; }
+			dsss->bitsleft = datalen*8;
+			dsss->state = CORR_DSSS_DATA;
+			break;
+		case CORR_DSSS_DATA:
+			if( bitstream_write_soft(&modem->demod_bits,1,bit,&soft) ) { return -1; }
+			dsss->bitsleft--;
+			if( !dsss->bitsleft ) {
+				dsss->state = CORR_DSSS_SEARCH;
+			}
+			break;
+		default:
+			break;
+	}
+	return 0;
+}
+
+static int corr_dsss_demodulate(corr_t *modem, double *samples, size_t sampleslen) {
+	corr_dsss_t *dsss = modem->dsss;
+	double step = 2*M_PI*dsss->frequency/dsss->samplerate;
+	double half = dsss->samp_per_chip/2.0;
+	double start;
+	double keep;
+	double diff;
+	double p[2];
+	double e[2];
+	double l[2];
+	double ep;
+	double lp;
+	size_t drop;
+	size_t ii;
+	size_t j;
+	
+	ii = 0;
+	while( ii < sampleslen ) {
+		//Make room by dropping everything before what is still needed
+		if( dsss->bufferlen >= dsss->bufferalloc ) {
+			keep = dsss->state == CORR_DSSS_SEARCH ? dsss->search : dsss->symbol - half;
+			drop = keep > 1.0 ? (size_t)floor(keep) - 1 : 0;
+			if( !drop ) {
+				//Should never happen; start over rather than overflow
+				drop = dsss->bufferlen;
+				dsss->state = CORR_DSSS_SEARCH;
+				dsss->search = (double)drop;
+				dsss->found = 0;
+			}
+			for( j=drop; j<=dsss->bufferlen; j++ ) {
+				dsss->sum_re[j-drop] = dsss->sum_re[j] - dsss->sum_re[drop];
+				dsss->sum_im[j-drop] = dsss->sum_im[j] - dsss->sum_im[drop];
+			}
+			dsss->bufferlen = dsss->bufferlen - drop;
+			dsss->search = dsss->search - drop;
+			dsss->symbol = dsss->symbol - drop;
+			dsss->found_at = dsss->found_at - drop;
+		}
+		
+		//Mix down and integrate
+		dsss->sum_re[dsss->bufferlen+1] = dsss->sum_re[dsss->bufferlen] + samples[ii]*cos(dsss->mix);
+		dsss->sum_im[dsss->bufferlen+1] = dsss->sum_im[dsss->bufferlen] - samples[ii]*sin(dsss->mix);
+		dsss->bufferlen++;
+		ii++;
+		dsss->mix = fmod(dsss->mix + step,2*M_PI);
+		
+		if( dsss->state == CORR_DSSS_SEARCH ) {
+			if( dsss->search + CORR_DSSS_ACQ_PERIODS*dsss->samp_per_bit + 1.0 >= dsss->bufferlen ) {
+				continue;
+			}
+			if( corr_dsss_acquire(dsss,dsss->search,&start) ) {
+				dsss->found = 0;
+			}
+			else {
+				//The same code phase has to show up in a row, one period apart
+				diff = fmod(start - dsss->found_at,dsss->samp_per_bit);
+				if( dsss->found && (diff <= half || dsss->samp_per_bit - diff <= half) ) {
+					dsss->found++;
+				}
+				else {
+					dsss->found = 1;
+				}
+				dsss->found_at = start;
+			}
+			dsss->search = dsss->search + dsss->samp_per_bit;
+			if( dsss->found >= CORR_DSSS_ACQUIRE_MIN ) {
+				if( modem->verbose ) {
+					printf("  Code phase found at %0.1lf\n",dsss->found_at);
+				}
+				//Start on the last period of the window, which is well
+				//inside the preamble
+				dsss->symbol = dsss->found_at + (CORR_DSSS_ACQ_PERIODS-1)*dsss->samp_per_bit;
+				dsss->state = CORR_DSSS_SYNC;
+				dsss->bitcount = 0;
+				dsss->found = 0;
+				dsss->freq = 0.0;
+				for( j=0; j<SYMSYNC_BARKER_LEN; j++ ) {
+					dsss->sync[j] = 0.0;
+				}
+			}
+			continue;
+		}
+		
+		if( dsss->symbol + dsss->samp_per_bit + half + 1.0 >= dsss->bufferlen ) {
+			continue;
+		}
+		corr_dsss_chips(dsss,dsss->symbol,p);
+		corr_dsss_chips(dsss,dsss->symbol-half,e);
+		corr_dsss_chips(dsss,dsss->symbol+half,l);
+		if( dsss->state == CORR_DSSS_SYNC && !dsss->bitcount ) {
+			//Lock the carrier to the first bit of the preamble
+			dsss->phase = atan2(p[1],p[0]);
+			dsss->amp = sqrt(p[0]*p[0] + p[1]*p[1]);
+		}
+		if( corr_dsss_bit(modem,p) ) { return -1; }
+		
+		//Early-late delay locked loop
+		ep = sqrt(e[0]*e[0] + e[1]*e[1]);
+		lp = sqrt(l[0]*l[0] + l[1]*l[1]);
+		if( ep + lp > 0.0 ) {
+			dsss->symbol = dsss->symbol + CORR_DSSS_DLL_GAIN*(lp - ep)/(ep + lp)*half;
+		}
+		dsss->symbol = dsss->symbol + dsss->samp_per_bit;
+		if( dsss->state == CORR_DSSS_SEARCH ) {
+			dsss->search = dsss->symbol;
+		}
+	}
+	return 0;
+}
+
 int corr_demodulate(corr_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
 	size_t   ii;
 	size_t   jj;
 	size_t   k;
 	size_t   next;
 	size_t   off;
-	uint8_t *tmpdata;
 	int      sym;
 	double   corr;
 	double   norm;
 	double   maxcorr;
+	double   llr[32];
 	
 	if( !modem ) { return -1; }
 	if( !data ) { return -1; }
@@ -445,7 +1054,12 @@ int corr_demodulate(corr_t *modem, uint8_t **data, size_t *datalen, double *samp
 		printf("corr_demodulate(...)\n");
 	}
 	
-	modem->demod_datalen = 0;
+	bitstream_rewind(&modem->demod_bits);
+	
+	if( modem->dsss ) {
+		if( corr_dsss_demodulate(modem,samples,sampleslen) ) { return -1; }
+		sampleslen = 0;
+	}
 	
 	ii = 0;
 	while( ii < sampleslen ) {
@@ -467,6 +1081,7 @@ int corr_demodulate(corr_t *modem, uint8_t **data, size_t *datalen, double *samp
 			}
 			//Normalized based upon per-symbol thresholds
 			norm = corr / modem->symbol_thresh[k];
+			modem->demod_norm[k] = norm;
 			if( norm >= 1.0 &&
 			    norm > maxcorr ) {
 			    maxcorr = norm;
@@ -477,44 +1092,75 @@ int corr_demodulate(corr_t *modem, uint8_t **data, size_t *datalen, double *samp
 			}
 		}
 		
-		if( sym >= 0 ) {
+		modem->demod_idle++;
+		modem->demod_heldage++;
+		if( sym >= 0 && maxcorr > modem->demod_heldnorm ) {
+			//Crossing the threshold only means the peak is near.  The 
+			//correlation ripples with the carrier on its way up, so hold
+			//the best symbol until an eighth of a symbol passes without a
+			//better one.
+			modem->demod_held = sym;
+			modem->demod_heldnorm = maxcorr;
+			modem->demod_heldoff = next;
+			modem->demod_heldage = 0;
+			memcpy(modem->demod_peak,modem->demod_norm,sizeof(double)*modem->symbol_count);
+		}
+		else if( modem->demod_held >= 0 &&
+		         modem->demod_heldage >= modem->symbols[modem->demod_held].len/8 ) {
+			sym = modem->demod_held;
 			if( modem->verbose ) {
 				printf("  Symbol: 0x%02x\n",sym);
 			}
-			putbits(modem->demod_bytes, sizeof(modem->demod_bytes), modem->demod_bit_count, modem->bit_per_sym, sym);
-			modem->demod_bit_count = modem->demod_bit_count + modem->bit_per_sym;
-			if( modem->demod_bit_count >= 8 ) {
-				//Push a demodulated byte
-				tmpdata = (uint8_t*)realloc(modem->demod_data,sizeof(uint8_t)*(modem->demod_datalen+1));
-				if( !tmpdata ) {
+			if( modem->tcm ) {
+				//The Viterbi decoder weighs every template's correlation
+				for( k=0; k<modem->symbol_count; k++ ) {
+					modem->demod_tcm.dist[k] = -modem->demod_peak[k];
+				}
+				if( tcm_decode(&modem->demod_tcm) ) {
+					return -1;
+				}
+			}
+			else {
+				//So do the soft bits, relative to the winning one
+				if( modem->demod_bits.softon ) {
+					bitstream_soft_demap(modem->demod_peak,modem->symbol_count,modem->bit_per_sym,
+					                     modem->demod_heldnorm,llr);
+				}
+				if( bitstream_write_soft(&modem->demod_bits, modem->bit_per_sym, sym, llr) ) {
 					if( modem->verbose ) {
-						printf("    Failed to reallocate data buffer\n");
+						printf("    Failed to grow data buffer\n");
 					}
 					return -1;
 				}
-				modem->demod_data = tmpdata;
-				modem->demod_data[modem->demod_datalen] = modem->demod_bytes[0];
-				modem->demod_datalen++;
-				modem->demod_bytes[0] = modem->demod_bytes[1];
-				modem->demod_bytes[1] = 0;
-				modem->demod_bit_count = modem->demod_bit_count - 8;
 			}
-			//Dump all of the samples used to create this correlation
-			off = next;
-			for( jj=0; jj<modem->symbols[sym].len; jj++ ) {
+			modem->demod_held = -1;
+			modem->demod_heldnorm = 0.0;
+			modem->demod_idle = 0;
+			//Dump all of the samples used to create this correlation, 
+			//except the oldest, which newer ones have already replaced
+			off = (modem->demod_heldoff + modem->demod_heldage) % modem->demod_bufferalloc;
+			for( jj=modem->demod_heldage; jj<modem->symbols[sym].len; jj++ ) {
 				modem->demod_buffer[off] = 0.0;
 				if( ++off >= modem->demod_bufferalloc ) { off = 0; }
 			}
 		}
+		else if( modem->tcm && modem->demod_tcm.decisionslen &&
+		         modem->demod_idle >= 2*modem->demod_bufferalloc ) {
+			//Two symbols without one ends the transmission
+			if( tcm_flush(&modem->demod_tcm,&modem->demod_bits) ) {
+				return -1;
+			}
+		}
 		
 		modem->demod_bufferoff = next;
 	}
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
 	if( modem->verbose ) {
 		printf("  Data: ");
-		for( ii=0; ii<modem->demod_datalen; ii++ ) {
-			printf("%02x ",modem->demod_data[ii]);
+		for( ii=0; ii<*datalen; ii++ ) {
+			printf("%02x ",(*data)[ii]);
 		}
 		printf("\n");
 	}
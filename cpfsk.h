@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __CPFSK_H__
+#define __CPFSK_H__
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitops.h"
+#include "pulse.h"
+#include "symsync.h"
+
+#define CPFSK_DEFAULT_VERBOSE     0
+#define CPFSK_DEFAULT_THRESH      0.25
+
+//Continuous phase FSK with a modulation index of 0.5, which is MSK for two
+//symbols, or binary with Gaussian smoothed frequency steps (GFSK).  The
+//envelope is constant and the phase never jumps, so the spectrum stays
+//compact.  The receiver mixes down to I/Q, low pass filters, and takes the
+//phase change over a sliding symbol window as a frequency discriminator; a
+//Gardner loop on the discriminator output picks the sampling instant.  A
+//transmission starts with an alternating preamble, a Barker sync word and
+//a length header, all on the outer frequencies.
+
+typedef struct {
+	int      verbose;
+	size_t   samplerate;
+	size_t   bitrate;
+	double   frequency;
+	size_t   bit_per_symbol;
+	size_t   symbol_count;
+	int      gaussian;
+	double   thresh;
+
+	size_t   samp_per_sym;
+	double   deviation;
+	pulse_t *shape;
+	pulse_t *filter;
+
+	double  *mod_samples;
+	size_t   mod_sampleslen;
+	double  *mod_level;
+	size_t   mod_levelalloc;
+
+	symsync_frame_t demod_frame;
+	double   demod_detect;
+	double   demod_nco;
+	double  *demod_mix;
+	size_t   demod_mixoff;
+	double   demod_last[2];
+	double  *demod_dphi;
+	size_t   demod_dphioff;
+	double   demod_dsum;
+	double  *demod_mf;
+	size_t   demod_mfalloc;
+	size_t   demod_count;
+	double   demod_power;
+
+	double   demod_prev;
+	double   demod_amp;
+	bitstream_t demod_bits;
+} cpfsk_t;
+
+
+cpfsk_t *cpfsk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count);
+cpfsk_t *cpfsk_gfsk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count);
+void     cpfsk_destroy(cpfsk_t *modem);
+int      cpfsk_set_thresh(cpfsk_t *modem, double thresh);
+int      cpfsk_set_verbose(cpfsk_t *modem, int verbose);
+int      cpfsk_set_soft(cpfsk_t *modem, int on);
+int      cpfsk_soft(cpfsk_t *modem, int8_t **soft, size_t *softlen);
+void     cpfsk_printinfo(cpfsk_t *modem);
+int      cpfsk_modulate(cpfsk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+int      cpfsk_demodulate(cpfsk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+
+#endif //__CPFSK_H__
+
+#ifdef CPFSK_IMPLEMENTATION
+#undef CPFSK_IMPLEMENTATION
+
+#define CPFSK_AMPLITUDE      0.5
+//Phase change per symbol between adjacent levels is CPFSK_INDEX*pi
+#define CPFSK_INDEX          0.5
+#define CPFSK_MAX_BITS       3
+//Gaussian bandwidth-symbol time product and length in symbols for GFSK
+#define CPFSK_BT             0.5
+#define CPFSK_GAUSS_SPAN     3
+//Receive low pass length in symbols
+#define CPFSK_FILTER_SPAN    4
+//Symbols sent past the data, so the last one clears the receive filters
+#define CPFSK_TAIL_LEN       (CPFSK_FILTER_SPAN/2+2)
+//Timing loop bandwidths (times the symbol period) while training and on data
+#define CPFSK_TIMING_ACQ     0.05
+#define CPFSK_TIMING_TRK     0.01
+
+static cpfsk_t *cpfsk_init_mode(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count, int gaussian) {
+	cpfsk_t *modem;
+	double sym_freq;
+	double half;
+
+	//Double check arguments
+	if( !bitrate ) { return 0; }
+	if( symbol_count < 2 ) { return 0; }
+
+	modem = (cpfsk_t*)malloc(sizeof(cpfsk_t));
+	if( !modem ) { goto cpfsk_init_error; }
+	memset(modem,0,sizeof(cpfsk_t));
+	bitstream_init_alloc(&modem->demod_bits);
+
+	modem->verbose = CPFSK_DEFAULT_VERBOSE;
+	modem->demod_frame.verbose = CPFSK_DEFAULT_VERBOSE;
+
+	modem->samplerate = samplerate;
+	modem->bitrate = bitrate;
+	modem->frequency = frequency;
+	modem->gaussian = gaussian;
+
+	modem->bit_per_symbol = 1;
+	while( 1<<modem->bit_per_symbol < symbol_count ) {
+		modem->bit_per_symbol++;
+	}
+	if( modem->bit_per_symbol > CPFSK_MAX_BITS ) { goto cpfsk_init_error; }
+	//Without an equalizer the Gaussian smearing closes the eye between
+	//inner and outer levels, so GFSK is binary only
+	if( gaussian && modem->bit_per_symbol > 1 ) { goto cpfsk_init_error; }
+	modem->symbol_count = (1 << modem->bit_per_symbol);
+	modem->demod_frame.bit_per_symbol = modem->bit_per_symbol;
+
+	//Gardner needs a few samples per symbol to interpolate between
+	sym_freq = (double)bitrate / (double)modem->bit_per_symbol;
+	modem->samp_per_sym = (size_t)round((double)samplerate / sym_freq);
+	if( modem->samp_per_sym < 4 ) { goto cpfsk_init_error; }
+	sym_freq = (double)samplerate / (double)modem->samp_per_sym;
+
+	//Levels are the odd integers up to +/-(symbol_count-1), each a
+	//deviation apart from the carrier
+	modem->deviation = CPFSK_INDEX*sym_freq/2.0;
+
+	//Receive filter passes the outer frequencies plus half a symbol rate
+	half = (modem->symbol_count-1)*modem->deviation + sym_freq/2.0;
+	if( frequency < half ) { goto cpfsk_init_error; }
+	if( frequency + half > samplerate/2.0 ) { goto cpfsk_init_error; }
+	modem->filter = pulse_lowpass_init(modem->samp_per_sym,CPFSK_FILTER_SPAN,half/sym_freq);
+	if( !modem->filter ) { goto cpfsk_init_error; }
+	if( gaussian ) {
+		modem->shape = pulse_gaussian_init(modem->samp_per_sym,CPFSK_GAUSS_SPAN,CPFSK_BT);
+		if( !modem->shape ) { goto cpfsk_init_error; }
+	}
+
+	//Mixer output history for the low pass (I/Q interleaved), phase steps
+	//for the one symbol discriminator window, and discriminator history
+	//for the timing interpolator
+	modem->demod_mix = (double*)malloc(sizeof(double)*2*modem->filter->len);
+	if( !modem->demod_mix ) { goto cpfsk_init_error; }
+	modem->demod_dphi = (double*)malloc(sizeof(double)*modem->samp_per_sym);
+	if( !modem->demod_dphi ) { goto cpfsk_init_error; }
+	modem->demod_mfalloc = symsync_ring_len(modem->samp_per_sym);
+	modem->demod_mf = (double*)malloc(sizeof(double)*modem->demod_mfalloc);
+	if( !modem->demod_mf ) { goto cpfsk_init_error; }
+
+	if( cpfsk_set_thresh(modem,CPFSK_DEFAULT_THRESH) ) {
+		goto cpfsk_init_error;
+	}
+
+	return modem;
+
+	cpfsk_init_error:
+	cpfsk_destroy(modem);
+	return 0;
+}
+
+cpfsk_t *cpfsk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count) {
+	return cpfsk_init_mode(samplerate,bitrate,frequency,symbol_count,0);
+}
+
+cpfsk_t *cpfsk_gfsk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count) {
+	return cpfsk_init_mode(samplerate,bitrate,frequency,symbol_count,1);
+}
+
+void cpfsk_destroy(cpfsk_t *modem) {
+	if( modem ) {
+		if( modem->shape ) { pulse_destroy(modem->shape); }
+		if( modem->filter ) { pulse_destroy(modem->filter); }
+		if( modem->mod_samples ) { free(modem->mod_samples); }
+		if( modem->mod_level ) { free(modem->mod_level); }
+		if( modem->demod_mix ) { free(modem->demod_mix); }
+		if( modem->demod_dphi ) { free(modem->demod_dphi); }
+		if( modem->demod_mf ) { free(modem->demod_mf); }
+		bitstream_destroy(&modem->demod_bits);
+		memset(modem,0,sizeof(cpfsk_t));
+		free(modem);
+	}
+}
+
+static void cpfsk_demodulate_reset(cpfsk_t *modem) {
+	memset(modem->demod_mix,0,sizeof(double)*2*modem->filter->len);
+	memset(modem->demod_dphi,0,sizeof(double)*modem->samp_per_sym);
+	memset(modem->demod_mf,0,sizeof(double)*modem->demod_mfalloc);
+	modem->demod_mixoff = 0;
+	modem->demod_dphioff = 0;
+	modem->demod_dsum = 0.0;
+	modem->demod_last[0] = 0.0;
+	modem->demod_last[1] = 0.0;
+	modem->demod_count = 0;
+	modem->demod_nco = 0.0;
+	modem->demod_power = 0.0;
+	modem->demod_frame.state = SYMSYNC_SEARCH;
+}
+
+static void cpfsk_demodulate_sample(cpfsk_t *modem, double x) {
+	//Mix one sample down to I/Q, low pass it, and slide the one symbol
+	//discriminator window along by its phase step
+	double *mix;
+	double i;
+	double q;
+	double dphi;
+	size_t j;
+	size_t off;
+
+	mix = modem->demod_mix + 2*modem->demod_mixoff;
+	mix[0] =  2.0*x*cos(modem->demod_nco);
+	mix[1] = -2.0*x*sin(modem->demod_nco);
+	modem->demod_nco = modem->demod_nco + 2*M_PI*modem->frequency/modem->samplerate;
+	if( modem->demod_nco > 2*M_PI ) {
+		modem->demod_nco = modem->demod_nco - 2*M_PI;
+	}
+
+	//Walk the ring from the oldest sample; the filter is symmetric, so
+	//this is the convolution
+	if( ++modem->demod_mixoff >= modem->filter->len ) { modem->demod_mixoff = 0; }
+	i = 0.0;
+	q = 0.0;
+	off = modem->demod_mixoff;
+	for( j=0; j<modem->filter->len; j++ ) {
+		i = i + modem->filter->taps[j]*modem->demod_mix[2*off];
+		q = q + modem->filter->taps[j]*modem->demod_mix[2*off+1];
+		if( ++off >= modem->filter->len ) { off = 0; }
+	}
+
+	//Phase step since the last sample
+	dphi = atan2(modem->demod_last[0]*q - modem->demod_last[1]*i,
+	             modem->demod_last[0]*i + modem->demod_last[1]*q);
+	modem->demod_last[0] = i;
+	modem->demod_last[1] = q;
+
+	modem->demod_dsum = modem->demod_dsum - modem->demod_dphi[modem->demod_dphioff] + dphi;
+	modem->demod_dphi[modem->demod_dphioff] = dphi;
+	if( ++modem->demod_dphioff >= modem->samp_per_sym ) {
+		modem->demod_dphioff = 0;
+		//Resum the window once a symbol, so rounding in the running sum
+		//does not build up
+		modem->demod_dsum = 0.0;
+		for( j=0; j<modem->samp_per_sym; j++ ) {
+			modem->demod_dsum = modem->demod_dsum + modem->demod_dphi[j];
+		}
+	}
+
+	//Phase change over the last symbol, in steps between adjacent levels
+	modem->demod_mf[modem->demod_count & (modem->demod_mfalloc-1)] = modem->demod_dsum / (CPFSK_INDEX*M_PI);
+	modem->demod_count++;
+
+	//Signal power, smoothed over a couple of symbols
+	modem->demod_power = modem->demod_power + (i*i + q*q - modem->demod_power) / (2.0*modem->samp_per_sym);
+}
+
+int cpfsk_set_thresh(cpfsk_t *modem, double thresh) {
+	//Detection level as a fraction of the filtered power of a clean
+	//preamble, measured by running one through the receiver
+	double *samples;
+	size_t  sampleslen;
+	uint8_t dummy = 0;
+	double  power;
+	size_t  count;
+	size_t  ii;
+
+	if( !modem ) { return -1; }
+	if( thresh <= 0.0 || thresh > 1.0 ) { return -1; }
+
+	if( cpfsk_modulate(modem,&samples,&sampleslen,&dummy,0) ) { return -1; }
+	cpfsk_demodulate_reset(modem);
+	power = 0.0;
+	count = 0;
+	for( ii=0; ii<sampleslen; ii++ ) {
+		cpfsk_demodulate_sample(modem,samples[ii]);
+		//Skip the ramp up and down of the filters
+		if( ii >= modem->filter->len && ii+modem->filter->len < sampleslen ) {
+			power = power + modem->demod_power;
+			count++;
+		}
+	}
+	cpfsk_demodulate_reset(modem);
+	if( !count ) { return -1; }
+
+	modem->thresh = thresh;
+	modem->demod_detect = thresh * power / count;
+	return 0;
+}
+
+int cpfsk_set_verbose(cpfsk_t *modem, int verbose) {
+	if( !modem ) { return -1; }
+	modem->verbose = verbose;
+	modem->demod_frame.verbose = verbose;
+	return 0;
+}
+
+int cpfsk_set_soft(cpfsk_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int cpfsk_soft(cpfsk_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+void cpfsk_printinfo(cpfsk_t *modem) {
+	printf("%s Modem:\n",modem->gaussian ? "GFSK" : (modem->symbol_count == 2 ? "MSK" : "CPFSK"));
+	printf("  Verbose                  : %d\n",modem->verbose);
+	printf("  Samplerate               : %zu\n",modem->samplerate);
+	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
+	printf("  Actual Bitrate           : %0.1lf bps\n",(double)modem->samplerate*modem->bit_per_symbol/modem->samp_per_sym);
+	printf("  Frequency                : %lf\n",modem->frequency);
+	printf("  Symbol Count             : %zu\n",modem->symbol_count);
+	printf("  Samples per Symbol       : %zu\n",modem->samp_per_sym);
+	printf("  Deviation                : %0.1lf Hz\n",modem->deviation);
+	if( modem->gaussian ) {
+		printf("  BT                       : %0.2lf\n",CPFSK_BT);
+	}
+	printf("  Detect Power             : %lf\n",modem->demod_detect);
+}
+
+static void cpfsk_modulate_symbol(cpfsk_t *modem, size_t idx, double level) {
+	//Hold the frequency level for one symbol
+	size_t j;
+	double *base;
+
+	base = modem->mod_level + idx*modem->samp_per_sym;
+	for( j=0; j<modem->samp_per_sym; j++ ) {
+		base[j] = level;
+	}
+}
+
+int cpfsk_modulate(cpfsk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_idx;
+	size_t symbol_count;
+	size_t data_count;
+	bitstream_t bits;
+	size_t ii;
+	size_t j;
+	size_t n;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	double *tmp;
+	double top;
+	double phase;
+	double level;
+	int sym;
+
+	if( !modem ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !data ) { return -1; }
+	if( datalen >= (1 << SYMSYNC_HEADER_BITS) ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("cpfsk_modulate(...):\n");
+		printf("  Data: ");
+		for( ii=0; ii<datalen; ii++ ) {
+			printf("%02x ",data[ii]);
+		}
+		printf("\n");
+	}
+
+	data_count = (datalen*8 + modem->bit_per_symbol - 1) / modem->bit_per_symbol;
+	symbol_count = SYMSYNC_SYNC_LEN + SYMSYNC_HEADER_LEN + data_count + CPFSK_TAIL_LEN;
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+
+	mod_sampleslen = symbol_count*modem->samp_per_sym;
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto cpfsk_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	if( modem->mod_levelalloc < mod_sampleslen ) {
+		tmp = (double*)realloc(modem->mod_level,sizeof(double)*mod_sampleslen);
+		if( !tmp ) {
+			goto cpfsk_modulate_error;
+		}
+		modem->mod_level = tmp;
+		modem->mod_levelalloc = mod_sampleslen;
+	}
+
+	top = (double)(modem->symbol_count-1);
+	symbol_idx = 0;
+	for( ii=0; ii<SYMSYNC_SYNC_LEN; ii++ ) {
+		cpfsk_modulate_symbol(modem,symbol_idx++,symsync_sync_bit(ii) ? top : -top);
+	}
+	for( ii=0; ii<SYMSYNC_HEADER_LEN; ii++ ) {
+		sym = symsync_header_bit(datalen,ii);
+		cpfsk_modulate_symbol(modem,symbol_idx++,sym ? top : -top);
+	}
+	bitstream_init(&bits, data, datalen);
+	for( ii=0; ii<data_count; ii++ ) {
+		//Gray coded, so landing on a neighbouring level is one bit error
+		sym = bitstream_read(&bits, modem->bit_per_symbol);
+		sym = sym ^ (sym >> 1);
+		cpfsk_modulate_symbol(modem,symbol_idx++,2.0*sym - top);
+	}
+	for( ii=0; ii<CPFSK_TAIL_LEN; ii++ ) {
+		cpfsk_modulate_symbol(modem,symbol_idx++,(ii & 1) ? -top : top);
+	}
+
+	phase = 0.0;
+	for( ii=0; ii<mod_sampleslen; ii++ ) {
+		if( modem->shape ) {
+			//Smooth the frequency steps, centered on the sample
+			level = 0.0;
+			for( j=0; j<modem->shape->len; j++ ) {
+				n = ii + j;
+				if( n < modem->shape->len/2 || n - modem->shape->len/2 >= mod_sampleslen ) {
+					continue;
+				}
+				level = level + modem->shape->taps[j]*modem->mod_level[n - modem->shape->len/2];
+			}
+		}
+		else {
+			level = modem->mod_level[ii];
+		}
+		mod_samples[ii] = CPFSK_AMPLITUDE*sin(phase);
+		phase = phase + 2*M_PI*(modem->frequency + level*modem->deviation)/modem->samplerate;
+		if( phase > 2*M_PI ) {
+			phase = phase - 2*M_PI;
+		}
+	}
+
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+
+	cpfsk_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
+}
+
+
+static void cpfsk_demodulate_llr(cpfsk_t *modem, double cur, double *llr) {
+	//Bit confidences from the squared distance to each frequency level,
+	//in units of the margin a clean symbol has over its neighbours
+	double metric[1 << CPFSK_MAX_BITS];
+	double d;
+	int k;
+
+	for( k=0; k<(int)modem->symbol_count; k++ ) {
+		d = cur - (2.0*k - (double)(modem->symbol_count-1));
+		metric[k ^ (k >> 1) ^ (k >> 2)] = -d*d;
+	}
+	bitstream_soft_demap(metric,modem->symbol_count,modem->bit_per_symbol,4.0,llr);
+}
+
+static int cpfsk_demodulate_decide(void *arg, symsync_state_t state, size_t idx, double *soft) {
+	//Decide on the discriminator output just timed (demod_prev, now that
+	//Gardner is done with it): its sign for the sync word and header, the
+	//nearest level for data
+	cpfsk_t *modem = (cpfsk_t*)arg;
+	double cur;
+	double top;
+	int k;
+
+	cur = modem->demod_prev;
+	top = (double)(modem->symbol_count-1);
+	if( state == SYMSYNC_SYNC ) {
+		soft[0] = cur / top;
+		return 0;
+	}
+	if( state == SYMSYNC_HEADER ) {
+		return cur > 0.0;
+	}
+
+	k = (int)round((cur + top) / 2.0);
+	if( k < 0 ) {
+		k = 0;
+	}
+	else if( k > (int)modem->symbol_count-1 ) {
+		k = (int)modem->symbol_count-1;
+	}
+	if( modem->demod_bits.softon ) {
+		cpfsk_demodulate_llr(modem,cur,soft);
+	}
+	//Undo the Gray code
+	return k ^ (k >> 1) ^ (k >> 2);
+}
+
+static int cpfsk_demodulate_symbol(cpfsk_t *modem) {
+	//One symbol at the frame's symbol instant: timing error, then the
+	//framing
+	double cur;
+	double mid;
+	double err;
+
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,1,modem->demod_frame.time,&cur);
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,1,modem->demod_frame.time-modem->samp_per_sym/2.0,&mid);
+	modem->demod_amp = modem->demod_amp + (cur*cur - modem->demod_amp) / 8.0;
+
+	//Gardner: the midpoint between symbols should cross zero
+	err = (modem->demod_prev-cur)*mid / modem->demod_amp;
+	modem->demod_prev = cur;
+	symsync_frame_timing(&modem->demod_frame,err,CPFSK_TIMING_ACQ,CPFSK_TIMING_TRK,modem->samp_per_sym);
+
+	if( symsync_frame_symbol(&modem->demod_frame,&modem->demod_bits,modem->demod_power < modem->demod_detect/2.0,cpfsk_demodulate_decide,modem) < 0 ) {
+		return -1;
+	}
+	return 0;
+}
+
+int cpfsk_demodulate(cpfsk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t ii;
+	size_t j;
+
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("cpfsk_demodulate(...)\n");
+	}
+
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+
+	for( ii=0; ii<sampleslen; ii++ ) {
+		cpfsk_demodulate_sample(modem,samples[ii]);
+
+		if( modem->demod_frame.state == SYMSYNC_SEARCH ) {
+			if( modem->demod_power >= modem->demod_detect ) {
+				//Start the timing loop fresh, one symbol out
+				symsync_frame_start(&modem->demod_frame,(double)modem->demod_count + modem->samp_per_sym);
+				modem->demod_prev = 0.0;
+				modem->demod_amp = (modem->symbol_count-1)*(modem->symbol_count-1);
+			}
+			continue;
+		}
+
+		if( symsync_frame_ready(&modem->demod_frame,modem->demod_count) ) {
+			if( cpfsk_demodulate_symbol(modem) ) {
+				return -1;
+			}
+		}
+	}
+
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+#endif //CPFSK_IMPLEMENTATION
\ No newline at end of file
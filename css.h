@@ -0,0 +1,651 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __CSS_H__
+#define __CSS_H__
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fftw3.h>
+
+#include "bitops.h"
+#include "symsync.h"
+
+#define CSS_DEFAULT_VERBOSE     0
+#define CSS_DEFAULT_THRESH      2.0
+
+//Chirp Spread Spectrum.  Every symbol is an up-chirp sweeping the chirp
+//bandwidth around the carrier frequency, cyclically shifted by its value,
+//so symbol_count (2^spreading factor) values take symbol_count chips and
+//carry log2(symbol_count) bits.  The receiver multiplies by the base
+//down-chirp, which turns a symbol into a single tone, and one FFT of 
+//symbol_count points picks the value.  A bigger symbol_count at the same
+//chirp bandwidth is slower but gathers more energy into that bin.  A frame
+//is:
+//  [0 0 ... 0]          CSS_PREAMBLE_LEN base chirps (timing)
+//  [N/2 N/2]            sync symbols
+//  [header]             byte count of symsync, sent twice
+//  [data] ...
+//Header and data symbols are Gray coded, so a one bin error is one bit.
+
+typedef enum{
+	CSS_DEMOD_SEARCH,
+	CSS_DEMOD_SYNC,
+	CSS_DEMOD_HEADER,
+	CSS_DEMOD_DATA,
+} css_demod_state_t;
+
+typedef struct {
+	int      verbose;
+	size_t   samplerate;
+	size_t   bitrate;
+	double   frequency;
+	size_t   bit_per_symbol;
+	size_t   symbol_count;
+	double   thresh;
+	
+	double   chirp_bandwidth;
+	double   samp_per_chip;
+	double   samp_per_sym;
+	
+	double  *mod_samples;
+	size_t   mod_sampleslen;
+	
+	fftw_complex *demod_dechirp;
+	fftw_complex *fft_in;
+	fftw_complex *fft_out;
+	fftw_plan     fft_plan;
+	
+	css_demod_state_t demod_state;
+	double  *demod_buffer;
+	size_t   demod_bufferalloc;
+	size_t   demod_bufferlen;
+	size_t   demod_bufferpos;
+	
+	double   demod_symbol;
+	size_t   demod_count;
+	size_t   demod_preamble;
+	size_t   demod_lastbin;
+	size_t   demod_bin;
+	double   demod_offset;
+	double   demod_metric;
+	double  *demod_mags;
+	int      demod_detect;
+	uint64_t demod_header;
+	size_t   demod_remaining;
+	bitstream_t demod_bits;
+} css_t;
+
+
+css_t *css_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count);
+void   css_destroy(css_t *modem);
+int    css_set_thresh(css_t *modem, double thresh);
+int    css_set_verbose(css_t *modem, int verbose);
+int    css_set_soft(css_t *modem, int on);
+int    css_soft(css_t *modem, int8_t **soft, size_t *softlen);
+void   css_printinfo(css_t *modem);
+int    css_modulate(css_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+int    css_demodulate(css_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+
+#endif //__CSS_H__
+
+#ifdef CSS_IMPLEMENTATION
+#undef CSS_IMPLEMENTATION
+
+#define CSS_PREAMBLE_LEN    8
+#define CSS_SYNC_LEN        2
+//Windows in a row with the same peak bin that make a preamble
+#define CSS_PREAMBLE_MIN    3
+//Lowest frequency the chirp may reach
+#define CSS_MIN_FREQ        100.0
+//Fraction of the measured timing error corrected on every symbol
+#define CSS_TRACK_GAIN      0.25
+
+css_t *css_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count) {
+	css_t *modem;
+	size_t n;
+	double phase;
+	
+	//Double check arguments
+	if( !bitrate ) { return 0; }
+	//The preamble is detected by how far its peak bin stands above the 
+	//average of the window, and with fewer than 8 bins even a clean 
+	//preamble does not reach the detection level
+	if( symbol_count < 8 ) { return 0; }
+	
+	modem = (css_t*)malloc(sizeof(css_t));
+	if( !modem ) { goto css_init_error; }
+	memset(modem,0,sizeof(css_t));
+	bitstream_init_alloc(&modem->demod_bits);
+	
+	modem->verbose = CSS_DEFAULT_VERBOSE;
+	modem->samplerate = samplerate;
+	modem->bitrate = bitrate;
+	modem->frequency = frequency;
+	
+	modem->bit_per_symbol = 3;
+	while( 1<<modem->bit_per_symbol < symbol_count ) {
+		modem->bit_per_symbol++;
+	}
+	if( modem->bit_per_symbol > 12 ) { goto css_init_error; }
+	modem->symbol_count = (1 << modem->bit_per_symbol);
+	
+	//One chip per symbol value, and the bitrate sets the chip rate
+	modem->chirp_bandwidth = (double)bitrate * modem->symbol_count / modem->bit_per_symbol;
+	if( frequency - modem->chirp_bandwidth/2 < CSS_MIN_FREQ ) { goto css_init_error; }
+	if( frequency + modem->chirp_bandwidth/2 >= samplerate/2 ) { goto css_init_error; }
+	modem->samp_per_chip = (double)samplerate / modem->chirp_bandwidth;
+	modem->samp_per_sym = modem->samp_per_chip * modem->symbol_count;
+	
+	//Base down-chirp at the chip instants
+	modem->demod_dechirp = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*modem->symbol_count);
+	if( !modem->demod_dechirp ) { goto css_init_error; }
+	for( n=0; n<modem->symbol_count; n++ ) {
+		phase = M_PI * ((double)n*n/modem->symbol_count - (double)n);
+		modem->demod_dechirp[n][0] = cos(phase);
+		modem->demod_dechirp[n][1] = -sin(phase);
+	}
+	
+	modem->fft_in = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*modem->symbol_count);
+	if( !modem->fft_in ) { goto css_init_error; }
+	modem->fft_out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*modem->symbol_count);
+	if( !modem->fft_out ) { goto css_init_error; }
+	modem->fft_plan = fftw_plan_dft_1d(modem->symbol_count,modem->fft_in,modem->fft_out,FFTW_FORWARD,FFTW_MEASURE);
+	if( !modem->fft_plan ) { goto css_init_error; }
+	
+	modem->demod_bufferalloc = 4*((size_t)ceil(modem->samp_per_sym)+1);
+	modem->demod_buffer = (double*)malloc(sizeof(double)*modem->demod_bufferalloc);
+	if( !modem->demod_buffer ) { goto css_init_error; }
+	modem->demod_mags = (double*)malloc(sizeof(double)*modem->symbol_count);
+	if( !modem->demod_mags ) { goto css_init_error; }
+	
+	if( css_set_thresh(modem,CSS_DEFAULT_THRESH) ) {
+		goto css_init_error;
+	}
+	modem->demod_state = CSS_DEMOD_SEARCH;
+	modem->demod_symbol = ceil(modem->samp_per_chip/2);
+	
+	return modem;
+	
+	css_init_error:
+	css_destroy(modem);
+	return 0;
+}
+
+void css_destroy(css_t *modem) {
+	if( modem ) {
+		if( modem->fft_plan ) { fftw_destroy_plan(modem->fft_plan); }
+		if( modem->fft_in ) { fftw_free(modem->fft_in); }
+		if( modem->fft_out ) { fftw_free(modem->fft_out); }
+		if( modem->demod_dechirp ) { fftw_free(modem->demod_dechirp); }
+		if( modem->mod_samples ) { free(modem->mod_samples); }
+		if( modem->demod_buffer ) { free(modem->demod_buffer); }
+		if( modem->demod_mags ) { free(modem->demod_mags); }
+		bitstream_destroy(&modem->demod_bits);
+		memset(modem,0,sizeof(css_t));
+		free(modem);
+	}
+}
+
+int css_set_thresh(css_t *modem, double thresh) {
+	//Peak to average power of the FFT bins needed to take a window as a
+	//chirp, in multiples of ln(symbol_count), which noise alone reaches 
+	//about once a window.  A clean chirp reaches symbol_count.
+	if( !modem ) { return -1; }
+	if( thresh <= 0.0 ) { return -1; }
+	modem->thresh = thresh;
+	return 0;
+}
+
+int css_set_verbose(css_t *modem, int verbose) {
+	if( !modem ) { return -1; }
+	modem->verbose = verbose;
+	return 0;
+}
+
+int css_set_soft(css_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int css_soft(css_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+void css_printinfo(css_t *modem) {
+	printf("Chirp Spread Spectrum Modem:\n");
+	printf("  Verbose                  : %d\n",modem->verbose);
+	printf("  Samplerate               : %zu\n",modem->samplerate);
+	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
+	printf("  Frequency                : %lf\n",modem->frequency);
+	printf("  Symbol Count             : %zu\n",modem->symbol_count);
+	printf("  Spreading Factor         : %zu\n",modem->bit_per_symbol);
+	printf("  Chirp Bandwidth          : %0.1lf Hz\n",modem->chirp_bandwidth);
+	printf("  Samples per Symbol       : %0.1lf\n",modem->samp_per_sym);
+	printf("  Detect Ratio             : %0.1lf\n",modem->thresh*log((double)modem->symbol_count));
+}
+
+static size_t css_gray_decode(size_t g) {
+	//The bin whose Gray code is g
+	size_t n = g;
+	while( g >>= 1 ) {
+		n = n ^ g;
+	}
+	return n;
+}
+
+static double css_phase(css_t *modem, size_t value, double u) {
+	//Phase of the baseband chirp for value at u chips into the symbol.  The
+	//frequency climbs from -1/2 to +1/2 cycles per chip and wraps around
+	//where value has shifted it to the top of the band.
+	double v = u + (double)value;
+	double n = (double)modem->symbol_count;
+	double phase;
+	
+	phase = (v*v - (double)value*value)/(2*n) - u/2;
+	if( v >= n ) {
+		phase = phase - (v - n);
+	}
+	return 2*M_PI*phase;
+}
+
+int css_modulate(css_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_count;
+	size_t header_count;
+	size_t data_count;
+	size_t symbol_idx;
+	size_t value;
+	size_t bits;
+	size_t j;
+	bitstream_t bs;
+	size_t ii;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	double start;
+	double end;
+	
+	if( !modem ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen || datalen >= (1 << SYMSYNC_HEADER_BITS) ) { return -1; }
+	
+	if( modem->verbose ) {
+		printf("css_modulate(...):\n");
+		printf("  Data: ");
+		for( ii=0; ii<datalen; ii++ ) {
+			printf("%02x ",data[ii]);
+		}
+		printf("\n");
+	}
+	
+	header_count = (SYMSYNC_HEADER_LEN + modem->bit_per_symbol - 1) / modem->bit_per_symbol;
+	data_count = (datalen*8 + modem->bit_per_symbol - 1) / modem->bit_per_symbol;
+	symbol_count = CSS_PREAMBLE_LEN + CSS_SYNC_LEN + header_count + data_count;
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+	
+	mod_sampleslen = (size_t)ceil(modem->samp_per_sym*symbol_count);
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto css_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	
+	bitstream_init(&bs, data, datalen);
+	for( symbol_idx=0; symbol_idx<symbol_count; symbol_idx++ ) {
+		if( symbol_idx < CSS_PREAMBLE_LEN ) {
+			value = 0;
+		}
+		else if( symbol_idx < CSS_PREAMBLE_LEN+CSS_SYNC_LEN ) {
+			value = modem->symbol_count/2;
+		}
+		else if( symbol_idx < CSS_PREAMBLE_LEN+CSS_SYNC_LEN+header_count ) {
+			bits = 0;
+			for( j=0; j<modem->bit_per_symbol; j++ ) {
+				ii = (symbol_idx-CSS_PREAMBLE_LEN-CSS_SYNC_LEN)*modem->bit_per_symbol + j;
+				bits = (bits << 1) | (ii < SYMSYNC_HEADER_LEN ? symsync_header_bit(datalen,ii) : 0);
+			}
+			value = css_gray_decode(bits);
+		}
+		else {
+			value = css_gray_decode(bitstream_read(&bs, modem->bit_per_symbol));
+		}
+		
+		start = modem->samp_per_sym*symbol_idx;
+		end = start + modem->samp_per_sym;
+		for( ii=(size_t)ceil(start); ii<(size_t)ceil(end) && ii<mod_sampleslen; ii++ ) {
+			mod_samples[ii] = cos(2*M_PI*fmod(modem->frequency*ii,modem->samplerate)/modem->samplerate +
+			                      css_phase(modem,value,(ii-start)/modem->samp_per_chip));
+		}
+	}
+	
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+	
+	css_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
+}
+
+
+static void css_demodulate_window(css_t *modem) {
+	//Dechirp and FFT the symbol starting at demod_symbol.  Each chip is the
+	//mixed down average of the samples within half a chip of its instant.
+	//Leaves the peak in demod_bin, its offset from the bin center (in
+	//chips) in demod_offset, and its power over the average in demod_metric.
+	size_t n;
+	size_t i;
+	size_t first;
+	size_t last;
+	size_t count;
+	size_t b;
+	double x;
+	double ang;
+	double re;
+	double im;
+	double mag;
+	double total;
+	double peak;
+	double ml;
+	double mr;
+	double den;
+	
+	last = (size_t)ceil(modem->demod_symbol - modem->samp_per_chip/2);
+	for( n=0; n<modem->symbol_count; n++ ) {
+		first = last;
+		last = (size_t)ceil(modem->demod_symbol + (n+0.5)*modem->samp_per_chip);
+		re = 0.0;
+		im = 0.0;
+		for( i=first; i<last; i++ ) {
+			x = modem->demod_buffer[i-modem->demod_bufferpos];
+			ang = 2*M_PI*fmod(modem->frequency*i,modem->samplerate)/modem->samplerate;
+			re = re + x*cos(ang);
+			im = im - x*sin(ang);
+		}
+		count = last - first;
+		if( count ) {
+			re = re / count;
+			im = im / count;
+		}
+		modem->fft_in[n][0] = re*modem->demod_dechirp[n][0] - im*modem->demod_dechirp[n][1];
+		modem->fft_in[n][1] = re*modem->demod_dechirp[n][1] + im*modem->demod_dechirp[n][0];
+	}
+	fftw_execute(modem->fft_plan);
+	
+	total = 0.0;
+	peak = 0.0;
+	b = 0;
+	for( n=0; n<modem->symbol_count; n++ ) {
+		mag = modem->fft_out[n][0]*modem->fft_out[n][0] + modem->fft_out[n][1]*modem->fft_out[n][1];
+		total = total + mag;
+		if( mag > peak ) {
+			peak = mag;
+			b = n;
+		}
+	}
+	modem->demod_bin = b;
+	modem->demod_metric = (total > 0.0) ? peak*modem->symbol_count/total : 0.0;
+	modem->demod_detect = modem->demod_metric >= modem->thresh*log((double)modem->symbol_count);
+	
+	//Parabola through the peak and its neighbours
+	n = (b+modem->symbol_count-1) % modem->symbol_count;
+	ml = sqrt(modem->fft_out[n][0]*modem->fft_out[n][0] + modem->fft_out[n][1]*modem->fft_out[n][1]);
+	n = (b+1) % modem->symbol_count;
+	mr = sqrt(modem->fft_out[n][0]*modem->fft_out[n][0] + modem->fft_out[n][1]*modem->fft_out[n][1]);
+	peak = sqrt(peak);
+	den = 2*peak - ml - mr;
+	modem->demod_offset = (den > 0.0) ? 0.5*(mr - ml)/den : 0.0;
+	
+	if( modem->verbose ) {
+		printf("  Window at %0.1lf: bin %zu%+0.2lf (%0.2lf)\n",modem->demod_symbol,b,modem->demod_offset,modem->demod_metric);
+	}
+}
+
+static size_t css_bin_distance(css_t *modem, size_t a, size_t b) {
+	//Cyclic distance between two bins
+	size_t d = (a > b) ? a-b : b-a;
+	return (d > modem->symbol_count/2) ? modem->symbol_count-d : d;
+}
+
+static void css_demodulate_llr(css_t *modem, double *llr) {
+	//Bit confidences from the magnitude of every bin of the last window,
+	//each bin standing for its Gray code
+	size_t n;
+	
+	for( n=0; n<modem->symbol_count; n++ ) {
+		modem->demod_mags[n ^ (n >> 1)] = sqrt(modem->fft_out[n][0]*modem->fft_out[n][0] + 
+		                                       modem->fft_out[n][1]*modem->fft_out[n][1]);
+	}
+	bitstream_soft_demap(modem->demod_mags,modem->symbol_count,modem->bit_per_symbol,
+	                     modem->demod_mags[modem->demod_bin ^ (modem->demod_bin >> 1)],llr);
+}
+
+static int css_demodulate_symbol(css_t *modem) {
+	//Advance the state machine by the window at demod_symbol
+	size_t value;
+	size_t bits;
+	size_t j;
+	size_t idx;
+	size_t header_count;
+	double llr[32];
+	
+	css_demodulate_window(modem);
+	
+	if( modem->demod_state == CSS_DEMOD_SEARCH ) {
+		//The preamble repeats, so any window within it is a cyclic shift of
+		//the base chirp by its distance past the chirp start
+		if( !modem->demod_detect ) {
+			modem->demod_count = 0;
+		}
+		else if( modem->demod_count && css_bin_distance(modem,modem->demod_bin,modem->demod_lastbin) <= 1 ) {
+			modem->demod_count++;
+		}
+		else {
+			modem->demod_count = 1;
+		}
+		modem->demod_lastbin = modem->demod_bin;
+		if( modem->demod_count < CSS_PREAMBLE_MIN ) {
+			modem->demod_symbol = modem->demod_symbol + modem->samp_per_sym;
+			return 0;
+		}
+		if( modem->verbose ) {
+			printf("  Preamble detected\n");
+		}
+		modem->demod_symbol = modem->demod_symbol +
+		                      (modem->symbol_count - modem->demod_bin - modem->demod_offset)*modem->samp_per_chip;
+		modem->demod_state = CSS_DEMOD_SYNC;
+		modem->demod_count = 0;
+		modem->demod_preamble = 0;
+		return 0;
+	}
+	
+	modem->demod_symbol = modem->demod_symbol + modem->samp_per_sym;
+	if( modem->demod_state == CSS_DEMOD_SYNC && !modem->demod_detect ) {
+		if( modem->verbose ) {
+			printf("  Signal lost\n");
+		}
+		modem->demod_state = CSS_DEMOD_SEARCH;
+		modem->demod_count = 0;
+		return 0;
+	}
+	//Late windows see a higher value.  The header sets the frame length,
+	//so weak header and data symbols are still decoded, just not tracked.
+	if( modem->demod_detect ) {
+		modem->demod_symbol = modem->demod_symbol - CSS_TRACK_GAIN*modem->demod_offset*modem->samp_per_chip;
+	}
+	value = modem->demod_bin;
+	
+	if( modem->demod_state == CSS_DEMOD_SYNC ) {
+		if( css_bin_distance(modem,value,modem->symbol_count/2) <= 1 ) {
+			if( ++modem->demod_count == CSS_SYNC_LEN ) {
+				if( modem->verbose ) {
+					printf("  Sync detected\n");
+				}
+				modem->demod_state = CSS_DEMOD_HEADER;
+				modem->demod_count = 0;
+				modem->demod_header = 0;
+			}
+		}
+		else if( css_bin_distance(modem,value,0) > 1 || modem->demod_count ||
+		         ++modem->demod_preamble > CSS_PREAMBLE_LEN ) {
+			modem->demod_state = CSS_DEMOD_SEARCH;
+			modem->demod_count = 0;
+		}
+		return 0;
+	}
+	
+	//Gray code of the bin
+	bits = value ^ (value >> 1);
+	if( modem->demod_state == CSS_DEMOD_HEADER ) {
+		header_count = (SYMSYNC_HEADER_LEN + modem->bit_per_symbol - 1) / modem->bit_per_symbol;
+		for( j=0; j<modem->bit_per_symbol; j++ ) {
+			idx = modem->demod_count*modem->bit_per_symbol + j;
+			if( idx < SYMSYNC_HEADER_LEN ) {
+				modem->demod_header = (modem->demod_header << 1) | ((bits >> (modem->bit_per_symbol-1-j)) & 1);
+			}
+		}
+		if( ++modem->demod_count < header_count ) {
+			return 0;
+		}
+		modem->demod_count = 0;
+		if( symsync_header_check(modem->demod_header,&modem->demod_remaining) ) {
+			if( modem->verbose ) {
+				printf("  Bad header\n");
+			}
+			modem->demod_state = CSS_DEMOD_SEARCH;
+			return 0;
+		}
+		if( modem->verbose ) {
+			printf("  Frame of %zu bytes\n",modem->demod_remaining);
+		}
+		//Frames are whole bytes; drop into line after one that was cut off
+		if( bitstream_flush(&modem->demod_bits) ) { return -1; }
+		modem->demod_remaining = modem->demod_remaining*8;
+		modem->demod_state = CSS_DEMOD_DATA;
+		return 0;
+	}
+	
+	//The last symbol is padded out to whole bits
+	j = modem->bit_per_symbol;
+	if( j > modem->demod_remaining ) {
+		j = modem->demod_remaining;
+	}
+	if( modem->demod_bits.softon ) {
+		css_demodulate_llr(modem,llr);
+	}
+	if( bitstream_write_soft(&modem->demod_bits, j, (int)(bits >> (modem->bit_per_symbol-j)), llr) ) {
+		if( modem->verbose ) {
+			printf("    Failed to grow data buffer\n");
+		}
+		return -1;
+	}
+	modem->demod_remaining = modem->demod_remaining - j;
+	if( !modem->demod_remaining ) {
+		if( modem->verbose ) {
+			printf("  End of frame\n");
+		}
+		modem->demod_state = CSS_DEMOD_SEARCH;
+		modem->demod_count = 0;
+	}
+	return 0;
+}
+
+int css_demodulate(css_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t ii;
+	size_t j;
+	size_t n;
+	size_t keep;
+	size_t end;
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+	
+	if( modem->verbose ) {
+		printf("css_demodulate(...)\n");
+	}
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	
+	ii = 0;
+	while( ii < sampleslen ) {
+		//Drop samples that no window can reach anymore
+		keep = (size_t)floor(modem->demod_symbol - modem->samp_per_chip);
+		if( modem->demod_symbol < modem->samp_per_chip ) {
+			keep = 0;
+		}
+		if( keep > modem->demod_bufferpos ) {
+			n = keep - modem->demod_bufferpos;
+			if( n > modem->demod_bufferlen ) {
+				n = modem->demod_bufferlen;
+			}
+			memmove(modem->demod_buffer,modem->demod_buffer+n,sizeof(double)*(modem->demod_bufferlen-n));
+			modem->demod_bufferlen = modem->demod_bufferlen - n;
+			modem->demod_bufferpos = modem->demod_bufferpos + n;
+		}
+		
+		n = modem->demod_bufferalloc - modem->demod_bufferlen;
+		if( n > sampleslen-ii ) {
+			n = sampleslen-ii;
+		}
+		for( j=0; j<n; j++ ) {
+			modem->demod_buffer[modem->demod_bufferlen++] = samples[ii++];
+		}
+		end = modem->demod_bufferpos + modem->demod_bufferlen;
+		
+		while( (size_t)ceil(modem->demod_symbol + (modem->symbol_count-0.5)*modem->samp_per_chip) <= end ) {
+			if( css_demodulate_symbol(modem) ) {
+				return -1;
+			}
+		}
+	}
+	
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+#endif //CSS_IMPLEMENTATION
\ No newline at end of file
@@ -38,19 +38,34 @@
 #define FSK_IMPLEMENTATION
 #define OOK_IMPLEMENTATION
 #define PSKCLK_IMPLEMENTATION
+#define TCM_IMPLEMENTATION
 #define CORR_IMPLEMENTATION
+#define OFDM_IMPLEMENTATION
+#define PULSE_IMPLEMENTATION
+#define SYMSYNC_IMPLEMENTATION
+#define PSK_IMPLEMENTATION
+#define QAM_IMPLEMENTATION
+#define NCFSK_IMPLEMENTATION
+#define CPFSK_IMPLEMENTATION
+#define CSS_IMPLEMENTATION
+#define CONV_IMPLEMENTATION
+#define RS_IMPLEMENTATION
+#define CRC_IMPLEMENTATION
 #define PKT_IMPLEMENTATION
 #define AUDIOMODEM_IMPLEMENTATION
 #include "audiomodem.h"
+#define LT_IMPLEMENTATION
+#include "lt.h"
 
 #define DEFAULT_BITRATE 64
 #define DEFAULT_BANDWIDTH 3000
 #define DEFAULT_SYMBOL_COUNT 4
 #define DEFAULT_FREQUENCY 1000
 
-typedef enum {OPT_NONE,OPT_FSK,OPT_FSKCLK,OPT_OOK,OPT_PSKCLK,OPT_CORRFSK,OPT_CORRPSK,OPT_CORRFPSK} modemopt_t;
-
 void usage(char* cmd) {
+	const audiomodem_ops_t **ops;
+	size_t opslen;
+	size_t j;
 	char* filename = cmd+strlen(cmd);
 	while( filename > cmd ) {
 		if( *(filename-1) == '/' ) {
@@ -58,8 +73,13 @@ void usage(char* cmd) {
 		}
 		filename--;
 	}
-	printf("Usage: %s [-h] [-v] [-p] [-fsk | -fskclk | -ook | -pskclk | -cfsk | -cpsk | -cfpsk]\n",filename);
-	printf("  [-r bitrate] [-bw bandwidth] [-c symbol_count] [-f frequency]\n");
+	opslen = audiomodem_registered(&ops);
+	printf("Usage: %s [-h] [-v] [-p [-e fec] [-sd] [-lt]] [",filename);
+	for( j=0; j<opslen; j++ ) {
+		printf("%s-%s",j ? " | " : "",ops[j]->name);
+	}
+	printf("]\n");
+	printf("  [-r bitrate] [-bw bandwidth] [-c symbol_count] [-f frequency] [-ro rolloff]\n");
 	printf("  -i input.wav [-o outpath]\n");
 	printf("\n");
 	printf("Defaults:\n");
@@ -67,6 +87,8 @@ void usage(char* cmd) {
 	printf("  bandwidth: %d\n",DEFAULT_BANDWIDTH);
 	printf("  symbol_count: %d\n",DEFAULT_SYMBOL_COUNT);
 	printf("  frequency: %d\n",DEFAULT_FREQUENCY);
+	printf("  rolloff: none (default symbol envelope)\n");
+	printf("  fec: none (conv12, conv23, conv34, rs)\n");
 	printf("\n");
 	exit(0);
 }
@@ -85,11 +107,20 @@ int main(int argc, char** argv) {
 	int fd;
 	int verbose = 0;
 	int use_pkt = 0;
-	modemopt_t modemopt = OPT_NONE;
+	pkt_fec_t fec = PKT_FEC_NONE;
+	int use_lt = 0;
+	int use_soft = 0;
+	lt_t *lt = 0;
+	pktdata_t *pkts;
+	size_t pktslen;
+	size_t j;
+	const audiomodem_ops_t *modemops = 0;
+	audiomodem_config_t config;
 	size_t bitrate = 0;
 	size_t bandwidth = 0;
 	size_t symbol_count = 0;
 	size_t frequency = 0;
+	double rolloff = 0.0;
 	int i = 1;
 	
 	while( i < argc ) {
@@ -105,47 +136,38 @@ int main(int argc, char** argv) {
 			}
 			use_pkt = 1;
 		}
-		else if( !strcmp(argv[i],"-fsk") ) {
-			if( modemopt != OPT_NONE ) {
+		else if( !strcmp(argv[i],"-e") ) {
+			++i;
+			if( i >= argc || fec != PKT_FEC_NONE ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_FSK;
-		}
-		else if( !strcmp(argv[i],"-fskclk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			if( !strcmp(argv[i],"conv12") ) {
+				fec = PKT_FEC_CONV_1_2;
 			}
-			modemopt = OPT_FSKCLK;
-		}
-		else if( !strcmp(argv[i],"-ook") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"conv23") ) {
+				fec = PKT_FEC_CONV_2_3;
 			}
-			modemopt = OPT_OOK;
-		}
-		else if( !strcmp(argv[i],"-pskclk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"conv34") ) {
+				fec = PKT_FEC_CONV_3_4;
 			}
-			modemopt = OPT_PSKCLK;
-		}
-		else if( !strcmp(argv[i],"-cfsk") ) {
-			if( modemopt != OPT_NONE ) {
+			else if( !strcmp(argv[i],"rs") ) {
+				fec = PKT_FEC_RS;
+			}
+			else if( strcmp(argv[i],"none") ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_CORRFSK;
 		}
-		else if( !strcmp(argv[i],"-cpsk") ) {
-			if( modemopt != OPT_NONE ) {
+		else if( !strcmp(argv[i],"-sd") ) {
+			if( use_soft ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_CORRPSK;
+			use_soft = 1;
 		}
-		else if( !strcmp(argv[i],"-cfpsk") ) {
-			if( modemopt != OPT_NONE ) {
+		else if( !strcmp(argv[i],"-lt") ) {
+			if( use_lt ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_CORRFPSK;
+			use_lt = 1;
 		}
 		else if( !strcmp(argv[i],"-r") ) {
 			++i;
@@ -187,6 +209,16 @@ int main(int argc, char** argv) {
 				usage(argv[0]);
 			}
 		}
+		else if( !strcmp(argv[i],"-ro") ) {
+			++i;
+			if( i >= argc || rolloff > 0.0 ) {
+				usage(argv[0]);
+			}
+			rolloff = strtod(argv[i],0);
+			if( rolloff <= 0.0 || rolloff > 1.0 ) {
+				usage(argv[0]);
+			}
+		}
 		else if( !strcmp(argv[i],"-o") ) {
 			++i;
 			if( i >= argc || outpath ) {
@@ -201,13 +233,28 @@ int main(int argc, char** argv) {
 			}
 			inpath = argv[i];
 		}
+		else if( argv[i][0] == '-' && audiomodem_lookup(argv[i]+1) ) {
+			if( modemops ) {
+				usage(argv[0]);
+			}
+			modemops = audiomodem_lookup(argv[i]+1);
+		}
 		else {
 			usage(argv[0]);
 		}
 		++i;
 	}
 
-	if( modemopt == OPT_NONE ) {
+	if( !modemops ) {
+		usage(argv[0]);
+	}
+	if( fec != PKT_FEC_NONE && !use_pkt ) {
+		usage(argv[0]);
+	}
+	if( use_lt && !use_pkt ) {
+		usage(argv[0]);
+	}
+	if( use_soft && !use_pkt ) {
 		usage(argv[0]);
 	}
 	if( !inpath ) {
@@ -241,41 +288,46 @@ int main(int argc, char** argv) {
 		}
 	}
 	
-	if( modemopt == OPT_FSKCLK ) {
-		modem = audiomodem_fskclk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
-	else if( modemopt == OPT_FSK ) {
-		modem = audiomodem_fsk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
-	else if( modemopt == OPT_OOK ) {
-		modem = audiomodem_ook_init(sfinfo.samplerate,bitrate,bandwidth,frequency);
-	}
-	else if( modemopt == OPT_PSKCLK ) {
-		modem = audiomodem_pskclk_init(sfinfo.samplerate,bitrate,bandwidth,frequency,symbol_count);
-	}
-	else if( modemopt == OPT_CORRFSK ) {
-		modem = audiomodem_corrfsk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
-	else if( modemopt == OPT_CORRPSK ) {
-		modem = audiomodem_corrpsk_init(sfinfo.samplerate,bitrate,frequency,symbol_count);
-	}
-	else if( modemopt == OPT_CORRFPSK ) {
-		modem = audiomodem_corrfpsk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
+	config.samplerate = sfinfo.samplerate;
+	config.bitrate = bitrate;
+	config.bandwidth = bandwidth;
+	config.freq = frequency;
+	config.symbol_count = symbol_count;
+	modem = audiomodem_ops_init(modemops,&config);
 	if( !modem ) {
 		printf("Failed to create modem\n");
 		exit(0);
 	}
+	if( rolloff > 0.0 && audiomodem_set_pulse(modem,rolloff) ) {
+		printf("Failed to set pulse shaping\n");
+		exit(0);
+	}
 	if( use_pkt ) {
 		if( audiomodem_pkt_init(modem) ) {
 			printf("Failed to create packet framer\n");
 			exit(0);
 		}
+		if( pkt_set_fec(modem->pkt,fec) ) {
+			printf("Failed to set packet fec\n");
+			exit(0);
+		}
+		if( use_soft && audiomodem_set_soft(modem,1) ) {
+			printf("Failed to enable soft decisions\n");
+			exit(0);
+		}
 	}
 	if( verbose ) {
 		audiomodem_printinfo(modem);
 		audiomodem_set_verbose(modem,verbose);
 	}
+	if( use_lt ) {
+		lt = lt_init();
+		if( !lt ) {
+			printf("Failed to create fountain decoder\n");
+			exit(0);
+		}
+		lt_set_verbose(lt,verbose);
+	}
 	
 	samples = (double*)malloc(sizeof(double)*sfinfo.samplerate);
 	if( !samples ) {
@@ -295,7 +347,22 @@ int main(int argc, char** argv) {
 			//Read upto a second of audio
 			samples_len = sf_readf_double(sndfile,samples,sfinfo.samplerate);
 		}
-		if( audiomodem_demodulate(modem, &data, &data_len, samples, samples_len) ) {
+		if( use_lt ) {
+			//Each packet is one fountain symbol, and nothing is output 
+			//until the whole file has been rebuilt
+			if( audiomodem_demodulate_pkts(modem, &pkts, &pktslen, samples, samples_len) ) {
+				printf("Failed to demodulate\n");
+				exit(0);
+			}
+			data_len = 0;
+			for( j=0; j<pktslen && !data_len; j++ ) {
+				if( lt_decode(lt, &data, &data_len, pkts[j].data, pkts[j].len) ) {
+					printf("Failed to decode fountain symbol\n");
+					exit(0);
+				}
+			}
+		}
+		else if( audiomodem_demodulate(modem, &data, &data_len, samples, samples_len) ) {
 			printf("Failed to demodulate\n");
 			exit(0);
 		}
@@ -319,6 +386,9 @@ int main(int argc, char** argv) {
 	if( modem ) {
 		audiomodem_destroy(modem);
 	}
+	if( lt ) {
+		lt_destroy(lt);
+	}
 	free(samples);
 	sf_close(sndfile);
 	return 0;
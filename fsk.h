@@ -57,6 +57,7 @@ typedef struct {
 	double  *mod_samples;
 	size_t   mod_sampleslen;
 	double   sym_freq;
+	pulse_t *mod_taper;
 	
 	srcfft_t *srcfft;
 	fsk_demod_state_t demod_state;
@@ -66,10 +67,7 @@ typedef struct {
 	double     demod_thresh;
 	size_t     demod_databin;
 	
-	uint8_t    demod_bytes[2];
-	uint8_t    demod_bit_count;
-	uint8_t   *demod_data;
-	size_t     demod_datalen;
+	bitstream_t demod_bits;
 } fsk_t;
 
 
@@ -77,9 +75,13 @@ fsk_t *fsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone
 void   fsk_destroy(fsk_t *modem);
 int    fsk_set_thresh(fsk_t *modem, double thresh);
 int    fsk_set_verbose(fsk_t *modem, int verbose);
+int    fsk_set_soft(fsk_t *modem, int on);
+int    fsk_soft(fsk_t *modem, int8_t **soft, size_t *softlen);
+int    fsk_set_pulse(fsk_t *modem, double rolloff);
 void   fsk_printinfo(fsk_t *modem);
 int    fsk_modulate(fsk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
 int    fsk_demodulate(fsk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+int    fsk_demodulate_fft(fsk_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen);
 
 #endif //__FSK_H__
 
@@ -100,6 +102,7 @@ fsk_t *fsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone
 	modem = (fsk_t*)malloc(sizeof(fsk_t));
 	if( !modem ) { goto fsk_init_error; }
 	memset(modem,0,sizeof(fsk_t));
+	bitstream_init_alloc(&modem->demod_bits);
 	
 	modem->verbose = FSK_DEFAULT_VERBOSE;
 	
@@ -149,8 +152,9 @@ void fsk_destroy(fsk_t *modem) {
 	if( modem ) {
 		if( modem->tones ) { free(modem->tones); }
 		if( modem->srcfft ) { srcfft_destroy(modem->srcfft); }
+		if( modem->mod_taper ) { pulse_destroy(modem->mod_taper); }
 		if( modem->mod_samples ) { free(modem->mod_samples); }
-		if( modem->demod_data ) { free(modem->demod_data); }
+		bitstream_destroy(&modem->demod_bits);
 		memset(modem,0,sizeof(fsk_t));
 		free(modem);
 	}
@@ -173,6 +177,36 @@ int fsk_set_verbose(fsk_t *modem, int verbose) {
 	return 0;
 }
 
+int fsk_set_soft(fsk_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int fsk_soft(fsk_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+int fsk_set_pulse(fsk_t *modem, double rolloff) {
+	//Send each symbol as a raised cosine pulse of the given roll-off and
+	//window the receive FFTs to match.  0 restores the half sine envelope.
+	pulse_t *taper = 0;
+	
+	if( !modem ) { return -1; }
+	if( rolloff != 0.0 ) {
+		taper = pulse_taper_init(modem->mod_samp_per_sym,rolloff);
+		if( !taper ) { return -1; }
+	}
+	if( srcfft_set_taper(modem->srcfft,rolloff) ) {
+		pulse_destroy(taper);
+		return -1;
+	}
+	pulse_destroy(modem->mod_taper);
+	modem->mod_taper = taper;
+	//The window moves the best frequency within each bin
+	return fsk_set_thresh(modem,modem->demod_thresh);
+}
+
 void fsk_printinfo(fsk_t *modem) {
 	size_t i;
 	size_t j;
@@ -184,6 +218,9 @@ void fsk_printinfo(fsk_t *modem) {
 	printf("  Bits per Symbol       : %zu\n",modem->bit_per_tone);
 	printf("  Samples per Symbol    : %zu\n",modem->mod_samp_per_sym);
 	printf("  Demod Samples per FFT : %zu\n",modem->demod_samp_per_fft);
+	if( modem->mod_taper ) {
+		printf("  Pulse Roll-off        : %0.2lf\n",modem->mod_taper->shape);
+	}
 	printf("  Tones(%zu):\n",modem->tone_count);
 	for( i=0; i<modem->tone_count; i++ ) {
 		printf("    0x%02lx: %04.1lf Hz\n",i,modem->tones[i]);
@@ -194,7 +231,7 @@ int fsk_modulate(fsk_t *modem, double **samples, size_t *sampleslen, uint8_t *da
 	size_t symbol_idx;
 	size_t symbol_count;
 	size_t sample_count;
-	size_t bit_idx;
+	bitstream_t bits;
 	size_t ii;
 	size_t mod_sampleslen;
 	double *mod_samples;
@@ -224,26 +261,37 @@ int fsk_modulate(fsk_t *modem, double **samples, size_t *sampleslen, uint8_t *da
 	}
 	
 	mod_sampleslen = modem->mod_samp_per_sym*symbol_count;
+	if( modem->mod_taper ) {
+		//The last symbol's trailing ramp
+		mod_sampleslen = mod_sampleslen + modem->mod_taper->len - modem->mod_samp_per_sym;
+	}
 	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
 	if( !mod_samples ) {
 		goto fsk_modulate_error;
 	}
 	modem->mod_samples = mod_samples;
 	modem->mod_sampleslen = mod_sampleslen;
+	memset(mod_samples,0,sizeof(double)*mod_sampleslen);
 	
 	ii = 0;
-	bit_idx = 0;
+	bitstream_init(&bits, data, datalen);
 	for( symbol_idx=0; symbol_idx<symbol_count; symbol_idx++ ) {
 		//Generate a bit of data
-		sym = getbits(data, datalen, bit_idx, modem->bit_per_tone);
+		sym = bitstream_read(&bits, modem->bit_per_tone);
 		if( modem->verbose ) {
 			printf("  Symbol[%zu]=0x%02x modulated to frequency %04.1lf Hz\n",symbol_idx,sym,modem->tones[sym]);
 		}
-		bit_idx = bit_idx + modem->bit_per_tone;
-		for( sample_count=0; sample_count<modem->mod_samp_per_sym; sample_count++ ) {
-			mod_samples[ii] = sin(2*M_PI*modem->tones[sym]*ii/modem->samplerate) *
-			                  sin(2*M_PI*modem->sym_freq*ii/modem->samplerate);
-			ii++;
+		if( modem->mod_taper ) {
+			//Raised cosine pulses overlap their neighbours on the ramps
+			pulse_taper_add(modem->mod_taper,mod_samples,ii,modem->tones[sym],0.0,modem->samplerate);
+			ii = ii + modem->mod_samp_per_sym;
+		}
+		else {
+			for( sample_count=0; sample_count<modem->mod_samp_per_sym; sample_count++ ) {
+				mod_samples[ii] = sin(2*M_PI*modem->tones[sym]*ii/modem->samplerate) *
+				                  sin(2*M_PI*modem->sym_freq*ii/modem->samplerate);
+				ii++;
+			}
 		}
 	}
 	
@@ -257,10 +305,98 @@ int fsk_modulate(fsk_t *modem, double **samples, size_t *sampleslen, uint8_t *da
 	return -1;
 }
 
+static int fsk_demodulate_result(fsk_t *modem) {
+	//Advance the demodulator by one FFT result held in modem->srcfft
+	int      sym;
+	double   llr[32];
+	
+	if( modem->verbose ) {
+		srcfft_printresult(modem->srcfft);
+	}
+	
+	//Check for signal
+	if( !modem->srcfft->detectlen ) {
+		//Not a definate peak
+		if( modem->demod_state != FSK_DEMOD_SEARCH ) {
+			modem->demod_sync_loss++;
+			if( modem->demod_sync_loss >= FSK_OVERSAMPLE ) {
+				if( modem->verbose ) {
+					printf("  Sync lost\n");
+				}
+				modem->demod_state = FSK_DEMOD_SEARCH;
+			}
+		}
+		return 0;
+	}
+	
+	modem->demod_sync_loss = 0;
+	sym = modem->srcfft->maxbin;
+	if( modem->demod_state == FSK_DEMOD_SEARCH ) {
+		//First sample of a new data
+		modem->demod_state = FSK_DEMOD_ACQUIRE;
+		modem->demod_databin = sym;
+	}
+	else if( modem->demod_state == FSK_DEMOD_ACQUIRE ) {
+		//Possible second sample of data
+		if( modem->demod_databin != sym ) {
+			//Not the data we expected, see if we get this one twice
+			modem->demod_state = FSK_DEMOD_ACQUIRE;
+			modem->demod_databin = sym;
+		}
+		else {
+			//Detected data - reset state to look for next symbol
+			modem->demod_state = FSK_DEMOD_DETECTED;
+			modem->demod_fft_skip = FSK_OVERSAMPLE - 2;
+			if( modem->verbose ) {
+				printf("  Found data 0x%02x\n",sym);
+			}
+			
+			if( modem->demod_bits.softon ) {
+				bitstream_soft_demap(modem->srcfft->mag,modem->tone_count,modem->bit_per_tone,modem->srcfft->maxmag,llr);
+			}
+			if( bitstream_write_soft(&modem->demod_bits, modem->bit_per_tone, sym, llr) ) {
+				if( modem->verbose ) {
+					printf("    Failed to grow data buffer\n");
+				}
+				return -1;
+			}
+		}
+	}
+	else if( modem->demod_state == FSK_DEMOD_DETECTED ) {
+		if( modem->demod_databin != sym ) {
+			//Changed before we expected
+			modem->demod_fft_skip = 0;
+			modem->demod_state = FSK_DEMOD_ACQUIRE;
+			modem->demod_databin = sym;
+		}
+		else {
+			modem->demod_fft_skip--;
+			if( !modem->demod_fft_skip ) {
+				modem->demod_state = FSK_DEMOD_SEARCH;
+			}
+		}
+	}
+	return 0;
+}
+
+static int fsk_demodulate_output(fsk_t *modem, uint8_t **data, size_t *datalen) {
+	size_t   ii;
+	
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( ii=0; ii<*datalen; ii++ ) {
+			printf("%02x ",(*data)[ii]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
 int fsk_demodulate(fsk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
 	size_t   ii;
-	uint8_t *tmpdata;
-	int      sym;
 	srcfft_status_t result;
 	
 	if( !modem ) { return -1; }
@@ -272,9 +408,9 @@ int fsk_demodulate(fsk_t *modem, uint8_t **data, size_t *datalen, double *sample
 		printf("fsk_demodulate(...)\n");
 	}
 	
-	modem->demod_datalen = 0;
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
 	
 	ii = 0;
 	while( ii < sampleslen ) {
@@ -289,92 +425,39 @@ int fsk_demodulate(fsk_t *modem, uint8_t **data, size_t *datalen, double *sample
 		else if( result == SRCFFT_NEED_MORE ) {
 			continue;
 		}
-		if( modem->verbose ) {
-			srcfft_printresult(modem->srcfft);
-		}
-		
-		//Check for signal
-		if( !modem->srcfft->detectlen ) {
-			//Not a definate peak
-			if( modem->demod_state != FSK_DEMOD_SEARCH ) {
-				modem->demod_sync_loss++;
-				if( modem->demod_sync_loss >= FSK_OVERSAMPLE ) {
-					if( modem->verbose ) {
-						printf("  Sync lost\n");
-					}
-					modem->demod_state = FSK_DEMOD_SEARCH;
-				}
-			}
-			continue;
-		}
-		
-		modem->demod_sync_loss = 0;
-		sym = modem->srcfft->maxbin;
-		if( modem->demod_state == FSK_DEMOD_SEARCH ) {
-			//First sample of a new data
-			modem->demod_state = FSK_DEMOD_ACQUIRE;
-			modem->demod_databin = sym;
-		}
-		else if( modem->demod_state == FSK_DEMOD_ACQUIRE ) {
-			//Possible second sample of data
-			if( modem->demod_databin != sym ) {
-				//Not the data we expected, see if we get this one twice
-				modem->demod_state = FSK_DEMOD_ACQUIRE;
-				modem->demod_databin = sym;
-			}
-			else {
-				//Detected data - reset state to look for next symbol
-				modem->demod_state = FSK_DEMOD_DETECTED;
-				modem->demod_fft_skip = FSK_OVERSAMPLE - 2;
-				if( modem->verbose ) {
-					printf("  Found data 0x%02x\n",sym);
-				}
-				
-				putbits(modem->demod_bytes, sizeof(modem->demod_bytes), modem->demod_bit_count, modem->bit_per_tone, sym);
-				modem->demod_bit_count = modem->demod_bit_count + modem->bit_per_tone;
-				if( modem->demod_bit_count >= 8 ) {
-					//Push a demodulated byte
-					tmpdata = (uint8_t*)realloc(modem->demod_data,sizeof(uint8_t)*(modem->demod_datalen+1));
-					if( !tmpdata ) {
-						if( modem->verbose ) {
-							printf("      Failed to reallocate data buffer\n");
-						}
-						return -1;
-					}
-					modem->demod_data = tmpdata;
-					modem->demod_data[modem->demod_datalen] = modem->demod_bytes[0];
-					modem->demod_datalen++;
-					modem->demod_bytes[0] = modem->demod_bytes[1];
-					modem->demod_bytes[1] = 0;
-					modem->demod_bit_count = modem->demod_bit_count - 8;
-				}
-			}
+		if( fsk_demodulate_result(modem) ) {
+			return -1;
 		}
-		else if( modem->demod_state == FSK_DEMOD_DETECTED ) {
-			if( modem->demod_databin != sym ) {
-				//Changed before we expected
-				modem->demod_fft_skip = 0;
-				modem->demod_state = FSK_DEMOD_ACQUIRE;
-				modem->demod_databin = sym;
-			}
-			else {
-				modem->demod_fft_skip--;
-				if( !modem->demod_fft_skip ) {
-					modem->demod_state = FSK_DEMOD_SEARCH;
-				}
+	}
+	return fsk_demodulate_output(modem,data,datalen);
+}
+
+int fsk_demodulate_fft(fsk_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen) {
+	//Same as fsk_demodulate, but starts from spectra already produced by 
+	//a front-end with the same resampling and FFT size as modem->srcfft
+	size_t   ii;
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !spectra && spectralen ) { return -1; }
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	
+	for( ii=0; ii<spectralen; ii++ ) {
+		if( srcfft_reduce(modem->srcfft,spectra+ii*srcfft_spectrum_len(modem->srcfft)) == SRCFFT_ERROR ) {
+			if( modem->verbose ) {
+				printf("  FFT failed\n");
 			}
+			return -1;
 		}
-	}
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
-	if( modem->verbose ) {
-		printf("  Data: ");
-		for( ii=0; ii<modem->demod_datalen; ii++ ) {
-			printf("%02x ",modem->demod_data[ii]);
+		if( fsk_demodulate_result(modem) ) {
+			return -1;
 		}
-		printf("\n");
 	}
-	return 0;
+	return fsk_demodulate_output(modem,data,datalen);
 }
 
 
@@ -53,15 +53,19 @@ typedef struct {
 	size_t   bandwidth;
 	size_t   bit_per_tone;
 	size_t   tone_count;
+	size_t   tones_per_sym;
 	double  *tones;
 	size_t  *tonesidx;
 	size_t   clkidx;
+	size_t  *sym_tones;
+	double  *sym_mags;
 	
 	size_t   mod_samp_per_sym;
 	size_t   demod_samp_per_fft;
 	double  *mod_samples;
 	size_t   mod_sampleslen;
 	double   sym_freq;
+	pulse_t *mod_taper;
 	
 	srcfft_t *srcfft;
 	fskclk_demod_state_t demod_state;
@@ -69,20 +73,22 @@ typedef struct {
 	double     demod_thresh;
 	size_t     demod_databin;
 	
-	uint8_t    demod_bytes[2];
-	uint8_t    demod_bit_count;
-	uint8_t   *demod_data;
-	size_t     demod_datalen;
+	bitstream_t demod_bits;
 } fskclk_t;
 
 
 fskclk_t *fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone_count);
+fskclk_t *fskclk_mfsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone_count, size_t tones_per_sym);
 void      fskclk_destroy(fskclk_t *modem);
 int       fskclk_set_thresh(fskclk_t *modem, double thresh);
 int       fskclk_set_verbose(fskclk_t *modem, int verbose);
+int       fskclk_set_soft(fskclk_t *modem, int on);
+int       fskclk_soft(fskclk_t *modem, int8_t **soft, size_t *softlen);
+int       fskclk_set_pulse(fskclk_t *modem, double rolloff);
 void      fskclk_printinfo(fskclk_t *modem);
 int       fskclk_modulate(fskclk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
 int       fskclk_demodulate(fskclk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+int       fskclk_demodulate_fft(fskclk_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen);
 
 #endif //__FSKCLK_H__
 
@@ -92,25 +98,76 @@ int       fskclk_demodulate(fskclk_t *modem, uint8_t **data, size_t *datalen, do
 
 #define FSKCLK_OVERSAMPLE 4
 
+static uint64_t fskclk_choose(size_t n, size_t k) {
+	//Binomial coefficient, 0 when k > n
+	uint64_t r = 1;
+	size_t i;
+	
+	if( k > n ) { return 0; }
+	for( i=0; i<k; i++ ) {
+		r = r * (n-i) / (i+1);
+	}
+	return r;
+}
+
+static void fskclk_unrank(fskclk_t *modem, uint64_t rank, size_t *idx) {
+	//Combinatorial number system: the data tones (ascending) of the rank'th
+	//combination of tones_per_sym out of tone_count-1
+	size_t i;
+	size_t c = modem->tone_count-1;
+	
+	for( i=modem->tones_per_sym; i>0; i-- ) {
+		do {
+			c--;
+		} while( fskclk_choose(c,i) > rank );
+		idx[i-1] = c;
+		rank = rank - fskclk_choose(c,i);
+	}
+}
+
 fskclk_t *fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone_count) {
+	return fskclk_mfsk_init(samplerate,bitrate,bandwidth,tone_count,1);
+}
+
+fskclk_t *fskclk_mfsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t tone_count, size_t tones_per_sym) {
+	//Each symbol sends tones_per_sym of the data tones at once, so it
+	//carries log2(data tones choose tones_per_sym) bits from the same FFTs
 	fskclk_t *modem;
 	size_t i;
+	size_t data_tones;
+	uint64_t combos;
 	
 	//Double check arguments
 	if( samplerate < (bandwidth * 2) ) { return 0; }
 	if( tone_count < 2 ) { return 0; }
+	if( tones_per_sym < 1 ) { return 0; }
 	
 	modem = (fskclk_t*)malloc(sizeof(fskclk_t));
 	if( !modem ) { goto fskclk_init_error; }
 	memset(modem,0,sizeof(fskclk_t));
+	bitstream_init_alloc(&modem->demod_bits);
 	
 	modem->verbose = FSKCLK_DEFAULT_VERBOSE;
 	
-	modem->bit_per_tone = 1;
-	while( 1<<modem->bit_per_tone < tone_count ) {
+	data_tones = 2;
+	while( data_tones < tone_count ) {
+		data_tones = data_tones*2;
+	}
+	if( tones_per_sym >= data_tones ) { goto fskclk_init_error; }
+	modem->tone_count = data_tones+1;
+	modem->tones_per_sym = tones_per_sym;
+	
+	//Only whole bits are sent, so some combinations go unused
+	combos = fskclk_choose(data_tones,tones_per_sym);
+	modem->bit_per_tone = 0;
+	while( modem->bit_per_tone < 31 && (2ULL << modem->bit_per_tone) <= combos ) {
 		modem->bit_per_tone++;
 	}
-	modem->tone_count = (1 << modem->bit_per_tone)+1;
+	if( !modem->bit_per_tone ) { goto fskclk_init_error; }
+	modem->sym_tones = (size_t*)malloc(sizeof(size_t)*tones_per_sym);
+	if( !modem->sym_tones ) { goto fskclk_init_error; }
+	modem->sym_mags = (double*)malloc(sizeof(double)*data_tones);
+	if( !modem->sym_mags ) { goto fskclk_init_error; }
 	
 	modem->samplerate = samplerate;
 	modem->bitrate = bitrate;
@@ -135,8 +192,7 @@ fskclk_t *fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_
 	modem->demod_thresh = FSKCLK_DEFAULT_THRESH;
 	
 	//Calculate optimal frequencies to use
-	if( fskcalibrate(modem->tones, modem->tone_count, modem->srcfft, 
-	                 modem->samplerate, modem->bandwidth, modem->demod_thresh) ) {
+	if( fskclk_set_thresh(modem,modem->demod_thresh) ) {
 		goto fskclk_init_error;
 	}
 	
@@ -167,9 +223,12 @@ fskclk_t *fskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_
 void fskclk_destroy(fskclk_t *modem) {
 	if( modem ) {
 		if( modem->tones ) { free(modem->tones); }
+		if( modem->sym_tones ) { free(modem->sym_tones); }
+		if( modem->sym_mags ) { free(modem->sym_mags); }
 		if( modem->srcfft ) { srcfft_destroy(modem->srcfft); }
+		if( modem->mod_taper ) { pulse_destroy(modem->mod_taper); }
 		if( modem->mod_samples ) { free(modem->mod_samples); }
-		if( modem->demod_data ) { free(modem->demod_data); }
+		bitstream_destroy(&modem->demod_bits);
 		memset(modem,0,sizeof(fskclk_t));
 		free(modem);
 	}
@@ -179,8 +238,9 @@ void fskclk_destroy(fskclk_t *modem) {
 int fskclk_set_thresh(fskclk_t *modem, double thresh) {
 	if( !modem ) { return -1; }
 	modem->demod_thresh = thresh;
+	//Tones are sent at 1/tones_per_sym of full scale
 	if( fskcalibrate(modem->tones, modem->tone_count, modem->srcfft, 
-	                 modem->samplerate, modem->bandwidth, modem->demod_thresh) ) {
+	                 modem->samplerate, modem->bandwidth, modem->demod_thresh/modem->tones_per_sym) ) {
 		return -1;
 	}
 	return 0;
@@ -192,6 +252,37 @@ int fskclk_set_verbose(fskclk_t *modem, int verbose) {
 	return 0;
 }
 
+int fskclk_set_soft(fskclk_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int fskclk_soft(fskclk_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+int fskclk_set_pulse(fskclk_t *modem, double rolloff) {
+	//Send the clock and data halves of each symbol as raised cosine pulses
+	//of the given roll-off and window the receive FFTs to match.  0 
+	//restores the half sine envelope.
+	pulse_t *taper = 0;
+	
+	if( !modem ) { return -1; }
+	if( rolloff != 0.0 ) {
+		taper = pulse_taper_init(modem->mod_samp_per_sym/2,rolloff);
+		if( !taper ) { return -1; }
+	}
+	if( srcfft_set_taper(modem->srcfft,rolloff) ) {
+		pulse_destroy(taper);
+		return -1;
+	}
+	pulse_destroy(modem->mod_taper);
+	modem->mod_taper = taper;
+	//The window moves the best frequency within each bin
+	return fskclk_set_thresh(modem,modem->demod_thresh);
+}
+
 void fskclk_printinfo(fskclk_t *modem) {
 	size_t i;
 	size_t j;
@@ -201,7 +292,11 @@ void fskclk_printinfo(fskclk_t *modem) {
 	printf("  Bitrate           : %zu bps\n",modem->bitrate);
 	printf("  Bandwidth         : %zu Hz\n",modem->bandwidth);
 	printf("  Bits per Symbol   : %zu\n",modem->bit_per_tone);
+	printf("  Tones per Symbol  : %zu\n",modem->tones_per_sym);
 	printf("  Samples per Symbol: %zu\n",modem->mod_samp_per_sym);
+	if( modem->mod_taper ) {
+		printf("  Pulse Roll-off    : %0.2lf\n",modem->mod_taper->shape);
+	}
 	printf("  Tones(%zu):\n",modem->tone_count);
 	for( i=0; i<modem->tone_count; i++ ) {
 		if( i==modem->clkidx ) {
@@ -221,12 +316,14 @@ int fskclk_modulate(fskclk_t *modem, double **samples, size_t *sampleslen, uint8
 	size_t symbol_idx;
 	size_t symbol_count;
 	size_t sample_count;
-	size_t bit_idx;
+	bitstream_t bits;
 	size_t ii;
+	size_t k;
 	size_t mod_sampleslen;
 	double *mod_samples;
 	int sym;
 	double amp;
+	double x;
 	
 	if( !modem ) { return -1; }
 	if( !samples ) { return -1; }
@@ -251,16 +348,42 @@ int fskclk_modulate(fskclk_t *modem, double **samples, size_t *sampleslen, uint8
 	}
 	
 	mod_sampleslen = modem->mod_samp_per_sym*symbol_count;
+	if( modem->mod_taper ) {
+		//The last half-bit's trailing ramp
+		mod_sampleslen = mod_sampleslen + modem->mod_taper->len - modem->mod_samp_per_sym/2;
+	}
 	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
 	if( !mod_samples ) {
 		goto fskclk_modulate_error;
 	}
 	modem->mod_samples = mod_samples;
 	modem->mod_sampleslen = mod_sampleslen;
+	memset(mod_samples,0,sizeof(double)*mod_sampleslen);
 	
 	ii = 0;
-	bit_idx = 0;
+	bitstream_init(&bits, data, datalen);
 	for( symbol_idx=0; symbol_idx<symbol_count; symbol_idx++ ) {
+		sym = bitstream_read(&bits, modem->bit_per_tone);
+		fskclk_unrank(modem,(uint64_t)sym,modem->sym_tones);
+		if( modem->verbose ) {
+			printf("  Symbol[%zu]=0x%02x modulated to frequency",symbol_idx,sym);
+			for( k=0; k<modem->tones_per_sym; k++ ) {
+				printf(" %04.1lf",modem->tones[modem->tonesidx[modem->sym_tones[k]]]);
+			}
+			printf(" Hz\n");
+		}
+		if( modem->mod_taper ) {
+			//Half-bits of clk and data as raised cosine pulses, which 
+			//overlap their neighbours on the ramps
+			pulse_taper_add(modem->mod_taper,mod_samples,ii,
+			                modem->tones[modem->clkidx],0.0,modem->samplerate);
+			for( k=0; k<modem->tones_per_sym; k++ ) {
+				pulse_taper_add(modem->mod_taper,mod_samples,ii+modem->mod_samp_per_sym/2,
+				                modem->tones[modem->tonesidx[modem->sym_tones[k]]],0.0,modem->samplerate);
+			}
+			ii = ii + modem->mod_samp_per_sym;
+			continue;
+		}
 		//Generate a half-bit of clk
 		for( sample_count=0; sample_count<modem->mod_samp_per_sym/2; sample_count++ ) {
 			mod_samples[ii] = sin(2*M_PI*modem->tones[modem->clkidx]*ii/modem->samplerate) *
@@ -268,18 +391,24 @@ int fskclk_modulate(fskclk_t *modem, double **samples, size_t *sampleslen, uint8
 			ii++;
 		}
 		//Generate a half-bit of data
-		sym = getbits(data, datalen, bit_idx, modem->bit_per_tone);
-		if( modem->verbose ) {
-			printf("  Symbol[%zu]=0x%02x modulated to frequency %04.1lf Hz\n",symbol_idx,sym,modem->tones[modem->tonesidx[sym]]);
-		}
-		bit_idx = bit_idx + modem->bit_per_tone;
 		for( ; sample_count<modem->mod_samp_per_sym; sample_count++ ) {
-			mod_samples[ii] = sin(2*M_PI*modem->tones[modem->tonesidx[sym]]*ii/modem->samplerate) *
-			                  sin(2*M_PI*modem->sym_freq*ii/modem->samplerate);
+			x = 0.0;
+			for( k=0; k<modem->tones_per_sym; k++ ) {
+				x = x + sin(2*M_PI*modem->tones[modem->tonesidx[modem->sym_tones[k]]]*ii/modem->samplerate);
+			}
+			mod_samples[ii] = x * sin(2*M_PI*modem->sym_freq*ii/modem->samplerate);
 			ii++;
 		}
 	}
 	
+	//Keep the sum of the data tones within full scale
+	if( modem->tones_per_sym > 1 ) {
+		amp = 1.0 / (double)modem->tones_per_sym;
+		for( ii=0; ii<mod_sampleslen; ii++ ) {
+			mod_samples[ii] = mod_samples[ii] * amp;
+		}
+	}
+	
 	*samples = mod_samples;
 	*sampleslen = mod_sampleslen;
 	return 0;
@@ -291,11 +420,184 @@ int fskclk_modulate(fskclk_t *modem, double **samples, size_t *sampleslen, uint8
 }
 
 
+static size_t fskclk_demodulate_symbol(fskclk_t *modem) {
+	//Ranks the tones_per_sym strongest data bins of the current FFT as a
+	//combination.  With one tone per symbol this is the data tone of maxbin.
+	size_t *top = modem->sym_tones;
+	size_t  k = modem->tones_per_sym;
+	size_t  n = 0;
+	size_t  i;
+	size_t  j;
+	size_t  t;
+	size_t  rank;
+	double  mag;
+	
+	for( i=0; i<modem->tone_count-1; i++ ) {
+		mag = modem->srcfft->mag[modem->tonesidx[i]];
+		for( j=n; j>0 && mag > modem->srcfft->mag[modem->tonesidx[top[j-1]]]; j-- ) {
+			if( j < k ) { top[j] = top[j-1]; }
+		}
+		if( j < k ) {
+			top[j] = i;
+			if( n < k ) { n++; }
+		}
+	}
+	
+	//Back into ascending tone order
+	for( i=1; i<k; i++ ) {
+		t = top[i];
+		for( j=i; j>0 && top[j-1] > t; j-- ) {
+			top[j] = top[j-1];
+		}
+		top[j] = t;
+	}
+	rank = 0;
+	for( i=0; i<k; i++ ) {
+		rank = rank + fskclk_choose(top[i],i+1);
+	}
+	return rank;
+}
+
+static void fskclk_demodulate_llr(fskclk_t *modem, double *llr) {
+	//Bit confidences for the symbol fskclk_demodulate_symbol just found.  
+	//A single data tone gives max-log values over the data tone magnitudes.  
+	//For a combination, the margin between the weakest chosen tone and the 
+	//strongest one left out goes to all of its bits.
+	size_t  i;
+	size_t  j;
+	double  mag;
+	double  top = 0.0;
+	double  weakest = HUGE_VAL;
+	double  other = 0.0;
+	
+	for( i=0; i<modem->tone_count-1; i++ ) {
+		modem->sym_mags[i] = modem->srcfft->mag[modem->tonesidx[i]];
+		if( modem->sym_mags[i] > top ) { top = modem->sym_mags[i]; }
+	}
+	if( modem->tones_per_sym == 1 ) {
+		bitstream_soft_demap(modem->sym_mags,modem->tone_count-1,modem->bit_per_tone,top,llr);
+		return;
+	}
+	for( i=0; i<modem->tone_count-1; i++ ) {
+		mag = modem->sym_mags[i];
+		for( j=0; j<modem->tones_per_sym && modem->sym_tones[j] != i; j++ );
+		if( j < modem->tones_per_sym ) {
+			if( mag < weakest ) { weakest = mag; }
+		}
+		else if( mag > other ) {
+			other = mag;
+		}
+	}
+	for( i=0; i<modem->bit_per_tone; i++ ) {
+		llr[i] = top > 0.0 ? (weakest-other)/top : 0.0;
+	}
+}
+
+static int fskclk_demodulate_result(fskclk_t *modem) {
+	//Advance the demodulator by one FFT result held in modem->srcfft
+	size_t   sym;
+	double   llr[32];
+	
+	if( modem->verbose ) {
+		srcfft_printresult(modem->srcfft);
+	}
+	
+	//Check for signal
+	if( !modem->srcfft->detectlen ) {
+		//Not a definate peak
+		if( modem->demod_state != FSKCLK_DEMOD_CLK_SEARCH ) {
+			modem->demod_sync_loss++;
+			if( modem->demod_sync_loss >= FSKCLK_OVERSAMPLE ) {
+				if( modem->verbose ) {
+					printf("  Sync lost\n");
+				}
+				modem->demod_state = FSKCLK_DEMOD_CLK_SEARCH;
+			}
+		}
+	} else {
+		modem->demod_sync_loss = 0;
+	}
+	
+	if( modem->srcfft->maxbin == modem->clkidx ) {
+		//Clock Tone
+		if( modem->demod_state == FSKCLK_DEMOD_CLK_ACQUIRE ) {
+			modem->demod_state = FSKCLK_DEMOD_CLK_DETECTED;
+			if( modem->verbose ) {
+				printf("  Found clock\n");
+			}
+			modem->demod_databin = modem->srcfft->maxbin;
+		}
+		else if( modem->demod_state == FSKCLK_DEMOD_CLK_DETECTED ) {
+			//Subsequent sample of our detected clock
+		}
+		else {
+			//First sample of a new clock
+			modem->demod_state = FSKCLK_DEMOD_CLK_ACQUIRE;
+		}
+	}
+	else {
+		//Data Tone
+		if( modem->demod_state == FSKCLK_DEMOD_CLK_ACQUIRE ) {
+			//Confused clock detected, reset
+			modem->demod_state = FSKCLK_DEMOD_CLK_SEARCH;
+		}
+		else if( modem->demod_state == FSKCLK_DEMOD_CLK_DETECTED ) {
+			//First sample of a new data
+			modem->demod_state = FSKCLK_DEMOD_DATA_ACQUIRE;
+			modem->demod_databin = fskclk_demodulate_symbol(modem);
+		}
+		else if( modem->demod_state == FSKCLK_DEMOD_DATA_ACQUIRE ) {
+			//Possible second sample of data
+			sym = fskclk_demodulate_symbol(modem);
+			if( modem->demod_databin != sym ) {
+				//Not the data we expected, try this new one
+				modem->demod_state = FSKCLK_DEMOD_DATA_ACQUIRE;
+				modem->demod_databin = sym;
+			}
+			else {
+				//Detected data
+				modem->demod_state = FSKCLK_DEMOD_DATA_DETECTED;
+				
+				if( modem->verbose ) {
+					printf("  Found data 0x%02zx\n",sym);
+				}
+				if( modem->demod_bits.softon ) {
+					fskclk_demodulate_llr(modem,llr);
+				}
+				if( bitstream_write_soft(&modem->demod_bits, modem->bit_per_tone, (int)sym, llr) ) {
+					if( modem->verbose ) {
+						printf("    Failed to grow data buffer\n");
+					}
+					return -1;
+				}
+			}
+		}
+		else {
+			//Either a subsequent sample of a detected data,
+			//or a spurious tone when searching for clock.
+		}
+	}
+	return 0;
+}
+
+static int fskclk_demodulate_output(fskclk_t *modem, uint8_t **data, size_t *datalen) {
+	size_t   ii;
+	
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( ii=0; ii<*datalen; ii++ ) {
+			printf("%02x ",(*data)[ii]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
 int fskclk_demodulate(fskclk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
 	size_t   ii;
-	size_t   i;
-	uint8_t *tmpdata;
-	int      sym;
 	srcfft_status_t result;
 	
 	if( !modem ) { return -1; }
@@ -307,9 +609,9 @@ int fskclk_demodulate(fskclk_t *modem, uint8_t **data, size_t *datalen, double *
 		printf("fskclk_demodulate(...)\n");
 	}
 	
-	modem->demod_datalen = 0;
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
 	
 	ii = 0;
 	while( ii < sampleslen ) {
@@ -324,112 +626,39 @@ int fskclk_demodulate(fskclk_t *modem, uint8_t **data, size_t *datalen, double *
 		else if( result == SRCFFT_NEED_MORE ) {
 			continue;
 		}
-		if( modem->verbose ) {
-			srcfft_printresult(modem->srcfft);
-		}
-		
-		//Check for signal
-		if( !modem->srcfft->detectlen ) {
-			//Not a definate peak
-			if( modem->demod_state != FSKCLK_DEMOD_CLK_SEARCH ) {
-				modem->demod_sync_loss++;
-				if( modem->demod_sync_loss >= FSKCLK_OVERSAMPLE ) {
-					if( modem->verbose ) {
-						printf("  Sync lost\n");
-					}
-					modem->demod_state = FSKCLK_DEMOD_CLK_SEARCH;
-				}
-			}
-		} else {
-			modem->demod_sync_loss = 0;
-		}
-		
-		if( modem->srcfft->maxbin == modem->clkidx ) {
-			//Clock Tone
-			if( modem->demod_state == FSKCLK_DEMOD_CLK_ACQUIRE ) {
-				modem->demod_state = FSKCLK_DEMOD_CLK_DETECTED;
-				if( modem->verbose ) {
-					printf("  Found clock\n");
-				}
-				modem->demod_databin = modem->srcfft->maxbin;
-			}
-			else if( modem->demod_state == FSKCLK_DEMOD_CLK_DETECTED ) {
-				//Subsequent sample of our detected clock
-			}
-			else {
-				//First sample of a new clock
-				modem->demod_state = FSKCLK_DEMOD_CLK_ACQUIRE;
-			}
+		if( fskclk_demodulate_result(modem) ) {
+			return -1;
 		}
-		else {
-			//Data Tone
-			if( modem->demod_state == FSKCLK_DEMOD_CLK_ACQUIRE ) {
-				//Confused clock detected, reset
-				modem->demod_state = FSKCLK_DEMOD_CLK_SEARCH;
-			}
-			else if( modem->demod_state == FSKCLK_DEMOD_CLK_DETECTED ) {
-				//First sample of a new data
-				modem->demod_state = FSKCLK_DEMOD_DATA_ACQUIRE;
-				modem->demod_databin = modem->srcfft->maxbin;
-			}
-			else if( modem->demod_state == FSKCLK_DEMOD_DATA_ACQUIRE ) {
-				//Possible second sample of data
-				if( modem->demod_databin != modem->srcfft->maxbin ) {
-					//Not the data we expected, try this new one
-					modem->demod_state = FSKCLK_DEMOD_DATA_ACQUIRE;
-					modem->demod_databin = modem->srcfft->maxbin;
-				}
-				else {
-					//Detected data
-					modem->demod_state = FSKCLK_DEMOD_DATA_DETECTED;
-					
-					//Find the symbol for this tone
-					for( i=0; i<modem->tone_count-1; i++ ) {
-						if( modem->tonesidx[i] == modem->srcfft->maxbin ) {
-							sym = (int)i;
-							break;
-						}
-					}
-			
-					if( modem->verbose ) {
-						printf("  Found data 0x%02x\n",sym);
-					}
-					putbits(modem->demod_bytes, sizeof(modem->demod_bytes), modem->demod_bit_count, modem->bit_per_tone, sym);
-					modem->demod_bit_count = modem->demod_bit_count + modem->bit_per_tone;
-					if( modem->demod_bit_count >= 8 ) {
-						//Push a demodulated byte
-						tmpdata = (uint8_t*)realloc(modem->demod_data,sizeof(uint8_t)*(modem->demod_datalen+1));
-						if( !tmpdata ) {
-							if( modem->verbose ) {
-								printf("      Failed to reallocate data buffer\n");
-							}
-							return -1;
-						}
-						modem->demod_data = tmpdata;
-						modem->demod_data[modem->demod_datalen] = modem->demod_bytes[0];
-						modem->demod_datalen++;
-						modem->demod_bytes[0] = modem->demod_bytes[1];
-						modem->demod_bytes[1] = 0;
-						modem->demod_bit_count = modem->demod_bit_count - 8;
-					}
-				}
-			}
-			else {
-				//Either a subsequent sample of a detected data,
-				//or a spurious tone when searching for clock.
+	}
+	return fskclk_demodulate_output(modem,data,datalen);
+}
+
+int fskclk_demodulate_fft(fskclk_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen) {
+	//Same as fskclk_demodulate, but starts from spectra already produced by 
+	//a front-end with the same resampling and FFT size as modem->srcfft
+	size_t   ii;
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !spectra && spectralen ) { return -1; }
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	
+	for( ii=0; ii<spectralen; ii++ ) {
+		if( srcfft_reduce(modem->srcfft,spectra+ii*srcfft_spectrum_len(modem->srcfft)) == SRCFFT_ERROR ) {
+			if( modem->verbose ) {
+				printf("  FFT failed\n");
 			}
+			return -1;
 		}
-	}
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
-	if( modem->verbose ) {
-		printf("  Data: ");
-		for( ii=0; ii<modem->demod_datalen; ii++ ) {
-			printf("%02x ",modem->demod_data[ii]);
+		if( fskclk_demodulate_result(modem) ) {
+			return -1;
 		}
-		printf("\n");
 	}
-	return 0;
+	return fskclk_demodulate_output(modem,data,datalen);
 }
 
 
@@ -32,6 +32,11 @@
 
 #define BITOPS_IMPLEMENTATION
 #define CORR_IMPLEMENTATION
+#define SYMSYNC_IMPLEMENTATION
+#define TCM_IMPLEMENTATION
+#define CONV_IMPLEMENTATION
+#define RS_IMPLEMENTATION
+#define CRC_IMPLEMENTATION
 #define PKT_IMPLEMENTATION
 #include "corr.h"
 #include "pkt.h"
@@ -0,0 +1,625 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __LT_H__
+#define __LT_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+//Luby Transform (fountain) erasure code.  The data is cut into k source 
+//symbols and any number of encoded symbols can be generated from it.  
+//Each encoded symbol carries its own header, so the receiver can rebuild 
+//the data from any sufficiently large subset, in any order.
+//
+//Encoded symbol: filelen (32 bits), symsize (16 bits), seed (32 bits), payload
+//Seeds below k are the source symbols themselves (systematic), seeds at or 
+//above k are XORs of a robust soliton distributed number of source symbols.
+
+#define LT_DEFAULT_VERBOSE  0
+#define LT_DEFAULT_SYMSIZE  256
+#define LT_HEADER_LEN       10
+#define LT_SOLITON_C        0.1
+#define LT_SOLITON_DELTA    0.5
+
+typedef struct {
+	uint8_t  *data;
+	uint32_t *nbrs;
+	size_t    degree;
+} ltsym_t;
+
+typedef struct {
+	int       verbose;
+	size_t    symsize;
+	
+	size_t    k;
+	double   *cdf;
+	uint32_t *nbrs;
+	uint8_t  *mark;
+	
+	uint8_t  *tx_sym;
+	
+	uint32_t  rx_filelen;
+	size_t    rx_symsize;
+	int       rx_active;
+	int       rx_done;
+	uint8_t  *rx_data;
+	uint8_t  *rx_known;
+	size_t    rx_knowncount;
+	ltsym_t  *rx_pending;
+	size_t    rx_pendinglen;
+	uint32_t *rx_stack;
+	size_t    rx_received;
+	
+	int       rx_elim;
+	size_t    rx_cols;
+	size_t    rx_words;
+	size_t    rx_rank;
+	uint32_t *rx_colsrc;
+	uint32_t *rx_srccol;
+	uint64_t *rx_rows;
+	uint8_t **rx_rowdata;
+	uint64_t *rx_row;
+} lt_t;
+
+lt_t  *lt_init();
+void   lt_destroy(lt_t *lt);
+int    lt_set_symsize(lt_t *lt, size_t symsize);
+int    lt_set_verbose(lt_t *lt, int verbose);
+size_t lt_source_count(lt_t *lt, size_t datalen);
+int    lt_encode(lt_t *lt, uint8_t **sym, size_t *symlen, uint8_t *data, size_t datalen, uint32_t seed);
+int    lt_decode(lt_t *lt, uint8_t **data, size_t *datalen, uint8_t *sym, size_t symlen);
+
+#endif //__LT_H__
+
+#ifdef LT_IMPLEMENTATION
+#undef LT_IMPLEMENTATION
+
+lt_t *lt_init() {
+	lt_t *lt;
+	
+	lt = (lt_t*)malloc(sizeof(lt_t));
+	if( !lt ) { return 0; }
+	memset(lt,0,sizeof(lt_t));
+	
+	lt->verbose = LT_DEFAULT_VERBOSE;
+	lt->symsize = LT_DEFAULT_SYMSIZE;
+	return lt;
+}
+
+static void lt_rx_reset(lt_t *lt) {
+	size_t i;
+	for( i=0; i<lt->rx_pendinglen; i++ ) {
+		if( lt->rx_pending[i].data ) { free(lt->rx_pending[i].data); }
+		if( lt->rx_pending[i].nbrs ) { free(lt->rx_pending[i].nbrs); }
+	}
+	if( lt->rx_pending ) { free(lt->rx_pending); }
+	if( lt->rx_data ) { free(lt->rx_data); }
+	if( lt->rx_known ) { free(lt->rx_known); }
+	if( lt->rx_stack ) { free(lt->rx_stack); }
+	if( lt->rx_rowdata ) {
+		for( i=0; i<lt->rx_cols; i++ ) {
+			if( lt->rx_rowdata[i] ) { free(lt->rx_rowdata[i]); }
+		}
+		free(lt->rx_rowdata);
+	}
+	if( lt->rx_colsrc ) { free(lt->rx_colsrc); }
+	if( lt->rx_srccol ) { free(lt->rx_srccol); }
+	if( lt->rx_rows ) { free(lt->rx_rows); }
+	if( lt->rx_row ) { free(lt->rx_row); }
+	lt->rx_pending = 0;
+	lt->rx_pendinglen = 0;
+	lt->rx_data = 0;
+	lt->rx_known = 0;
+	lt->rx_knowncount = 0;
+	lt->rx_stack = 0;
+	lt->rx_received = 0;
+	lt->rx_active = 0;
+	lt->rx_done = 0;
+	lt->rx_elim = 0;
+	lt->rx_cols = 0;
+	lt->rx_words = 0;
+	lt->rx_rank = 0;
+	lt->rx_colsrc = 0;
+	lt->rx_srccol = 0;
+	lt->rx_rows = 0;
+	lt->rx_rowdata = 0;
+	lt->rx_row = 0;
+}
+
+void lt_destroy(lt_t *lt) {
+	if( lt ) {
+		lt_rx_reset(lt);
+		if( lt->cdf ) { free(lt->cdf); }
+		if( lt->nbrs ) { free(lt->nbrs); }
+		if( lt->mark ) { free(lt->mark); }
+		if( lt->tx_sym ) { free(lt->tx_sym); }
+		memset(lt,0,sizeof(lt_t));
+		free(lt);
+	}
+}
+
+int lt_set_symsize(lt_t *lt, size_t symsize) {
+	if( !lt ) { return -1; }
+	if( symsize == 0 || symsize > 0xffff ) { return -1; }
+	lt->symsize = symsize;
+	return 0;
+}
+
+int lt_set_verbose(lt_t *lt, int verbose) {
+	if( !lt ) { return -1; }
+	lt->verbose = verbose;
+	return 0;
+}
+
+size_t lt_source_count(lt_t *lt, size_t datalen) {
+	if( !lt ) { return 0; }
+	return (datalen+lt->symsize-1)/lt->symsize;
+}
+
+static int lt_setup(lt_t *lt, size_t k) {
+	//Build the robust soliton degree distribution (as a CDF) for k
+	//source symbols, along with the scratch space for neighbor lists
+	double *rho;
+	double R;
+	double sum;
+	size_t spike;
+	size_t d;
+	void *tmp;
+	
+	if( k == lt->k ) { return 0; }
+	
+	tmp = realloc(lt->cdf,sizeof(double)*(k+1));
+	if( !tmp ) { return -1; }
+	lt->cdf = (double*)tmp;
+	tmp = realloc(lt->nbrs,sizeof(uint32_t)*k);
+	if( !tmp ) { return -1; }
+	lt->nbrs = (uint32_t*)tmp;
+	tmp = realloc(lt->mark,sizeof(uint8_t)*k);
+	if( !tmp ) { return -1; }
+	lt->mark = (uint8_t*)tmp;
+	memset(lt->mark,0,k);
+	
+	rho = lt->cdf;
+	R = LT_SOLITON_C*log((double)k/LT_SOLITON_DELTA)*sqrt((double)k);
+	if( R < 1.0 ) { R = 1.0; }
+	spike = (size_t)((double)k/R);
+	if( spike < 1 ) { spike = 1; }
+	if( spike > k ) { spike = k; }
+	
+	rho[0] = 0.0;
+	sum = 0.0;
+	for( d=1; d<=k; d++ ) {
+		//Ideal soliton
+		if( d == 1 ) {
+			rho[d] = 1.0/(double)k;
+		}
+		else {
+			rho[d] = 1.0/((double)d*(double)(d-1));
+		}
+		//Robust additions
+		if( d < spike ) {
+			rho[d] = rho[d] + R/((double)d*(double)k);
+		}
+		else if( d == spike ) {
+			rho[d] = rho[d] + R*log(R/LT_SOLITON_DELTA)/(double)k;
+		}
+		sum = sum + rho[d];
+	}
+	//Convert to a normalized CDF in place
+	for( d=1; d<=k; d++ ) {
+		rho[d] = rho[d-1] + rho[d]/sum;
+	}
+	lt->cdf[k] = 1.0;
+	lt->k = k;
+	return 0;
+}
+
+static uint32_t lt_rand(uint32_t *state) {
+	uint32_t x = *state;
+	x = x ^ (x << 13);
+	x = x ^ (x >> 17);
+	x = x ^ (x << 5);
+	*state = x;
+	return x;
+}
+
+static size_t lt_neighbors(lt_t *lt, uint32_t seed) {
+	//Fill lt->nbrs with the source symbols combined into encoded symbol seed
+	uint32_t state;
+	double u;
+	size_t degree;
+	size_t lo,hi,mid;
+	size_t i;
+	uint32_t n;
+	
+	if( seed < lt->k ) {
+		lt->nbrs[0] = seed;
+		return 1;
+	}
+	
+	state = (seed * 2654435761u) ^ 0x9E3779B9u;
+	if( !state ) { state = 1; }
+	lt_rand(&state);
+	
+	//Binary search the CDF for the degree
+	u = (double)lt_rand(&state)/4294967296.0;
+	lo = 1;
+	hi = lt->k;
+	while( lo < hi ) {
+		mid = (lo+hi)/2;
+		if( lt->cdf[mid] > u ) { hi = mid; }
+		else { lo = mid+1; }
+	}
+	degree = lo;
+	
+	//Pick distinct neighbors
+	for( i=0; i<degree; ) {
+		n = lt_rand(&state) % lt->k;
+		if( !lt->mark[n] ) {
+			lt->mark[n] = 1;
+			lt->nbrs[i++] = n;
+		}
+	}
+	for( i=0; i<degree; i++ ) {
+		lt->mark[lt->nbrs[i]] = 0;
+	}
+	return degree;
+}
+
+static void lt_xor(uint8_t *dst, uint8_t *src, size_t len) {
+	size_t i;
+	for( i=0; i<len; i++ ) {
+		dst[i] = dst[i] ^ src[i];
+	}
+}
+
+int lt_encode(lt_t *lt, uint8_t **sym, size_t *symlen, uint8_t *data, size_t datalen, uint32_t seed) {
+	size_t k;
+	size_t degree;
+	size_t i;
+	size_t off;
+	size_t len;
+	uint8_t *payload;
+	void *tmp;
+	
+	if( !lt ) { return -1; }
+	if( !sym ) { return -1; }
+	if( !symlen ) { return -1; }
+	if( !data && datalen ) { return -1; }
+	if( datalen > 0xffffffff ) { return -1; }
+	
+	k = lt_source_count(lt,datalen);
+	if( k == 0 ) { return -1; }
+	if( lt_setup(lt,k) ) { return -1; }
+	
+	tmp = realloc(lt->tx_sym,LT_HEADER_LEN+lt->symsize);
+	if( !tmp ) { return -1; }
+	lt->tx_sym = (uint8_t*)tmp;
+	
+	lt->tx_sym[0] = (datalen>>24)&0xff;
+	lt->tx_sym[1] = (datalen>>16)&0xff;
+	lt->tx_sym[2] = (datalen>>8)&0xff;
+	lt->tx_sym[3] = (datalen>>0)&0xff;
+	lt->tx_sym[4] = (lt->symsize>>8)&0xff;
+	lt->tx_sym[5] = (lt->symsize>>0)&0xff;
+	lt->tx_sym[6] = (seed>>24)&0xff;
+	lt->tx_sym[7] = (seed>>16)&0xff;
+	lt->tx_sym[8] = (seed>>8)&0xff;
+	lt->tx_sym[9] = (seed>>0)&0xff;
+	
+	//XOR the neighboring source symbols (the last one is zero padded)
+	payload = lt->tx_sym+LT_HEADER_LEN;
+	memset(payload,0,lt->symsize);
+	degree = lt_neighbors(lt,seed);
+	for( i=0; i<degree; i++ ) {
+		off = lt->nbrs[i]*lt->symsize;
+		len = datalen-off < lt->symsize ? datalen-off : lt->symsize;
+		lt_xor(payload,data+off,len);
+	}
+	
+	if( lt->verbose ) {
+		printf("lt_encode(...): seed %u, degree %zu of %zu\n",seed,degree,k);
+	}
+	
+	*sym = lt->tx_sym;
+	*symlen = LT_HEADER_LEN+lt->symsize;
+	return 0;
+}
+
+static void lt_recover(lt_t *lt, uint32_t src, uint8_t *payload) {
+	//Mark a source symbol as known and peel it out of every pending 
+	//encoded symbol, recovering any that drop to degree one
+	size_t stacklen;
+	size_t i,j;
+	ltsym_t *p;
+	uint8_t *srcdata;
+	
+	if( lt->rx_known[src] ) { return; }
+	memcpy(lt->rx_data+src*lt->rx_symsize,payload,lt->rx_symsize);
+	lt->rx_known[src] = 1;
+	lt->rx_knowncount++;
+	
+	stacklen = 0;
+	lt->rx_stack[stacklen++] = src;
+	while( stacklen ) {
+		src = lt->rx_stack[--stacklen];
+		srcdata = lt->rx_data+src*lt->rx_symsize;
+		for( i=0; i<lt->rx_pendinglen; i++ ) {
+			p = &lt->rx_pending[i];
+			if( p->degree == 0 ) { continue; }
+			for( j=0; j<p->degree; j++ ) {
+				if( p->nbrs[j] == src ) { break; }
+			}
+			if( j == p->degree ) { continue; }
+			lt_xor(p->data,srcdata,lt->rx_symsize);
+			p->nbrs[j] = p->nbrs[--p->degree];
+			if( p->degree == 1 && !lt->rx_known[p->nbrs[0]] ) {
+				memcpy(lt->rx_data+p->nbrs[0]*lt->rx_symsize,p->data,lt->rx_symsize);
+				lt->rx_known[p->nbrs[0]] = 1;
+				lt->rx_knowncount++;
+				lt->rx_stack[stacklen++] = p->nbrs[0];
+				p->degree = 0;
+			}
+			else if( p->degree == 1 ) {
+				p->degree = 0;
+			}
+		}
+	}
+	
+	//Compact out the symbols that are used up
+	for( i=0, j=0; i<lt->rx_pendinglen; i++ ) {
+		if( lt->rx_pending[i].degree ) {
+			lt->rx_pending[j++] = lt->rx_pending[i];
+		}
+		else {
+			free(lt->rx_pending[i].data);
+			free(lt->rx_pending[i].nbrs);
+		}
+	}
+	lt->rx_pendinglen = j;
+}
+
+static size_t lt_lowest(uint64_t *row, size_t from, size_t cols) {
+	//First set column of a bit row at or after column from (cols if none)
+	size_t c;
+	for( c=from; c<cols; c++ ) {
+		if( !(c%64) ) {
+			while( c<cols && !row[c/64] ) { c = c + 64; }
+			if( c >= cols ) { break; }
+		}
+		if( (row[c/64] >> (c%64)) & 1 ) { return c; }
+	}
+	return cols;
+}
+
+static void lt_elim_add(lt_t *lt, uint32_t *nbrs, size_t degree, uint8_t *payload) {
+	//Reduce an encoded symbol against the rows kept so far.  Every row 
+	//is stored under its lowest column, so each step moves the lowest 
+	//column up and a symbol costs at most one pass over the columns.
+	//Takes ownership of payload.
+	size_t words = lt->rx_words;
+	size_t c;
+	size_t j;
+	uint64_t *row = lt->rx_row;
+	uint64_t *pivot;
+	
+	memset(row,0,sizeof(uint64_t)*words);
+	for( j=0; j<degree; j++ ) {
+		c = lt->rx_srccol[nbrs[j]];
+		row[c/64] ^= (uint64_t)1 << (c%64);
+	}
+	c = 0;
+	while( (c = lt_lowest(row,c,lt->rx_cols)) < lt->rx_cols && lt->rx_rowdata[c] ) {
+		pivot = lt->rx_rows+c*words;
+		for( j=c/64; j<words; j++ ) {
+			row[j] ^= pivot[j];
+		}
+		lt_xor(payload,lt->rx_rowdata[c],lt->rx_symsize);
+	}
+	if( c == lt->rx_cols ) {
+		//Nothing new
+		free(payload);
+		return;
+	}
+	memcpy(lt->rx_rows+c*words,row,sizeof(uint64_t)*words);
+	lt->rx_rowdata[c] = payload;
+	lt->rx_rank++;
+}
+
+static int lt_elim_start(lt_t *lt) {
+	//Peeling has stalled with at least as many pending symbols as unknown
+	//source symbols.  From here on the unknowns are solved over GF(2): 
+	//the pending symbols seed the rows, and every later symbol is reduced
+	//into them as it arrives instead of redoing the elimination.
+	size_t k = lt->k;
+	size_t i,c;
+	
+	if( lt->rx_rowdata ) { return -1; }
+	lt->rx_cols = k-lt->rx_knowncount;
+	lt->rx_words = (lt->rx_cols+63)/64;
+	lt->rx_rowdata = (uint8_t**)malloc(sizeof(uint8_t*)*lt->rx_cols);
+	if( !lt->rx_rowdata ) { return -1; }
+	memset(lt->rx_rowdata,0,sizeof(uint8_t*)*lt->rx_cols);
+	lt->rx_colsrc = (uint32_t*)malloc(sizeof(uint32_t)*lt->rx_cols);
+	lt->rx_srccol = (uint32_t*)malloc(sizeof(uint32_t)*k);
+	lt->rx_rows = (uint64_t*)malloc(sizeof(uint64_t)*lt->rx_cols*lt->rx_words);
+	lt->rx_row = (uint64_t*)malloc(sizeof(uint64_t)*lt->rx_words);
+	if( !lt->rx_colsrc || !lt->rx_srccol || !lt->rx_rows || !lt->rx_row ) { 
+		return -1; 
+	}
+	lt->rx_rank = 0;
+	lt->rx_elim = 1;
+	
+	for( i=0, c=0; i<k; i++ ) {
+		if( !lt->rx_known[i] ) {
+			lt->rx_srccol[i] = c;
+			lt->rx_colsrc[c++] = i;
+		}
+	}
+	for( i=0; i<lt->rx_pendinglen; i++ ) {
+		lt_elim_add(lt,lt->rx_pending[i].nbrs,lt->rx_pending[i].degree,lt->rx_pending[i].data);
+		free(lt->rx_pending[i].nbrs);
+	}
+	lt->rx_pendinglen = 0;
+	return 0;
+}
+
+static void lt_elim_finish(lt_t *lt) {
+	//Every column has a row, and each row only reaches above its own 
+	//column, so back substituting from the last row leaves every row 
+	//holding its source symbol alone
+	size_t words = lt->rx_words;
+	size_t c,b;
+	uint64_t *row;
+	
+	for( c=lt->rx_cols; c--; ) {
+		row = lt->rx_rows+c*words;
+		for( b=lt_lowest(row,c+1,lt->rx_cols); b<lt->rx_cols; b=lt_lowest(row,b+1,lt->rx_cols) ) {
+			lt_xor(lt->rx_rowdata[c],lt->rx_rowdata[b],lt->rx_symsize);
+		}
+	}
+	for( c=0; c<lt->rx_cols; c++ ) {
+		memcpy(lt->rx_data+lt->rx_colsrc[c]*lt->rx_symsize,lt->rx_rowdata[c],lt->rx_symsize);
+		lt->rx_known[lt->rx_colsrc[c]] = 1;
+	}
+	lt->rx_knowncount = lt->k;
+	if( lt->verbose ) {
+		printf("lt_decode(...): solved %zu source symbols by elimination\n",lt->rx_cols);
+	}
+}
+
+int lt_decode(lt_t *lt, uint8_t **data, size_t *datalen, uint8_t *sym, size_t symlen) {
+	uint32_t filelen;
+	size_t symsize;
+	uint32_t seed;
+	size_t k;
+	size_t degree;
+	size_t i,j;
+	uint8_t *payload;
+	ltsym_t *p;
+	void *tmp;
+	
+	if( !lt ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !sym && symlen ) { return -1; }
+	
+	*data = 0;
+	*datalen = 0;
+	
+	if( symlen < LT_HEADER_LEN ) { return 0; }
+	filelen = ((uint32_t)sym[0]<<24) | ((uint32_t)sym[1]<<16) | ((uint32_t)sym[2]<<8) | sym[3];
+	symsize = ((size_t)sym[4]<<8) | sym[5];
+	seed    = ((uint32_t)sym[6]<<24) | ((uint32_t)sym[7]<<16) | ((uint32_t)sym[8]<<8) | sym[9];
+	if( symsize == 0 || symlen != LT_HEADER_LEN+symsize || filelen == 0 ) { return 0; }
+	
+	//A symbol from a different transfer starts over
+	if( lt->rx_active && (filelen != lt->rx_filelen || symsize != lt->rx_symsize) ) {
+		if( lt->verbose ) {
+			printf("lt_decode(...): new transfer\n");
+		}
+		lt_rx_reset(lt);
+	}
+	if( lt->rx_done ) { return 0; }
+	
+	k = (filelen+symsize-1)/symsize;
+	if( !lt->rx_active ) {
+		lt->rx_filelen = filelen;
+		lt->rx_symsize = symsize;
+		lt->rx_data = (uint8_t*)malloc(k*symsize);
+		lt->rx_known = (uint8_t*)malloc(k);
+		lt->rx_stack = (uint32_t*)malloc(sizeof(uint32_t)*k);
+		if( !lt->rx_data || !lt->rx_known || !lt->rx_stack ) { 
+			lt_rx_reset(lt);
+			return -1; 
+		}
+		memset(lt->rx_known,0,k);
+		lt->rx_active = 1;
+	}
+	if( lt_setup(lt,k) ) { return -1; }
+	lt->rx_received++;
+	
+	//Reduce the new symbol by everything already known
+	payload = (uint8_t*)malloc(symsize);
+	if( !payload ) { return -1; }
+	memcpy(payload,sym+LT_HEADER_LEN,symsize);
+	degree = lt_neighbors(lt,seed);
+	for( i=0, j=0; i<degree; i++ ) {
+		if( lt->rx_known[lt->nbrs[i]] ) {
+			lt_xor(payload,lt->rx_data+lt->nbrs[i]*symsize,symsize);
+		}
+		else {
+			lt->nbrs[j++] = lt->nbrs[i];
+		}
+	}
+	if( j == 0 ) {
+		//Nothing new
+		free(payload);
+	}
+	else if( lt->rx_elim ) {
+		lt_elim_add(lt,lt->nbrs,j,payload);
+	}
+	else if( j == 1 ) {
+		lt_recover(lt,lt->nbrs[0],payload);
+		free(payload);
+	}
+	else {
+		//Keep it until enough of its neighbors are known
+		tmp = realloc(lt->rx_pending,sizeof(ltsym_t)*(lt->rx_pendinglen+1));
+		if( !tmp ) { free(payload); return -1; }
+		lt->rx_pending = (ltsym_t*)tmp;
+		p = &lt->rx_pending[lt->rx_pendinglen];
+		p->nbrs = (uint32_t*)malloc(sizeof(uint32_t)*j);
+		if( !p->nbrs ) { free(payload); return -1; }
+		memcpy(p->nbrs,lt->nbrs,sizeof(uint32_t)*j);
+		p->data = payload;
+		p->degree = j;
+		lt->rx_pendinglen++;
+	}
+	
+	if( !lt->rx_elim && lt->rx_knowncount < k && lt->rx_pendinglen >= k-lt->rx_knowncount ) {
+		if( lt_elim_start(lt) ) { return -1; }
+	}
+	if( lt->verbose ) {
+		printf("lt_decode(...): seed %u, %zu of %zu source symbols after %zu received\n",
+		       seed,lt->rx_knowncount+lt->rx_rank,k,lt->rx_received);
+	}
+	if( lt->rx_elim && lt->rx_knowncount < k && lt->rx_rank == lt->rx_cols ) {
+		lt_elim_finish(lt);
+	}
+	
+	if( lt->rx_knowncount == k ) {
+		lt->rx_done = 1;
+		*data = lt->rx_data;
+		*datalen = filelen;
+	}
+	return 0;
+}
+
+#endif //LT_IMPLEMENTATION
@@ -39,19 +39,35 @@
 #define FSK_IMPLEMENTATION
 #define OOK_IMPLEMENTATION
 #define PSKCLK_IMPLEMENTATION
+#define TCM_IMPLEMENTATION
 #define CORR_IMPLEMENTATION
+#define OFDM_IMPLEMENTATION
+#define PULSE_IMPLEMENTATION
+#define SYMSYNC_IMPLEMENTATION
+#define PSK_IMPLEMENTATION
+#define QAM_IMPLEMENTATION
+#define NCFSK_IMPLEMENTATION
+#define CPFSK_IMPLEMENTATION
+#define CSS_IMPLEMENTATION
+#define CONV_IMPLEMENTATION
+#define RS_IMPLEMENTATION
+#define CRC_IMPLEMENTATION
 #define PKT_IMPLEMENTATION
 #define AUDIOMODEM_IMPLEMENTATION
 #include "audiomodem.h"
+#define LT_IMPLEMENTATION
+#include "lt.h"
 
 #define DEFAULT_BITRATE 64
 #define DEFAULT_BANDWIDTH 3000
 #define DEFAULT_SYMBOL_COUNT 4
 #define DEFAULT_FREQUENCY 1000
-
-typedef enum {OPT_NONE,OPT_FSK,OPT_FSKCLK,OPT_OOK,OPT_PSKCLK,OPT_CORRFSK,OPT_CORRPSK,OPT_CORRFPSK} modemopt_t;
+#define DEFAULT_LT_OVERHEAD 50
 
 void usage(char* cmd) {
+	const audiomodem_ops_t **ops;
+	size_t opslen;
+	size_t j;
 	char* filename = cmd+strlen(cmd);
 	while( filename > cmd ) {
 		if( *(filename-1) == '/' ) {
@@ -59,8 +75,13 @@ void usage(char* cmd) {
 		}
 		filename--;
 	}
-	printf("Usage: %s [-h] [-v] [-p] [-fsk | -fskclk | -ook | -pskclk | -cfsk | -cpsk | -cfpsk]\n",filename);
-	printf("  [-s samplerate] [-r bitrate] [-bw bandwidth] [-c symbol_count] [-f frequency]\n");
+	opslen = audiomodem_registered(&ops);
+	printf("Usage: %s [-h] [-v] [-p [-e fec] [-lt overhead]] [",filename);
+	for( j=0; j<opslen; j++ ) {
+		printf("%s-%s",j ? " | " : "",ops[j]->name);
+	}
+	printf("]\n");
+	printf("  [-s samplerate] [-r bitrate] [-bw bandwidth] [-c symbol_count] [-f frequency] [-ro rolloff]\n");
 	printf("  [-n noise_amplitude] [-i inpath | -m \"message\"] -o output.wav\n");
 	printf("\n");
 	printf("Defaults:\n");
@@ -69,6 +90,9 @@ void usage(char* cmd) {
 	printf("  bandwidth : %d\n",DEFAULT_BANDWIDTH);
 	printf("  symbol_count: %d\n",DEFAULT_SYMBOL_COUNT);
 	printf("  frequency : %d\n",DEFAULT_FREQUENCY);
+	printf("  rolloff   : none (default symbol envelope)\n");
+	printf("  fec       : none (conv12, conv23, conv34, rs)\n");
+	printf("  overhead  : %d (percent of extra fountain symbols, requires -i)\n",DEFAULT_LT_OVERHEAD);
 	printf("\n");
 	exit(0);
 }
@@ -88,8 +112,19 @@ int main(int argc, char** argv) {
 	int fd;
 	int verbose = 0;
 	int use_pkt = 0;
+	pkt_fec_t fec = PKT_FEC_NONE;
+	int use_lt = 0;
+	size_t lt_overhead = DEFAULT_LT_OVERHEAD;
+	lt_t *lt = 0;
+	uint32_t seed;
+	size_t seed_count = 0;
+	uint8_t *chunk;
+	size_t chunk_len;
+	void *tmp;
 	double noise_amp = 0.0;
-	modemopt_t modemopt = OPT_NONE;
+	double rolloff = 0.0;
+	const audiomodem_ops_t *modemops = 0;
+	audiomodem_config_t config;
 	size_t samplerate = 0;
 	size_t bitrate = 0;
 	size_t bandwidth = 0;
@@ -110,47 +145,34 @@ int main(int argc, char** argv) {
 			}
 			use_pkt = 1;
 		}
-		else if( !strcmp(argv[i],"-fsk") ) {
-			if( modemopt != OPT_NONE ) {
+		else if( !strcmp(argv[i],"-e") ) {
+			++i;
+			if( i >= argc || fec != PKT_FEC_NONE ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_FSK;
-		}
-		else if( !strcmp(argv[i],"-fskclk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			if( !strcmp(argv[i],"conv12") ) {
+				fec = PKT_FEC_CONV_1_2;
 			}
-			modemopt = OPT_FSKCLK;
-		}
-		else if( !strcmp(argv[i],"-ook") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"conv23") ) {
+				fec = PKT_FEC_CONV_2_3;
 			}
-			modemopt = OPT_OOK;
-		}
-		else if( !strcmp(argv[i],"-pskclk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"conv34") ) {
+				fec = PKT_FEC_CONV_3_4;
 			}
-			modemopt = OPT_PSKCLK;
-		}
-		else if( !strcmp(argv[i],"-cfsk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"rs") ) {
+				fec = PKT_FEC_RS;
 			}
-			modemopt = OPT_CORRFSK;
-		}
-		else if( !strcmp(argv[i],"-cpsk") ) {
-			if( modemopt != OPT_NONE ) {
+			else if( strcmp(argv[i],"none") ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_CORRPSK;
 		}
-		else if( !strcmp(argv[i],"-cfpsk") ) {
-			if( modemopt != OPT_NONE ) {
+		else if( !strcmp(argv[i],"-lt") ) {
+			++i;
+			if( i >= argc || use_lt ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_CORRFPSK;
+			use_lt = 1;
+			lt_overhead = strtoul(argv[i],0,0);
 		}
 		else if( !strcmp(argv[i],"-s") ) {
 			++i;
@@ -209,6 +231,16 @@ int main(int argc, char** argv) {
 			}
 			outpath = argv[i];
 		}
+		else if( !strcmp(argv[i],"-ro") ) {
+			++i;
+			if( i >= argc || rolloff > 0.0 ) {
+				usage(argv[0]);
+			}
+			rolloff = strtod(argv[i],0);
+			if( rolloff <= 0.0 || rolloff > 1.0 ) {
+				usage(argv[0]);
+			}
+		}
 		else if( !strcmp(argv[i],"-n") ) {
 			++i;
 			if( i >= argc || noise_amp > 0.0 ) {
@@ -234,13 +266,25 @@ int main(int argc, char** argv) {
 			data = (uint8_t*)argv[i];
 			data_len = strlen(argv[i]);
 		}
+		else if( argv[i][0] == '-' && audiomodem_lookup(argv[i]+1) ) {
+			if( modemops ) {
+				usage(argv[0]);
+			}
+			modemops = audiomodem_lookup(argv[i]+1);
+		}
 		else {
 			usage(argv[0]);
 		}
 		++i;
 	}
 
-	if( modemopt == OPT_NONE ) {
+	if( !modemops ) {
+		usage(argv[0]);
+	}
+	if( fec != PKT_FEC_NONE && !use_pkt ) {
+		usage(argv[0]);
+	}
+	if( use_lt && (!use_pkt || !inpath) ) {
 		usage(argv[0]);
 	}
 	if( !outpath ) {
@@ -291,36 +335,29 @@ int main(int argc, char** argv) {
 		exit(0);
 	}
 	
-	if( modemopt == OPT_FSKCLK ) {
-		modem = audiomodem_fskclk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
-	else if( modemopt == OPT_FSK ) {
-		modem = audiomodem_fsk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
-	else if( modemopt == OPT_OOK ) {
-		modem = audiomodem_ook_init(sfinfo.samplerate,bitrate,bandwidth,frequency);
-	}
-	else if( modemopt == OPT_PSKCLK ) {
-		modem = audiomodem_pskclk_init(sfinfo.samplerate,bitrate,bandwidth,frequency,symbol_count);
-	}
-	else if( modemopt == OPT_CORRFSK ) {
-		modem = audiomodem_corrfsk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
-	else if( modemopt == OPT_CORRPSK ) {
-		modem = audiomodem_corrpsk_init(sfinfo.samplerate,bitrate,frequency,symbol_count);
-	}
-	else if( modemopt == OPT_CORRFPSK ) {
-		modem = audiomodem_corrfpsk_init(sfinfo.samplerate, bitrate, bandwidth, symbol_count);
-	}
+	config.samplerate = sfinfo.samplerate;
+	config.bitrate = bitrate;
+	config.bandwidth = bandwidth;
+	config.freq = frequency;
+	config.symbol_count = symbol_count;
+	modem = audiomodem_ops_init(modemops,&config);
 	if( !modem ) {
 		printf("Failed to create modem\n");
 		exit(0);
 	}
+	if( rolloff > 0.0 && audiomodem_set_pulse(modem,rolloff) ) {
+		printf("Failed to set pulse shaping\n");
+		exit(0);
+	}
 	if( use_pkt ) {
 		if( audiomodem_pkt_init(modem) ) {
 			printf("Failed to create packet framer\n");
 			exit(0);
 		}
+		if( pkt_set_fec(modem->pkt,fec) ) {
+			printf("Failed to set packet fec\n");
+			exit(0);
+		}
 	}
 	audiomodem_set_verbose(modem,verbose);
 	if( verbose ) {
@@ -357,11 +394,43 @@ int main(int argc, char** argv) {
 			printf("Memory allocation failed\n");
 			exit(0);
 		}
-		for(;;) {
-			readlen = read(fd,data,1024);
-			if( readlen <= 0 ) { break; }
-			data_len = (size_t)readlen;
-			if( audiomodem_modulate(modem, &samples, &samples_len, data, data_len) ) {
+		if( use_lt ) {
+			//The fountain code needs the whole file up front
+			data_len = 0;
+			for(;;) {
+				readlen = read(fd,data+data_len,1024);
+				if( readlen <= 0 ) { break; }
+				data_len = data_len + (size_t)readlen;
+				tmp = realloc(data,data_len+1024);
+				if( !tmp ) {
+					printf("Memory allocation failed\n");
+					exit(0);
+				}
+				data = (uint8_t*)tmp;
+			}
+			lt = lt_init();
+			if( !lt ) {
+				printf("Failed to create fountain encoder\n");
+				exit(0);
+			}
+			lt_set_verbose(lt,verbose);
+			seed_count = lt_source_count(lt,data_len)*(100+lt_overhead)/100;
+		}
+		for( seed=0;; seed++ ) {
+			if( use_lt ) {
+				if( seed >= seed_count ) { break; }
+				if( lt_encode(lt,&chunk,&chunk_len,data,data_len,seed) ) {
+					printf("Failed to encode fountain symbol\n");
+					exit(0);
+				}
+			}
+			else {
+				readlen = read(fd,data,1024);
+				if( readlen <= 0 ) { break; }
+				chunk = data;
+				chunk_len = (size_t)readlen;
+			}
+			if( audiomodem_modulate(modem, &samples, &samples_len, chunk, chunk_len) ) {
 				printf("Failed to generate audio\n");
 				exit(0);
 			}
@@ -380,6 +449,9 @@ int main(int argc, char** argv) {
 			sf_writef_double(sndfile,samples,samples_len);
 		}
 		free(data);
+		if( lt ) {
+			lt_destroy(lt);
+		}
 	}
 	else {
 		if( audiomodem_modulate(modem, &samples, &samples_len, data, data_len) ) {
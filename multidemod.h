@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __MULTIDEMOD_H__
+#define __MULTIDEMOD_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audiomodem.h"
+
+//Demodulates one audio stream with several modems at once.  Modems whose 
+//front-ends match (samplerate, bandwidth, FFT size and taper) share a single 
+//resampler and FFT, and the spectra are fanned out to each of them.  
+//Modems without a srcfft front-end are run on the samples directly.
+
+typedef struct {
+	srcfft_t     *srcfft;
+	fftw_complex *spectra;
+	size_t        spectralen;
+	size_t        spectraalloc;
+} multidemod_group_t;
+
+typedef struct {
+	audiomodem_t *modem;
+	int           group;
+	uint8_t      *data;
+	size_t        datalen;
+} multidemod_member_t;
+
+typedef struct {
+	int                  verbose;
+	multidemod_group_t  *groups;
+	size_t               groupslen;
+	multidemod_member_t *members;
+	size_t               memberslen;
+} multidemod_t;
+
+multidemod_t *multidemod_init(void);
+void          multidemod_destroy(multidemod_t *md);
+int           multidemod_add(multidemod_t *md, audiomodem_t *modem);
+int           multidemod_set_verbose(multidemod_t *md, int verbose);
+void          multidemod_printinfo(multidemod_t *md);
+int           multidemod_demodulate(multidemod_t *md, double *samples, size_t sampleslen);
+
+#endif //__MULTIDEMOD_H__
+
+#ifdef MULTIDEMOD_IMPLEMENTATION
+#undef MULTIDEMOD_IMPLEMENTATION
+
+#include <stdio.h>
+
+multidemod_t *multidemod_init(void) {
+	multidemod_t *md;
+	
+	md = (multidemod_t*)malloc(sizeof(multidemod_t));
+	if( !md ) { return 0; }
+	memset(md,0,sizeof(multidemod_t));
+	return md;
+}
+
+void multidemod_destroy(multidemod_t *md) {
+	//The member modems belong to the caller and are not destroyed
+	size_t i;
+	
+	if( md ) {
+		for( i=0; i<md->groupslen; i++ ) {
+			if( md->groups[i].srcfft ) { srcfft_destroy(md->groups[i].srcfft); }
+			if( md->groups[i].spectra ) { free(md->groups[i].spectra); }
+		}
+		if( md->groups ) { free(md->groups); }
+		if( md->members ) { free(md->members); }
+		memset(md,0,sizeof(multidemod_t));
+		free(md);
+	}
+}
+
+static int multidemod_find_group(multidemod_t *md, srcfft_t *frontend) {
+	//Returns the group whose front-end matches, creating it if needed
+	multidemod_group_t *tmp;
+	srcfft_t *srcfft;
+	size_t i;
+	
+	for( i=0; i<md->groupslen; i++ ) {
+		srcfft = md->groups[i].srcfft;
+		if( srcfft->samplerate == frontend->samplerate &&
+		    srcfft->bandwidth  == frontend->bandwidth &&
+		    srcfft->srcinalloc == frontend->srcinalloc &&
+		    srcfft->taper      == frontend->taper ) {
+			return (int)i;
+		}
+	}
+	
+	tmp = (multidemod_group_t*)realloc(md->groups,sizeof(multidemod_group_t)*(md->groupslen+1));
+	if( !tmp ) { return -1; }
+	md->groups = tmp;
+	memset(&md->groups[md->groupslen],0,sizeof(multidemod_group_t));
+	md->groups[md->groupslen].srcfft = srcfft_init(frontend->samplerate,frontend->srcinalloc,frontend->bandwidth,0);
+	if( !md->groups[md->groupslen].srcfft ) { return -1; }
+	if( srcfft_set_taper(md->groups[md->groupslen].srcfft,frontend->taper) ) {
+		srcfft_destroy(md->groups[md->groupslen].srcfft);
+		md->groups[md->groupslen].srcfft = 0;
+		return -1;
+	}
+	md->groupslen++;
+	return (int)(md->groupslen-1);
+}
+
+int multidemod_add(multidemod_t *md, audiomodem_t *modem) {
+	//Attach a modem (before any samples are demodulated).  Returns its 
+	//index in md->members, or -1 on failure.
+	multidemod_member_t *tmp;
+	srcfft_t *frontend = 0;
+	int group = -1;
+	
+	if( !md ) { return -1; }
+	if( !modem ) { return -1; }
+	
+	if( modem->ops->frontend && modem->ops->demodulate_fft ) {
+		frontend = modem->ops->frontend(modem->handle);
+	}
+	if( frontend ) {
+		group = multidemod_find_group(md,frontend);
+		if( group < 0 ) { return -1; }
+	}
+	
+	tmp = (multidemod_member_t*)realloc(md->members,sizeof(multidemod_member_t)*(md->memberslen+1));
+	if( !tmp ) { return -1; }
+	md->members = tmp;
+	memset(&md->members[md->memberslen],0,sizeof(multidemod_member_t));
+	md->members[md->memberslen].modem = modem;
+	md->members[md->memberslen].group = group;
+	md->memberslen++;
+	return (int)(md->memberslen-1);
+}
+
+int multidemod_set_verbose(multidemod_t *md, int verbose) {
+	if( !md ) { return -1; }
+	md->verbose = verbose;
+	return 0;
+}
+
+void multidemod_printinfo(multidemod_t *md) {
+	size_t i;
+	
+	if( md ) {
+		printf("Multi-Demodulator\n");
+		printf("  Members: %zu\n",md->memberslen);
+		printf("  Shared front-ends: %zu\n",md->groupslen);
+		for( i=0; i<md->groupslen; i++ ) {
+			printf("    [%zu] %zu Hz -> %zu Hz bandwidth, %zu sample FFT\n",i,
+			       md->groups[i].srcfft->samplerate,
+			       md->groups[i].srcfft->bandwidth,
+			       md->groups[i].srcfft->fftalloc);
+		}
+		for( i=0; i<md->memberslen; i++ ) {
+			printf("  Member[%zu]: %s",i,md->members[i].modem->ops->name);
+			if( md->members[i].group >= 0 ) {
+				printf(" (front-end %d)\n",md->members[i].group);
+			}
+			else {
+				printf(" (own front-end)\n");
+			}
+		}
+	}
+}
+
+static int multidemod_transform(multidemod_t *md, multidemod_group_t *group, double *samples, size_t sampleslen) {
+	//Run the group's front-end over the samples, keeping every spectrum
+	fftw_complex *tmp;
+	srcfft_status_t result;
+	size_t binslen;
+	size_t alloc;
+	size_t ii;
+	
+	binslen = srcfft_spectrum_len(group->srcfft);
+	group->spectralen = 0;
+	ii = 0;
+	while( ii < sampleslen ) {
+		result = srcfft_transform(group->srcfft,samples+ii,sampleslen-ii);
+		ii = ii + group->srcfft->used_samples;
+		if( result == SRCFFT_ERROR ) {
+			if( md->verbose ) {
+				printf("  FFT failed\n");
+			}
+			return -1;
+		}
+		else if( result == SRCFFT_NEED_MORE ) {
+			continue;
+		}
+		if( group->spectralen == group->spectraalloc ) {
+			alloc = group->spectraalloc ? group->spectraalloc*2 : 16;
+			tmp = (fftw_complex*)realloc(group->spectra,sizeof(fftw_complex)*binslen*alloc);
+			if( !tmp ) { return -1; }
+			group->spectra = tmp;
+			group->spectraalloc = alloc;
+		}
+		memcpy(group->spectra+group->spectralen*binslen,group->srcfft->fftout,sizeof(fftw_complex)*binslen);
+		group->spectralen++;
+	}
+	return 0;
+}
+
+int multidemod_demodulate(multidemod_t *md, double *samples, size_t sampleslen) {
+	//Demodulate the samples with every member.  The results are left in 
+	//md->members[i].data and md->members[i].datalen (as returned by 
+	//audiomodem_demodulate) until the next call.
+	multidemod_member_t *member;
+	size_t i;
+	
+	if( !md ) { return -1; }
+	if( !samples ) { return -1; }
+	
+	if( md->verbose ) {
+		printf("multidemod_demodulate(...)\n");
+	}
+	
+	for( i=0; i<md->groupslen; i++ ) {
+		if( multidemod_transform(md,&md->groups[i],samples,sampleslen) ) {
+			return -1;
+		}
+		if( md->verbose ) {
+			printf("  Front-end %zu: %zu spectra\n",i,md->groups[i].spectralen);
+		}
+	}
+	
+	for( i=0; i<md->memberslen; i++ ) {
+		member = &md->members[i];
+		if( member->group >= 0 ) {
+			if( audiomodem_demodulate_fft(member->modem,&member->data,&member->datalen,
+			                              md->groups[member->group].spectra,
+			                              md->groups[member->group].spectralen) ) {
+				return -1;
+			}
+		}
+		else if( audiomodem_demodulate(member->modem,&member->data,&member->datalen,samples,sampleslen) ) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+#endif //MULTIDEMOD_IMPLEMENTATION
\ No newline at end of file
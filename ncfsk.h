@@ -0,0 +1,559 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __NCFSK_H__
+#define __NCFSK_H__
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitops.h"
+#include "symsync.h"
+
+#define NCFSK_DEFAULT_VERBOSE     0
+#define NCFSK_DEFAULT_THRESH      0.25
+
+//Non-coherent M-ary FSK with tones one symbol rate apart, the closest
+//spacing at which they stay orthogonal over a symbol.  The receiver works
+//on the sample stream: every tone has a quadrature matched filter (a
+//sliding sum of the mixed down signal over one symbol), and a Gardner loop
+//on the filter magnitudes picks the instant at which each symbol is
+//decided.  A transmission starts with a preamble alternating between the
+//outer tones (for the timing loop), a Barker sync word and a length header,
+//all sent on the outer tones.
+
+typedef struct {
+	int      verbose;
+	size_t   samplerate;
+	size_t   bitrate;
+	double   frequency;
+	size_t   bit_per_tone;
+	size_t   tone_count;
+	double  *tones;
+	double   thresh;
+
+	size_t   samp_per_sym;
+
+	double  *mod_samples;
+	size_t   mod_sampleslen;
+
+	symsync_frame_t demod_frame;
+	double   demod_detect;
+	double  *demod_nco;
+	double  *demod_mix;
+	double  *demod_sum;
+	size_t   demod_mixoff;
+	double  *demod_mf;
+	size_t   demod_mfalloc;
+	size_t   demod_count;
+	double   demod_power;
+
+	double  *demod_prev;
+	double  *demod_cur;
+	double  *demod_mid;
+	double   demod_amp;
+	bitstream_t demod_bits;
+} ncfsk_t;
+
+
+ncfsk_t *ncfsk_init(size_t samplerate, size_t bitrate, double frequency, size_t tone_count);
+void     ncfsk_destroy(ncfsk_t *modem);
+int      ncfsk_set_thresh(ncfsk_t *modem, double thresh);
+int      ncfsk_set_verbose(ncfsk_t *modem, int verbose);
+int      ncfsk_set_soft(ncfsk_t *modem, int on);
+int      ncfsk_soft(ncfsk_t *modem, int8_t **soft, size_t *softlen);
+void     ncfsk_printinfo(ncfsk_t *modem);
+int      ncfsk_modulate(ncfsk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+int      ncfsk_demodulate(ncfsk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+
+#endif //__NCFSK_H__
+
+#ifdef NCFSK_IMPLEMENTATION
+#undef NCFSK_IMPLEMENTATION
+
+#define NCFSK_AMPLITUDE      0.5
+#define NCFSK_MAX_BITS       6
+//Timing loop bandwidths (times the symbol period) while training and on data
+#define NCFSK_TIMING_ACQ     0.05
+#define NCFSK_TIMING_TRK     0.01
+
+ncfsk_t *ncfsk_init(size_t samplerate, size_t bitrate, double frequency, size_t tone_count) {
+	ncfsk_t *modem;
+	double sym_freq;
+	size_t i;
+
+	//Double check arguments
+	if( !bitrate ) { return 0; }
+	if( tone_count < 2 ) { return 0; }
+
+	modem = (ncfsk_t*)malloc(sizeof(ncfsk_t));
+	if( !modem ) { goto ncfsk_init_error; }
+	memset(modem,0,sizeof(ncfsk_t));
+	bitstream_init_alloc(&modem->demod_bits);
+
+	modem->verbose = NCFSK_DEFAULT_VERBOSE;
+	modem->demod_frame.verbose = NCFSK_DEFAULT_VERBOSE;
+
+	modem->samplerate = samplerate;
+	modem->bitrate = bitrate;
+	modem->frequency = frequency;
+
+	modem->bit_per_tone = 1;
+	while( 1<<modem->bit_per_tone < tone_count ) {
+		modem->bit_per_tone++;
+	}
+	if( modem->bit_per_tone > NCFSK_MAX_BITS ) { goto ncfsk_init_error; }
+	modem->tone_count = (1 << modem->bit_per_tone);
+	modem->demod_frame.bit_per_symbol = modem->bit_per_tone;
+
+	//Gardner needs a few samples per symbol to interpolate between
+	sym_freq = (double)bitrate / (double)modem->bit_per_tone;
+	modem->samp_per_sym = (size_t)round((double)samplerate / sym_freq);
+	if( modem->samp_per_sym < 4 ) { goto ncfsk_init_error; }
+
+	//Tones a whole number of cycles per symbol apart, centered on frequency
+	sym_freq = (double)samplerate / (double)modem->samp_per_sym;
+	modem->tones = (double*)malloc(sizeof(double)*modem->tone_count);
+	if( !modem->tones ) { goto ncfsk_init_error; }
+	for( i=0; i<modem->tone_count; i++ ) {
+		modem->tones[i] = frequency + ((double)i - (modem->tone_count-1)/2.0)*sym_freq;
+	}
+	if( modem->tones[0] < sym_freq ) { goto ncfsk_init_error; }
+	if( modem->tones[modem->tone_count-1] + sym_freq > samplerate/2.0 ) { goto ncfsk_init_error; }
+
+	//Mixer output history for the matched filters (I/Q interleaved per
+	//tone), and matched filter magnitude history for the timing interpolator
+	modem->demod_nco = (double*)malloc(sizeof(double)*modem->tone_count);
+	if( !modem->demod_nco ) { goto ncfsk_init_error; }
+	modem->demod_mix = (double*)malloc(sizeof(double)*2*modem->tone_count*modem->samp_per_sym);
+	if( !modem->demod_mix ) { goto ncfsk_init_error; }
+	modem->demod_sum = (double*)malloc(sizeof(double)*2*modem->tone_count);
+	if( !modem->demod_sum ) { goto ncfsk_init_error; }
+	modem->demod_mfalloc = symsync_ring_len(modem->samp_per_sym);
+	modem->demod_mf = (double*)malloc(sizeof(double)*modem->tone_count*modem->demod_mfalloc);
+	if( !modem->demod_mf ) { goto ncfsk_init_error; }
+	modem->demod_prev = (double*)malloc(sizeof(double)*modem->tone_count);
+	if( !modem->demod_prev ) { goto ncfsk_init_error; }
+	modem->demod_cur = (double*)malloc(sizeof(double)*modem->tone_count);
+	if( !modem->demod_cur ) { goto ncfsk_init_error; }
+	modem->demod_mid = (double*)malloc(sizeof(double)*modem->tone_count);
+	if( !modem->demod_mid ) { goto ncfsk_init_error; }
+
+	if( ncfsk_set_thresh(modem,NCFSK_DEFAULT_THRESH) ) {
+		goto ncfsk_init_error;
+	}
+
+	return modem;
+
+	ncfsk_init_error:
+	ncfsk_destroy(modem);
+	return 0;
+}
+
+void ncfsk_destroy(ncfsk_t *modem) {
+	if( modem ) {
+		if( modem->tones ) { free(modem->tones); }
+		if( modem->mod_samples ) { free(modem->mod_samples); }
+		if( modem->demod_nco ) { free(modem->demod_nco); }
+		if( modem->demod_mix ) { free(modem->demod_mix); }
+		if( modem->demod_sum ) { free(modem->demod_sum); }
+		if( modem->demod_mf ) { free(modem->demod_mf); }
+		if( modem->demod_prev ) { free(modem->demod_prev); }
+		if( modem->demod_cur ) { free(modem->demod_cur); }
+		if( modem->demod_mid ) { free(modem->demod_mid); }
+		bitstream_destroy(&modem->demod_bits);
+		memset(modem,0,sizeof(ncfsk_t));
+		free(modem);
+	}
+}
+
+static void ncfsk_demodulate_reset(ncfsk_t *modem) {
+	memset(modem->demod_nco,0,sizeof(double)*modem->tone_count);
+	memset(modem->demod_mix,0,sizeof(double)*2*modem->tone_count*modem->samp_per_sym);
+	memset(modem->demod_sum,0,sizeof(double)*2*modem->tone_count);
+	memset(modem->demod_mf,0,sizeof(double)*modem->tone_count*modem->demod_mfalloc);
+	modem->demod_mixoff = 0;
+	modem->demod_count = 0;
+	modem->demod_power = 0.0;
+	modem->demod_frame.state = SYMSYNC_SEARCH;
+}
+
+static void ncfsk_demodulate_sample(ncfsk_t *modem, double x) {
+	//Mix one sample down against every tone and slide the one symbol
+	//matched filters along by it
+	double *mix;
+	double *sum;
+	double *mf;
+	double power;
+	double m;
+	size_t k;
+	size_t j;
+
+	mix = modem->demod_mix + 2*modem->tone_count*modem->demod_mixoff;
+	mf = modem->demod_mf + modem->tone_count*(modem->demod_count & (modem->demod_mfalloc-1));
+	power = 0.0;
+	for( k=0; k<modem->tone_count; k++ ) {
+		sum = modem->demod_sum + 2*k;
+		//Drop the sample leaving the window, add the new one
+		sum[0] = sum[0] - mix[2*k];
+		sum[1] = sum[1] - mix[2*k+1];
+		mix[2*k]   =  2.0*x*cos(modem->demod_nco[k]);
+		mix[2*k+1] = -2.0*x*sin(modem->demod_nco[k]);
+		sum[0] = sum[0] + mix[2*k];
+		sum[1] = sum[1] + mix[2*k+1];
+		modem->demod_nco[k] = modem->demod_nco[k] + 2*M_PI*modem->tones[k]/modem->samplerate;
+		if( modem->demod_nco[k] > 2*M_PI ) {
+			modem->demod_nco[k] = modem->demod_nco[k] - 2*M_PI;
+		}
+		m = sqrt(sum[0]*sum[0] + sum[1]*sum[1]) / modem->samp_per_sym;
+		mf[k] = m;
+		power = power + m*m;
+	}
+	modem->demod_count++;
+
+	if( ++modem->demod_mixoff >= modem->samp_per_sym ) {
+		modem->demod_mixoff = 0;
+		//Resum the window once a symbol, so rounding in the running sums
+		//does not build up
+		memset(modem->demod_sum,0,sizeof(double)*2*modem->tone_count);
+		for( j=0; j<modem->samp_per_sym; j++ ) {
+			mix = modem->demod_mix + 2*modem->tone_count*j;
+			for( k=0; k<2*modem->tone_count; k++ ) {
+				modem->demod_sum[k] = modem->demod_sum[k] + mix[k];
+			}
+		}
+	}
+
+	//Signal power, smoothed over a couple of symbols
+	modem->demod_power = modem->demod_power + (power - modem->demod_power) / (2.0*modem->samp_per_sym);
+}
+
+int ncfsk_set_thresh(ncfsk_t *modem, double thresh) {
+	//Detection level as a fraction of the matched filter power of a clean
+	//preamble, measured by running one through the receiver
+	double *samples;
+	size_t  sampleslen;
+	uint8_t dummy = 0;
+	double  power;
+	size_t  count;
+	size_t  ii;
+
+	if( !modem ) { return -1; }
+	if( thresh <= 0.0 || thresh > 1.0 ) { return -1; }
+
+	if( ncfsk_modulate(modem,&samples,&sampleslen,&dummy,0) ) { return -1; }
+	ncfsk_demodulate_reset(modem);
+	power = 0.0;
+	count = 0;
+	for( ii=0; ii<sampleslen; ii++ ) {
+		ncfsk_demodulate_sample(modem,samples[ii]);
+		//Skip the ramp up and down of the filters
+		if( ii >= 2*modem->samp_per_sym && ii+2*modem->samp_per_sym < sampleslen ) {
+			power = power + modem->demod_power;
+			count++;
+		}
+	}
+	ncfsk_demodulate_reset(modem);
+	if( !count ) { return -1; }
+
+	modem->thresh = thresh;
+	modem->demod_detect = thresh * power / count;
+	return 0;
+}
+
+int ncfsk_set_verbose(ncfsk_t *modem, int verbose) {
+	if( !modem ) { return -1; }
+	modem->verbose = verbose;
+	modem->demod_frame.verbose = verbose;
+	return 0;
+}
+
+int ncfsk_set_soft(ncfsk_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int ncfsk_soft(ncfsk_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+void ncfsk_printinfo(ncfsk_t *modem) {
+	size_t i;
+	printf("Non-coherent FSK Modem:\n");
+	printf("  Verbose                  : %d\n",modem->verbose);
+	printf("  Samplerate               : %zu\n",modem->samplerate);
+	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
+	printf("  Actual Bitrate           : %0.1lf bps\n",(double)modem->samplerate*modem->bit_per_tone/modem->samp_per_sym);
+	printf("  Frequency                : %lf\n",modem->frequency);
+	printf("  Bits per Symbol          : %zu\n",modem->bit_per_tone);
+	printf("  Samples per Symbol       : %zu\n",modem->samp_per_sym);
+	printf("  Detect Power             : %lf\n",modem->demod_detect);
+	printf("  Tones(%zu):\n",modem->tone_count);
+	for( i=0; i<modem->tone_count; i++ ) {
+		printf("    0x%02lx: %04.1lf Hz\n",i,modem->tones[i]);
+	}
+}
+
+static void ncfsk_modulate_symbol(ncfsk_t *modem, size_t idx, double *phase, size_t tone) {
+	//One symbol of a tone, carrying the phase on so there is no jump
+	size_t j;
+	double *samples;
+
+	samples = modem->mod_samples + idx*modem->samp_per_sym;
+	for( j=0; j<modem->samp_per_sym; j++ ) {
+		samples[j] = NCFSK_AMPLITUDE*sin(*phase);
+		*phase = *phase + 2*M_PI*modem->tones[tone]/modem->samplerate;
+		if( *phase > 2*M_PI ) {
+			*phase = *phase - 2*M_PI;
+		}
+	}
+}
+
+int ncfsk_modulate(ncfsk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_idx;
+	size_t symbol_count;
+	size_t data_count;
+	bitstream_t bits;
+	size_t ii;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	double phase;
+	size_t top;
+	int sym;
+
+	if( !modem ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !data ) { return -1; }
+	if( datalen >= (1 << SYMSYNC_HEADER_BITS) ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("ncfsk_modulate(...):\n");
+		printf("  Data: ");
+		for( ii=0; ii<datalen; ii++ ) {
+			printf("%02x ",data[ii]);
+		}
+		printf("\n");
+	}
+
+	data_count = (datalen*8 + modem->bit_per_tone - 1) / modem->bit_per_tone;
+	symbol_count = SYMSYNC_SYNC_LEN + SYMSYNC_HEADER_LEN + data_count;
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+
+	//One silent symbol on the end lets the receiver interpolate the last one
+	mod_sampleslen = (symbol_count+1)*modem->samp_per_sym;
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto ncfsk_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	memset(mod_samples,0,sizeof(double)*mod_sampleslen);
+
+	top = modem->tone_count-1;
+	phase = 0.0;
+	symbol_idx = 0;
+	for( ii=0; ii<SYMSYNC_SYNC_LEN; ii++ ) {
+		ncfsk_modulate_symbol(modem,symbol_idx++,&phase,symsync_sync_bit(ii) ? top : 0);
+	}
+	for( ii=0; ii<SYMSYNC_HEADER_LEN; ii++ ) {
+		sym = symsync_header_bit(datalen,ii);
+		ncfsk_modulate_symbol(modem,symbol_idx++,&phase,sym ? top : 0);
+	}
+	bitstream_init(&bits, data, datalen);
+	for( ii=0; ii<data_count; ii++ ) {
+		//Gray coded, so landing on a neighbouring tone is one bit error
+		sym = bitstream_read(&bits, modem->bit_per_tone);
+		sym = sym ^ (sym >> 1);
+		if( modem->verbose ) {
+			printf("  Symbol[%zu]=0x%02x modulated to frequency %04.1lf Hz\n",ii,sym,modem->tones[sym]);
+		}
+		ncfsk_modulate_symbol(modem,symbol_idx++,&phase,sym);
+	}
+
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+
+	ncfsk_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
+}
+
+
+static void ncfsk_demodulate_llr(ncfsk_t *modem, double *cur, size_t best, double *llr) {
+	//Bit confidences from the tone magnitudes, each tone standing for 
+	//the symbol its Gray code undoes to
+	double metric[1 << NCFSK_MAX_BITS];
+	size_t k;
+	size_t j;
+	size_t sym;
+
+	for( k=0; k<modem->tone_count; k++ ) {
+		sym = k;
+		for( j=1; j<modem->bit_per_tone; j++ ) {
+			sym = sym ^ (k >> j);
+		}
+		metric[sym] = cur[k];
+	}
+	bitstream_soft_demap(metric,modem->tone_count,modem->bit_per_tone,cur[best],llr);
+}
+
+static int ncfsk_demodulate_decide(void *arg, symsync_state_t state, size_t idx, double *soft) {
+	//Decide on the tone magnitudes in demod_cur: the outer tones for the
+	//sync word and header, the strongest tone for data
+	ncfsk_t *modem = (ncfsk_t*)arg;
+	double *cur;
+	size_t top;
+	size_t best;
+	size_t k;
+	int sym;
+
+	cur = modem->demod_cur;
+	top = modem->tone_count-1;
+	if( state == SYMSYNC_SYNC ) {
+		soft[0] = (cur[top] - cur[0]) / sqrt(modem->demod_amp);
+		return 0;
+	}
+	if( state == SYMSYNC_HEADER ) {
+		return cur[top] > cur[0];
+	}
+
+	best = 0;
+	for( k=1; k<modem->tone_count; k++ ) {
+		if( cur[k] > cur[best] ) {
+			best = k;
+		}
+	}
+	if( modem->demod_bits.softon ) {
+		ncfsk_demodulate_llr(modem,cur,best,soft);
+	}
+	//Undo the Gray code
+	sym = (int)best;
+	for( k=1; k<modem->bit_per_tone; k++ ) {
+		sym = sym ^ ((int)best >> k);
+	}
+	return sym;
+}
+
+static int ncfsk_demodulate_symbol(ncfsk_t *modem) {
+	//One symbol at the frame's symbol instant: timing error, then the
+	//framing
+	double *cur;
+	double *mid;
+	double mean;
+	double err;
+	size_t k;
+	size_t best;
+
+	cur = modem->demod_cur;
+	mid = modem->demod_mid;
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,modem->tone_count,modem->demod_frame.time,cur);
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,modem->tone_count,modem->demod_frame.time-modem->samp_per_sym/2.0,mid);
+	best = 0;
+	mean = 0.0;
+	for( k=0; k<modem->tone_count; k++ ) {
+		if( cur[k] > cur[best] ) {
+			best = k;
+		}
+		mean = mean + mid[k];
+	}
+	mean = mean / modem->tone_count;
+	modem->demod_amp = modem->demod_amp + (cur[best]*cur[best] - modem->demod_amp) / 8.0;
+
+	//Gardner on the magnitudes: between two different tones the one fading
+	//out and the one fading in should be level at the midpoint
+	err = 0.0;
+	for( k=0; k<modem->tone_count; k++ ) {
+		err = err + (modem->demod_prev[k]-cur[k])*(mid[k]-mean);
+		modem->demod_prev[k] = cur[k];
+	}
+	err = err / modem->demod_amp;
+	symsync_frame_timing(&modem->demod_frame,err,NCFSK_TIMING_ACQ,NCFSK_TIMING_TRK,modem->samp_per_sym);
+
+	if( symsync_frame_symbol(&modem->demod_frame,&modem->demod_bits,modem->demod_power < modem->demod_detect/2.0,ncfsk_demodulate_decide,modem) < 0 ) {
+		return -1;
+	}
+	return 0;
+}
+
+int ncfsk_demodulate(ncfsk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t ii;
+	size_t j;
+
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("ncfsk_demodulate(...)\n");
+	}
+
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+
+	for( ii=0; ii<sampleslen; ii++ ) {
+		ncfsk_demodulate_sample(modem,samples[ii]);
+
+		if( modem->demod_frame.state == SYMSYNC_SEARCH ) {
+			if( modem->demod_power >= modem->demod_detect ) {
+				//Start the timing loop fresh, one symbol out
+				symsync_frame_start(&modem->demod_frame,(double)modem->demod_count + modem->samp_per_sym);
+				memset(modem->demod_prev,0,sizeof(double)*modem->tone_count);
+				modem->demod_amp = modem->demod_power;
+			}
+			continue;
+		}
+
+		if( symsync_frame_ready(&modem->demod_frame,modem->demod_count) ) {
+			if( ncfsk_demodulate_symbol(modem) ) {
+				return -1;
+			}
+		}
+	}
+
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+#endif //NCFSK_IMPLEMENTATION
\ No newline at end of file
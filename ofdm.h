@@ -0,0 +1,803 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __OFDM_H__
+#define __OFDM_H__
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fftw3.h>
+
+#include "bitops.h"
+#include "symsync.h"
+
+#define OFDM_DEFAULT_VERBOSE     0
+#define OFDM_DEFAULT_THRESH      0.50
+
+//Orthogonal Frequency Division Multiplexing.  Each OFDM symbol carries
+//BPSK, QPSK or 16-QAM (symbol_count 2, 4 or 16) on a set of subcarriers in
+//the middle of the band, with every OFDM_PILOT_SPACING'th carrier a known
+//pilot.  A frame is:
+//  [cp|A|A]   timing preamble (even carriers only, so both halves match)
+//  [cp|T]     training symbol with every carrier known (channel estimate)
+//  [cp|D] ... data symbols: the symsync byte count on BPSK carriers, then data
+//The number of carriers is picked to meet the bitrate, so the bitrate that
+//is actually used can be a little higher than the one asked for.
+
+typedef enum{
+	OFDM_DEMOD_SEARCH,
+	OFDM_DEMOD_PLATEAU,
+	OFDM_DEMOD_TRAINING,
+	OFDM_DEMOD_DATA,
+} ofdm_demod_state_t;
+
+typedef struct {
+	int      verbose;
+	size_t   samplerate;
+	size_t   bitrate;
+	size_t   bandwidth;
+	size_t   bit_per_symbol;
+	size_t   symbol_count;
+	double   thresh;
+
+	size_t   fftlen;
+	size_t   cplen;
+	size_t   carrier_count;
+	size_t   data_count;
+	size_t   first_bin;
+	uint8_t *pilot;
+	double  *pn;
+	double   scale;
+
+	double       *fft_time;
+	fftw_complex *fft_freq;
+	fftw_plan     mod_plan;
+	fftw_plan     demod_plan;
+
+	double  *mod_samples;
+	size_t   mod_sampleslen;
+
+	ofdm_demod_state_t demod_state;
+	double  *demod_buffer;
+	size_t   demod_bufferalloc;
+	size_t   demod_bufferlen;
+	size_t   demod_bufferpos;
+
+	size_t   demod_search;
+	size_t   demod_sumpos;
+	size_t   demod_sumcount;
+	double   demod_p;
+	double   demod_r;
+	size_t   demod_plateau_start;
+	size_t   demod_plateau_end;
+
+	size_t        demod_symbol;
+	uint64_t      demod_header;
+	size_t        demod_count;
+	size_t        demod_remaining;
+	fftw_complex *demod_chan;
+	fftw_complex *demod_gain;
+	double        demod_pilot_power;
+	bitstream_t   demod_bits;
+} ofdm_t;
+
+
+ofdm_t *ofdm_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count);
+void   ofdm_destroy(ofdm_t *modem);
+int    ofdm_set_thresh(ofdm_t *modem, double thresh);
+int    ofdm_set_verbose(ofdm_t *modem, int verbose);
+int    ofdm_set_soft(ofdm_t *modem, int on);
+int    ofdm_soft(ofdm_t *modem, int8_t **soft, size_t *softlen);
+void   ofdm_printinfo(ofdm_t *modem);
+int    ofdm_modulate(ofdm_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+int    ofdm_demodulate(ofdm_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+
+#endif //__OFDM_H__
+
+#ifdef OFDM_IMPLEMENTATION
+#undef OFDM_IMPLEMENTATION
+
+//Widest carrier spacing; the FFT size is the smallest power of two under it
+#define OFDM_MAX_SPACING    64.0
+//Lowest carrier frequency
+#define OFDM_MIN_FREQ       300.0
+#define OFDM_PILOT_SPACING  4
+//RMS of the modulated signal
+#define OFDM_AMPLITUDE      0.25
+//Quietest signal (mean power per sample) the preamble search will look at
+#define OFDM_MIN_POWER      1e-8
+//Training symbol must be this self consistent across adjacent carriers
+#define OFDM_TRAINING_MIN   0.5
+
+ofdm_t *ofdm_init(size_t samplerate, size_t bitrate, size_t bandwidth, size_t symbol_count) {
+	ofdm_t *modem;
+	size_t min_bin;
+	size_t max_bin;
+	size_t data;
+	size_t c;
+	uint32_t lfsr;
+
+	//Double check arguments
+	if( samplerate < (bandwidth * 2) ) { return 0; }
+	if( !bitrate ) { return 0; }
+	if( symbol_count < 2 ) { return 0; }
+
+	modem = (ofdm_t*)malloc(sizeof(ofdm_t));
+	if( !modem ) { goto ofdm_init_error; }
+	memset(modem,0,sizeof(ofdm_t));
+	bitstream_init_alloc(&modem->demod_bits);
+
+	modem->verbose = OFDM_DEFAULT_VERBOSE;
+
+	modem->samplerate = samplerate;
+	modem->bitrate = bitrate;
+	modem->bandwidth = bandwidth;
+
+	modem->bit_per_symbol = 1;
+	while( 1<<modem->bit_per_symbol < symbol_count ) {
+		modem->bit_per_symbol++;
+	}
+	//BPSK, QPSK and 16-QAM only
+	if( modem->bit_per_symbol == 3 || modem->bit_per_symbol > 4 ) { goto ofdm_init_error; }
+	modem->symbol_count = (1 << modem->bit_per_symbol);
+
+	modem->fftlen = 16;
+	while( (double)samplerate / (double)modem->fftlen > OFDM_MAX_SPACING ) {
+		modem->fftlen *= 2;
+	}
+	modem->cplen = modem->fftlen / 4;
+
+	//Enough data carriers for the bitrate, with pilots at both ends and
+	//every OFDM_PILOT_SPACING carriers in between
+	modem->data_count = (bitrate*(modem->fftlen+modem->cplen) + samplerate*modem->bit_per_symbol - 1) /
+	                    (samplerate*modem->bit_per_symbol);
+	if( modem->data_count < 1 ) {
+		modem->data_count = 1;
+	}
+	data = 0;
+	c = 0;
+	while( data < modem->data_count ) {
+		if( c % OFDM_PILOT_SPACING ) {
+			data++;
+		}
+		c++;
+	}
+	modem->carrier_count = c+1;
+
+	//Center the carriers in the usable part of the band
+	min_bin = (size_t)ceil(OFDM_MIN_FREQ * modem->fftlen / samplerate);
+	max_bin = bandwidth * modem->fftlen / samplerate;
+	if( max_bin > modem->fftlen/2 ) {
+		max_bin = modem->fftlen/2;
+	}
+	if( max_bin < min_bin+modem->carrier_count ) { goto ofdm_init_error; }
+	modem->first_bin = (min_bin + max_bin - modem->carrier_count) / 2;
+
+	modem->pilot = (uint8_t*)malloc(sizeof(uint8_t)*modem->carrier_count);
+	if( !modem->pilot ) { goto ofdm_init_error; }
+	modem->pn = (double*)malloc(sizeof(double)*modem->carrier_count);
+	if( !modem->pn ) { goto ofdm_init_error; }
+	//Pseudo random carrier signs keep the peak to average ratio down
+	lfsr = 0xACE1;
+	for( c=0; c<modem->carrier_count; c++ ) {
+		modem->pilot[c] = (c % OFDM_PILOT_SPACING == 0) || (c == modem->carrier_count-1);
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+		modem->pn[c] = (lfsr & 1) ? 1.0 : -1.0;
+	}
+	//c2r output is 2*Re() of each carrier
+	modem->scale = OFDM_AMPLITUDE / sqrt(2.0*modem->carrier_count);
+
+	modem->fft_time = (double*)fftw_malloc(sizeof(double)*modem->fftlen);
+	if( !modem->fft_time ) { goto ofdm_init_error; }
+	modem->fft_freq = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*(modem->fftlen/2+1));
+	if( !modem->fft_freq ) { goto ofdm_init_error; }
+	modem->mod_plan = fftw_plan_dft_c2r_1d(modem->fftlen,modem->fft_freq,modem->fft_time,FFTW_MEASURE);
+	if( !modem->mod_plan ) { goto ofdm_init_error; }
+	modem->demod_plan = fftw_plan_dft_r2c_1d(modem->fftlen,modem->fft_time,modem->fft_freq,FFTW_MEASURE);
+	if( !modem->demod_plan ) { goto ofdm_init_error; }
+
+	modem->demod_chan = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*modem->carrier_count);
+	if( !modem->demod_chan ) { goto ofdm_init_error; }
+	modem->demod_gain = (fftw_complex*)fftw_malloc(sizeof(fftw_complex)*modem->carrier_count);
+	if( !modem->demod_gain ) { goto ofdm_init_error; }
+
+	modem->demod_bufferalloc = 4*(modem->fftlen+modem->cplen);
+	modem->demod_buffer = (double*)malloc(sizeof(double)*modem->demod_bufferalloc);
+	if( !modem->demod_buffer ) { goto ofdm_init_error; }
+
+	if( ofdm_set_thresh(modem,OFDM_DEFAULT_THRESH) ) {
+		goto ofdm_init_error;
+	}
+	modem->demod_state = OFDM_DEMOD_SEARCH;
+
+	return modem;
+
+	ofdm_init_error:
+	ofdm_destroy(modem);
+	return 0;
+}
+
+void ofdm_destroy(ofdm_t *modem) {
+	if( modem ) {
+		if( modem->pilot ) { free(modem->pilot); }
+		if( modem->pn ) { free(modem->pn); }
+		if( modem->mod_plan ) { fftw_destroy_plan(modem->mod_plan); }
+		if( modem->demod_plan ) { fftw_destroy_plan(modem->demod_plan); }
+		if( modem->fft_time ) { fftw_free(modem->fft_time); }
+		if( modem->fft_freq ) { fftw_free(modem->fft_freq); }
+		if( modem->demod_chan ) { fftw_free(modem->demod_chan); }
+		if( modem->demod_gain ) { fftw_free(modem->demod_gain); }
+		if( modem->mod_samples ) { free(modem->mod_samples); }
+		if( modem->demod_buffer ) { free(modem->demod_buffer); }
+		bitstream_destroy(&modem->demod_bits);
+		memset(modem,0,sizeof(ofdm_t));
+		free(modem);
+	}
+}
+
+int ofdm_set_thresh(ofdm_t *modem, double thresh) {
+	//Threshold on the preamble timing metric, which is 1.0 for a clean
+	//preamble and falls with noise
+	if( !modem ) { return -1; }
+	if( thresh <= 0.0 || thresh > 1.0 ) { return -1; }
+	modem->thresh = thresh;
+	return 0;
+}
+
+int ofdm_set_verbose(ofdm_t *modem, int verbose) {
+	if( !modem ) { return -1; }
+	modem->verbose = verbose;
+	return 0;
+}
+
+int ofdm_set_soft(ofdm_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int ofdm_soft(ofdm_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+void ofdm_printinfo(ofdm_t *modem) {
+	printf("OFDM Modem:\n");
+	printf("  Verbose                  : %d\n",modem->verbose);
+	printf("  Samplerate               : %zu\n",modem->samplerate);
+	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
+	printf("  Actual Bitrate           : %0.1lf bps\n",(double)modem->data_count*modem->bit_per_symbol*modem->samplerate/(double)(modem->fftlen+modem->cplen));
+	printf("  Bandwidth                : %zu Hz\n",modem->bandwidth);
+	printf("  Bits per Carrier         : %zu\n",modem->bit_per_symbol);
+	printf("  FFT Size                 : %zu\n",modem->fftlen);
+	printf("  Cyclic Prefix            : %zu\n",modem->cplen);
+	printf("  Carrier Spacing          : %0.1lf Hz\n",(double)modem->samplerate/(double)modem->fftlen);
+	printf("  Carriers                 : %zu (%zu data)\n",modem->carrier_count,modem->data_count);
+	printf("  Frequencies              : %0.1lf - %0.1lf Hz\n",
+	       (double)modem->first_bin*modem->samplerate/modem->fftlen,
+	       (double)(modem->first_bin+modem->carrier_count-1)*modem->samplerate/modem->fftlen);
+}
+
+static void ofdm_map(ofdm_t *modem, int sym, double *re, double *im) {
+	//Gray coded constellations with unit average power
+	static const double qam16[4] = { -3.0, -1.0, 3.0, 1.0 };
+
+	if( modem->bit_per_symbol == 1 ) {
+		*re = (sym & 1) ? 1.0 : -1.0;
+		*im = 0.0;
+	}
+	else if( modem->bit_per_symbol == 2 ) {
+		*re = ((sym & 2) ? 1.0 : -1.0) / sqrt(2.0);
+		*im = ((sym & 1) ? 1.0 : -1.0) / sqrt(2.0);
+	}
+	else {
+		*re = qam16[(sym >> 2) & 3] / sqrt(10.0);
+		*im = qam16[sym & 3] / sqrt(10.0);
+	}
+}
+
+static int ofdm_demap(ofdm_t *modem, double re, double im) {
+	if( modem->bit_per_symbol == 1 ) {
+		return re > 0.0;
+	}
+	else if( modem->bit_per_symbol == 2 ) {
+		return ((re > 0.0) << 1) | (im > 0.0);
+	}
+	re = re * sqrt(10.0);
+	im = im * sqrt(10.0);
+	return ((re > 0.0) << 3) | ((fabs(re) < 2.0) << 2) |
+	       ((im > 0.0) << 1) |  (fabs(im) < 2.0);
+}
+
+static void ofdm_demap_llr(ofdm_t *modem, double re, double im, double *llr) {
+	//Bit confidences for ofdm_demap: the distance to each decision 
+	//boundary, in units of the distance a clean point has from it
+	if( modem->bit_per_symbol == 1 ) {
+		llr[0] = re;
+		return;
+	}
+	else if( modem->bit_per_symbol == 2 ) {
+		llr[0] = re * sqrt(2.0);
+		llr[1] = im * sqrt(2.0);
+		return;
+	}
+	re = re * sqrt(10.0);
+	im = im * sqrt(10.0);
+	llr[0] = re;
+	llr[1] = 2.0 - fabs(re);
+	llr[2] = im;
+	llr[3] = 2.0 - fabs(im);
+}
+
+static void ofdm_modulate_symbol(ofdm_t *modem, double *out) {
+	//Turn modem->fft_freq into one symbol (with cyclic prefix) at out
+	size_t j;
+	double x;
+
+	fftw_execute(modem->mod_plan);
+	for( j=0; j<modem->fftlen+modem->cplen; j++ ) {
+		x = modem->fft_time[(j+modem->fftlen-modem->cplen) % modem->fftlen] * modem->scale;
+		if( x > 1.0 ) {
+			x = 1.0;
+		}
+		else if( x < -1.0 ) {
+			x = -1.0;
+		}
+		out[j] = x;
+	}
+}
+
+int ofdm_modulate(ofdm_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_idx;
+	size_t symbol_count;
+	size_t symbol_len;
+	bitstream_t bits;
+	size_t ii;
+	size_t c;
+	size_t bin;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	double re;
+	double im;
+	size_t carrier;
+
+	if( !modem ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen || datalen >= (1 << SYMSYNC_HEADER_BITS) ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("ofdm_modulate(...):\n");
+		printf("  Data: ");
+		for( ii=0; ii<datalen; ii++ ) {
+			printf("%02x ",data[ii]);
+		}
+		printf("\n");
+	}
+
+	carrier = SYMSYNC_HEADER_LEN + (datalen*8 + modem->bit_per_symbol - 1)/modem->bit_per_symbol;
+	symbol_count = (carrier + modem->data_count - 1) / modem->data_count;
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+
+	symbol_len = modem->fftlen+modem->cplen;
+	mod_sampleslen = symbol_len*(symbol_count+2);
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto ofdm_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+
+	//Timing preamble: only even bins, so the two halves repeat
+	memset(modem->fft_freq,0,sizeof(fftw_complex)*(modem->fftlen/2+1));
+	for( c=0; c<modem->carrier_count; c++ ) {
+		bin = modem->first_bin+c;
+		if( !(bin & 1) ) {
+			modem->fft_freq[bin][0] = modem->pn[c]*sqrt(2.0);
+		}
+	}
+	ofdm_modulate_symbol(modem,mod_samples);
+
+	//Training symbol
+	memset(modem->fft_freq,0,sizeof(fftw_complex)*(modem->fftlen/2+1));
+	for( c=0; c<modem->carrier_count; c++ ) {
+		modem->fft_freq[modem->first_bin+c][0] = modem->pn[c];
+	}
+	ofdm_modulate_symbol(modem,mod_samples+symbol_len);
+
+	bitstream_init(&bits, data, datalen);
+	carrier = 0;
+	for( symbol_idx=0; symbol_idx<symbol_count; symbol_idx++ ) {
+		memset(modem->fft_freq,0,sizeof(fftw_complex)*(modem->fftlen/2+1));
+		for( c=0; c<modem->carrier_count; c++ ) {
+			bin = modem->first_bin+c;
+			if( modem->pilot[c] ) {
+				modem->fft_freq[bin][0] = modem->pn[c];
+			}
+			else {
+				//The byte count goes first, one BPSK bit per carrier
+				if( carrier < SYMSYNC_HEADER_LEN ) {
+					re = symsync_header_bit(datalen,carrier) ? 1.0 : -1.0;
+					im = 0.0;
+				}
+				else {
+					ofdm_map(modem,bitstream_read(&bits, modem->bit_per_symbol),&re,&im);
+				}
+				carrier++;
+				modem->fft_freq[bin][0] = re*modem->pn[c];
+				modem->fft_freq[bin][1] = im*modem->pn[c];
+			}
+		}
+		ofdm_modulate_symbol(modem,mod_samples+symbol_len*(symbol_idx+2));
+	}
+
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+
+	ofdm_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
+}
+
+
+static void ofdm_demodulate_search(ofdm_t *modem) {
+	//Evaluate the repeated half metric for the window at demod_search.
+	//P and R are slid along one sample at a time, and recomputed from
+	//scratch every fftlen steps to keep rounding from building up.
+	double *r;
+	size_t half;
+	size_t m;
+	double metric;
+
+	half = modem->fftlen/2;
+	r = modem->demod_buffer + (modem->demod_search - modem->demod_bufferpos);
+	if( modem->demod_sumcount && modem->demod_sumpos+1 == modem->demod_search &&
+	    modem->demod_sumcount < modem->fftlen ) {
+		modem->demod_p = modem->demod_p - r[-1]*r[half-1] + r[half-1]*r[2*half-1];
+		modem->demod_r = modem->demod_r - r[half-1]*r[half-1] + r[2*half-1]*r[2*half-1];
+		modem->demod_sumcount++;
+	}
+	else {
+		modem->demod_p = 0.0;
+		modem->demod_r = 0.0;
+		for( m=0; m<half; m++ ) {
+			modem->demod_p = modem->demod_p + r[m]*r[m+half];
+			modem->demod_r = modem->demod_r + r[m+half]*r[m+half];
+		}
+		modem->demod_sumcount = 1;
+	}
+	modem->demod_sumpos = modem->demod_search;
+
+	metric = 0.0;
+	if( modem->demod_p > 0.0 && modem->demod_r > OFDM_MIN_POWER*half ) {
+		metric = (modem->demod_p*modem->demod_p) / (modem->demod_r*modem->demod_r);
+	}
+
+	if( modem->demod_state == OFDM_DEMOD_SEARCH ) {
+		if( metric >= modem->thresh ) {
+			modem->demod_plateau_start = modem->demod_search;
+			modem->demod_plateau_end = modem->demod_search;
+			modem->demod_state = OFDM_DEMOD_PLATEAU;
+		}
+	}
+	else if( metric >= modem->thresh &&
+	         modem->demod_search - modem->demod_plateau_start < modem->fftlen+modem->cplen ) {
+		modem->demod_plateau_end = modem->demod_search;
+	}
+	else {
+		//The metric is flat while the window is inside [cp|A|A], so the
+		//middle of the plateau is half a prefix ahead of the FFT start.
+		//Aim a quarter prefix early to leave room for echoes either way.
+		modem->demod_symbol = (modem->demod_plateau_start+modem->demod_plateau_end)/2 +
+		                      modem->cplen/4 + modem->fftlen+modem->cplen;
+		if( modem->verbose ) {
+			printf("  Preamble at %zu - %zu\n",modem->demod_plateau_start,modem->demod_plateau_end);
+		}
+		modem->demod_state = OFDM_DEMOD_TRAINING;
+	}
+	modem->demod_search++;
+}
+
+static void ofdm_demodulate_restart(ofdm_t *modem, size_t pos) {
+	if( pos < modem->demod_bufferpos ) {
+		pos = modem->demod_bufferpos;
+	}
+	modem->demod_search = pos;
+	modem->demod_sumcount = 0;
+	modem->demod_state = OFDM_DEMOD_SEARCH;
+}
+
+static int ofdm_demodulate_carrier(ofdm_t *modem, double re, double im) {
+	//Take one equalized data carrier: a bit of the byte count, or data
+	//until the count runs out
+	double llr[4];
+
+	if( modem->demod_count < SYMSYNC_HEADER_LEN ) {
+		modem->demod_header = (modem->demod_header << 1) | (re > 0.0);
+		modem->demod_count++;
+		if( modem->demod_count < SYMSYNC_HEADER_LEN ) {
+			return 0;
+		}
+		if( symsync_header_check(modem->demod_header,&modem->demod_remaining) ) {
+			if( modem->verbose ) {
+				printf("  Bad header\n");
+			}
+			modem->demod_remaining = 0;
+			return 0;
+		}
+		if( modem->verbose ) {
+			printf("  Frame of %zu bytes\n",modem->demod_remaining);
+		}
+		//bit_per_symbol divides 8, so the count is whole carriers
+		modem->demod_remaining = modem->demod_remaining*8 / modem->bit_per_symbol;
+		return 0;
+	}
+	if( modem->demod_bits.softon ) {
+		ofdm_demap_llr(modem,re,im,llr);
+	}
+	if( bitstream_write_soft(&modem->demod_bits, modem->bit_per_symbol, ofdm_demap(modem,re,im), llr) ) {
+		if( modem->verbose ) {
+			printf("    Failed to grow data buffer\n");
+		}
+		return -1;
+	}
+	modem->demod_remaining--;
+	return 0;
+}
+
+static int ofdm_demodulate_symbol(ofdm_t *modem) {
+	//FFT the symbol at demod_symbol, and either take the channel estimate
+	//from it (training) or equalize and slice it (data)
+	size_t c;
+	size_t p0;
+	size_t p1;
+	size_t bin;
+	double *yr;
+	double re;
+	double im;
+	double mag;
+	double even;
+	double odd;
+	double power;
+	double num_re;
+	double num_im;
+	double den;
+	double frac;
+	size_t pilots;
+
+	memcpy(modem->fft_time,modem->demod_buffer+(modem->demod_symbol-modem->demod_bufferpos),sizeof(double)*modem->fftlen);
+	fftw_execute(modem->demod_plan);
+
+	if( modem->demod_state == OFDM_DEMOD_TRAINING ) {
+		//Known symbol, so the channel is Y * pn
+		num_re = 0.0;
+		num_im = 0.0;
+		den = 0.0;
+		power = 0.0;
+		for( c=0; c<modem->carrier_count; c++ ) {
+			yr = modem->fft_freq[modem->first_bin+c];
+			modem->demod_chan[c][0] = yr[0]*modem->pn[c];
+			modem->demod_chan[c][1] = yr[1]*modem->pn[c];
+			mag = yr[0]*yr[0] + yr[1]*yr[1];
+			power = power + mag;
+			den = den + mag;
+			if( c ) {
+				num_re = num_re + modem->demod_chan[c][0]*modem->demod_chan[c-1][0] + modem->demod_chan[c][1]*modem->demod_chan[c-1][1];
+				num_im = num_im + modem->demod_chan[c][1]*modem->demod_chan[c-1][0] - modem->demod_chan[c][0]*modem->demod_chan[c-1][1];
+			}
+		}
+		//A real training symbol gives a smooth channel, noise does not
+		if( den <= 0.0 || sqrt(num_re*num_re+num_im*num_im) < OFDM_TRAINING_MIN*den ) {
+			if( modem->verbose ) {
+				printf("  Training symbol rejected\n");
+			}
+			ofdm_demodulate_restart(modem,modem->demod_plateau_end+1);
+			return 0;
+		}
+		modem->demod_pilot_power = power / modem->carrier_count;
+		modem->demod_symbol = modem->demod_symbol + modem->fftlen + modem->cplen;
+		modem->demod_state = OFDM_DEMOD_DATA;
+		modem->demod_header = 0;
+		modem->demod_count = 0;
+		modem->demod_remaining = 0;
+		//Frames start on a byte; drop the padding of one that was cut off
+		if( bitstream_flush(&modem->demod_bits) ) { return -1; }
+		return 0;
+	}
+
+	//A frame cut short runs into silence or the next frame's timing
+	//preamble, which has nothing on odd bins
+	even = 0.0;
+	odd = 0.0;
+	power = 0.0;
+	pilots = 0;
+	for( c=0; c<modem->carrier_count; c++ ) {
+		bin = modem->first_bin+c;
+		yr = modem->fft_freq[bin];
+		mag = yr[0]*yr[0] + yr[1]*yr[1];
+		if( bin & 1 ) {
+			odd = odd + mag;
+		}
+		else {
+			even = even + mag;
+		}
+		if( modem->pilot[c] ) {
+			power = power + mag;
+			pilots++;
+		}
+	}
+	power = power / pilots;
+	if( odd < 0.1*even || power < 0.25*modem->demod_pilot_power ) {
+		if( modem->verbose ) {
+			printf("  Signal lost\n");
+		}
+		ofdm_demodulate_restart(modem,modem->demod_symbol-modem->cplen-modem->cplen/2);
+		return 0;
+	}
+
+	//Pilot gain relative to the training estimate, linearly interpolated
+	//over the data carriers between them
+	for( c=0; c<modem->carrier_count; c++ ) {
+		if( modem->pilot[c] ) {
+			yr = modem->fft_freq[modem->first_bin+c];
+			den = modem->demod_chan[c][0]*modem->demod_chan[c][0] + modem->demod_chan[c][1]*modem->demod_chan[c][1];
+			re = (yr[0]*modem->demod_chan[c][0] + yr[1]*modem->demod_chan[c][1]) * modem->pn[c] / den;
+			im = (yr[1]*modem->demod_chan[c][0] - yr[0]*modem->demod_chan[c][1]) * modem->pn[c] / den;
+			modem->demod_gain[c][0] = re;
+			modem->demod_gain[c][1] = im;
+		}
+	}
+	p0 = 0;
+	for( c=1; c<modem->carrier_count; c++ ) {
+		if( !modem->pilot[c] ) {
+			continue;
+		}
+		p1 = c;
+		for( c=p0+1; c<p1; c++ ) {
+			frac = (double)(c-p0) / (double)(p1-p0);
+			modem->demod_gain[c][0] = modem->demod_gain[p0][0] + frac*(modem->demod_gain[p1][0]-modem->demod_gain[p0][0]);
+			modem->demod_gain[c][1] = modem->demod_gain[p0][1] + frac*(modem->demod_gain[p1][1]-modem->demod_gain[p0][1]);
+		}
+		p0 = p1;
+	}
+
+	for( c=0; c<modem->carrier_count; c++ ) {
+		if( modem->pilot[c] ) {
+			continue;
+		}
+		yr = modem->fft_freq[modem->first_bin+c];
+		//H = chan * gain
+		re = modem->demod_chan[c][0]*modem->demod_gain[c][0] - modem->demod_chan[c][1]*modem->demod_gain[c][1];
+		im = modem->demod_chan[c][0]*modem->demod_gain[c][1] + modem->demod_chan[c][1]*modem->demod_gain[c][0];
+		den = re*re + im*im;
+		if( den <= 0.0 ) {
+			num_re = 0.0;
+			num_im = 0.0;
+		}
+		else {
+			num_re = (yr[0]*re + yr[1]*im) * modem->pn[c] / den;
+			num_im = (yr[1]*re - yr[0]*im) * modem->pn[c] / den;
+		}
+		if( ofdm_demodulate_carrier(modem,num_re,num_im) ) {
+			return -1;
+		}
+		if( modem->demod_count == SYMSYNC_HEADER_LEN && !modem->demod_remaining ) {
+			break;
+		}
+	}
+	modem->demod_symbol = modem->demod_symbol + modem->fftlen + modem->cplen;
+	if( modem->demod_count == SYMSYNC_HEADER_LEN && !modem->demod_remaining ) {
+		//The frame is complete (or its header was bad), so look for the
+		//next preamble where the next symbol would start
+		if( modem->verbose ) {
+			printf("  End of frame\n");
+		}
+		ofdm_demodulate_restart(modem,modem->demod_symbol-modem->cplen-modem->cplen/2);
+	}
+	return 0;
+}
+
+int ofdm_demodulate(ofdm_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t ii;
+	size_t j;
+	size_t n;
+	size_t keep;
+	size_t end;
+
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("ofdm_demodulate(...)\n");
+	}
+
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+
+	ii = 0;
+	while( ii < sampleslen ) {
+		//Drop samples that no window can reach anymore
+		if( modem->demod_state == OFDM_DEMOD_SEARCH || modem->demod_state == OFDM_DEMOD_PLATEAU ) {
+			keep = modem->demod_search ? modem->demod_search-1 : 0;
+		}
+		else {
+			keep = modem->demod_symbol - 2*modem->cplen;
+		}
+		if( keep > modem->demod_bufferpos ) {
+			n = keep - modem->demod_bufferpos;
+			if( n > modem->demod_bufferlen ) {
+				n = modem->demod_bufferlen;
+			}
+			memmove(modem->demod_buffer,modem->demod_buffer+n,sizeof(double)*(modem->demod_bufferlen-n));
+			modem->demod_bufferlen = modem->demod_bufferlen - n;
+			modem->demod_bufferpos = modem->demod_bufferpos + n;
+		}
+
+		n = modem->demod_bufferalloc - modem->demod_bufferlen;
+		if( n > sampleslen-ii ) {
+			n = sampleslen-ii;
+		}
+		for( j=0; j<n; j++ ) {
+			modem->demod_buffer[modem->demod_bufferlen++] = samples[ii++];
+		}
+		end = modem->demod_bufferpos + modem->demod_bufferlen;
+
+		for(;;) {
+			if( modem->demod_state == OFDM_DEMOD_SEARCH || modem->demod_state == OFDM_DEMOD_PLATEAU ) {
+				if( modem->demod_search + modem->fftlen > end ) { break; }
+				ofdm_demodulate_search(modem);
+			}
+			else {
+				if( modem->demod_symbol + modem->fftlen > end ) { break; }
+				if( ofdm_demodulate_symbol(modem) ) {
+					return -1;
+				}
+			}
+		}
+	}
+
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+#endif //OFDM_IMPLEMENTATION
\ No newline at end of file
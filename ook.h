@@ -43,6 +43,7 @@ typedef enum{
 	OOK_DEMOD_IDLE_DETECTED,
 	OOK_DEMOD_START_ACQUIRE,
 	OOK_DEMOD_CAPTURE,
+	OOK_DEMOD_FRAME,
 } ook_demod_state_t;
 
 typedef struct {
@@ -50,30 +51,62 @@ typedef struct {
 	size_t   samplerate;
 	size_t   bitrate;
 	double   frequency;
+	int      rll;
 	
 	size_t   mod_samp_per_sym;
 	size_t   demod_samp_per_fft;
+	size_t   demod_bandwidth;
+	double   demod_thresh;
+	double   demod_rolloff;
 	double  *mod_samples;
 	size_t   mod_sampleslen;
+	pulse_t *mod_taper;
 	
+	//Only created once ook_demodulate_fft or the front-end needs it
 	srcfft_t *srcfft;
 	ook_demod_state_t demod_state;
+	//Tone measurements per bit for the path in use
+	size_t     demod_oversample;
+	
+	//Time domain envelope detector
+	double     demod_nco;
+	double     demod_env_alpha;
+	double     demod_env[4];
+	double     demod_env_detect;
 	
 	size_t     demod_capture_alloc;
 	size_t     demod_capture_len;
 	uint8_t   *demod_capture;
-	uint8_t   *demod_data;
-	size_t     demod_datalen;
+	
+	//Run length limited framing
+	int        demod_tone;
+	size_t     demod_flip;
+	size_t     demod_debounce;
+	size_t     demod_clock;
+	int        demod_last;
+	size_t     demod_run;
+	uint32_t   demod_pend;
+	size_t     demod_pendlen;
+	double     demod_pendllr[32];
+	size_t     demod_agree;
+	size_t     demod_seen;
+	bitstream_t demod_bits;
 } ook_t;
 
 
 ook_t *ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency);
+ook_t *ook_rll_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency);
 void   ook_destroy(ook_t *modem);
 int    ook_set_thresh(ook_t *modem, double thresh);
 int    ook_set_verbose(ook_t *modem, int verbose);
+int    ook_set_soft(ook_t *modem, int on);
+int    ook_soft(ook_t *modem, int8_t **soft, size_t *softlen);
+int    ook_set_pulse(ook_t *modem, double rolloff);
+srcfft_t *ook_frontend(ook_t *modem);
 void   ook_printinfo(ook_t *modem);
 int    ook_modulate(ook_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
 int    ook_demodulate(ook_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+int    ook_demodulate_fft(ook_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen);
 
 #endif //__OOK_H__
 
@@ -82,8 +115,18 @@ int    ook_demodulate(ook_t *modem, uint8_t **data, size_t *datalen, double *sam
 #undef OOK_IMPLEMENTATION
 
 #define OOK_OVERSAMPLE 5
+//Envelope low pass cutoff, times the bitrate
+#define OOK_ENV_CUTOFF 2.0
 
-ook_t *ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency) {
+//Run length limited framing: after OOK_RLL_MAX_RUN equal symbols the
+//opposite symbol is stuffed in, so the receiver sees an edge to recover
+//the clock from at least that often.  A run of tone one longer is the
+//start flag, and a run of silence one longer ends the frame.
+#define OOK_RLL_MAX_RUN   5
+#define OOK_RLL_PREAMBLE  8
+#define OOK_RLL_DEBOUNCE  2
+
+static ook_t *ook_init_mode(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, int rll) {
 	ook_t *modem;
 	
 	//Double check arguments
@@ -93,11 +136,13 @@ ook_t *ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq
 	modem = (ook_t*)malloc(sizeof(ook_t));
 	if( !modem ) { goto ook_init_error; }
 	memset(modem,0,sizeof(ook_t));
+	bitstream_init_alloc(&modem->demod_bits);
 	
 	modem->verbose = OOK_DEFAULT_VERBOSE;
 	modem->samplerate = samplerate;
 	modem->bitrate = bitrate;
 	modem->frequency = frequency;
+	modem->rll = rll;
 	
 	modem->mod_samp_per_sym = (double)samplerate / (double)bitrate;
 	//Make sure that we are measureing the signal fast enough to 
@@ -105,22 +150,33 @@ ook_t *ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq
 	//clk and the data
 	modem->demod_samp_per_fft = ((double)samplerate / (double)bitrate )/ (double)OOK_OVERSAMPLE;
 	
-	//Create the Samplerate converting FFT object
-	modem->srcfft = srcfft_init(samplerate,modem->demod_samp_per_fft,bandwidth,1);
-	if( !modem->srcfft ) { goto ook_init_error; }
+	modem->demod_bandwidth = bandwidth;
+	
+	//Two one pole low pass stages after the mixer
+	modem->demod_env_alpha = 1.0 - exp(-2*M_PI*OOK_ENV_CUTOFF*bitrate/samplerate);
+	
+	//The Samplerate converting FFT object is left to ook_frontend, so
+	//the time domain path never pays for it
 	if( ook_set_thresh(modem,OOK_DEFAULT_THRESH) ) {
 		goto ook_init_error;
 	}
 	
 	//Record captured values (high/low) for an entire Byte:
-	//OOK_OVERSAMPLE for each bit plus start byte and next idle
-	modem->demod_capture_alloc = OOK_OVERSAMPLE * 10;
+	//every measurement of each bit plus start byte and next idle.  The
+	//envelope detector measures every sample, the FFTs OOK_OVERSAMPLE
+	//times a bit.
+	modem->demod_capture_alloc = modem->mod_samp_per_sym;
+	if( modem->demod_capture_alloc < OOK_OVERSAMPLE ) {
+		modem->demod_capture_alloc = OOK_OVERSAMPLE;
+	}
+	modem->demod_capture_alloc = modem->demod_capture_alloc * 10;
 	modem->demod_capture = (uint8_t*)malloc(sizeof(uint8_t)*modem->demod_capture_alloc);
 	if( !modem->demod_capture ) {
 		goto ook_init_error;
 	}
 	
 	modem->demod_state = OOK_DEMOD_SEARCH;
+	modem->demod_last = -1;
 	
 	return modem;
 	
@@ -129,28 +185,37 @@ ook_t *ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double freq
 	return 0;
 }
 
+ook_t *ook_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency) {
+	return ook_init_mode(samplerate,bitrate,bandwidth,frequency,0);
+}
+
+ook_t *ook_rll_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency) {
+	//A single preamble per frame and stuffed bits instead of 8N1 framing
+	return ook_init_mode(samplerate,bitrate,bandwidth,frequency,1);
+}
+
 void ook_destroy(ook_t *modem) {
 	if( modem ) {
 		if( modem->srcfft) { srcfft_destroy(modem->srcfft); }
+		if( modem->mod_taper ) { pulse_destroy(modem->mod_taper); }
 		if( modem->mod_samples ) { free(modem->mod_samples); }
-		if( modem->demod_data ) { free(modem->demod_data); }
+		if( modem->demod_capture ) { free(modem->demod_capture); }
+		bitstream_destroy(&modem->demod_bits);
 		memset(modem,0,sizeof(ook_t));
 		free(modem);
 	}
 }
 
 
-int ook_set_thresh(ook_t *modem, double thresh) {
+static int ook_srcfft_thresh(ook_t *modem, double thresh) {
+	//Measures a tone of amplitude thresh through srcfft and sets that as
+	//its detection threshold
 	size_t ii;
 	size_t k;
 	size_t sampleslen = 0;
 	double *samples = 0;
 	srcfft_status_t result;
 	
-	if( modem->verbose ) {
-		printf("ook_set_thresh(...)\n");
-	}
-	
 	sampleslen = modem->srcfft->srcinalloc;
 	samples = (double*)malloc(sizeof(double)*sampleslen);
 	if( !samples ) {
@@ -204,12 +269,78 @@ int ook_set_thresh(ook_t *modem, double thresh) {
 	return -1;
 }
 
+int ook_set_thresh(ook_t *modem, double thresh) {
+	if( modem->verbose ) {
+		printf("ook_set_thresh(...)\n");
+	}
+	
+	if( modem->srcfft && ook_srcfft_thresh(modem,thresh) ) {
+		return -1;
+	}
+	modem->demod_thresh = thresh;
+	//The envelope of a full scale tone is 1
+	modem->demod_env_detect = thresh;
+	return 0;
+}
+
 int ook_set_verbose(ook_t *modem, int verbose) {
 	if( !modem ) { return -1; }
 	modem->verbose = verbose;
 	return 0;
 }
 
+int ook_set_soft(ook_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int ook_soft(ook_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+int ook_set_pulse(ook_t *modem, double rolloff) {
+	//Send tone symbols as raised cosine pulses of the given roll-off and 
+	//window the receive FFTs to match.  0 restores hard keying.
+	pulse_t *taper = 0;
+	
+	if( !modem ) { return -1; }
+	if( rolloff != 0.0 ) {
+		taper = pulse_taper_init(modem->mod_samp_per_sym,rolloff);
+		if( !taper ) { return -1; }
+	}
+	if( modem->srcfft && srcfft_set_taper(modem->srcfft,rolloff) ) {
+		pulse_destroy(taper);
+		return -1;
+	}
+	pulse_destroy(modem->mod_taper);
+	modem->mod_taper = taper;
+	modem->demod_rolloff = rolloff;
+	return 0;
+}
+
+srcfft_t *ook_frontend(ook_t *modem) {
+	//Creates the Samplerate converting FFT object on first use, with the
+	//threshold and taper already set on the modem
+	if( !modem ) { return 0; }
+	if( modem->srcfft ) { return modem->srcfft; }
+	
+	modem->srcfft = srcfft_init(modem->samplerate,modem->demod_samp_per_fft,modem->demod_bandwidth,1);
+	if( !modem->srcfft ) { goto ook_frontend_error; }
+	if( srcfft_set_taper(modem->srcfft,modem->demod_rolloff) ) {
+		goto ook_frontend_error;
+	}
+	if( ook_srcfft_thresh(modem,modem->demod_thresh) ) {
+		goto ook_frontend_error;
+	}
+	return modem->srcfft;
+	
+	ook_frontend_error:
+	if( modem->srcfft ) { srcfft_destroy(modem->srcfft); }
+	modem->srcfft = 0;
+	return 0;
+}
+
 void ook_printinfo(ook_t *modem) {
 	size_t i;
 	size_t j;
@@ -219,7 +350,164 @@ void ook_printinfo(ook_t *modem) {
 	printf("  Bitrate            : %zu bps\n",modem->bitrate);
 	printf("  Samples per Symbol : %zu\n",modem->mod_samp_per_sym);
 	printf("  Samples per FFT    : %zu\n",modem->demod_samp_per_fft);
+	printf("  Envelope Decisions : every sample\n");
+	printf("  Envelope Cutoff    : %0.1lf Hz\n",OOK_ENV_CUTOFF*modem->bitrate);
 	printf("  Frequency          : %0.1lf Hz\n",modem->frequency);
+	printf("  Framing            : %s\n",modem->rll ? "Run length limited" : "8N1");
+	if( modem->mod_taper ) {
+		printf("  Pulse Roll-off     : %0.2lf\n",modem->mod_taper->shape);
+	}
+}
+
+static size_t ook_rll_symbols(uint8_t *syms, uint8_t *data, size_t datalen) {
+	//Line codes data into tone (1) / silence (0) symbols, and returns the
+	//count.  With syms null, only counts.
+	size_t count = 0;
+	size_t ii;
+	size_t run;
+	int last;
+	int bit;
+	
+	//Alternating preamble for the clock, then the start flag
+	for( ii=0; ii<OOK_RLL_PREAMBLE; ii++ ) {
+		if( syms ) { syms[count] = !(ii & 1); }
+		count++;
+	}
+	for( ii=0; ii<OOK_RLL_MAX_RUN+1; ii++ ) {
+		if( syms ) { syms[count] = 1; }
+		count++;
+	}
+	if( syms ) { syms[count] = 0; }
+	count++;
+	
+	last = -1;
+	run = 0;
+	for( ii=0; ii<datalen*8+1; ii++ ) {
+		//A final 1 marks where the data stops
+		bit = 1;
+		if( ii < datalen*8 ) {
+			bit = (data[ii/8] >> (7-(ii%8))) & 1;
+		}
+		if( syms ) { syms[count] = bit; }
+		count++;
+		run = (bit == last) ? run+1 : 1;
+		last = bit;
+		if( run == OOK_RLL_MAX_RUN ) {
+			if( syms ) { syms[count] = !bit; }
+			count++;
+			last = !bit;
+			run = 1;
+		}
+	}
+	
+	//Enough silence to end the frame
+	for( ii=0; ii<OOK_RLL_MAX_RUN+1; ii++ ) {
+		if( syms ) { syms[count] = 0; }
+		count++;
+	}
+	return count;
+}
+
+static int ook_symbol_on(ook_t *modem, size_t sym_idx) {
+	//Keyed samples are either silent or a tone
+	size_t ii;
+	double *samples;
+	
+	samples = modem->mod_samples + sym_idx*modem->mod_samp_per_sym;
+	for( ii=0; ii<modem->mod_samp_per_sym; ii++ ) {
+		if( samples[ii] != 0.0 ) { return 1; }
+	}
+	return 0;
+}
+
+static int ook_shape(ook_t *modem) {
+	//Resend the hard keyed tone symbols as raised cosine pulses, which 
+	//overlap their neighbours on the ramps, so runs of tone keep a 
+	//constant amplitude and only the on/off edges are smoothed
+	size_t symbol_count;
+	size_t sym_idx;
+	size_t start;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	int on;
+	
+	if( !modem->mod_taper ) { return 0; }
+	symbol_count = modem->mod_sampleslen / modem->mod_samp_per_sym;
+	mod_sampleslen = modem->mod_sampleslen + modem->mod_taper->len - modem->mod_samp_per_sym;
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) { return -1; }
+	memset(mod_samples+modem->mod_sampleslen,0,sizeof(double)*(mod_sampleslen-modem->mod_sampleslen));
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	
+	//Backwards, so each symbol is read before the pulse before it spills in
+	sym_idx = symbol_count;
+	while( sym_idx-- ) {
+		on = ook_symbol_on(modem,sym_idx);
+		start = sym_idx*modem->mod_samp_per_sym;
+		memset(mod_samples+start,0,sizeof(double)*modem->mod_samp_per_sym);
+		if( on ) {
+			pulse_taper_add(modem->mod_taper,mod_samples,start,modem->frequency,0.0,modem->samplerate);
+		}
+	}
+	return 0;
+}
+
+static int ook_modulate_rll(ook_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_count;
+	size_t sym_idx;
+	size_t sample_count;
+	size_t ii;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	uint8_t *syms;
+	
+	symbol_count = ook_rll_symbols(0,data,datalen);
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+	syms = (uint8_t*)malloc(symbol_count);
+	if( !syms ) {
+		goto ook_modulate_rll_error;
+	}
+	ook_rll_symbols(syms,data,datalen);
+	
+	mod_sampleslen = modem->mod_samp_per_sym*symbol_count;
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto ook_modulate_rll_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	
+	ii = 0;
+	for( sym_idx=0; sym_idx<symbol_count; sym_idx++ ) {
+		if( modem->verbose ) {
+			printf("%c",syms[sym_idx] ? '-' : '_');
+		}
+		for( sample_count=0; sample_count<modem->mod_samp_per_sym; sample_count++ ) {
+			mod_samples[ii] = syms[sym_idx] ? sin(2*M_PI*modem->frequency*ii/modem->samplerate) : 0;
+			ii++;
+		}
+	}
+	if( modem->verbose ) {
+		printf("\n");
+	}
+	free(syms);
+	syms = 0;
+	if( ook_shape(modem) ) {
+		goto ook_modulate_rll_error;
+	}
+	
+	*samples = modem->mod_samples;
+	*sampleslen = modem->mod_sampleslen;
+	return 0;
+	
+	ook_modulate_rll_error:
+	if( syms ) { free(syms); }
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
 }
 
 int ook_modulate(ook_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
@@ -246,6 +534,10 @@ int ook_modulate(ook_t *modem, double **samples, size_t *sampleslen, uint8_t *da
 		}
 	}
 	
+	if( modem->rll ) {
+		return ook_modulate_rll(modem,samples,sampleslen,data,datalen);
+	}
+	
 	//To sync receive
 	//  1 symbol of tone (idle)
 	//All bytes will have
@@ -314,9 +606,12 @@ int ook_modulate(ook_t *modem, double **samples, size_t *sampleslen, uint8_t *da
 			ii++;
 		}
 	}
+	if( ook_shape(modem) ) {
+		goto ook_modulate_error;
+	}
 	
-	*samples = mod_samples;
-	*sampleslen = mod_sampleslen;
+	*samples = modem->mod_samples;
+	*sampleslen = modem->mod_sampleslen;
 	return 0;
 	
 	ook_modulate_error:
@@ -326,8 +621,143 @@ int ook_modulate(ook_t *modem, double **samples, size_t *sampleslen, uint8_t *da
 }
 
 
-int ook_demodulate(ook_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
-	size_t   ii;
+static int ook_demodulate_rll_end(ook_t *modem) {
+	//Drops the end marker (and the silence after it) from the pending
+	//bits, and writes out what is left, which should be whole bytes
+	while( modem->demod_pendlen && !(modem->demod_pend & 1) ) {
+		modem->demod_pend = modem->demod_pend >> 1;
+		modem->demod_pendlen--;
+	}
+	if( modem->demod_pendlen ) {
+		modem->demod_pend = modem->demod_pend >> 1;
+		modem->demod_pendlen--;
+	}
+	if( modem->demod_pendlen == 8 ) {
+		if( bitstream_write_soft(&modem->demod_bits, 8, modem->demod_pend, modem->demod_pendllr) ) {
+			return -1;
+		}
+	}
+	else if( modem->demod_pendlen && modem->verbose ) {
+		printf("    %zu stray bits at end of frame\n",modem->demod_pendlen);
+	}
+	modem->demod_pendlen = 0;
+	return 0;
+}
+
+static int ook_demodulate_rll_symbol(ook_t *modem, int sym, double llr) {
+	//Handles one recovered symbol of a run length limited frame, llr being
+	//how sure the tone measurements over the symbol were of it
+	size_t run;
+	
+	run = (sym == modem->demod_last) ? modem->demod_run+1 : 1;
+	
+	if( modem->demod_state != OOK_DEMOD_FRAME ) {
+		//Start flag is a run of tone one longer than data can have
+		if( !sym && modem->demod_last == 1 && modem->demod_run > OOK_RLL_MAX_RUN ) {
+			if( modem->verbose ) {
+				printf("      Start flag detected\n");
+			}
+			modem->demod_state = OOK_DEMOD_FRAME;
+			modem->demod_pendlen = 0;
+			modem->demod_last = -1;
+			modem->demod_run = 0;
+			return 0;
+		}
+		modem->demod_last = sym;
+		modem->demod_run = run;
+		return 0;
+	}
+	
+	if( modem->demod_run == OOK_RLL_MAX_RUN ) {
+		if( sym != modem->demod_last ) {
+			//Stuffed symbol
+			modem->demod_last = sym;
+			modem->demod_run = 1;
+			return 0;
+		}
+		modem->demod_state = OOK_DEMOD_SEARCH;
+		modem->demod_last = sym;
+		modem->demod_run = run;
+		if( sym ) {
+			if( modem->verbose ) {
+				printf("      Frame lost\n");
+			}
+			modem->demod_pendlen = 0;
+			return 0;
+		}
+		if( modem->verbose ) {
+			printf("      End of frame\n");
+		}
+		return ook_demodulate_rll_end(modem);
+	}
+	modem->demod_last = sym;
+	modem->demod_run = run;
+	
+	//Hold back enough bits to strip the end marker and silence from
+	modem->demod_pend = (modem->demod_pend << 1) | sym;
+	modem->demod_pendllr[modem->demod_pendlen] = llr;
+	modem->demod_pendlen++;
+	if( modem->demod_pendlen >= 8+OOK_RLL_MAX_RUN+1 ) {
+		if( modem->verbose ) {
+			printf("    Byte: %02x\n",(modem->demod_pend >> (modem->demod_pendlen-8)) & 0xff);
+		}
+		if( bitstream_write_soft(&modem->demod_bits, 8, modem->demod_pend >> (modem->demod_pendlen-8), modem->demod_pendllr) ) {
+			if( modem->verbose ) {
+				printf("      Failed to grow data buffer\n");
+			}
+			return -1;
+		}
+		modem->demod_pendlen = modem->demod_pendlen - 8;
+		memmove(modem->demod_pendllr,modem->demod_pendllr+8,sizeof(double)*modem->demod_pendlen);
+	}
+	return 0;
+}
+
+static int ook_demodulate_rll_emit(ook_t *modem) {
+	double llr = 2.0*modem->demod_agree/modem->demod_seen - 1.0;
+	
+	modem->demod_agree = 0;
+	modem->demod_seen = 0;
+	return ook_demodulate_rll_symbol(modem,modem->demod_tone,llr);
+}
+
+static int ook_demodulate_rll_result(ook_t *modem, int tone_detected) {
+	//Recovers the symbol clock from the tone edges: every edge restarts
+	//the count to the middle of the symbol.  An edge has to hold for
+	//demod_debounce results, so single noisy results are ignored.  The 
+	//share of results since the last symbol that agree with the one sent 
+	//on is its confidence.
+	modem->demod_seen++;
+	if( tone_detected != modem->demod_tone ) {
+		if( ++modem->demod_flip >= modem->demod_debounce ) {
+			modem->demod_tone = tone_detected;
+			modem->demod_flip = 0;
+			modem->demod_agree = modem->demod_debounce;
+			modem->demod_seen = modem->demod_debounce;
+			modem->demod_clock = modem->demod_oversample/2 - (modem->demod_debounce-1);
+			if( !modem->demod_clock ) {
+				modem->demod_clock = modem->demod_oversample;
+				return ook_demodulate_rll_emit(modem);
+			}
+			return 0;
+		}
+	}
+	else {
+		modem->demod_flip = 0;
+		modem->demod_agree++;
+	}
+	if( modem->demod_clock ) {
+		modem->demod_clock--;
+	}
+	if( modem->demod_clock ) {
+		return 0;
+	}
+	modem->demod_clock = modem->demod_oversample;
+	return ook_demodulate_rll_emit(modem);
+}
+
+static int ook_demodulate_result(ook_t *modem, int tone_detected) {
+	//Advance the demodulator by one tone measurement
 	size_t   j;
 	size_t   start;
 	size_t   end;
@@ -335,188 +765,280 @@ int ook_demodulate(ook_t *modem, uint8_t **data, size_t *datalen, double *sample
 	size_t   bitcount;
 	size_t   bitslen;
 	uint8_t  bits[10];
+	double   bitsllr[10];
+	double   llr[8];
+	double   runlen;
 	uint8_t  databyte;
-	int tone_detected;
-	uint8_t *tmpdata;
-	srcfft_status_t result;
-	
-	
-	if( !modem ) { return -1; }
-	if( !data ) { return -1; }
-	if( !datalen ) { return -1; }
-	if( !samples ) { return -1; }
 	
-	if( modem->verbose ) {
-		printf("ook_demodulate(...)\n");
+	if( modem->rll ) {
+		return ook_demodulate_rll_result(modem,tone_detected);
 	}
 	
-	modem->demod_datalen = 0;
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
-	
-	
-	ii = 0;
-	while( ii < sampleslen ) {
-		result = srcfft_process(modem->srcfft,samples+ii,sampleslen-ii);
-		ii = ii + modem->srcfft->used_samples;
-		if( result == SRCFFT_ERROR ) { 
+	if( modem->demod_state == OOK_DEMOD_SEARCH ) {
+		if( tone_detected ) {
+			//First sample (idle)
+			modem->demod_state = OOK_DEMOD_IDLE_ACQUIRE;
+		}
+	}
+	else if( modem->demod_state == OOK_DEMOD_IDLE_ACQUIRE ) {
+		if( tone_detected ) {
+			modem->demod_state = OOK_DEMOD_IDLE_DETECTED;
 			if( modem->verbose ) {
-				printf("  FFT failed\n");
-				return -1; 
+				printf("      Sync detected\n");
 			}
 		}
-		else if( result == SRCFFT_NEED_MORE ) {
-			continue;
+		else {
+			//False Sync
+			modem->demod_state = OOK_DEMOD_SEARCH;
 		}
-		if( modem->verbose ) {
-			srcfft_printresult(modem->srcfft);
-		}
-		
-		//Check for signal
-		tone_detected = modem->srcfft->detectlen;
-		
-		if( modem->demod_state == OOK_DEMOD_SEARCH ) {
-			if( tone_detected ) {
-				//First sample (idle)
-				modem->demod_state = OOK_DEMOD_IDLE_ACQUIRE;
-			}
+	}
+	else if( modem->demod_state == OOK_DEMOD_IDLE_DETECTED ) {
+		if( !tone_detected ) {
+			//First sample (start)
+			modem->demod_state = OOK_DEMOD_START_ACQUIRE;
 		}
-		else if( modem->demod_state == OOK_DEMOD_IDLE_ACQUIRE ) {
-			if( tone_detected ) {
-				modem->demod_state = OOK_DEMOD_IDLE_DETECTED;
-				if( modem->verbose ) {
-					printf("      Sync detected\n");
-				}
-			}
-			else {
-				//False Sync
-				modem->demod_state = OOK_DEMOD_SEARCH;
+	}
+	else if( modem->demod_state == OOK_DEMOD_START_ACQUIRE ) {
+		if( tone_detected ) {
+			//False Start
+			modem->demod_state = OOK_DEMOD_SEARCH;
+			if( modem->verbose ) {
+				printf("      False Sync\n");
 			}
 		}
-		else if( modem->demod_state == OOK_DEMOD_IDLE_DETECTED ) {
-			if( !tone_detected ) {
-				//First sample (start)
-				modem->demod_state = OOK_DEMOD_START_ACQUIRE;
+		else {
+			if( modem->verbose ) {
+				printf("      Start Byte detected\n");
 			}
+			modem->demod_capture[0] = tone_detected;
+			modem->demod_capture[1] = tone_detected;
+			modem->demod_capture_len = 2;
+			modem->demod_state = OOK_DEMOD_CAPTURE;
 		}
-		else if( modem->demod_state == OOK_DEMOD_START_ACQUIRE ) {
-			if( tone_detected ) {
-				//False Start
-				modem->demod_state = OOK_DEMOD_SEARCH;
-				if( modem->verbose ) {
-					printf("      False Sync\n");
-				}
-			}
-			else {
-				if( modem->verbose ) {
-					printf("      Start Byte detected\n");
+	}
+	else if( modem->demod_state == OOK_DEMOD_CAPTURE ) {
+		//The byte is finished half way into the stop bit, so that a 
+		//transmission ending right after it still gives its last byte
+		modem->demod_capture[modem->demod_capture_len++] = tone_detected;
+		if( modem->demod_capture_len == (modem->demod_oversample*19)/2 ) {
+			if( modem->verbose ) {
+				printf("  Byte Pattern:\n");
+				for( j=0; j<modem->demod_capture_len; j++ ) {
+					if( modem->demod_capture[j] ) {
+						printf("-");
+					}
+					else {
+						printf("_");
+					}
 				}
-				modem->demod_capture[0] = tone_detected;
-				modem->demod_capture[1] = tone_detected;
-				modem->demod_capture_len = 2;
-				modem->demod_state = OOK_DEMOD_CAPTURE;
+				printf("\n");
 			}
-		}
-		else if( modem->demod_state == OOK_DEMOD_CAPTURE ) {
-			modem->demod_capture[modem->demod_capture_len++] = tone_detected;
-			if( modem->demod_capture_len == modem->demod_capture_alloc ) {
-				if( modem->verbose ) {
-					printf("  Byte Pattern:\n");
-					for( j=0; j<modem->demod_capture_len; j++ ) {
-						if( modem->demod_capture[j] ) {
-							printf("-");
+			
+			//Reduce the 
+			bitslen =0;
+			start = 0;
+			end = 1;
+			while( bitslen < 10 && end<=modem->demod_capture_len ) {
+				if( end == modem->demod_capture_len || 
+				    modem->demod_capture[start] != modem->demod_capture[end] ) {
+					//How close the run is to a whole number of bits is 
+					//the confidence in each of them
+					runlen = (double)(end-start)/(double)modem->demod_oversample;
+					if( end == modem->demod_capture_len ) {
+						//The last run goes on to the end of the stop bit
+						runlen = runlen + 0.5;
+					}
+					symcount = round(runlen);
+					if( modem->verbose ) { printf("    Symcount: %zu\n",symcount); }
+					while( symcount ) {
+						if( bitslen == 10 ) {
+							if( modem->verbose ) { printf("    Too many Bits\n"); }
+							break;
+						}
+						bitsllr[bitslen] = 1.0 - 2.0*fabs(runlen-round(runlen));
+						if( modem->demod_capture[start] ) {
+							bits[bitslen++] = 0;
+							if( modem->verbose ) { printf("     Bit: 0\n"); }
 						}
 						else {
-							printf("_");
+							bits[bitslen++] = 1;
+							if( modem->verbose ) { printf("     Bit: 1\n"); }
 						}
+						symcount--;
 					}
-					printf("\n");
+					start = end;
 				}
-				
-				//Reduce the 
-				bitslen =0;
-				start = 0;
-				end = 1;
-				while( bitslen < 10 && end<=modem->demod_capture_len ) {
-					if( end == modem->demod_capture_len || 
-					    modem->demod_capture[start] != modem->demod_capture[end] ) {
-						symcount = round((double)(end-start)/(double)OOK_OVERSAMPLE);
-						if( modem->verbose ) { printf("    Symcount: %zu\n",symcount); }
-						while( symcount ) {
-							if( bitslen == 10 ) {
-								if( modem->verbose ) { printf("    Too many Bits\n"); }
-								break;
-							}
-							if( modem->demod_capture[start] ) {
-								bits[bitslen++] = 0;
-								if( modem->verbose ) { printf("     Bit: 0\n"); }
-							}
-							else {
-								bits[bitslen++] = 1;
-								if( modem->verbose ) { printf("     Bit: 1\n"); }
-							}
-							symcount--;
-						}
-						start = end;
+				end++;
+			}
+			
+			//Double check start bit
+			if( bits[0] != 1 ) {
+				if( modem->verbose ) { printf("    No Start Bit\n"); }
+			}
+			
+			if( bitslen >= 9 ) {
+				databyte = 0;
+				for( j=1; j<9; j++ ) {
+					databyte = (databyte) >> 1;
+					if( bits[j] ) {
+						databyte = databyte | 0x80;
 					}
-					end++;
+					llr[8-j] = bitsllr[j];
 				}
-				
-				//Double check start bit
-				if( bits[0] != 1 ) {
-					if( modem->verbose ) { printf("    No Start Bit\n"); }
+				//Push a demodulated byte
+				if( modem->verbose ) {
+					printf("    Byte: %02x\n",databyte);
 				}
-				
-				if( bitslen >= 9 ) {
-					databyte = 0;
-					for( j=1; j<9; j++ ) {
-						databyte = (databyte) >> 1;
-						if( bits[j] ) {
-							databyte = databyte | 0x80;
-						}
-					}
-					//Push a demodulated byte
+				if( bitstream_write_soft(&modem->demod_bits, 8, databyte, llr) ) {
 					if( modem->verbose ) {
-						printf("    Byte: %02x\n",databyte);
-					}
-					tmpdata = (uint8_t*)realloc(modem->demod_data,sizeof(uint8_t)*(modem->demod_datalen+1));
-					if( !tmpdata ) {
-						if( modem->verbose ) {
-							printf("      Failed to reallocate data buffer\n");
-						}
-						return -1;
+						printf("      Failed to grow data buffer\n");
 					}
-					modem->demod_data = tmpdata;
-					modem->demod_data[modem->demod_datalen] = databyte;
-					modem->demod_datalen++;
-				} else {
-					if( modem->verbose ) { printf("    Not enoughBits\n"); }
-				}
-				
-				//Check to see how much of a follow idle we detected
-				if( bitslen == 10 && bits[9] == 0 ) {
-					modem->demod_state = OOK_DEMOD_IDLE_DETECTED;
-				}
-				else if( modem->demod_capture[modem->demod_capture_len-1] == 0 ) {
-					modem->demod_state = OOK_DEMOD_IDLE_ACQUIRE;
-				}
-				else {
-					modem->demod_state = OOK_DEMOD_SEARCH;
+					return -1;
 				}
+			} else {
+				if( modem->verbose ) { printf("    Not enoughBits\n"); }
+			}
+			
+			//Check to see how much of a follow idle we detected
+			if( bitslen == 10 && bits[9] == 0 ) {
+				modem->demod_state = OOK_DEMOD_IDLE_DETECTED;
+			}
+			else if( modem->demod_capture[modem->demod_capture_len-1] == 0 ) {
+				modem->demod_state = OOK_DEMOD_IDLE_ACQUIRE;
+			}
+			else {
+				modem->demod_state = OOK_DEMOD_SEARCH;
 			}
 		}
 	}
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
+	return 0;
+}
+
+static int ook_demodulate_output(ook_t *modem, uint8_t **data, size_t *datalen) {
+	size_t   j;
+	
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
 	if( modem->verbose ) {
 		printf("  Data: ");
-		for( j=0; j<modem->demod_datalen; j++ ) {
-			printf("%02x ",modem->demod_data[j]);
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
 		}
 		printf("\n");
 	}
 	return 0;
 }
 
+static void ook_demodulate_rate(ook_t *modem, size_t oversample) {
+	//Sets how many tone measurements make up a bit.  The RLL edge has to
+	//hold for the same fraction of a bit at any rate.
+	if( modem->demod_oversample == oversample ) { return; }
+	modem->demod_oversample = oversample;
+	modem->demod_debounce = (oversample*OOK_RLL_DEBOUNCE + OOK_OVERSAMPLE/2)/OOK_OVERSAMPLE;
+	if( !modem->demod_debounce ) {
+		modem->demod_debounce = 1;
+	}
+	modem->demod_state = OOK_DEMOD_SEARCH;
+	modem->demod_capture_len = 0;
+	modem->demod_flip = 0;
+	modem->demod_clock = 0;
+	modem->demod_agree = 0;
+	modem->demod_seen = 0;
+}
+
+static int ook_demodulate_sample(ook_t *modem, double x) {
+	//Mix to baseband, low pass the I/Q, and hand the envelope of every
+	//sample to the state machine, so bit edges are timed to the sample
+	double *env = modem->demod_env;
+	double a = modem->demod_env_alpha;
+	double mag;
+	
+	env[0] = env[0] + a*( 2.0*x*cos(modem->demod_nco) - env[0]);
+	env[1] = env[1] + a*(-2.0*x*sin(modem->demod_nco) - env[1]);
+	env[2] = env[2] + a*(env[0] - env[2]);
+	env[3] = env[3] + a*(env[1] - env[3]);
+	modem->demod_nco = modem->demod_nco + 2*M_PI*modem->frequency/modem->samplerate;
+	if( modem->demod_nco > 2*M_PI ) {
+		modem->demod_nco = modem->demod_nco - 2*M_PI;
+	}
+	
+	mag = sqrt(env[2]*env[2] + env[3]*env[3]);
+	if( modem->verbose ) {
+		if( mag >= modem->demod_env_detect ) {
+			printf("env : [%05.3lf]\n",mag);
+		}
+		else {
+			printf("env :  %05.3lf \n",mag);
+		}
+	}
+	return ook_demodulate_result(modem,mag >= modem->demod_env_detect);
+}
+
+int ook_demodulate(ook_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t   ii;
+	
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+	
+	if( modem->verbose ) {
+		printf("ook_demodulate(...)\n");
+	}
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	ook_demodulate_rate(modem,modem->mod_samp_per_sym);
+	
+	for( ii=0; ii<sampleslen; ii++ ) {
+		if( ook_demodulate_sample(modem,samples[ii]) ) {
+			return -1;
+		}
+	}
+	return ook_demodulate_output(modem,data,datalen);
+}
+
+int ook_demodulate_fft(ook_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen) {
+	//Same state machine as ook_demodulate, but measures the tone in 
+	//spectra already produced by a front-end with the same resampling and
+	//FFT size as ook_frontend, rather than with the envelope detector
+	size_t   ii;
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !spectra && spectralen ) { return -1; }
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	if( !ook_frontend(modem) ) {
+		if( modem->verbose ) {
+			printf("  Failed to create srcfft\n");
+		}
+		return -1;
+	}
+	ook_demodulate_rate(modem,OOK_OVERSAMPLE);
+	
+	for( ii=0; ii<spectralen; ii++ ) {
+		if( srcfft_reduce(modem->srcfft,spectra+ii*srcfft_spectrum_len(modem->srcfft)) == SRCFFT_ERROR ) {
+			if( modem->verbose ) {
+				printf("  FFT failed\n");
+			}
+			return -1;
+		}
+		if( modem->verbose ) {
+			srcfft_printresult(modem->srcfft);
+		}
+		if( ook_demodulate_result(modem,modem->srcfft->detectlen != 0) ) {
+			return -1;
+		}
+	}
+	return ook_demodulate_output(modem,data,datalen);
+}
+
 
 #endif //OOK_IMPLEMENTATION
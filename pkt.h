@@ -2,19 +2,44 @@
 #define __PKT_H__
 
 #include "bitops.h"
+#include "conv.h"
+#include "rs.h"
+#include "crc.h"
 
 #define PKT_DEFAULT_VERBOSE     0
 #define PKT_DEFAULT_REDUNDANCY  1
+#define PKT_DEFAULT_FEC         PKT_FEC_NONE
+//The CRC is on the wire, so both ends must agree (older builds had none)
+#define PKT_DEFAULT_CRC         1
+#define PKT_DEFAULT_RS_K        223
+#define PKT_DEFAULT_RS_DEPTH    1
+#define PKT_RS_HEADER_NSYM      4
 #define PKT_DEFAULT_SYNC_0      0xC9
 #define PKT_DEFAULT_SYNC_1      0x3F
+//Tolerating sync bit errors finds more packets in noise but also more 
+//false syncs; the header CRC drops those, so turn it down without one
+#define PKT_DEFAULT_SYNC_TOLERANCE 1
 #define PKT_DEFAULT_MASK_0      0x5A
 #define PKT_DEFAULT_MASK_1      0xA5
 
+typedef enum {
+	PKT_FEC_NONE,
+	PKT_FEC_CONV_1_2,
+	PKT_FEC_CONV_2_3,
+	PKT_FEC_CONV_3_4,
+	PKT_FEC_RS,
+} pkt_fec_t;
+
 typedef struct {
 	uint8_t *data;
 	size_t   len;
 } pktdata_t;
 
+typedef struct {
+	uint8_t *data;
+	size_t   alloc;
+} pktslot_t;
+
 typedef struct {
 	int      verbose;
 	size_t   redundancy;
@@ -22,31 +47,60 @@ typedef struct {
 	size_t   synclen;
 	uint8_t *mask;
 	size_t   masklen;
+	pkt_fec_t fec;
+	int      crc;
+	conv_t  *conv;
+	size_t   rs_k;
+	size_t   rs_depth;
+	rs_t    *rs;
+	rs_t    *rs_header;
 	
 	uint8_t *tx_pkt;
 	size_t   tx_pktlen;
+	uint8_t *tx_coded;
+	size_t   tx_codedalloc;
+	uint8_t *tx_body;
+	size_t   tx_bodyalloc;
 	
 	int      rx_synced;
-	uint8_t *rx_sync;
-	size_t   rx_synclen;
+	size_t   sync_tolerance;
+	bitcorr_t rx_corr;
 	uint8_t *rx_buf;
+	int8_t  *rx_bufsoft;
 	size_t   rx_buflen;
 	size_t   rx_bitoff;
+	size_t   rx_codedlen;
+	int8_t  *rx_soft;
+	size_t   rx_softalloc;
+	uint8_t *rx_coded;
+	size_t   rx_codedalloc;
+	int8_t  *rx_hist;
+	int8_t  *rx_replay;
+	size_t   rx_histalloc;
 	
 	uint8_t    *rx_data;
 	size_t      rx_datalen;
 	pktdata_t  *rx_pkts;
 	size_t      rx_pktslen;
+	size_t      rx_pktsalloc;
+	pktslot_t  *rx_slots;
+	size_t      rx_slotslen;
+	size_t      rx_slotsused;
 } pkt_t;
 
 pkt_t *pkt_init();
 void   pkt_destroy(pkt_t *pkt);
 int    pkt_set_redundancy(pkt_t *pkt, size_t redundancy);
 int    pkt_set_sync(pkt_t *pkt, uint8_t *sync, size_t synclen);
+int    pkt_set_sync_tolerance(pkt_t *pkt, size_t tolerance);
 int    pkt_set_mask(pkt_t *pkt, uint8_t *mask, size_t masklen);
+int    pkt_set_fec(pkt_t *pkt, pkt_fec_t fec);
+int    pkt_set_rs(pkt_t *pkt, size_t k, size_t depth);
+int    pkt_set_crc(pkt_t *pkt, int crc);
 int    pkt_set_verbose(pkt_t *pkt, int verbose);
 int    pkt_tx(pkt_t *pkt, uint8_t **pktdata, size_t *pktdatalen, uint8_t *rawdata, size_t rawdatalen);
 int    pkt_rx(pkt_t *pkt, pktdata_t **rxpkts, size_t *rxpktslen, uint8_t *rawdata, size_t rawdatalen);
+int    pkt_rx_soft(pkt_t *pkt, pktdata_t **rxpkts, size_t *rxpktslen, uint8_t *rawdata, size_t rawdatalen, int8_t *soft, size_t softlen);
 
 #endif //__PKT_H__
 
@@ -62,6 +116,19 @@ pkt_t *pkt_init() {
 
 	pkt->verbose    = PKT_DEFAULT_VERBOSE;
 	pkt->redundancy = PKT_DEFAULT_REDUNDANCY;
+	pkt->fec        = PKT_DEFAULT_FEC;
+	pkt->crc        = PKT_DEFAULT_CRC;
+	pkt->rs_k       = PKT_DEFAULT_RS_K;
+	pkt->rs_depth   = PKT_DEFAULT_RS_DEPTH;
+	
+	pkt->conv = conv_init();
+	if( !pkt->conv ) { goto pkt_init_error; }
+	
+	pkt->rs = rs_init(RS_MAX_LEN-pkt->rs_k);
+	if( !pkt->rs ) { goto pkt_init_error; }
+	
+	pkt->rs_header = rs_init(PKT_RS_HEADER_NSYM);
+	if( !pkt->rs_header ) { goto pkt_init_error; }
 	
 	pkt->sync = (uint8_t*)malloc(sizeof(uint8_t)*2);
 	if( !pkt->sync ) { goto pkt_init_error; }
@@ -69,13 +136,13 @@ pkt_t *pkt_init() {
 	pkt->sync[1] = PKT_DEFAULT_SYNC_1;
 	pkt->synclen = 2;
 	
-	pkt->rx_sync = (uint8_t*)malloc(sizeof(uint8_t)*pkt->synclen);
-	if( !pkt->rx_sync ) { goto pkt_init_error; }
-	memset(pkt->rx_sync,0,2);
-	pkt->rx_synclen = pkt->synclen;
+	pkt->sync_tolerance = PKT_DEFAULT_SYNC_TOLERANCE;
+	if( bitcorr_set(&pkt->rx_corr,pkt->sync,pkt->synclen*8,pkt->sync_tolerance) ) { goto pkt_init_error; }
 	
 	pkt->rx_buf = (uint8_t*)malloc(sizeof(uint8_t)*pkt->redundancy);
 	if( ! pkt->rx_buf ) { goto pkt_init_error; };
+	pkt->rx_bufsoft = (int8_t*)malloc(sizeof(int8_t)*pkt->redundancy*8);
+	if( !pkt->rx_bufsoft ) { goto pkt_init_error; }
 	
 	pkt->mask = (uint8_t*)malloc(sizeof(uint8_t)*2);
 	if( !pkt->mask ) { goto pkt_init_error; }
@@ -94,18 +161,28 @@ void pkt_destroy(pkt_t *pkt) {
 	size_t i;
 	if( pkt ) {
 		if( pkt->sync ) { free(pkt->sync); }
-		if( pkt->rx_sync ) { free(pkt->rx_sync); }
 		if( pkt->rx_buf ) { free(pkt->rx_buf); }
+		if( pkt->rx_bufsoft ) { free(pkt->rx_bufsoft); }
 		if( pkt->mask ) { free(pkt->mask); }
 		if( pkt->tx_pkt ) { free(pkt->tx_pkt); }
-		if( pkt->rx_data ) { free(pkt->rx_data); }
-		if( pkt->rx_pkts ) {
-			for( i=0; i<pkt->rx_pktslen; i++ ) {
-				if( pkt->rx_pkts[i].data ) { 
-					free(pkt->rx_pkts[i].data-2);
+		if( pkt->tx_coded ) { free(pkt->tx_coded); }
+		if( pkt->tx_body ) { free(pkt->tx_body); }
+		if( pkt->conv ) { conv_destroy(pkt->conv); }
+		if( pkt->rs ) { rs_destroy(pkt->rs); }
+		if( pkt->rs_header ) { rs_destroy(pkt->rs_header); }
+		if( pkt->rx_coded ) { free(pkt->rx_coded); }
+		if( pkt->rx_hist ) { free(pkt->rx_hist); }
+		if( pkt->rx_replay ) { free(pkt->rx_replay); }
+		if( pkt->rx_soft ) { free(pkt->rx_soft); }
+		if( pkt->rx_slots ) {
+			for( i=0; i<pkt->rx_slotslen; i++ ) {
+				if( pkt->rx_slots[i].data ) { 
+					free(pkt->rx_slots[i].data);
 				}
 			}
+			free(pkt->rx_slots);
 		}
+		if( pkt->rx_pkts ) { free(pkt->rx_pkts); }
 		free(pkt);
 	}
 }
@@ -121,23 +198,34 @@ int pkt_set_redundancy(pkt_t *pkt, size_t redundancy) {
 	tmp = (uint8_t*)realloc(pkt->rx_buf,sizeof(uint8_t)*pkt->redundancy);
 	if( !tmp ) { return -1; }
 	pkt->rx_buf = tmp;
+	tmp = (uint8_t*)realloc(pkt->rx_bufsoft,sizeof(int8_t)*pkt->redundancy*8);
+	if( !tmp ) { return -1; }
+	pkt->rx_bufsoft = (int8_t*)tmp;
+	return 0;
 }
 
 int pkt_set_sync(pkt_t *pkt, uint8_t *sync, size_t synclen) {
 	uint8_t *tmp;
 	if( !pkt ) { return -1; }
+	if( !sync ) { return -1; }
+	//The sync is searched for with a 64-bit correlator
+	if( synclen == 0 || synclen > 8 ) { return -1; }
+	if( pkt->sync_tolerance >= synclen*8 ) { return -1; }
 	tmp = (uint8_t*)realloc(pkt->sync,sizeof(uint8_t)*synclen);
 	if( !tmp ) { return -1; }
 	pkt->sync = tmp;
 	pkt->synclen = synclen;
 	memcpy(pkt->sync,sync,synclen);
 	
-	tmp = (uint8_t*)realloc(pkt->rx_sync,sizeof(uint8_t)*synclen);
-	if( !tmp ) { return -1; }
-	pkt->rx_sync = tmp;
-	pkt->rx_synclen = synclen;
-	memset(pkt->rx_sync,0,synclen);
-	
+	if( bitcorr_set(&pkt->rx_corr,pkt->sync,pkt->synclen*8,pkt->sync_tolerance) ) { return -1; }
+	pkt->rx_synced = 0;
+	return 0;
+}
+
+int pkt_set_sync_tolerance(pkt_t *pkt, size_t tolerance) {
+	if( !pkt ) { return -1; }
+	if( bitcorr_set(&pkt->rx_corr,pkt->sync,pkt->synclen*8,tolerance) ) { return -1; }
+	pkt->sync_tolerance = tolerance;
 	pkt->rx_synced = 0;
 	return 0;
 }
@@ -153,19 +241,201 @@ int pkt_set_mask(pkt_t *pkt, uint8_t *mask, size_t masklen) {
 	return 0;
 }
 
+int pkt_set_fec(pkt_t *pkt, pkt_fec_t fec) {
+	if( !pkt ) { return -1; }
+	if( fec != PKT_FEC_NONE && 
+	    fec != PKT_FEC_CONV_1_2 && 
+	    fec != PKT_FEC_CONV_2_3 && 
+	    fec != PKT_FEC_CONV_3_4 &&
+	    fec != PKT_FEC_RS ) {
+		return -1;
+	}
+	pkt->fec = fec;
+	pkt->rx_synced = 0;
+	return 0;
+}
+
+int pkt_set_rs(pkt_t *pkt, size_t k, size_t depth) {
+	rs_t *tmp;
+	if( !pkt ) { return -1; }
+	if( k == 0 || k > RS_MAX_LEN-2 ) { return -1; }
+	if( depth == 0 ) { depth = 1; }
+	tmp = rs_init(RS_MAX_LEN-k);
+	if( !tmp ) { return -1; }
+	rs_destroy(pkt->rs);
+	pkt->rs = tmp;
+	pkt->rs_k = k;
+	pkt->rs_depth = depth;
+	pkt->rx_synced = 0;
+	return 0;
+}
+
+int pkt_set_crc(pkt_t *pkt, int crc) {
+	if( !pkt ) { return -1; }
+	pkt->crc = crc ? 1 : 0;
+	pkt->rx_synced = 0;
+	return 0;
+}
+
+static conv_rate_t pkt_conv_rate(pkt_fec_t fec) {
+	if( fec == PKT_FEC_CONV_2_3 ) { return CONV_RATE_2_3; }
+	if( fec == PKT_FEC_CONV_3_4 ) { return CONV_RATE_3_4; }
+	return CONV_RATE_1_2;
+}
+
+static size_t pkt_header_bytes(pkt_t *pkt) {
+	//The length, followed by its CRC-8
+	return pkt->crc ? 3 : 2;
+}
+
+static size_t pkt_crc_len(pkt_t *pkt) {
+	//The CRC-32 that follows the payload
+	return pkt->crc ? 4 : 0;
+}
+
+static size_t pkt_header_bits(pkt_t *pkt) {
+	//The length is sent on its own, always at the strongest rate, 
+	//so that it can be decoded before the payload size is known
+	if( pkt->fec == PKT_FEC_NONE ) {
+		return pkt_header_bytes(pkt)*8;
+	}
+	if( pkt->fec == PKT_FEC_RS ) {
+		return (pkt_header_bytes(pkt)+PKT_RS_HEADER_NSYM)*8;
+	}
+	return conv_coded_bits(CONV_RATE_1_2,pkt_header_bytes(pkt)*8);
+}
+
+static size_t pkt_rs_blocks(pkt_t *pkt, size_t datalen) {
+	//The payload is split into the fewest codewords that will hold it,
+	//but at least rs_depth of them (each holding a byte or more), with 
+	//the data spread evenly across them.  The codewords are interleaved 
+	//byte by byte, so rs_depth sets the burst length that every packet 
+	//survives, at the cost of rs_depth sets of parity on short packets.
+	size_t nblocks;
+	nblocks = (datalen+pkt->rs_k-1)/pkt->rs_k;
+	if( nblocks < pkt->rs_depth ) { nblocks = pkt->rs_depth; }
+	if( nblocks > datalen ) { nblocks = datalen; }
+	return nblocks;
+}
+
+static size_t pkt_rs_block_len(pkt_t *pkt, size_t datalen, size_t block) {
+	size_t nblocks = pkt_rs_blocks(pkt,datalen);
+	return datalen/nblocks + (block < datalen%nblocks ? 1 : 0);
+}
+
+static size_t pkt_payload_bits(pkt_t *pkt, size_t datalen) {
+	//Number of bits sent after the length for a payload of datalen bytes
+	if( pkt->fec == PKT_FEC_NONE ) {
+		return datalen*8;
+	}
+	if( pkt->fec == PKT_FEC_RS ) {
+		return (datalen+pkt_rs_blocks(pkt,datalen)*pkt->rs->nsym)*8;
+	}
+	return conv_coded_bits(pkt_conv_rate(pkt->fec),datalen*8);
+}
+
+static void pkt_hard_bits(pkt_t *pkt, uint8_t *data, size_t datalen) {
+	//Reduce the soft bits back to bytes for the block decoder
+	bitstream_t bits;
+	size_t i;
+	bitstream_init(&bits,data,datalen);
+	for( i=0; i<datalen*8; i++ ) {
+		bitstream_write(&bits,1,pkt->rx_soft[i] > 0);
+	}
+	bitstream_flush(&bits);
+}
+
+static int pkt_rs_decode(pkt_t *pkt) {
+	//Deinterleave and correct the payload held in rx_soft into rx_data.
+	//Returns -1 if any of the codewords could not be corrected.
+	size_t codedlen;
+	size_t datalen;
+	size_t block;
+	size_t blocklen;
+	size_t src;
+	size_t dst;
+	uint8_t *tmp;
+	int result;
+	
+	codedlen = pkt->rx_codedlen/8;
+	datalen = pkt->rx_datalen-2;
+	if( codedlen == 0 ) { return 0; }
+	if( pkt->rx_codedalloc < codedlen*2 ) {
+		tmp = (uint8_t*)realloc(pkt->rx_coded,codedlen*2);
+		if( !tmp ) { return -1; }
+		pkt->rx_coded = tmp;
+		pkt->rx_codedalloc = codedlen*2;
+	}
+	pkt_hard_bits(pkt,pkt->rx_coded+codedlen,codedlen);
+	rs_deinterleave(pkt->rx_coded,pkt->rx_coded+codedlen,codedlen,pkt_rs_blocks(pkt,datalen));
+	
+	src = 0;
+	dst = 0;
+	for( block=0; block<pkt_rs_blocks(pkt,datalen); block++ ) {
+		blocklen = pkt_rs_block_len(pkt,datalen,block);
+		result = rs_decode(pkt->rs,pkt->rx_coded+src,blocklen+pkt->rs->nsym);
+		if( pkt->verbose ) {
+			printf("  RS Block %zu: %d corrected\n",block,result);
+		}
+		if( result < 0 ) { return -1; }
+		memcpy(pkt->rx_data+2+dst,pkt->rx_coded+src,blocklen);
+		src = src + blocklen + pkt->rs->nsym;
+		dst = dst + blocklen;
+	}
+	return 0;
+}
+
 int pkt_set_verbose(pkt_t *pkt, int verbose) {
 	if( !pkt ) { return -1; }
 	pkt->verbose = verbose;
 	return 0;
 }
 
+static void pkt_tx_pack(pkt_t *pkt, bitstream_t *out, uint8_t *data, size_t datalen, size_t bits) {
+	//Append the first bits of data with every bit repeated redundancy times
+	bitstream_t in;
+	size_t n;
+	size_t j;
+	int bit;
+	
+	bitstream_init(&in,data,datalen);
+	if( pkt->redundancy == 1 ) {
+		while( bits ) {
+			n = bits < 32 ? bits : 32;
+			bitstream_write(out,n,bitstream_read(&in,n));
+			bits = bits - n;
+		}
+		return;
+	}
+	while( bits-- ) {
+		bit = bitstream_read(&in,1);
+		for( j=pkt->redundancy; j; j=j-n ) {
+			n = j < 32 ? j : 32;
+			bitstream_write(out,n,bit ? -1 : 0);
+		}
+	}
+}
+
 int pkt_tx(pkt_t *pkt, uint8_t **pktdata, size_t *pktdatalen, uint8_t *rawdata, size_t rawdatalen) {
 	uint8_t *tmp;
 	size_t i,j;
 	size_t dst;
-	int bit;
-	uint8_t pktlen16[2];
+	bitstream_t out;
+	uint8_t pktlen16[3];
+	uint8_t header[8];
+	size_t header_bits;
 	size_t pktalloc;
+	size_t payload_bits;
+	size_t pad_bits;
+	uint8_t pad = 0;
+	uint8_t *payload;
+	size_t payloadlen;
+	uint8_t *body;
+	size_t bodylen;
+	uint32_t crc;
+	size_t block;
+	size_t blocklen;
+	size_t src;
 	
 	if( !pkt ) { return -1; }
 	if( !pktdata ) { return -1; }
@@ -182,37 +452,105 @@ int pkt_tx(pkt_t *pkt, uint8_t **pktdata, size_t *pktdatalen, uint8_t *rawdata,
 		printf("\n");
 	}
 	
-	pktalloc = (pkt->synclen+2+rawdatalen)*pkt->redundancy;
-	tmp = realloc(pkt->tx_pkt,pktalloc);
-	if( !tmp ) { return -1; }
-	pkt->tx_pkt = tmp;
-	pkt->tx_pktlen = pktalloc;
-	memset(pkt->tx_pkt,0,pktalloc);
+	//Append the CRC-32 to the payload (if requested)
+	body = rawdata;
+	bodylen = rawdatalen;
+	if( pkt->crc ) {
+		bodylen = rawdatalen+pkt_crc_len(pkt);
+		if( pkt->tx_bodyalloc < bodylen ) {
+			tmp = realloc(pkt->tx_body,bodylen);
+			if( !tmp ) { return -1; }
+			pkt->tx_body = tmp;
+			pkt->tx_bodyalloc = bodylen;
+		}
+		memcpy(pkt->tx_body,rawdata,rawdatalen);
+		crc = crc_32(rawdata,rawdatalen);
+		pkt->tx_body[rawdatalen+0] = (crc>>24)&0xff;
+		pkt->tx_body[rawdatalen+1] = (crc>>16)&0xff;
+		pkt->tx_body[rawdatalen+2] = (crc>>8)&0xff;
+		pkt->tx_body[rawdatalen+3] = (crc>>0)&0xff;
+		body = pkt->tx_body;
+	}
 	
-	//Pack the redundant bits of the sync
-	dst = 0;
-	for( i=0; i<pkt->synclen*8; i++ ) {
-		bit = getbits(pkt->sync, pkt->synclen, i, 1);
-		for( j=0; j<pkt->redundancy; j++ ) {
-			putbits(pkt->tx_pkt, pkt->tx_pktlen, dst++, 1, bit);
+	//Encode the payload (if requested)
+	payload_bits = pkt_payload_bits(pkt,bodylen);
+	if( pkt->fec == PKT_FEC_NONE ) {
+		payload = body;
+		payloadlen = bodylen;
+	}
+	else if( pkt->fec == PKT_FEC_RS ) {
+		//Codewords are built in the first half of tx_coded and 
+		//interleaved into the second half
+		payloadlen = payload_bits/8;
+		if( pkt->tx_codedalloc < payloadlen*2 ) {
+			tmp = realloc(pkt->tx_coded,payloadlen*2);
+			if( !tmp ) { return -1; }
+			pkt->tx_coded = tmp;
+			pkt->tx_codedalloc = payloadlen*2;
 		}
+		src = 0;
+		dst = 0;
+		for( block=0; block<pkt_rs_blocks(pkt,bodylen); block++ ) {
+			blocklen = pkt_rs_block_len(pkt,bodylen,block);
+			memcpy(pkt->tx_coded+dst,body+src,blocklen);
+			if( rs_encode(pkt->rs,pkt->tx_coded+dst+blocklen,body+src,blocklen) ) {
+				return -1;
+			}
+			src = src + blocklen;
+			dst = dst + blocklen + pkt->rs->nsym;
+		}
+		rs_interleave(pkt->tx_coded+payloadlen,pkt->tx_coded,payloadlen,pkt_rs_blocks(pkt,bodylen));
+		payload = pkt->tx_coded+payloadlen;
+	}
+	else {
+		payloadlen = (payload_bits+7)/8;
+		if( pkt->tx_codedalloc < payloadlen ) {
+			tmp = realloc(pkt->tx_coded,payloadlen);
+			if( !tmp ) { return -1; }
+			pkt->tx_coded = tmp;
+			pkt->tx_codedalloc = payloadlen;
+		}
+		if( conv_encode(pkt_conv_rate(pkt->fec),pkt->tx_coded,payloadlen,body,bodylen) ) {
+			return -1;
+		}
+		payload = pkt->tx_coded;
 	}
+	
 	pktlen16[0] = (rawdatalen>>8)&0xff;
 	pktlen16[1] = (rawdatalen>>0)&0xff;
-	//Pack the redundant bits of packet length
-	for( i=0; i<16; i++ ) {
-		bit = getbits(pktlen16,2,i,1);
-		for( j=0; j<pkt->redundancy; j++ ) {
-			putbits(pkt->tx_pkt, pkt->tx_pktlen, dst++, 1, bit);
-		}
+	pktlen16[2] = crc_8(pktlen16,2);
+	header_bits = pkt_header_bits(pkt);
+	if( pkt->fec == PKT_FEC_NONE ) {
+		memcpy(header,pktlen16,pkt_header_bytes(pkt));
 	}
-	//Pack the redundant bits of the data
-	for( i=0; i<rawdatalen*8; i++ ) {
-		bit = getbits(rawdata, rawdatalen, i, 1);
-		for( j=0; j<pkt->redundancy; j++ ) {
-			putbits(pkt->tx_pkt, pkt->tx_pktlen, dst++, 1, bit);
+	else if( pkt->fec == PKT_FEC_RS ) {
+		memcpy(header,pktlen16,pkt_header_bytes(pkt));
+		if( rs_encode(pkt->rs_header,header+pkt_header_bytes(pkt),pktlen16,pkt_header_bytes(pkt)) ) {
+			return -1;
 		}
 	}
+	else if( conv_encode(CONV_RATE_1_2,header,sizeof(header),pktlen16,pkt_header_bytes(pkt)) ) {
+		return -1;
+	}
+	
+	//Punctured codes leave the frame short of a whole byte.  Pad it out
+	//before the copies are made, so that the frame takes a whole number 
+	//of redundancy byte groups and the next packet's copies still line 
+	//up with the receiver's groups.
+	pad_bits = (8-(pkt->synclen*8+header_bits+payload_bits)%8)%8;
+	pktalloc = (pkt->synclen*8+header_bits+payload_bits+pad_bits)*pkt->redundancy/8;
+	tmp = realloc(pkt->tx_pkt,pktalloc);
+	if( !tmp ) { return -1; }
+	pkt->tx_pkt = tmp;
+	pkt->tx_pktlen = pktalloc;
+	
+	//Pack the redundant bits of the sync, packet length and data
+	bitstream_init(&out,pkt->tx_pkt,pkt->tx_pktlen);
+	pkt_tx_pack(pkt,&out,pkt->sync,pkt->synclen,pkt->synclen*8);
+	pkt_tx_pack(pkt,&out,header,sizeof(header),header_bits);
+	pkt_tx_pack(pkt,&out,payload,payloadlen,payload_bits);
+	pkt_tx_pack(pkt,&out,&pad,1,pad_bits);
+	bitstream_flush(&out);
 	//Apply the mask (after the sync)
 	for( i=pkt->synclen*pkt->redundancy, j=0; i<pkt->tx_pktlen; i++, j++ ) {
 		pkt->tx_pkt[i] = pkt->tx_pkt[i] ^ pkt->mask[j%pkt->masklen];
@@ -232,20 +570,277 @@ int pkt_tx(pkt_t *pkt, uint8_t **pktdata, size_t *pktdatalen, uint8_t *rawdata,
 	return 0;
 }
 
-int pkt_rx(pkt_t *pkt, pktdata_t **rx, size_t *rxlen, uint8_t *rawdata, size_t rawdatalen) {
-	size_t bitoff;
-	size_t rawoff;
+static int pkt_rx_bit(pkt_t *pkt, uint8_t *buf, size_t buflen, int8_t *soft, size_t bitoff);
+
+static int pkt_rx_resync(pkt_t *pkt) {
+	//The header did not check out, so the sync was false.  Replay the 
+	//bits that were taken for the header through the sync search, so 
+	//that a real packet starting inside them is not lost.  The replay 
+	//is shorter than a header, so a sync found within it can not reach
+	//another resync before the replay is finished.
+	size_t replaybits;
+	size_t off;
+	
+	if( pkt->verbose ) {
+		printf("  Bad Header\n");
+	}
+	replaybits = pkt_header_bits(pkt)*pkt->redundancy;
+	memcpy(pkt->rx_replay,pkt->rx_hist,replaybits);
+	
+	pkt->rx_synced = 0;
+	pkt->rx_corr.reg = pkt->rx_corr.pattern;
+	pkt->rx_corr.filled = pkt->rx_corr.bits;
+	for( off=0; off<replaybits; off=off+pkt->redundancy ) {
+		if( pkt_rx_bit(pkt,0,0,pkt->rx_replay,off) ) { return -1; }
+	}
+	return 0;
+}
+
+static int pkt_rx_reserve(pkt_t *pkt, size_t len) {
+	//Size the slot of the packet being received (always the first unused
+	//slot) to len bytes, keeping its contents.  Slots are recycled by the
+	//next pkt_rx call and never shrink, so a steady stream of packets
+	//stops allocating once the pool has warmed up.
+	pktslot_t *slot;
+	void *tmp;
+	
+	if( pkt->rx_slotsused == pkt->rx_slotslen ) {
+		tmp = realloc(pkt->rx_slots,sizeof(pktslot_t)*(pkt->rx_slotslen+1));
+		if( !tmp ) { return -1; }
+		pkt->rx_slots = (pktslot_t*)tmp;
+		pkt->rx_slots[pkt->rx_slotslen].data = 0;
+		pkt->rx_slots[pkt->rx_slotslen].alloc = 0;
+		pkt->rx_slotslen++;
+	}
+	slot = &pkt->rx_slots[pkt->rx_slotsused];
+	if( slot->alloc < len ) {
+		tmp = realloc(slot->data,len);
+		if( !tmp ) { return -1; }
+		slot->data = (uint8_t*)tmp;
+		slot->alloc = len;
+	}
+	pkt->rx_data = slot->data;
+	pkt->rx_datalen = len;
+	return 0;
+}
+
+static int pkt_rx_found_sync(pkt_t *pkt) {
+	//Start receiving a packet right after the sync
+	uint8_t *tmp;
+	size_t header_bits;
+	size_t header_bytes;
+	
+	header_bits = pkt_header_bits(pkt);
+	header_bytes = pkt_header_bytes(pkt);
+	if( pkt->verbose ) {
+		printf("  Found Sync (%d bit errors)\n",
+		       bitcount64((pkt->rx_corr.reg ^ pkt->rx_corr.pattern) & pkt->rx_corr.mask));
+	}
+	pkt->rx_synced = 1;
+	pkt->rx_bitoff = 0;
+	bitcorr_reset(&pkt->rx_corr);
+	if( pkt_rx_reserve(pkt,header_bytes) ) { return -1; }
+	memset(pkt->rx_data,0,header_bytes);
+	if( pkt->rx_softalloc < header_bits ) {
+		tmp = (uint8_t*)realloc(pkt->rx_soft,header_bits);
+		if( !tmp ) { return -1; }
+		pkt->rx_soft = (int8_t*)tmp;
+		pkt->rx_softalloc = header_bits;
+	}
+	if( pkt->rx_histalloc < header_bits*pkt->redundancy ) {
+		//The replay buffer is the same size, so that a false sync 
+		//never has to allocate
+		tmp = (uint8_t*)realloc(pkt->rx_hist,header_bits*pkt->redundancy);
+		if( !tmp ) { return -1; }
+		pkt->rx_hist = (int8_t*)tmp;
+		tmp = (uint8_t*)realloc(pkt->rx_replay,header_bits*pkt->redundancy);
+		if( !tmp ) { return -1; }
+		pkt->rx_replay = (int8_t*)tmp;
+		pkt->rx_histalloc = header_bits*pkt->redundancy;
+	}
+	memset(pkt->rx_hist,0,pkt->rx_histalloc);
+	return 0;
+}
+
+static int pkt_rx_bit(pkt_t *pkt, uint8_t *buf, size_t buflen, int8_t *soft, size_t bitoff) {
+	//Vote the redundant copies of a single bit starting at bitoff
+	//and run it through the sync search or the packet being received.
+	//With soft (one confidence per bit of buf) the copies are summed by
+	//their confidence, so that strong copies outweigh faint ones; 
+	//otherwise each copy is a full vote.
 	size_t i;
 	int bit;
-	int bit_votes;
+	int conf;
+	int sum;
 	int mask;
 	uint8_t *tmp;
 	uint16_t pktlen16;
+	size_t header_bits;
+	size_t header_bytes;
+	uint8_t header[3+PKT_RS_HEADER_NSYM];
+	uint32_t crc;
+	size_t len;
+	
+	header_bits = pkt_header_bits(pkt);
+	header_bytes = pkt_header_bytes(pkt);
+	
+	//Pull redundant bits and vote
+	sum = 0;
+	for( i=0; i<pkt->redundancy; i++ ) {
+		if( soft ) {
+			conf = soft[bitoff+i];
+		}
+		else {
+			conf = getbits(buf, buflen, bitoff+i, 1) ? BITSTREAM_SOFT_MAX : -BITSTREAM_SOFT_MAX;
+		}
+		if( pkt->rx_synced ) {
+			//Keep the raw header bits in case the sync turns out to be false
+			if( pkt->rx_bitoff < header_bits ) {
+				pkt->rx_hist[pkt->rx_bitoff*pkt->redundancy+i] = (int8_t)conf;
+			}
+			//Apply the mask for all bits after the sync
+			mask = getbits(pkt->mask,pkt->masklen,(pkt->rx_bitoff*pkt->redundancy+i)%(pkt->masklen*8),1);
+			if( mask ) {
+				conf = -conf;
+			}
+		}
+		sum = sum + conf;
+	}
+	//Reduce the votes down to a singel bit
+	bit = sum > 0;
+	
+	if( !pkt->rx_synced ) {
+		//Try to find the sync
+		if( bitcorr_push(&pkt->rx_corr,bit) ) {
+			return pkt_rx_found_sync(pkt);
+		}
+		if( pkt->verbose ) {
+			printf("  Testing Sync: ");
+			for( i=0; i<pkt->synclen; i++ ) {
+				printf("%02x ",(unsigned int)(pkt->rx_corr.reg >> ((pkt->synclen-1-i)*8)) & 0xff);
+			}
+			printf("\n");
+		}
+		return 0;
+	}
+	
+	if( pkt->fec != PKT_FEC_NONE ) {
+		//Keep the vote margin as a soft bit for the decoder
+		pkt->rx_soft[pkt->rx_bitoff < header_bits ? pkt->rx_bitoff : pkt->rx_bitoff-header_bits] = 
+			(int8_t)(sum/(int)pkt->redundancy);
+	}
+	else {
+		//Put the bit in the rx_pkt buffer (the payload goes after the length)
+		putbits(pkt->rx_data,pkt->rx_datalen,
+		        pkt->rx_bitoff < header_bits ? pkt->rx_bitoff : pkt->rx_bitoff-header_bits+16,1,bit);
+	}
+	pkt->rx_bitoff++;
+	
+	if( pkt->rx_bitoff == header_bits ) {
+		if( pkt->fec == PKT_FEC_RS ) {
+			pkt_hard_bits(pkt,header,header_bytes+PKT_RS_HEADER_NSYM);
+			if( rs_decode(pkt->rs_header,header,header_bytes+PKT_RS_HEADER_NSYM) < 0 ) {
+				return pkt_rx_resync(pkt);
+			}
+			memcpy(pkt->rx_data,header,header_bytes);
+		}
+		else if( pkt->fec != PKT_FEC_NONE ) {
+			if( conv_decode(pkt->conv,CONV_RATE_1_2,pkt->rx_data,header_bytes,pkt->rx_soft,header_bits) ) {
+				return -1;
+			}
+		}
+		//Reject a corrupt length right away instead of waiting on it
+		if( pkt->crc && crc_8(pkt->rx_data,2) != pkt->rx_data[2] ) {
+			return pkt_rx_resync(pkt);
+		}
+		//Read the packet size and realloc the buffer
+		pktlen16 = (pkt->rx_data[0]<<8) | (pkt->rx_data[1]);
+		if( pkt->verbose ) {
+			printf("  Packet Length: %u\n",pktlen16);
+		}
+		if( pkt_rx_reserve(pkt,2+pktlen16+pkt_crc_len(pkt)) ) { return -1; }
+		memset(pkt->rx_data+2,0,pktlen16+pkt_crc_len(pkt));
+		
+		pkt->rx_codedlen = pkt_payload_bits(pkt,pktlen16+pkt_crc_len(pkt));
+		if( pkt->fec != PKT_FEC_NONE && pkt->rx_softalloc < pkt->rx_codedlen ) {
+			tmp = (uint8_t*)realloc(pkt->rx_soft,pkt->rx_codedlen);
+			if( !tmp ) { return -1; }
+			pkt->rx_soft = (int8_t*)tmp;
+			pkt->rx_softalloc = pkt->rx_codedlen;
+		}
+	}
+	if( pkt->rx_bitoff >= header_bits && pkt->rx_bitoff-header_bits >= pkt->rx_codedlen ) {
+		//We've finish reading the complete packet
+		pkt->rx_synced = 0;
+		if( pkt->fec == PKT_FEC_RS ) {
+			if( pkt_rs_decode(pkt) ) {
+				//Uncorrectable, so drop it rather than pass up bad data
+				if( pkt->verbose ) {
+					printf("  Dropped Packet\n");
+				}
+				return 0;
+			}
+		}
+		else if( pkt->fec != PKT_FEC_NONE ) {
+			if( conv_decode(pkt->conv,pkt_conv_rate(pkt->fec),
+			                pkt->rx_data+2,pkt->rx_datalen-2,
+			                pkt->rx_soft,pkt->rx_codedlen) ) {
+				return -1;
+			}
+		}
+		len = pkt->rx_datalen-2-pkt_crc_len(pkt);
+		if( pkt->crc ) {
+			crc = ((uint32_t)pkt->rx_data[2+len]<<24) | ((uint32_t)pkt->rx_data[2+len+1]<<16) | 
+			      ((uint32_t)pkt->rx_data[2+len+2]<<8) | ((uint32_t)pkt->rx_data[2+len+3]);
+			if( crc != crc_32(pkt->rx_data+2,len) ) {
+				if( pkt->verbose ) {
+					printf("  Bad CRC, Dropped Packet\n");
+				}
+				return 0;
+			}
+		}
+		//Append it to the result set, handing over its slot
+		if( pkt->rx_pktslen == pkt->rx_pktsalloc ) {
+			tmp = (uint8_t*)realloc(pkt->rx_pkts,sizeof(pktdata_t)*(pkt->rx_pktsalloc*2+1));
+			if( !tmp ) { return -1; }
+			pkt->rx_pkts = (pktdata_t*)tmp;
+			pkt->rx_pktsalloc = pkt->rx_pktsalloc*2+1;
+		}
+		pkt->rx_pktslen++;
+		pkt->rx_pkts[pkt->rx_pktslen-1].data = pkt->rx_data+2;
+		pkt->rx_pkts[pkt->rx_pktslen-1].len  = len;
+		pkt->rx_slotsused++;
+		pkt->rx_data = 0;
+		pkt->rx_datalen = 0;
+		if( pkt->verbose ) {
+			printf("  Pkt[%zu]: ",pkt->rx_pkts[pkt->rx_pktslen-1].len);
+			for( i=0; i<pkt->rx_pkts[pkt->rx_pktslen-1].len ; i++ ) {
+				printf("%02x ",pkt->rx_pkts[pkt->rx_pktslen-1].data[i]);
+			}
+			printf("\n");
+		}
+	}
+	return 0;
+}
+
+int pkt_rx(pkt_t *pkt, pktdata_t **rx, size_t *rxlen, uint8_t *rawdata, size_t rawdatalen) {
+	return pkt_rx_soft(pkt,rx,rxlen,rawdata,rawdatalen,0,0);
+}
+
+int pkt_rx_soft(pkt_t *pkt, pktdata_t **rx, size_t *rxlen, uint8_t *rawdata, size_t rawdatalen, int8_t *soft, size_t softlen) {
+	//Same as pkt_rx, with a confidence for every bit of rawdata (as from 
+	//XXX_soft, positive for a one) that the redundant copies are summed 
+	//with and that the convolutional decoder sees, or none (soft of 0).
+	size_t bitoff;
+	size_t rawoff;
+	size_t i;
+	pktslot_t slot;
 	
 	if( !pkt ) { return -1; }
 	if( !rx ) { return -1; }
 	if( !rxlen ) { return -1; }
 	if( !rawdata && rawdatalen ) { return -1; }
+	if( soft && softlen != rawdatalen*8 ) { return -1; }
 	
 	*rx = 0;
 	*rxlen = 0;
@@ -259,103 +854,61 @@ int pkt_rx(pkt_t *pkt, pktdata_t **rx, size_t *rxlen, uint8_t *rawdata, size_t r
 		printf("\n");
 	}
 	
-	//Free up any previously returned packets
-	for( i=0; i<pkt->rx_pktslen; i++ ) {
-		if( pkt->rx_pkts[i].data ) {
-			free(pkt->rx_pkts[i].data-2);
+	//Recycle the slots of any previously returned packets.  A packet that
+	//is part way through being received sits in the first unused slot, so 
+	//move it to the front.
+	if( pkt->rx_slotsused ) {
+		if( pkt->rx_slotsused < pkt->rx_slotslen ) {
+			slot = pkt->rx_slots[0];
+			pkt->rx_slots[0] = pkt->rx_slots[pkt->rx_slotsused];
+			pkt->rx_slots[pkt->rx_slotsused] = slot;
+			if( pkt->rx_data ) {
+				pkt->rx_data = pkt->rx_slots[0].data;
+			}
 		}
+		pkt->rx_slotsused = 0;
 	}
 	pkt->rx_pktslen = 0;
 	
 	rawoff = 0;
 	while( rawoff < rawdatalen ) {
+		if( !pkt->rx_synced && pkt->redundancy == 1 && !pkt->verbose ) {
+			//Without redundancy the raw bytes can be scanned for the sync in bulk
+			bitoff = rawoff*8;
+			if( !bitcorr_scan(&pkt->rx_corr,rawdata,rawdatalen,&bitoff) ) {
+				break;
+			}
+			if( pkt_rx_found_sync(pkt) ) {
+				return -1;
+			}
+			//Finish off the byte the sync ended in
+			for( ; bitoff%8; bitoff++ ) {
+				if( pkt_rx_bit(pkt,rawdata,rawdatalen,soft,bitoff) ) {
+					return -1;
+				}
+			}
+			rawoff = bitoff/8;
+			continue;
+		}
 		//Move redudancy worth of bytes into initial buffer
 		while( pkt->rx_buflen < pkt->redundancy && rawoff < rawdatalen ) {
+			for( i=0; i<8; i++ ) {
+				if( soft ) {
+					pkt->rx_bufsoft[pkt->rx_buflen*8+i] = soft[rawoff*8+i];
+				}
+				else {
+					pkt->rx_bufsoft[pkt->rx_buflen*8+i] = 
+						((rawdata[rawoff] >> (7-i)) & 1) ? BITSTREAM_SOFT_MAX : -BITSTREAM_SOFT_MAX;
+				}
+			}
 			pkt->rx_buf[pkt->rx_buflen++] = rawdata[rawoff++];
 		}
 	
 		if( pkt->rx_buflen == pkt->redundancy ) {
 			//Process bits in rx_buf
-			bitoff = 0;
-			while( bitoff < pkt->rx_buflen*8 ) {
-				//Pull redundant bits and vote
-				bit_votes = 0;
-				for( i=0; i<pkt->redundancy; i++ ) {
-					bit = getbits(pkt->rx_buf, pkt->rx_buflen, bitoff++, 1);
-					if( pkt->rx_synced ) {
-						//Apply the mask for all bits after the sync
-						mask = getbits(pkt->mask,pkt->masklen,(pkt->rx_bitoff*pkt->redundancy+i)%(pkt->masklen*8),1);
-						bit = bit ^ mask;
-					}
-					bit_votes = bit_votes + bit;
-				}
-				//Reduce the votes down to a singel bit
-				if( bit_votes > pkt->redundancy/2 ) {
-					bit = 1;
-				}
-				else {
-					bit = 0;
-				}
-				
-				if( !pkt->rx_synced ) {
-					//Try to find the sync
-					shiftbits(pkt->rx_sync,pkt->rx_synclen,1);
-					putbits(pkt->rx_sync,pkt->rx_synclen,pkt->rx_synclen*8-1,1,bit);
-					if( pkt->verbose ) {
-						printf("  Testing Sync: ");
-						for( i=0; i<pkt->synclen; i++ ) {
-							printf("%02x ",pkt->rx_sync[i]);
-						}
-						printf("\n");
-					}
-					if( !memcmp(pkt->rx_sync, pkt->sync, pkt->synclen) ) {
-						if( pkt->verbose ) {
-							printf("  Found Sync\n");
-						}
-						pkt->rx_synced = 1;
-						pkt->rx_bitoff = 0;
-						tmp = (uint8_t*)realloc(pkt->rx_data,2);
-						if( !tmp ) { return -1; }
-						pkt->rx_data = tmp;
-						pkt->rx_datalen = 2;
-						memset(pkt->rx_data,0,2);
-						memset(pkt->rx_sync,0,pkt->rx_synclen);
-					}
-				}
-				else {
-					//Put the bit in the rx_pkt buffer
-					putbits(pkt->rx_data,pkt->rx_datalen,pkt->rx_bitoff++,1,bit);
-					if( pkt->rx_bitoff == 16 ) {
-						//Read the packet size and realloc the buffer
-						pktlen16 = (pkt->rx_data[0]<<8) | (pkt->rx_data[1]);
-						if( pkt->verbose ) {
-							printf("  Packet Length: %u\n",pktlen16);
-						}
-						tmp = (uint8_t*)realloc(pkt->rx_data,2+pktlen16);
-						if( !tmp ) { return -1; }
-						pkt->rx_data = tmp;
-						pkt->rx_datalen = 2+pktlen16;
-						memset(pkt->rx_data+2,0,pktlen16);
-					}
-					else if( pkt->rx_bitoff >= pkt->rx_datalen*8 ) {
-						//We've finish reading the complete packet
-						//Append it to the result set
-						pkt->rx_pktslen++;
-						pkt->rx_pkts = realloc(pkt->rx_pkts,sizeof(pktdata_t)*pkt->rx_pktslen);
-						if( !pkt->rx_pkts ) { return -1; }
-						pkt->rx_pkts[pkt->rx_pktslen-1].data = pkt->rx_data+2;
-						pkt->rx_pkts[pkt->rx_pktslen-1].len  = pkt->rx_datalen-2;
-						pkt->rx_data = 0;
-						pkt->rx_datalen = 0;
-						pkt->rx_synced = 0;
-						if( pkt->verbose ) {
-							printf("  Pkt[%zu]: ",pkt->rx_pkts[pkt->rx_pktslen-1].len);
-							for( i=0; i<pkt->rx_pkts[pkt->rx_pktslen-1].len ; i++ ) {
-								printf("%02x ",pkt->rx_pkts[pkt->rx_pktslen-1].data[i]);
-							}
-							printf("\n");
-						}
-					}
+			for( bitoff=0; bitoff<pkt->rx_buflen*8; bitoff=bitoff+pkt->redundancy ) {
+				if( pkt_rx_bit(pkt,pkt->rx_buf,pkt->rx_buflen,pkt->rx_bufsoft,bitoff) ) {
+					return -1;
 				}
 			}
 			pkt->rx_buflen = 0;
@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __PSK_H__
+#define __PSK_H__
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitops.h"
+#include "pulse.h"
+#include "symsync.h"
+
+#define PSK_DEFAULT_VERBOSE     0
+#define PSK_DEFAULT_THRESH      0.25
+
+//Coherent PSK (BPSK, QPSK or 8PSK) with root raised cosine pulses on a
+//single carrier.  The receiver works on the sample stream: it mixes down
+//to I/Q, matched filters, recovers symbol timing with a Gardner loop and
+//carrier phase with a Costas loop.  A transmission starts with an
+//alternating BPSK preamble (for the timing loop), a Barker sync word
+//(which also settles the phase ambiguity) and a BPSK length header.
+
+typedef struct {
+	int      verbose;
+	size_t   samplerate;
+	size_t   bitrate;
+	double   frequency;
+	size_t   bit_per_symbol;
+	size_t   symbol_count;
+	double   thresh;
+
+	size_t   samp_per_sym;
+	pulse_t *pulse;
+
+	double  *mod_samples;
+	size_t   mod_sampleslen;
+	double  *mod_base;
+	size_t   mod_basealloc;
+
+	symsync_frame_t demod_frame;
+	double   demod_detect;
+	double   demod_nco;
+	double  *demod_mix;
+	size_t   demod_mixoff;
+	double  *demod_mf;
+	size_t   demod_mfalloc;
+	size_t   demod_count;
+	double   demod_power;
+
+	double   demod_phase;
+	double   demod_freq;
+	double   demod_prev[2];
+	double   demod_amp;
+	bitstream_t demod_bits;
+} psk_t;
+
+
+psk_t *psk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count);
+void   psk_destroy(psk_t *modem);
+int    psk_set_thresh(psk_t *modem, double thresh);
+int    psk_set_verbose(psk_t *modem, int verbose);
+int    psk_set_soft(psk_t *modem, int on);
+int    psk_soft(psk_t *modem, int8_t **soft, size_t *softlen);
+void   psk_printinfo(psk_t *modem);
+int    psk_modulate(psk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+int    psk_demodulate(psk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+
+#endif //__PSK_H__
+
+#ifdef PSK_IMPLEMENTATION
+#undef PSK_IMPLEMENTATION
+
+#define PSK_ROLLOFF        0.35
+//Pulse length in symbols
+#define PSK_SPAN           8
+//Peak of the modulated signal is about this times the constellation peak
+#define PSK_AMPLITUDE      0.5
+//Loop bandwidths (times the symbol period) while training and on data
+#define PSK_TIMING_ACQ     0.05
+#define PSK_TIMING_TRK     0.01
+#define PSK_CARRIER_ACQ    0.05
+#define PSK_CARRIER_TRK    0.01
+//Largest carrier offset the phase loop will follow, in radians per symbol
+#define PSK_MAX_FREQ       (M_PI/8)
+
+psk_t *psk_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count) {
+	psk_t *modem;
+	double sym_freq;
+
+	//Double check arguments
+	if( !bitrate ) { return 0; }
+	if( symbol_count < 2 ) { return 0; }
+
+	modem = (psk_t*)malloc(sizeof(psk_t));
+	if( !modem ) { goto psk_init_error; }
+	memset(modem,0,sizeof(psk_t));
+	bitstream_init_alloc(&modem->demod_bits);
+
+	modem->verbose = PSK_DEFAULT_VERBOSE;
+	modem->demod_frame.verbose = PSK_DEFAULT_VERBOSE;
+	//Costas settles at either 0 or 180 degrees; the sign of the sync word
+	//says which
+	modem->demod_frame.inverted = 1;
+
+	modem->samplerate = samplerate;
+	modem->bitrate = bitrate;
+	modem->frequency = frequency;
+
+	modem->bit_per_symbol = 1;
+	while( 1<<modem->bit_per_symbol < symbol_count ) {
+		modem->bit_per_symbol++;
+	}
+	if( modem->bit_per_symbol > 3 ) { goto psk_init_error; }
+	modem->symbol_count = (1 << modem->bit_per_symbol);
+	modem->demod_frame.bit_per_symbol = modem->bit_per_symbol;
+
+	//Gardner needs a few samples per symbol to interpolate between
+	sym_freq = (double)bitrate / (double)modem->bit_per_symbol;
+	modem->samp_per_sym = (size_t)round((double)samplerate / sym_freq);
+	if( modem->samp_per_sym < 4 ) { goto psk_init_error; }
+
+	//The shaped spectrum has to fit between DC and Nyquist
+	sym_freq = (double)samplerate / (double)modem->samp_per_sym;
+	if( frequency < sym_freq*(1.0+PSK_ROLLOFF)/2.0 ) { goto psk_init_error; }
+	if( frequency + sym_freq*(1.0+PSK_ROLLOFF)/2.0 > samplerate/2.0 ) { goto psk_init_error; }
+
+	modem->pulse = pulse_rrc_init(modem->samp_per_sym,PSK_SPAN,PSK_ROLLOFF);
+	if( !modem->pulse ) { goto psk_init_error; }
+
+	//Mixer output history for the matched filter (I/Q interleaved), and
+	//matched filter output history for the timing interpolator
+	modem->demod_mix = (double*)malloc(sizeof(double)*2*modem->pulse->len);
+	if( !modem->demod_mix ) { goto psk_init_error; }
+	modem->demod_mfalloc = symsync_ring_len(modem->samp_per_sym);
+	modem->demod_mf = (double*)malloc(sizeof(double)*2*modem->demod_mfalloc);
+	if( !modem->demod_mf ) { goto psk_init_error; }
+
+	if( psk_set_thresh(modem,PSK_DEFAULT_THRESH) ) {
+		goto psk_init_error;
+	}
+
+	return modem;
+
+	psk_init_error:
+	psk_destroy(modem);
+	return 0;
+}
+
+void psk_destroy(psk_t *modem) {
+	if( modem ) {
+		if( modem->pulse ) { pulse_destroy(modem->pulse); }
+		if( modem->mod_samples ) { free(modem->mod_samples); }
+		if( modem->mod_base ) { free(modem->mod_base); }
+		if( modem->demod_mix ) { free(modem->demod_mix); }
+		if( modem->demod_mf ) { free(modem->demod_mf); }
+		bitstream_destroy(&modem->demod_bits);
+		memset(modem,0,sizeof(psk_t));
+		free(modem);
+	}
+}
+
+static void psk_demodulate_reset(psk_t *modem) {
+	memset(modem->demod_mix,0,sizeof(double)*2*modem->pulse->len);
+	memset(modem->demod_mf,0,sizeof(double)*2*modem->demod_mfalloc);
+	modem->demod_mixoff = 0;
+	modem->demod_count = 0;
+	modem->demod_nco = 0.0;
+	modem->demod_power = 0.0;
+	modem->demod_frame.state = SYMSYNC_SEARCH;
+}
+
+static void psk_demodulate_sample(psk_t *modem, double x) {
+	//Mix one sample down to I/Q and run it through the matched filter
+	double *mix;
+	double *mf;
+	double i;
+	double q;
+	size_t j;
+	size_t off;
+
+	mix = modem->demod_mix + 2*modem->demod_mixoff;
+	mix[0] =  2.0*x*cos(modem->demod_nco);
+	mix[1] = -2.0*x*sin(modem->demod_nco);
+	modem->demod_nco = modem->demod_nco + 2*M_PI*modem->frequency/modem->samplerate;
+	if( modem->demod_nco > 2*M_PI ) {
+		modem->demod_nco = modem->demod_nco - 2*M_PI;
+	}
+
+	//Walk the ring from the oldest sample; the pulse is symmetric, so
+	//this is the convolution
+	if( ++modem->demod_mixoff >= modem->pulse->len ) { modem->demod_mixoff = 0; }
+	i = 0.0;
+	q = 0.0;
+	off = modem->demod_mixoff;
+	for( j=0; j<modem->pulse->len; j++ ) {
+		i = i + modem->pulse->taps[j]*modem->demod_mix[2*off];
+		q = q + modem->pulse->taps[j]*modem->demod_mix[2*off+1];
+		if( ++off >= modem->pulse->len ) { off = 0; }
+	}
+
+	mf = modem->demod_mf + 2*(modem->demod_count & (modem->demod_mfalloc-1));
+	mf[0] = i;
+	mf[1] = q;
+	modem->demod_count++;
+
+	//Signal power, smoothed over a couple of symbols
+	modem->demod_power = modem->demod_power + (i*i + q*q - modem->demod_power) / (2.0*modem->samp_per_sym);
+}
+
+int psk_set_thresh(psk_t *modem, double thresh) {
+	//Detection level as a fraction of the matched filter power of a clean
+	//preamble, measured by running one through the receiver
+	double *samples;
+	size_t  sampleslen;
+	uint8_t dummy = 0;
+	double  power;
+	size_t  count;
+	size_t  ii;
+
+	if( !modem ) { return -1; }
+	if( thresh <= 0.0 || thresh > 1.0 ) { return -1; }
+
+	if( psk_modulate(modem,&samples,&sampleslen,&dummy,0) ) { return -1; }
+	psk_demodulate_reset(modem);
+	power = 0.0;
+	count = 0;
+	for( ii=0; ii<sampleslen; ii++ ) {
+		psk_demodulate_sample(modem,samples[ii]);
+		//Skip the ramp up and down of the filters
+		if( ii >= modem->pulse->len && ii+modem->pulse->len < sampleslen ) {
+			power = power + modem->demod_power;
+			count++;
+		}
+	}
+	psk_demodulate_reset(modem);
+	if( !count ) { return -1; }
+
+	modem->thresh = thresh;
+	modem->demod_detect = thresh * power / count;
+	return 0;
+}
+
+int psk_set_verbose(psk_t *modem, int verbose) {
+	if( !modem ) { return -1; }
+	modem->verbose = verbose;
+	modem->demod_frame.verbose = verbose;
+	return 0;
+}
+
+int psk_set_soft(psk_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int psk_soft(psk_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+void psk_printinfo(psk_t *modem) {
+	printf("Coherent PSK Modem:\n");
+	printf("  Verbose                  : %d\n",modem->verbose);
+	printf("  Samplerate               : %zu\n",modem->samplerate);
+	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
+	printf("  Actual Bitrate           : %0.1lf bps\n",(double)modem->samplerate*modem->bit_per_symbol/modem->samp_per_sym);
+	printf("  Frequency                : %lf\n",modem->frequency);
+	printf("  Symbol Count             : %zu\n",modem->symbol_count);
+	printf("  Samples per Symbol       : %zu\n",modem->samp_per_sym);
+	printf("  Roll-off                 : %0.2lf\n",PSK_ROLLOFF);
+	printf("  Detect Power             : %lf\n",modem->demod_detect);
+}
+
+static void psk_modulate_symbol(psk_t *modem, size_t idx, double re, double im) {
+	//Add one shaped symbol to the I/Q baseband
+	size_t j;
+	double g;
+	double *base;
+
+	base = modem->mod_base + 2*idx*modem->samp_per_sym;
+	g = 1.0 / pulse_peak(modem->pulse);
+	for( j=0; j<modem->pulse->len; j++ ) {
+		base[2*j]   = base[2*j]   + re*modem->pulse->taps[j]*g;
+		base[2*j+1] = base[2*j+1] + im*modem->pulse->taps[j]*g;
+	}
+}
+
+int psk_modulate(psk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_idx;
+	size_t symbol_count;
+	size_t data_count;
+	bitstream_t bits;
+	size_t ii;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	double *tmp;
+	double ang;
+	double x;
+	int sym;
+
+	if( !modem ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !data ) { return -1; }
+	if( datalen >= (1 << SYMSYNC_HEADER_BITS) ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("psk_modulate(...):\n");
+		printf("  Data: ");
+		for( ii=0; ii<datalen; ii++ ) {
+			printf("%02x ",data[ii]);
+		}
+		printf("\n");
+	}
+
+	data_count = (datalen*8 + modem->bit_per_symbol - 1) / modem->bit_per_symbol;
+	symbol_count = SYMSYNC_SYNC_LEN + SYMSYNC_HEADER_LEN + data_count;
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+
+	//Room for the pulse tails at both ends
+	mod_sampleslen = (symbol_count+PSK_SPAN)*modem->samp_per_sym+1;
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto psk_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	if( modem->mod_basealloc < mod_sampleslen ) {
+		tmp = (double*)realloc(modem->mod_base,sizeof(double)*2*mod_sampleslen);
+		if( !tmp ) {
+			goto psk_modulate_error;
+		}
+		modem->mod_base = tmp;
+		modem->mod_basealloc = mod_sampleslen;
+	}
+	memset(modem->mod_base,0,sizeof(double)*2*mod_sampleslen);
+
+	symbol_idx = 0;
+	for( ii=0; ii<SYMSYNC_SYNC_LEN; ii++ ) {
+		psk_modulate_symbol(modem,symbol_idx++,symsync_sync_bit(ii) ? 1.0 : -1.0,0.0);
+	}
+	for( ii=0; ii<SYMSYNC_HEADER_LEN; ii++ ) {
+		sym = symsync_header_bit(datalen,ii);
+		psk_modulate_symbol(modem,symbol_idx++,sym ? 1.0 : -1.0,0.0);
+	}
+	bitstream_init(&bits, data, datalen);
+	for( ii=0; ii<data_count; ii++ ) {
+		//Gray coded, so a one step phase error is one bit error
+		sym = bitstream_read(&bits, modem->bit_per_symbol);
+		sym = sym ^ (sym >> 1);
+		ang = (2*M_PI) / (double)modem->symbol_count * sym;
+		psk_modulate_symbol(modem,symbol_idx++,cos(ang),sin(ang));
+	}
+
+	for( ii=0; ii<mod_sampleslen; ii++ ) {
+		ang = 2*M_PI*modem->frequency*ii/modem->samplerate;
+		x = PSK_AMPLITUDE*(modem->mod_base[2*ii]*cos(ang) - modem->mod_base[2*ii+1]*sin(ang));
+		if( x > 1.0 ) {
+			x = 1.0;
+		}
+		else if( x < -1.0 ) {
+			x = -1.0;
+		}
+		mod_samples[ii] = x;
+	}
+
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+
+	psk_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
+}
+
+
+static void psk_demodulate_llr(psk_t *modem, double *z, double *llr) {
+	//Bit confidences from how close z is to each constellation point, in
+	//units of the margin a clean symbol has over its neighbours
+	double metric[8];
+	double r;
+	double ang;
+	int k;
+	
+	r = sqrt((z[0]*z[0] + z[1]*z[1]) / modem->demod_amp);
+	ang = atan2(z[1],z[0]);
+	for( k=0; k<(int)modem->symbol_count; k++ ) {
+		metric[k ^ (k >> 1) ^ (k >> 2)] = r*cos(ang - (2*M_PI) / (double)modem->symbol_count * k);
+	}
+	bitstream_soft_demap(metric,modem->symbol_count,modem->bit_per_symbol,
+	                     1.0 - cos((2*M_PI) / (double)modem->symbol_count),llr);
+}
+
+static int psk_demodulate_decide(void *arg, symsync_state_t state, size_t idx, double *soft) {
+	//Costas: rotate the symbol just timed (demod_prev, now that Gardner is
+	//done with it) by the carrier phase and decide
+	psk_t *modem = (psk_t*)arg;
+	double *cur;
+	double z[2];
+	double d[2];
+	double err;
+	double mag;
+	double kp;
+	double ki;
+	int k;
+
+	cur = modem->demod_prev;
+	z[0] = cur[0]*cos(modem->demod_phase) + cur[1]*sin(modem->demod_phase);
+	z[1] = cur[1]*cos(modem->demod_phase) - cur[0]*sin(modem->demod_phase);
+	if( state != SYMSYNC_DATA ) {
+		d[0] = z[0] >= 0.0 ? 1.0 : -1.0;
+		d[1] = 0.0;
+		k = 0;
+	}
+	else {
+		k = (int)round(atan2(z[1],z[0]) / ((2*M_PI) / (double)modem->symbol_count));
+		k = (k + (int)modem->symbol_count) % (int)modem->symbol_count;
+		d[0] = cos((2*M_PI) / (double)modem->symbol_count * k);
+		d[1] = sin((2*M_PI) / (double)modem->symbol_count * k);
+	}
+	mag = sqrt(z[0]*z[0] + z[1]*z[1]);
+	err = 0.0;
+	if( mag > 0.0 ) {
+		err = (z[1]*d[0] - z[0]*d[1]) / mag;
+	}
+	symsync_loop_gains(state == SYMSYNC_SYNC ? PSK_CARRIER_ACQ : PSK_CARRIER_TRK,&kp,&ki);
+	modem->demod_freq = modem->demod_freq + ki*err;
+	//Half a turn per symbol looks the same as the alternating preamble,
+	//so keep the loop well away from it
+	if( modem->demod_freq > PSK_MAX_FREQ ) {
+		modem->demod_freq = PSK_MAX_FREQ;
+	}
+	else if( modem->demod_freq < -PSK_MAX_FREQ ) {
+		modem->demod_freq = -PSK_MAX_FREQ;
+	}
+	modem->demod_phase = modem->demod_phase + kp*err + modem->demod_freq;
+
+	if( state == SYMSYNC_SYNC ) {
+		soft[0] = z[0] / sqrt(modem->demod_amp);
+		return 0;
+	}
+	if( state == SYMSYNC_HEADER ) {
+		return d[0] > 0.0;
+	}
+	if( modem->demod_bits.softon ) {
+		psk_demodulate_llr(modem,z,soft);
+	}
+	return k ^ (k >> 1) ^ (k >> 2);
+}
+
+static int psk_demodulate_symbol(psk_t *modem) {
+	//One symbol at the frame's symbol instant: timing error, then the 
+	//framing, which takes the carrier loop's decisions
+	double cur[2];
+	double mid[2];
+	double err;
+	double mag;
+	int ret;
+
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,2,modem->demod_frame.time,cur);
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,2,modem->demod_frame.time-modem->samp_per_sym/2.0,mid);
+	mag = cur[0]*cur[0] + cur[1]*cur[1];
+	modem->demod_amp = modem->demod_amp + (mag - modem->demod_amp) / 8.0;
+
+	//Gardner: the midpoint between symbols should cross zero
+	err = ((modem->demod_prev[0]-cur[0])*mid[0] + (modem->demod_prev[1]-cur[1])*mid[1]) / modem->demod_amp;
+	modem->demod_prev[0] = cur[0];
+	modem->demod_prev[1] = cur[1];
+	symsync_frame_timing(&modem->demod_frame,err,PSK_TIMING_ACQ,PSK_TIMING_TRK,modem->samp_per_sym);
+
+	ret = symsync_frame_symbol(&modem->demod_frame,&modem->demod_bits,modem->demod_power < modem->demod_detect/2.0,psk_demodulate_decide,modem);
+	if( ret < 0 ) {
+		return -1;
+	}
+	if( ret > 0 && modem->demod_frame.corr < 0.0 ) {
+		modem->demod_phase = modem->demod_phase + M_PI;
+	}
+	return 0;
+}
+
+int psk_demodulate(psk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t ii;
+	size_t j;
+
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("psk_demodulate(...)\n");
+	}
+
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+
+	for( ii=0; ii<sampleslen; ii++ ) {
+		psk_demodulate_sample(modem,samples[ii]);
+
+		if( modem->demod_frame.state == SYMSYNC_SEARCH ) {
+			if( modem->demod_power >= modem->demod_detect ) {
+				//Start the loops fresh, one symbol out
+				symsync_frame_start(&modem->demod_frame,(double)modem->demod_count + modem->samp_per_sym);
+				modem->demod_phase = 0.0;
+				modem->demod_freq = 0.0;
+				modem->demod_prev[0] = 0.0;
+				modem->demod_prev[1] = 0.0;
+				modem->demod_amp = modem->demod_power;
+			}
+			continue;
+		}
+
+		if( symsync_frame_ready(&modem->demod_frame,modem->demod_count) ) {
+			if( psk_demodulate_symbol(modem) ) {
+				return -1;
+			}
+		}
+	}
+
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+#endif //PSK_IMPLEMENTATION
\ No newline at end of file
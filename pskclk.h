@@ -33,6 +33,7 @@
 
 #include "bitops.h"
 #include "srcfft.h"
+#include "tcm.h"
 
 #define PSKCLK_DEFAULT_VERBOSE     0
 #define PSKCLK_DEFAULT_THRESH      0.75
@@ -54,13 +55,17 @@ typedef struct {
 	double   frequency;
 	size_t   bit_per_symbol;
 	size_t   symbol_count;
+	int      differential;
+	int      tcm;
 	
 	double   sym_freq;
 	size_t   mod_samp_per_sym;
+	size_t   mod_samp_per_seg;
 	size_t   demod_samp_per_fft;
-	size_t   demod_fft_per_halfsym;
+	size_t   demod_fft_per_seg;
 	double  *mod_samples;
 	size_t   mod_sampleslen;
+	pulse_t *mod_taper;
 	
 	srcfft_t *srcfft;
 	pskclk_demod_state_t demod_state;
@@ -74,20 +79,25 @@ typedef struct {
 	double     demod_base_ang;
 	double     demod_data_ang;
 	size_t     demod_fft_count;
-	uint8_t    demod_bytes[2];
-	uint8_t    demod_bit_count;
-	uint8_t   *demod_data;
-	size_t     demod_datalen;
+	double    *demod_metric;
+	tcm_t      demod_tcm;
+	bitstream_t demod_bits;
 } pskclk_t;
 
 
 pskclk_t *pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count);
+pskclk_t *pskclk_dpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count);
+pskclk_t *pskclk_tcm_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count);
 void   pskclk_destroy(pskclk_t *modem);
 int    pskclk_set_thresh(pskclk_t *modem, double thresh);
 int    pskclk_set_verbose(pskclk_t *modem, int verbose);
+int    pskclk_set_soft(pskclk_t *modem, int on);
+int    pskclk_soft(pskclk_t *modem, int8_t **soft, size_t *softlen);
+int    pskclk_set_pulse(pskclk_t *modem, double rolloff);
 void   pskclk_printinfo(pskclk_t *modem);
 int    pskclk_modulate(pskclk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
 int    pskclk_demodulate(pskclk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+int    pskclk_demodulate_fft(pskclk_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen);
 
 #endif //__PSKCLK_H__
 
@@ -96,7 +106,15 @@ int    pskclk_demodulate(pskclk_t *modem, uint8_t **data, size_t *datalen, doubl
 
 #define PSKCLK_OVERSAMPLE 5
 
-pskclk_t *pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count) {
+//Each symbol is sent as tone segments with a half sine envelope.  pskclk
+//sends two per symbol: a phase 0 base, then the data phase.  The 
+//differential (DPSK) mode sends one, with the data phase added to the 
+//previous segment's phase.  The previous segment stands in for the base,
+//so at the same bitrate each segment is a whole symbol long.  The trellis
+//coded (TCM) mode sends the same segments as pskclk, but one bit per 
+//symbol fewer (see tcm.h), with the phases decided by a Viterbi decoder
+//once the signal goes away.
+static pskclk_t *pskclk_init_mode(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count, int differential, int tcm) {
 	pskclk_t *modem;
 	size_t i;
 	
@@ -108,6 +126,7 @@ pskclk_t *pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, doubl
 	modem = (pskclk_t*)malloc(sizeof(pskclk_t));
 	if( !modem ) { goto pskclk_init_error; }
 	memset(modem,0,sizeof(pskclk_t));
+	bitstream_init_alloc(&modem->demod_bits);
 	
 	modem->verbose = PSKCLK_DEFAULT_VERBOSE;
 	
@@ -115,25 +134,33 @@ pskclk_t *pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, doubl
 	modem->bitrate = bitrate;
 	modem->bandwidth = bandwidth;
 	modem->frequency = frequency;
+	modem->differential = differential;
+	modem->tcm = tcm;
 
 	modem->bit_per_symbol = 1;
 	while( 1<<modem->bit_per_symbol < symbol_count ) {
 		modem->bit_per_symbol++;
 	}
 	modem->symbol_count = (1 << modem->bit_per_symbol);
+	modem->demod_metric = (double*)malloc(sizeof(double)*modem->symbol_count);
+	if( !modem->demod_metric ) { goto pskclk_init_error; }
+	if( tcm && tcm_init(&modem->demod_tcm,modem->symbol_count) ) {
+		goto pskclk_init_error;
+	}
 	
 	//Samples to produce per symbol (clock/base and data)
-	modem->sym_freq = ((double)bitrate / (double)modem->bit_per_symbol);
+	modem->sym_freq = ((double)bitrate / (double)(modem->bit_per_symbol-tcm));
 	modem->mod_samp_per_sym = (double)samplerate / modem->sym_freq;
 	if( modem->mod_samp_per_sym < 4 ) { goto pskclk_init_error; }
+	modem->mod_samp_per_seg = differential ? modem->mod_samp_per_sym : modem->mod_samp_per_sym/2;
 	
 	//Measure the signal by even wavelengths
 	modem->demod_samp_per_fft = 0;
 	do {
 		modem->demod_samp_per_fft += samplerate / frequency;
-		modem->demod_fft_per_halfsym = (modem->mod_samp_per_sym/2) / modem->demod_samp_per_fft;
-	} while( modem->demod_fft_per_halfsym > PSKCLK_OVERSAMPLE );
-	if( modem->demod_fft_per_halfsym < 1 ) { goto pskclk_init_error; }
+		modem->demod_fft_per_seg = modem->mod_samp_per_seg / modem->demod_samp_per_fft;
+	} while( modem->demod_fft_per_seg > PSKCLK_OVERSAMPLE );
+	if( modem->demod_fft_per_seg < 1 ) { goto pskclk_init_error; }
 	
 	//Create the Samplerate converting FFT object
 	modem->srcfft = srcfft_init(samplerate,modem->demod_samp_per_fft,bandwidth,0);
@@ -153,11 +180,26 @@ pskclk_t *pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, doubl
 	return 0;
 }
 
+pskclk_t *pskclk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count) {
+	return pskclk_init_mode(samplerate,bitrate,bandwidth,frequency,symbol_count,0,0);
+}
+
+pskclk_t *pskclk_dpsk_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count) {
+	return pskclk_init_mode(samplerate,bitrate,bandwidth,frequency,symbol_count,1,0);
+}
+
+pskclk_t *pskclk_tcm_init(size_t samplerate, size_t bitrate, size_t bandwidth, double frequency, size_t symbol_count) {
+	return pskclk_init_mode(samplerate,bitrate,bandwidth,frequency,symbol_count,0,1);
+}
+
 void pskclk_destroy(pskclk_t *modem) {
 	if( modem ) {
 		if( modem->srcfft ) { srcfft_destroy(modem->srcfft); }
+		if( modem->mod_taper ) { pulse_destroy(modem->mod_taper); }
 		if( modem->mod_samples ) { free(modem->mod_samples); }
-		if( modem->demod_data ) { free(modem->demod_data); }
+		if( modem->demod_metric ) { free(modem->demod_metric); }
+		tcm_destroy(&modem->demod_tcm);
+		bitstream_destroy(&modem->demod_bits);
 		memset(modem,0,sizeof(pskclk_t));
 		free(modem);
 	}
@@ -214,28 +256,93 @@ int pskclk_set_verbose(pskclk_t *modem, int verbose) {
 	return 0;
 }
 
+int pskclk_set_soft(pskclk_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int pskclk_soft(pskclk_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+int pskclk_set_pulse(pskclk_t *modem, double rolloff) {
+	//Send each tone segment as a raised cosine pulse of the given roll-off
+	//and window the receive FFTs to match.  0 restores the half sine 
+	//envelope.
+	pulse_t *taper = 0;
+	
+	if( !modem ) { return -1; }
+	if( rolloff != 0.0 ) {
+		//The receiver finds segments by the gaps between them, so the 
+		//pulses are fitted inside the segments rather than overlapped
+		taper = pulse_taper_fit(modem->mod_samp_per_seg,rolloff);
+		if( !taper ) { return -1; }
+	}
+	if( srcfft_set_taper(modem->srcfft,rolloff) ) {
+		pulse_destroy(taper);
+		return -1;
+	}
+	pulse_destroy(modem->mod_taper);
+	modem->mod_taper = taper;
+	return 0;
+}
+
 void pskclk_printinfo(pskclk_t *modem) {
 	size_t i;
 	size_t j;
-	printf("PSK (with Clock) Modem:\n");
+	if( modem->differential ) {
+		printf("DPSK Modem:\n");
+	}
+	else if( modem->tcm ) {
+		printf("Trellis Coded PSK (with Clock) Modem:\n");
+	}
+	else {
+		printf("PSK (with Clock) Modem:\n");
+	}
 	printf("  Verbose                  : %d\n",modem->verbose);
 	printf("  Samplerate               : %zu\n",modem->samplerate);
 	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
 	printf("  Bandwidth                : %zu Hz\n",modem->bandwidth);
 	printf("  Samples per Symbol       : %zu\n",modem->mod_samp_per_sym);
 	printf("  Demod Samples per FFT    : %zu\n",modem->demod_samp_per_fft);
-	printf("  Demod FFT per HalfSymbol : %zu\n",modem->demod_fft_per_halfsym);
+	printf("  Samples per Segment      : %zu\n",modem->mod_samp_per_seg);
+	printf("  Demod FFT per Segment    : %zu\n",modem->demod_fft_per_seg);
 	printf("  Frequency                : %lf\n",modem->frequency);
+	if( modem->mod_taper ) {
+		printf("  Pulse Roll-off           : %0.2lf\n",modem->mod_taper->shape);
+	}
+}
+
+static void pskclk_modulate_segment(pskclk_t *modem, double *mod_samples, size_t *ii, double ang) {
+	//One tone segment at phase ang, under a half sine envelope or a 
+	//raised cosine pulse
+	size_t sample_count;
+	double env_freq;
+	
+	if( modem->mod_taper ) {
+		pulse_taper_add(modem->mod_taper,mod_samples,*ii,modem->frequency,ang,modem->samplerate);
+		*ii = *ii + modem->mod_samp_per_seg;
+		return;
+	}
+	env_freq = modem->differential ? modem->sym_freq/2 : modem->sym_freq;
+	for( sample_count=0; sample_count<modem->mod_samp_per_seg; sample_count++ ) {
+		mod_samples[*ii] = sin(2*M_PI*modem->frequency*(*ii)/modem->samplerate + ang) *
+		                   sin(2*M_PI*env_freq*sample_count/modem->samplerate);
+		(*ii)++;
+	}
 }
 
 int pskclk_modulate(pskclk_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
 	size_t symbol_idx;
 	size_t symbol_count;
-	size_t sample_count;
-	size_t bit_idx;
+	size_t seg_count;
+	bitstream_t bits;
 	size_t ii;
 	size_t mod_sampleslen;
 	double *mod_samples;
+	size_t bit_per_data;
+	unsigned int state;
 	int sym;
 	double ang;
 	
@@ -252,41 +359,53 @@ int pskclk_modulate(pskclk_t *modem, double **samples, size_t *sampleslen, uint8
 		}
 	}
 	
-	symbol_count = (datalen*8) / modem->bit_per_symbol;
-	if( (datalen*8) % (modem->bit_per_symbol) ) {
-		symbol_count++;
+	bit_per_data = modem->bit_per_symbol - modem->tcm;
+	if( modem->tcm ) {
+		symbol_count = tcm_symbol_count(datalen*8,modem->bit_per_symbol);
+	}
+	else {
+		symbol_count = (datalen*8) / modem->bit_per_symbol;
+		if( (datalen*8) % (modem->bit_per_symbol) ) {
+			symbol_count++;
+		}
 	}
 	if( modem->verbose ) {
 		printf("  Symbol count: %zu\n",symbol_count);
 	}
 	
-	mod_sampleslen = modem->mod_samp_per_sym*symbol_count;
+	//Differential mode leads with a phase 0 reference segment
+	seg_count = modem->differential ? symbol_count+1 : symbol_count*2;
+	mod_sampleslen = modem->mod_samp_per_seg*seg_count;
 	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
 	if( !mod_samples ) {
 		goto ook_modulate_error;
 	}
 	modem->mod_samples = mod_samples;
 	modem->mod_sampleslen = mod_sampleslen;
+	memset(mod_samples,0,sizeof(double)*mod_sampleslen);
 	
 	ii = 0;
-	bit_idx = 0;
+	ang = 0.0;
+	state = 0;
+	bitstream_init(&bits, data, datalen);
+	if( modem->differential ) {
+		pskclk_modulate_segment(modem,mod_samples,&ii,ang);
+	}
 	for( symbol_idx=0; symbol_idx<symbol_count; symbol_idx++ ) {
-		for( sample_count=0; sample_count<modem->mod_samp_per_sym/2; sample_count++ ) {
-			//Generate base tone (phase 0)
-			mod_samples[ii] = sin(2*M_PI*modem->frequency*ii/modem->samplerate) *
-							  sin(2*M_PI*modem->sym_freq*sample_count/modem->samplerate);
-			ii++;
+		//Reads past the end give the zero tail
+		sym = bitstream_read(&bits, bit_per_data);
+		if( modem->tcm ) {
+			sym = tcm_encode(&state, modem->bit_per_symbol, sym);
 		}
-		sym = getbits(data, datalen, bit_idx, modem->bit_per_symbol);
-		bit_idx = bit_idx + modem->bit_per_symbol;
-		
-		ang = (2*M_PI) / (double)modem->symbol_count * sym;
-		for( sample_count=0; sample_count<modem->mod_samp_per_sym/2; sample_count++ ) {
-			//Generate base tone (phase X)
-			mod_samples[ii] = sin(2*M_PI*modem->frequency*ii/modem->samplerate + ang) *
-							  sin(2*M_PI*modem->sym_freq*sample_count/modem->samplerate);
-			ii++;
+		if( modem->differential ) {
+			ang = fmod(ang + (2*M_PI) / (double)modem->symbol_count * sym, 2*M_PI);
+		}
+		else {
+			//Generate base tone (phase 0)
+			pskclk_modulate_segment(modem,mod_samples,&ii,0.0);
+			ang = (2*M_PI) / (double)modem->symbol_count * sym;
 		}
+		pskclk_modulate_segment(modem,mod_samples,&ii,ang);
 	}
 	
 	*samples = mod_samples;
@@ -300,221 +419,324 @@ int pskclk_modulate(pskclk_t *modem, double **samples, size_t *sampleslen, uint8
 }
 
 
-int pskclk_demodulate(pskclk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
-	size_t   ii;
+static double pskclk_ang_dist(double a, double b) {
+	//Angle between two phases, so that 0 and 2 pi are the same phase
+	double diff;
+	
+	diff = fmod(fabs(a - b),2*M_PI);
+	return diff > M_PI ? 2*M_PI - diff : diff;
+}
+
+static int pskclk_demodulate_symbol(pskclk_t *modem) {
+	//Symbol from the phase of the data segment relative to the base (or,
+	//when differential, the previous) segment
+	double diff;
+	
+	diff = modem->demod_data_ang - modem->demod_base_ang;
+	while( diff < 0.0 ) {
+		diff = diff + 2*M_PI;
+	}
+	return (int)round( diff / ((double)(2*M_PI) / (double)modem->symbol_count) ) % (int)modem->symbol_count;
+}
+
+static void pskclk_demodulate_llr(pskclk_t *modem, double *llr) {
+	//Bit confidences from how close the measured phase is to each symbol's.  
+	//A clean symbol is 1-cos(2 pi/symbol_count) better than its neighbours.
+	double diff;
+	size_t k;
+	
+	diff = modem->demod_data_ang - modem->demod_base_ang;
+	for( k=0; k<modem->symbol_count; k++ ) {
+		modem->demod_metric[k] = cos(diff - (2*M_PI) / (double)modem->symbol_count * k);
+	}
+	bitstream_soft_demap(modem->demod_metric,modem->symbol_count,modem->bit_per_symbol,
+	                     1.0 - cos((2*M_PI) / (double)modem->symbol_count),llr);
+}
+
+static int pskclk_demodulate_tcm(pskclk_t *modem) {
+	//Squared distance from the measured phase to every symbol's, for the
+	//Viterbi decoder
+	double diff;
+	size_t k;
+	
+	diff = modem->demod_data_ang - modem->demod_base_ang;
+	for( k=0; k<modem->symbol_count; k++ ) {
+		modem->demod_tcm.dist[k] = 2.0 - 2.0*cos(diff - (2*M_PI) / (double)modem->symbol_count * k);
+	}
+	return tcm_decode(&modem->demod_tcm);
+}
+
+static int pskclk_demodulate_result(pskclk_t *modem) {
+	//Advance the demodulator by one FFT result held in modem->srcfft
 	size_t   j;
 	int tone_detected;
 	int sym;
-	uint8_t *tmpdata;
-	srcfft_status_t result;
+	double llr[32];
 	
 	
-	if( !modem ) { return -1; }
-	if( !data ) { return -1; }
-	if( !datalen ) { return -1; }
-	if( !samples ) { return -1; }
+	//if( modem->verbose ) {
+	//	printf("  ");
+	//	srcfft_printresult(modem->srcfft);
+	//}
 	
-	if( modem->verbose ) {
-		printf("ook_demodulate(...)\n");
-	}
-	
-	modem->demod_datalen = 0;
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
-	
-	
-	ii = 0;
-	while( ii < sampleslen ) {
-		result = srcfft_process(modem->srcfft,samples+ii,sampleslen-ii);
-		ii = ii + modem->srcfft->used_samples;
-		if( result == SRCFFT_ERROR ) { 
+	//Check for signal
+	tone_detected = 0;
+	for( j=0; j<modem->srcfft->detectlen; j++ ) {
+		if( modem->srcfft->detect[j] == modem->demod_fftbin ) {
+			tone_detected = 1;
 			if( modem->verbose ) {
-				printf("  FFT failed\n");
-				return -1; 
+				printf("  * %0.1lf with angle %0.1lf\n",modem->srcfft->mag[modem->demod_fftbin],modem->srcfft->ang[modem->demod_fftbin]);
 			}
 		}
-		else if( result == SRCFFT_NEED_MORE ) {
-			continue;
+	}
+	
+	if( !tone_detected ) {
+		if( modem->verbose ) {
+			printf("    %0.1lf with angle %0.1lf\n",modem->srcfft->mag[modem->demod_fftbin],modem->srcfft->ang[modem->demod_fftbin]);
 		}
-		
-		//if( modem->verbose ) {
-		//	printf("  ");
-		//	srcfft_printresult(modem->srcfft);
-		//}
-		
-		//Check for signal
-		tone_detected = 0;
-		for( j=0; j<modem->srcfft->detectlen; j++ ) {
-			if( modem->srcfft->detect[j] == modem->demod_fftbin ) {
-				tone_detected = 1;
+		//A trellis coded transmission is decoded once the signal is gone
+		if( modem->demod_state != PSKCLK_DEMOD_BASE_SEARCH || modem->demod_tcm.decisionslen ) {
+			modem->demod_sync_loss += modem->demod_samp_per_fft;
+			if( modem->verbose ) {
+				printf("    Lossing Sync %zu / %zu\n",modem->demod_sync_loss,modem->mod_samp_per_sym);
+			}
+			if( modem->demod_sync_loss >= modem->mod_samp_per_sym ) {
 				if( modem->verbose ) {
-					printf("  * %0.1lf with angle %0.1lf\n",modem->srcfft->mag[modem->demod_fftbin],modem->srcfft->ang[modem->demod_fftbin]);
+					printf("    Sync lost\n");
+				}
+				modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
+				modem->demod_fft_count = 0;
+				if( modem->tcm && tcm_flush(&modem->demod_tcm,&modem->demod_bits) ) {
+					return -1;
 				}
 			}
 		}
-		
-		if( !tone_detected ) {
-			if( modem->verbose ) {
-				printf("    %0.1lf with angle %0.1lf\n",modem->srcfft->mag[modem->demod_fftbin],modem->srcfft->ang[modem->demod_fftbin]);
+	}
+	else {
+		modem->demod_sync_loss = 0;
+	}
+	
+	if( modem->demod_state == PSKCLK_DEMOD_BASE_SEARCH ) {
+		if( tone_detected ) {
+			modem->demod_base_ang = modem->srcfft->ang[modem->demod_fftbin];
+			modem->demod_fft_count = 1;
+			modem->demod_state = PSKCLK_DEMOD_BASE_ACQUIRE;
+		}
+	}
+	else if( modem->demod_state == PSKCLK_DEMOD_BASE_ACQUIRE ) {
+		if( tone_detected ) {
+			if( pskclk_ang_dist(modem->srcfft->ang[modem->demod_fftbin],modem->demod_base_ang) >
+			      ((double)(2*M_PI) / (double)modem->symbol_count) ) {
+				//Angle went off
+				modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
+				modem->demod_fft_count = 0;
 			}
-			if( modem->demod_state != PSKCLK_DEMOD_BASE_SEARCH ) {
-				modem->demod_sync_loss += modem->demod_samp_per_fft;
+			else {
 				if( modem->verbose ) {
-					printf("    Lossing Sync %zu / %zu\n",modem->demod_sync_loss,modem->mod_samp_per_sym);
-				}
-				if( modem->demod_sync_loss >= modem->mod_samp_per_sym ) {
-					if( modem->verbose ) {
-						printf("    Sync lost\n");
-					}
-					modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
-					modem->demod_fft_count = 0;
+					printf("      Base detected\n");
 				}
+				modem->demod_state = PSKCLK_DEMOD_BASE_DETECTED;
+				modem->demod_fft_count++;
 			}
 		}
 		else {
-			modem->demod_sync_loss = 0;
+			modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
+			modem->demod_fft_count = 0;
 		}
-		
-		if( modem->demod_state == PSKCLK_DEMOD_BASE_SEARCH ) {
-			if( tone_detected ) {
-				modem->demod_base_ang = modem->srcfft->ang[modem->demod_fftbin];
-				modem->demod_fft_count = 1;
-				modem->demod_state = PSKCLK_DEMOD_BASE_ACQUIRE;
-			}
+	}
+	else if( modem->demod_state == PSKCLK_DEMOD_BASE_DETECTED ) {
+		modem->demod_fft_count++;
+		if( modem->verbose ) {
+			printf("      Base measurement: %zu / %zu\n",modem->demod_fft_count,modem->demod_fft_per_seg );
 		}
-		else if( modem->demod_state == PSKCLK_DEMOD_BASE_ACQUIRE ) {
-			if( tone_detected ) {
-				if( fabs(modem->srcfft->ang[modem->demod_fftbin] - modem->demod_base_ang) >
-				      ((double)(2*M_PI) / (double)modem->symbol_count) ) {
-					//Angle went off
-					modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
-					modem->demod_fft_count = 0;
-				}
-				else {
-					if( modem->verbose ) {
-						printf("      Base detected\n");
-					}
-					modem->demod_state = PSKCLK_DEMOD_BASE_DETECTED;
-					modem->demod_fft_count++;
-				}
-			}
-			else {
-				modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
-				modem->demod_fft_count = 0;
-			}
+		if( modem->demod_fft_count >= modem->demod_fft_per_seg ) {
+			modem->demod_state = PSKCLK_DEMOD_DATA_SEARCH;
+			modem->demod_fft_count = 0;
 		}
-		else if( modem->demod_state == PSKCLK_DEMOD_BASE_DETECTED ) {
-			modem->demod_fft_count++;
+		else if( tone_detected &&
+		         pskclk_ang_dist(modem->srcfft->ang[modem->demod_fftbin],modem->demod_base_ang) >
+		           ((double)(2*M_PI) / (double)modem->symbol_count) ) {
+			//Phase changed dramatically and prematurely
 			if( modem->verbose ) {
-				printf("      Base measurement: %zu / %zu\n",modem->demod_fft_count,modem->demod_fft_per_halfsym );
+				printf("      Premature angle change from base\n");
+				printf("        %0.1lf -> %0.1lf\n",modem->demod_base_ang,modem->srcfft->ang[modem->demod_fftbin]);
 			}
-			if( modem->demod_fft_count >= modem->demod_fft_per_halfsym ) {
-				modem->demod_state = PSKCLK_DEMOD_DATA_SEARCH;
+			modem->demod_data_ang = modem->srcfft->ang[modem->demod_fftbin];
+			modem->demod_state = PSKCLK_DEMOD_DATA_ACQUIRE;
+			modem->demod_fft_count = 1;
+		}
+	}
+	else if( modem->demod_state == PSKCLK_DEMOD_DATA_SEARCH ) {
+		if( tone_detected ) {
+			modem->demod_data_ang = modem->srcfft->ang[modem->demod_fftbin];
+			modem->demod_state = PSKCLK_DEMOD_DATA_ACQUIRE;
+			modem->demod_fft_count = 1;
+		}
+	}
+	else if( modem->demod_state == PSKCLK_DEMOD_DATA_ACQUIRE ) {
+		if( tone_detected ) {
+			if( pskclk_ang_dist(modem->srcfft->ang[modem->demod_fftbin],modem->demod_data_ang) >
+			    ((double)(2*M_PI) / (double)modem->symbol_count) ) {
+				//Phase changed dramatically and prematurely
+				modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
 				modem->demod_fft_count = 0;
 			}
-			else if( tone_detected &&
-			         fabs(modem->srcfft->ang[modem->demod_fftbin] - modem->demod_base_ang) >
-			           ((double)(2*M_PI) / (double)modem->symbol_count) ) {
-				//Phase changed dramatically and prematurely
+			else {
 				if( modem->verbose ) {
-					printf("      Premature angle change from base\n");
-					printf("        %0.1lf -> %0.1lf\n",modem->demod_base_ang,modem->srcfft->ang[modem->demod_fftbin]);
+					printf("      Data detected %lf / %lf\n",modem->demod_base_ang,modem->demod_data_ang);
 				}
-				modem->demod_data_ang = modem->srcfft->ang[modem->demod_fftbin];
-				modem->demod_state = PSKCLK_DEMOD_DATA_ACQUIRE;
-				modem->demod_fft_count = 1;
-			}
-		}
-		else if( modem->demod_state == PSKCLK_DEMOD_DATA_SEARCH ) {
-			if( tone_detected ) {
-				modem->demod_data_ang = modem->srcfft->ang[modem->demod_fftbin];
-				modem->demod_state = PSKCLK_DEMOD_DATA_ACQUIRE;
-				modem->demod_fft_count = 1;
-			}
-		}
-		else if( modem->demod_state == PSKCLK_DEMOD_DATA_ACQUIRE ) {
-			if( tone_detected ) {
-				if( fabs(modem->srcfft->ang[modem->demod_fftbin] - modem->demod_data_ang) >
-				    ((double)(2*M_PI) / (double)modem->symbol_count) ) {
-					//Phase changed dramatically and prematurely
-					modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
-					modem->demod_fft_count = 0;
+				modem->demod_state = PSKCLK_DEMOD_DATA_DETECTED;
+				modem->demod_fft_count++;
+				
+				sym = pskclk_demodulate_symbol(modem);
+				if( modem->verbose ) {
+					printf("      Symbol Calc: %0.1lf - %0.1lf\n",modem->demod_data_ang,modem->demod_base_ang);
+					printf("      WTF: %d\n",sym);
+					printf("----->Symbol: 0x%02x\n",sym);
 				}
-				else {
-					if( modem->verbose ) {
-						printf("      Data detected %lf / %lf\n",modem->demod_base_ang,modem->demod_data_ang);
+				if( modem->tcm ) {
+					if( pskclk_demodulate_tcm(modem) ) {
+						return -1;
 					}
-					modem->demod_state = PSKCLK_DEMOD_DATA_DETECTED;
-					modem->demod_fft_count++;
-					
-					sym = (int)round( fabs(modem->demod_data_ang-modem->demod_base_ang) / ((double)(2*M_PI) / (double)modem->symbol_count) );
-					if( modem->verbose ) {
-						printf("      Symbol Calc: %lf = |%0.1lf - %0.1lf| / %0.1lf / %0.1lf\n",fabs(modem->demod_data_ang-modem->demod_base_ang) / ((double)(2*M_PI) / (double)modem->symbol_count),
-						    modem->demod_data_ang,
-						    modem->demod_base_ang,
-						    (double)(2*M_PI),(double)modem->symbol_count);
-						printf("      WTF: %d\n",sym);
-						printf("----->Symbol: 0x%02x\n",sym);
+				}
+				else {
+					if( modem->demod_bits.softon ) {
+						pskclk_demodulate_llr(modem,llr);
 					}
-					putbits(modem->demod_bytes, sizeof(modem->demod_bytes), modem->demod_bit_count, modem->bit_per_symbol, sym);
-					modem->demod_bit_count = modem->demod_bit_count + modem->bit_per_symbol;
-					if( modem->demod_bit_count >= 8 ) {
-						//Push a demodulated byte
-						tmpdata = (uint8_t*)realloc(modem->demod_data,sizeof(uint8_t)*(modem->demod_datalen+1));
-						if( !tmpdata ) {
-							if( modem->verbose ) {
-								printf("      Failed to reallocate data buffer\n");
-							}
-							return -1;
+					if( bitstream_write_soft(&modem->demod_bits, modem->bit_per_symbol, sym, llr) ) {
+						if( modem->verbose ) {
+							printf("    Failed to grow data buffer\n");
 						}
-						modem->demod_data = tmpdata;
-						modem->demod_data[modem->demod_datalen] = modem->demod_bytes[0];
-						modem->demod_datalen++;
-						modem->demod_bytes[0] = modem->demod_bytes[1];
-						modem->demod_bytes[1] = 0;
-						modem->demod_bit_count = modem->demod_bit_count - 8;
+						return -1;
 					}
 				}
 			}
+		}
+		else {
+			modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
+			modem->demod_fft_count = 0;
+		}
+	}
+	else if( modem->demod_state == PSKCLK_DEMOD_DATA_DETECTED ) {
+		modem->demod_fft_count++;
+		if( modem->verbose ) {
+			printf("      Data measurement: %zu / %zu\n",modem->demod_fft_count,modem->demod_fft_per_seg );
+		}
+		if( modem->demod_fft_count >= modem->demod_fft_per_seg ) {
+			if( modem->differential ) {
+				//This segment is the reference for the next
+				modem->demod_base_ang = modem->demod_data_ang;
+				modem->demod_state = PSKCLK_DEMOD_DATA_SEARCH;
+			}
 			else {
 				modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
-				modem->demod_fft_count = 0;
 			}
+			modem->demod_fft_count = 0;
 		}
-		else if( modem->demod_state == PSKCLK_DEMOD_DATA_DETECTED ) {
-			modem->demod_fft_count++;
+		else if( tone_detected &&
+		         pskclk_ang_dist(modem->srcfft->ang[modem->demod_fftbin],modem->demod_data_ang) >
+		           ((double)(2*M_PI) / (double)modem->symbol_count) ) {
+			//Phase changed dramatically change prematurely
 			if( modem->verbose ) {
-				printf("      Data measurement: %zu / %zu\n",modem->demod_fft_count,modem->demod_fft_per_halfsym );
+				printf("      Premature angle change from data\n");
+				printf("        %0.1lf -> %0.1lf\n",modem->demod_data_ang,modem->srcfft->ang[modem->demod_fftbin]);
 			}
-			if( modem->demod_fft_count >= modem->demod_fft_per_halfsym ) {
-				modem->demod_state = PSKCLK_DEMOD_BASE_SEARCH;
-				modem->demod_fft_count = 0;
+			if( modem->differential ) {
+				modem->demod_base_ang = modem->demod_data_ang;
+				modem->demod_data_ang = modem->srcfft->ang[modem->demod_fftbin];
+				modem->demod_state = PSKCLK_DEMOD_DATA_ACQUIRE;
 			}
-			else if( tone_detected &&
-			         fabs(modem->srcfft->ang[modem->demod_fftbin] - modem->demod_data_ang) >
-			           ((double)(2*M_PI) / (double)modem->symbol_count) ) {
-				//Phase changed dramatically change prematurely
-				if( modem->verbose ) {
-					printf("      Premature angle change from data\n");
-					printf("        %0.1lf -> %0.1lf\n",modem->demod_data_ang,modem->srcfft->ang[modem->demod_fftbin]);
-				}
+			else {
 				modem->demod_base_ang = modem->srcfft->ang[modem->demod_fftbin];
 				modem->demod_state = PSKCLK_DEMOD_BASE_ACQUIRE;
-				modem->demod_fft_count = 1;
 			}
+			modem->demod_fft_count = 1;
 		}
 	}
+	return 0;
+}
+
+static int pskclk_demodulate_output(pskclk_t *modem, uint8_t **data, size_t *datalen) {
+	size_t   j;
 	
-	*data = modem->demod_data;
-	*datalen = modem->demod_datalen;
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
 	if( modem->verbose ) {
 		printf("  Data: ");
-		for( j=0; j<modem->demod_datalen; j++ ) {
-			printf("%02x ",modem->demod_data[j]);
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
 		}
 		printf("\n");
 	}
 	return 0;
 }
 
+int pskclk_demodulate(pskclk_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t   ii;
+	srcfft_status_t result;
+	
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+	
+	if( modem->verbose ) {
+		printf("ook_demodulate(...)\n");
+	}
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	
+	
+	ii = 0;
+	while( ii < sampleslen ) {
+		result = srcfft_process(modem->srcfft,samples+ii,sampleslen-ii);
+		ii = ii + modem->srcfft->used_samples;
+		if( result == SRCFFT_ERROR ) { 
+			if( modem->verbose ) {
+				printf("  FFT failed\n");
+				return -1; 
+			}
+		}
+		else if( result == SRCFFT_NEED_MORE ) {
+			continue;
+		}
+		if( pskclk_demodulate_result(modem) ) {
+			return -1;
+		}
+	}
+	return pskclk_demodulate_output(modem,data,datalen);
+}
+
+int pskclk_demodulate_fft(pskclk_t *modem, uint8_t **data, size_t *datalen, fftw_complex *spectra, size_t spectralen) {
+	//Same as pskclk_demodulate, but starts from spectra already produced by 
+	//a front-end with the same resampling and FFT size as modem->srcfft
+	size_t   ii;
+	
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !spectra && spectralen ) { return -1; }
+	
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+	
+	for( ii=0; ii<spectralen; ii++ ) {
+		if( srcfft_reduce(modem->srcfft,spectra+ii*srcfft_spectrum_len(modem->srcfft)) == SRCFFT_ERROR ) {
+			if( modem->verbose ) {
+				printf("  FFT failed\n");
+			}
+			return -1;
+		}
+		if( pskclk_demodulate_result(modem) ) {
+			return -1;
+		}
+	}
+	return pskclk_demodulate_output(modem,data,datalen);
+}
+
 #endif //PSKCLK_IMPLEMENTATION
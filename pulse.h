@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __PULSE_H__
+#define __PULSE_H__
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Pulses and filters sampled at samp_per_sym samples per symbol and
+//truncated to span symbols.  Root raised cosine taps have unit energy, so
+//using the same pulse as the receive (matched) filter gives a raised cosine
+//overall.  Gaussian and low pass taps have unit sum (unity gain at DC).
+//Tapers are raised cosine symbol envelopes with unit peak, used to key
+//tones on and off without splatter.
+typedef struct {
+	size_t  samp_per_sym;
+	size_t  span;
+	//Roll-off, BT product or cutoff, depending on the pulse
+	double  shape;
+	size_t  len;
+	double *taps;
+} pulse_t;
+
+pulse_t *pulse_rrc_init(size_t samp_per_sym, size_t span, double rolloff);
+pulse_t *pulse_gaussian_init(size_t samp_per_sym, size_t span, double bt);
+pulse_t *pulse_lowpass_init(size_t samp_per_sym, size_t span, double cutoff);
+pulse_t *pulse_taper_init(size_t samp_per_sym, double rolloff);
+pulse_t *pulse_taper_fit(size_t len, double rolloff);
+void     pulse_taper_add(pulse_t *taper, double *samples, size_t start, double freq, double phase, size_t samplerate);
+void     pulse_destroy(pulse_t *pulse);
+double   pulse_peak(pulse_t *pulse);
+
+#endif //__PULSE_H__
+
+#ifdef PULSE_IMPLEMENTATION
+#undef PULSE_IMPLEMENTATION
+
+static pulse_t *pulse_alloc(size_t samp_per_sym, size_t span, double shape, size_t len) {
+	pulse_t *pulse;
+
+	pulse = (pulse_t*)malloc(sizeof(pulse_t));
+	if( !pulse ) { return 0; }
+	memset(pulse,0,sizeof(pulse_t));
+	pulse->samp_per_sym = samp_per_sym;
+	pulse->span = span;
+	pulse->shape = shape;
+	pulse->len = len;
+	pulse->taps = (double*)malloc(sizeof(double)*pulse->len);
+	if( !pulse->taps ) {
+		pulse_destroy(pulse);
+		return 0;
+	}
+	return pulse;
+}
+
+static void pulse_unit_sum(pulse_t *pulse) {
+	double sum;
+	size_t j;
+
+	sum = 0.0;
+	for( j=0; j<pulse->len; j++ ) {
+		sum = sum + pulse->taps[j];
+	}
+	for( j=0; j<pulse->len; j++ ) {
+		pulse->taps[j] = pulse->taps[j] / sum;
+	}
+}
+
+pulse_t *pulse_rrc_init(size_t samp_per_sym, size_t span, double rolloff) {
+	pulse_t *pulse = 0;
+	double energy;
+	double t;
+	double a;
+	size_t j;
+
+	if( samp_per_sym < 2 ) { goto pulse_rrc_init_error; }
+	if( span < 2 ) { goto pulse_rrc_init_error; }
+	if( rolloff <= 0.0 || rolloff > 1.0 ) { goto pulse_rrc_init_error; }
+
+	pulse = pulse_alloc(samp_per_sym,span,rolloff,span*samp_per_sym+1);
+	if( !pulse ) { goto pulse_rrc_init_error; }
+
+	a = rolloff;
+	energy = 0.0;
+	for( j=0; j<pulse->len; j++ ) {
+		//Time in symbols from the center tap
+		t = ((double)j - (double)(pulse->len-1)/2.0) / (double)samp_per_sym;
+		if( fabs(t) < 1e-9 ) {
+			pulse->taps[j] = 1.0 - a + 4.0*a/M_PI;
+		}
+		else if( fabs(fabs(t) - 1.0/(4.0*a)) < 1e-9 ) {
+			pulse->taps[j] = a/sqrt(2.0) * ((1.0+2.0/M_PI)*sin(M_PI/(4.0*a)) +
+			                                (1.0-2.0/M_PI)*cos(M_PI/(4.0*a)));
+		}
+		else {
+			pulse->taps[j] = (sin(M_PI*t*(1.0-a)) + 4.0*a*t*cos(M_PI*t*(1.0+a))) /
+			                 (M_PI*t*(1.0-(4.0*a*t)*(4.0*a*t)));
+		}
+		energy = energy + pulse->taps[j]*pulse->taps[j];
+	}
+	energy = sqrt(energy);
+	for( j=0; j<pulse->len; j++ ) {
+		pulse->taps[j] = pulse->taps[j] / energy;
+	}
+	return pulse;
+
+	pulse_rrc_init_error:
+	pulse_destroy(pulse);
+	return 0;
+}
+
+pulse_t *pulse_gaussian_init(size_t samp_per_sym, size_t span, double bt) {
+	//Gaussian filter with the given bandwidth-symbol time product, as used
+	//to smooth the frequency steps of GFSK
+	pulse_t *pulse = 0;
+	double sigma;
+	double t;
+	size_t j;
+
+	if( samp_per_sym < 2 ) { goto pulse_gaussian_init_error; }
+	if( span < 1 ) { goto pulse_gaussian_init_error; }
+	if( bt <= 0.0 ) { goto pulse_gaussian_init_error; }
+
+	pulse = pulse_alloc(samp_per_sym,span,bt,span*samp_per_sym+1);
+	if( !pulse ) { goto pulse_gaussian_init_error; }
+
+	//Standard deviation in symbols
+	sigma = sqrt(log(2.0)) / (2.0*M_PI*bt);
+	for( j=0; j<pulse->len; j++ ) {
+		t = ((double)j - (double)(pulse->len-1)/2.0) / (double)samp_per_sym;
+		pulse->taps[j] = exp(-t*t / (2.0*sigma*sigma));
+	}
+	pulse_unit_sum(pulse);
+	return pulse;
+
+	pulse_gaussian_init_error:
+	pulse_destroy(pulse);
+	return 0;
+}
+
+pulse_t *pulse_lowpass_init(size_t samp_per_sym, size_t span, double cutoff) {
+	//Hamming windowed sinc low pass, with the cutoff given in multiples of
+	//the symbol rate
+	pulse_t *pulse = 0;
+	double t;
+	size_t j;
+
+	if( samp_per_sym < 2 ) { goto pulse_lowpass_init_error; }
+	if( span < 1 ) { goto pulse_lowpass_init_error; }
+	if( cutoff <= 0.0 || cutoff >= samp_per_sym/2.0 ) { goto pulse_lowpass_init_error; }
+
+	pulse = pulse_alloc(samp_per_sym,span,cutoff,span*samp_per_sym+1);
+	if( !pulse ) { goto pulse_lowpass_init_error; }
+
+	for( j=0; j<pulse->len; j++ ) {
+		t = ((double)j - (double)(pulse->len-1)/2.0) / (double)samp_per_sym;
+		if( fabs(t) < 1e-9 ) {
+			pulse->taps[j] = 1.0;
+		}
+		else {
+			pulse->taps[j] = sin(2.0*M_PI*cutoff*t) / (2.0*M_PI*cutoff*t);
+		}
+		pulse->taps[j] = pulse->taps[j] * (0.54 + 0.46*cos(2.0*M_PI*t/(double)span));
+	}
+	pulse_unit_sum(pulse);
+	return pulse;
+
+	pulse_lowpass_init_error:
+	pulse_destroy(pulse);
+	return 0;
+}
+
+pulse_t *pulse_taper_init(size_t samp_per_sym, double rolloff) {
+	//Raised cosine envelope (1+rolloff) symbols long: cosine ramps of 
+	//rolloff symbols either side of a flat top.  Envelopes placed a symbol
+	//apart overlap on their ramps and sum to one, so a run of one tone 
+	//keeps a constant amplitude and each edge is centered on the symbol 
+	//boundary.
+	pulse_t *pulse = 0;
+	size_t ramp;
+	size_t j;
+
+	if( samp_per_sym < 2 ) { goto pulse_taper_init_error; }
+	if( rolloff <= 0.0 || rolloff > 1.0 ) { goto pulse_taper_init_error; }
+
+	ramp = (size_t)round(rolloff*samp_per_sym);
+	if( ramp < 1 ) { ramp = 1; }
+	pulse = pulse_alloc(samp_per_sym,1,rolloff,samp_per_sym+ramp);
+	if( !pulse ) { goto pulse_taper_init_error; }
+
+	for( j=0; j<pulse->len; j++ ) {
+		if( j < ramp ) {
+			pulse->taps[j] = 0.5 * (1.0 - cos(M_PI*((double)j+0.5)/(double)ramp));
+		}
+		else if( j >= samp_per_sym ) {
+			pulse->taps[j] = 0.5 * (1.0 + cos(M_PI*((double)(j-samp_per_sym)+0.5)/(double)ramp));
+		}
+		else {
+			pulse->taps[j] = 1.0;
+		}
+	}
+	return pulse;
+
+	pulse_taper_init_error:
+	pulse_destroy(pulse);
+	return 0;
+}
+
+pulse_t *pulse_taper_fit(size_t len, double rolloff) {
+	//The longest taper of the given roll-off that fits in len samples, for
+	//windows and for symbols that must not overlap
+	pulse_t *pulse;
+	size_t samp_per_sym;
+
+	samp_per_sym = (size_t)((double)len / (1.0+rolloff));
+	pulse = pulse_taper_init(samp_per_sym,rolloff);
+	while( pulse && pulse->len > len ) {
+		pulse_destroy(pulse);
+		pulse = pulse_taper_init(--samp_per_sym,rolloff);
+	}
+	return pulse;
+}
+
+void pulse_taper_add(pulse_t *taper, double *samples, size_t start, double freq, double phase, size_t samplerate) {
+	//Add a tone under the taper to samples[start...start+taper->len).  The
+	//tone's phase follows the absolute sample index, so overlapping symbols
+	//of the same tone join without a phase step.
+	size_t j;
+	size_t ii;
+
+	for( j=0; j<taper->len; j++ ) {
+		ii = start + j;
+		samples[ii] = samples[ii] + taper->taps[j] * sin(2*M_PI*freq*ii/samplerate + phase);
+	}
+}
+
+void pulse_destroy(pulse_t *pulse) {
+	if( pulse ) {
+		if( pulse->taps ) { free(pulse->taps); }
+		memset(pulse,0,sizeof(pulse_t));
+		free(pulse);
+	}
+}
+
+double pulse_peak(pulse_t *pulse) {
+	//Center tap; dividing by it gives a transmit pulse with unit peak
+	return pulse->taps[pulse->len/2];
+}
+
+#endif //PULSE_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,710 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __QAM_H__
+#define __QAM_H__
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bitops.h"
+#include "pulse.h"
+#include "symsync.h"
+
+#define QAM_DEFAULT_VERBOSE     0
+#define QAM_DEFAULT_THRESH      0.25
+
+//Square QAM (4, 16 or 64 points) with root raised cosine pulses on a
+//single carrier, for clean links where bits per Hz matter more than
+//robustness.  The receiver front end matches psk (matched filter, and
+//the Gardner timing and framing of symsync.h), followed by a half symbol
+//spaced LMS equalizer and a decision directed phase loop.  A frame is an alternating preamble, a
+//Barker sync word, a known training sequence for the equalizer, a
+//repeated length header and then the data.
+
+//Half symbol spaced, with the center tap on a symbol (4n+1)
+#define QAM_EQ_TAPS        17
+
+typedef struct {
+	int      verbose;
+	size_t   samplerate;
+	size_t   bitrate;
+	double   frequency;
+	size_t   bit_per_symbol;
+	size_t   symbol_count;
+	size_t   levels;
+	double   scale;
+	double   thresh;
+
+	size_t   samp_per_sym;
+	pulse_t *pulse;
+	double  *train;
+	size_t   trainlen;
+
+	double  *mod_samples;
+	size_t   mod_sampleslen;
+	double  *mod_base;
+	size_t   mod_basealloc;
+
+	symsync_frame_t demod_frame;
+	double   demod_detect;
+	double   demod_nco;
+	double  *demod_mix;
+	size_t   demod_mixoff;
+	double  *demod_mf;
+	size_t   demod_mfalloc;
+	size_t   demod_count;
+	double   demod_power;
+
+	double   demod_phase;
+	double   demod_freq;
+	double   demod_prev[2];
+	double   demod_amp;
+	double   demod_eq[2*QAM_EQ_TAPS];
+	double   demod_eqin[2*QAM_EQ_TAPS];
+	double   demod_mse;
+	bitstream_t demod_bits;
+} qam_t;
+
+
+qam_t *qam_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count);
+void   qam_destroy(qam_t *modem);
+int    qam_set_thresh(qam_t *modem, double thresh);
+int    qam_set_verbose(qam_t *modem, int verbose);
+int    qam_set_soft(qam_t *modem, int on);
+int    qam_soft(qam_t *modem, int8_t **soft, size_t *softlen);
+void   qam_printinfo(qam_t *modem);
+int    qam_modulate(qam_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen);
+int    qam_demodulate(qam_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen);
+
+#endif //__QAM_H__
+
+#ifdef QAM_IMPLEMENTATION
+#undef QAM_IMPLEMENTATION
+
+#define QAM_ROLLOFF        0.25
+//Pulse length in symbols
+#define QAM_SPAN           8
+//Peak of the modulated signal is about this times the constellation peak
+#define QAM_AMPLITUDE      0.4
+#define QAM_TRAIN_LEN      64
+//Loop bandwidths (times the symbol period) while training and on data
+#define QAM_TIMING_ACQ     0.05
+#define QAM_TIMING_TRK     0.005
+#define QAM_CARRIER_ACQ    0.05
+#define QAM_CARRIER_TRK    0.01
+//Largest carrier offset the phase loop will follow, in radians per symbol
+#define QAM_MAX_FREQ       (M_PI/8)
+//Normalized LMS step sizes with a reference and on decisions
+#define QAM_EQ_MU_TRAIN    0.5
+#define QAM_EQ_MU_DD       0.05
+//Equalizer output lags the newest symbol by this many symbols
+#define QAM_EQ_DELAY       (QAM_EQ_TAPS/4)
+
+qam_t *qam_init(size_t samplerate, size_t bitrate, double frequency, size_t symbol_count) {
+	qam_t *modem;
+	double sym_freq;
+	uint32_t lfsr;
+	size_t ii;
+
+	//Double check arguments
+	if( !bitrate ) { return 0; }
+	if( symbol_count < 4 ) { return 0; }
+
+	modem = (qam_t*)malloc(sizeof(qam_t));
+	if( !modem ) { goto qam_init_error; }
+	memset(modem,0,sizeof(qam_t));
+	bitstream_init_alloc(&modem->demod_bits);
+
+	modem->verbose = QAM_DEFAULT_VERBOSE;
+	modem->demod_frame.verbose = QAM_DEFAULT_VERBOSE;
+	//The BPSK phase loop before the sync word settles at either 0 or 180
+	//degrees, and the equalizer output is EQ_DELAY symbols behind
+	modem->demod_frame.inverted = 1;
+	modem->demod_frame.delay = QAM_EQ_DELAY;
+
+	modem->samplerate = samplerate;
+	modem->bitrate = bitrate;
+	modem->frequency = frequency;
+
+	//Square constellations only: an even number of bits per symbol
+	modem->bit_per_symbol = 2;
+	while( 1<<modem->bit_per_symbol < symbol_count ) {
+		modem->bit_per_symbol = modem->bit_per_symbol + 2;
+	}
+	if( modem->bit_per_symbol > 6 ) { goto qam_init_error; }
+	modem->symbol_count = (1 << modem->bit_per_symbol);
+	modem->levels = (1 << (modem->bit_per_symbol/2));
+	modem->demod_frame.bit_per_symbol = modem->bit_per_symbol;
+	//Unit average symbol energy, the same as the BPSK preamble
+	modem->scale = 1.0 / sqrt(2.0*(modem->levels*modem->levels-1)/3.0);
+
+	sym_freq = (double)bitrate / (double)modem->bit_per_symbol;
+	modem->samp_per_sym = (size_t)round((double)samplerate / sym_freq);
+	if( modem->samp_per_sym < 4 ) { goto qam_init_error; }
+
+	//The shaped spectrum has to fit between DC and Nyquist
+	sym_freq = (double)samplerate / (double)modem->samp_per_sym;
+	if( frequency < sym_freq*(1.0+QAM_ROLLOFF)/2.0 ) { goto qam_init_error; }
+	if( frequency + sym_freq*(1.0+QAM_ROLLOFF)/2.0 > samplerate/2.0 ) { goto qam_init_error; }
+
+	modem->pulse = pulse_rrc_init(modem->samp_per_sym,QAM_SPAN,QAM_ROLLOFF);
+	if( !modem->pulse ) { goto qam_init_error; }
+
+	//Pseudo random QPSK training symbols
+	modem->trainlen = QAM_TRAIN_LEN;
+	modem->demod_frame.trainlen = modem->trainlen;
+	modem->train = (double*)malloc(sizeof(double)*2*modem->trainlen);
+	if( !modem->train ) { goto qam_init_error; }
+	lfsr = 0xACE1;
+	for( ii=0; ii<2*modem->trainlen; ii++ ) {
+		lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+		modem->train[ii] = (lfsr & 1) ? M_SQRT1_2 : -M_SQRT1_2;
+	}
+
+	modem->demod_mix = (double*)malloc(sizeof(double)*2*modem->pulse->len);
+	if( !modem->demod_mix ) { goto qam_init_error; }
+	modem->demod_mfalloc = symsync_ring_len(modem->samp_per_sym);
+	modem->demod_mf = (double*)malloc(sizeof(double)*2*modem->demod_mfalloc);
+	if( !modem->demod_mf ) { goto qam_init_error; }
+
+	if( qam_set_thresh(modem,QAM_DEFAULT_THRESH) ) {
+		goto qam_init_error;
+	}
+
+	return modem;
+
+	qam_init_error:
+	qam_destroy(modem);
+	return 0;
+}
+
+void qam_destroy(qam_t *modem) {
+	if( modem ) {
+		if( modem->pulse ) { pulse_destroy(modem->pulse); }
+		if( modem->train ) { free(modem->train); }
+		if( modem->mod_samples ) { free(modem->mod_samples); }
+		if( modem->mod_base ) { free(modem->mod_base); }
+		if( modem->demod_mix ) { free(modem->demod_mix); }
+		if( modem->demod_mf ) { free(modem->demod_mf); }
+		bitstream_destroy(&modem->demod_bits);
+		memset(modem,0,sizeof(qam_t));
+		free(modem);
+	}
+}
+
+static void qam_demodulate_reset(qam_t *modem) {
+	memset(modem->demod_mix,0,sizeof(double)*2*modem->pulse->len);
+	memset(modem->demod_mf,0,sizeof(double)*2*modem->demod_mfalloc);
+	modem->demod_mixoff = 0;
+	modem->demod_count = 0;
+	modem->demod_nco = 0.0;
+	modem->demod_power = 0.0;
+	modem->demod_frame.state = SYMSYNC_SEARCH;
+}
+
+static void qam_demodulate_sample(qam_t *modem, double x) {
+	//Mix one sample down to I/Q and run it through the matched filter
+	double *mix;
+	double *mf;
+	double i;
+	double q;
+	size_t j;
+	size_t off;
+
+	mix = modem->demod_mix + 2*modem->demod_mixoff;
+	mix[0] =  2.0*x*cos(modem->demod_nco);
+	mix[1] = -2.0*x*sin(modem->demod_nco);
+	modem->demod_nco = modem->demod_nco + 2*M_PI*modem->frequency/modem->samplerate;
+	if( modem->demod_nco > 2*M_PI ) {
+		modem->demod_nco = modem->demod_nco - 2*M_PI;
+	}
+
+	if( ++modem->demod_mixoff >= modem->pulse->len ) { modem->demod_mixoff = 0; }
+	i = 0.0;
+	q = 0.0;
+	off = modem->demod_mixoff;
+	for( j=0; j<modem->pulse->len; j++ ) {
+		i = i + modem->pulse->taps[j]*modem->demod_mix[2*off];
+		q = q + modem->pulse->taps[j]*modem->demod_mix[2*off+1];
+		if( ++off >= modem->pulse->len ) { off = 0; }
+	}
+
+	mf = modem->demod_mf + 2*(modem->demod_count & (modem->demod_mfalloc-1));
+	mf[0] = i;
+	mf[1] = q;
+	modem->demod_count++;
+
+	modem->demod_power = modem->demod_power + (i*i + q*q - modem->demod_power) / (2.0*modem->samp_per_sym);
+}
+
+int qam_set_thresh(qam_t *modem, double thresh) {
+	//Detection level as a fraction of the matched filter power of a clean
+	//preamble, measured by running one through the receiver
+	double *samples;
+	size_t  sampleslen;
+	uint8_t dummy = 0;
+	double  power;
+	size_t  count;
+	size_t  ii;
+
+	if( !modem ) { return -1; }
+	if( thresh <= 0.0 || thresh > 1.0 ) { return -1; }
+
+	if( qam_modulate(modem,&samples,&sampleslen,&dummy,0) ) { return -1; }
+	qam_demodulate_reset(modem);
+	power = 0.0;
+	count = 0;
+	for( ii=0; ii<sampleslen; ii++ ) {
+		qam_demodulate_sample(modem,samples[ii]);
+		if( ii >= modem->pulse->len && ii+modem->pulse->len < sampleslen ) {
+			power = power + modem->demod_power;
+			count++;
+		}
+	}
+	qam_demodulate_reset(modem);
+	if( !count ) { return -1; }
+
+	modem->thresh = thresh;
+	modem->demod_detect = thresh * power / count;
+	return 0;
+}
+
+int qam_set_verbose(qam_t *modem, int verbose) {
+	if( !modem ) { return -1; }
+	modem->verbose = verbose;
+	modem->demod_frame.verbose = verbose;
+	return 0;
+}
+
+int qam_set_soft(qam_t *modem, int on) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_enable(&modem->demod_bits,on);
+}
+
+int qam_soft(qam_t *modem, int8_t **soft, size_t *softlen) {
+	if( !modem ) { return -1; }
+	return bitstream_soft_output(&modem->demod_bits,soft,softlen);
+}
+
+void qam_printinfo(qam_t *modem) {
+	printf("QAM Modem:\n");
+	printf("  Verbose                  : %d\n",modem->verbose);
+	printf("  Samplerate               : %zu\n",modem->samplerate);
+	printf("  Bitrate                  : %zu bps\n",modem->bitrate);
+	printf("  Actual Bitrate           : %0.1lf bps\n",(double)modem->samplerate*modem->bit_per_symbol/modem->samp_per_sym);
+	printf("  Frequency                : %lf\n",modem->frequency);
+	printf("  Symbol Count             : %zu\n",modem->symbol_count);
+	printf("  Samples per Symbol       : %zu\n",modem->samp_per_sym);
+	printf("  Bandwidth                : %0.1lf Hz\n",(double)modem->samplerate/modem->samp_per_sym*(1.0+QAM_ROLLOFF));
+	printf("  Equalizer Taps           : %d\n",QAM_EQ_TAPS);
+	printf("  Detect Power             : %lf\n",modem->demod_detect);
+}
+
+static double qam_level(qam_t *modem, int bits) {
+	//Gray coded amplitude on one axis
+	int g = bits ^ (bits >> 1);
+	return modem->scale * (2.0*g - (double)(modem->levels-1));
+}
+
+static int qam_slice(qam_t *modem, double x, double *level) {
+	//Nearest amplitude on one axis, and the bits it stands for
+	int g;
+	int bits;
+	int shift;
+
+	g = (int)round((x/modem->scale + (double)(modem->levels-1)) / 2.0);
+	if( g < 0 ) { g = 0; }
+	if( g > (int)modem->levels-1 ) { g = (int)modem->levels-1; }
+	*level = modem->scale * (2.0*g - (double)(modem->levels-1));
+	bits = g;
+	for( shift=1; shift<8; shift<<=1 ) {
+		bits = bits ^ (bits >> shift);
+	}
+	return bits;
+}
+
+static void qam_slice_llr(qam_t *modem, double x, double *llr) {
+	//Bit confidences on one axis, from the squared distance to each 
+	//amplitude, in units of the margin a clean symbol has
+	double metric[8];
+	double d;
+	int bits;
+
+	for( bits=0; bits<(int)modem->levels; bits++ ) {
+		d = x - qam_level(modem,bits);
+		metric[bits] = -d*d;
+	}
+	bitstream_soft_demap(metric,modem->levels,modem->bit_per_symbol/2,
+	                     4.0*modem->scale*modem->scale,llr);
+}
+
+static void qam_modulate_symbol(qam_t *modem, size_t idx, double re, double im) {
+	//Add one shaped symbol to the I/Q baseband
+	size_t j;
+	double g;
+	double *base;
+
+	base = modem->mod_base + 2*idx*modem->samp_per_sym;
+	g = 1.0 / pulse_peak(modem->pulse);
+	for( j=0; j<modem->pulse->len; j++ ) {
+		base[2*j]   = base[2*j]   + re*modem->pulse->taps[j]*g;
+		base[2*j+1] = base[2*j+1] + im*modem->pulse->taps[j]*g;
+	}
+}
+
+int qam_modulate(qam_t *modem, double **samples, size_t *sampleslen, uint8_t *data, size_t datalen) {
+	size_t symbol_idx;
+	size_t symbol_count;
+	size_t data_count;
+	bitstream_t bits;
+	size_t ii;
+	size_t half;
+	size_t mod_sampleslen;
+	double *mod_samples;
+	double *tmp;
+	double ang;
+	double x;
+	int sym;
+
+	if( !modem ) { return -1; }
+	if( !samples ) { return -1; }
+	if( !sampleslen ) { return -1; }
+	if( !data ) { return -1; }
+	if( datalen >= (1 << SYMSYNC_HEADER_BITS) ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("qam_modulate(...):\n");
+		printf("  Data: ");
+		for( ii=0; ii<datalen; ii++ ) {
+			printf("%02x ",data[ii]);
+		}
+		printf("\n");
+	}
+
+	data_count = (datalen*8 + modem->bit_per_symbol - 1) / modem->bit_per_symbol;
+	symbol_count = SYMSYNC_SYNC_LEN + modem->trainlen + SYMSYNC_HEADER_LEN + data_count;
+	if( modem->verbose ) {
+		printf("  Symbol count: %zu\n",symbol_count);
+	}
+
+	//Room for the pulse tails at both ends
+	mod_sampleslen = (symbol_count+QAM_SPAN)*modem->samp_per_sym+1;
+	mod_samples = (double*)realloc(modem->mod_samples,sizeof(double)*mod_sampleslen);
+	if( !mod_samples ) {
+		goto qam_modulate_error;
+	}
+	modem->mod_samples = mod_samples;
+	modem->mod_sampleslen = mod_sampleslen;
+	if( modem->mod_basealloc < mod_sampleslen ) {
+		tmp = (double*)realloc(modem->mod_base,sizeof(double)*2*mod_sampleslen);
+		if( !tmp ) {
+			goto qam_modulate_error;
+		}
+		modem->mod_base = tmp;
+		modem->mod_basealloc = mod_sampleslen;
+	}
+	memset(modem->mod_base,0,sizeof(double)*2*mod_sampleslen);
+
+	symbol_idx = 0;
+	for( ii=0; ii<SYMSYNC_SYNC_LEN; ii++ ) {
+		qam_modulate_symbol(modem,symbol_idx++,symsync_sync_bit(ii) ? 1.0 : -1.0,0.0);
+	}
+	for( ii=0; ii<modem->trainlen; ii++ ) {
+		qam_modulate_symbol(modem,symbol_idx++,modem->train[2*ii],modem->train[2*ii+1]);
+	}
+	for( ii=0; ii<SYMSYNC_HEADER_LEN; ii++ ) {
+		sym = symsync_header_bit(datalen,ii);
+		qam_modulate_symbol(modem,symbol_idx++,sym ? 1.0 : -1.0,0.0);
+	}
+	bitstream_init(&bits, data, datalen);
+	half = modem->bit_per_symbol/2;
+	for( ii=0; ii<data_count; ii++ ) {
+		sym = bitstream_read(&bits, modem->bit_per_symbol);
+		qam_modulate_symbol(modem,symbol_idx++,
+		                    qam_level(modem,sym >> half),
+		                    qam_level(modem,sym & ((1 << half)-1)));
+	}
+
+	for( ii=0; ii<mod_sampleslen; ii++ ) {
+		ang = 2*M_PI*modem->frequency*ii/modem->samplerate;
+		x = QAM_AMPLITUDE*(modem->mod_base[2*ii]*cos(ang) - modem->mod_base[2*ii+1]*sin(ang));
+		if( x > 1.0 ) {
+			x = 1.0;
+		}
+		else if( x < -1.0 ) {
+			x = -1.0;
+		}
+		mod_samples[ii] = x;
+	}
+
+	*samples = mod_samples;
+	*sampleslen = mod_sampleslen;
+	return 0;
+
+	qam_modulate_error:
+	*samples = 0;
+	*sampleslen = 0;
+	return -1;
+}
+
+
+static void qam_demodulate_eq(qam_t *modem, double *z, double *d, int adapt, double mu) {
+	//Equalizer output z (after the phase loop) for the symbol EQ_DELAY
+	//back.  If adapt is set, d is the wanted point (decided if d is null)
+	//and the taps and phase loop are moved toward it.
+	double *w = modem->demod_eq;
+	double *x = modem->demod_eqin;
+	double y[2];
+	double dd[2];
+	double e[2];
+	double c;
+	double s;
+	double energy;
+	double err;
+	double kp;
+	double ki;
+	size_t k;
+
+	y[0] = 0.0;
+	y[1] = 0.0;
+	energy = 0.0;
+	for( k=0; k<QAM_EQ_TAPS; k++ ) {
+		y[0] = y[0] + w[2*k]*x[2*k] - w[2*k+1]*x[2*k+1];
+		y[1] = y[1] + w[2*k]*x[2*k+1] + w[2*k+1]*x[2*k];
+		energy = energy + x[2*k]*x[2*k] + x[2*k+1]*x[2*k+1];
+	}
+	c = cos(modem->demod_phase);
+	s = sin(modem->demod_phase);
+	z[0] = y[0]*c + y[1]*s;
+	z[1] = y[1]*c - y[0]*s;
+	if( !adapt ) { return; }
+
+	if( d ) {
+		dd[0] = d[0];
+		dd[1] = d[1];
+	}
+	else {
+		qam_slice(modem,z[0],&dd[0]);
+		qam_slice(modem,z[1],&dd[1]);
+	}
+
+	//Phase loop on the angle between the output and the wanted point
+	err = (z[1]*dd[0] - z[0]*dd[1]) / (dd[0]*dd[0] + dd[1]*dd[1]);
+	symsync_loop_gains(modem->demod_frame.state == SYMSYNC_DATA ? QAM_CARRIER_TRK : QAM_CARRIER_ACQ,&kp,&ki);
+	modem->demod_freq = modem->demod_freq + ki*err;
+	modem->demod_phase = modem->demod_phase + kp*err + modem->demod_freq;
+
+	//Normalized LMS, with the error rotated back to the equalizer input
+	e[0] = (dd[0]-z[0])*c - (dd[1]-z[1])*s;
+	e[1] = (dd[1]-z[1])*c + (dd[0]-z[0])*s;
+	modem->demod_mse = modem->demod_mse + ((dd[0]-z[0])*(dd[0]-z[0]) + (dd[1]-z[1])*(dd[1]-z[1]) - modem->demod_mse) / 16.0;
+	if( energy <= 0.0 ) { return; }
+	mu = mu / energy;
+	for( k=0; k<QAM_EQ_TAPS; k++ ) {
+		//w += mu*e*conj(x)
+		w[2*k]   = w[2*k]   + mu*(e[0]*x[2*k]   + e[1]*x[2*k+1]);
+		w[2*k+1] = w[2*k+1] + mu*(e[1]*x[2*k]   - e[0]*x[2*k+1]);
+	}
+}
+
+static int qam_demodulate_decide(void *arg, symsync_state_t state, size_t idx, double *soft) {
+	//Before the sync word, a BPSK Costas loop on the symbol just timed 
+	//(demod_prev, now that Gardner is done with it); after it, the 
+	//equalizer output
+	qam_t *modem = (qam_t*)arg;
+	double *cur;
+	double z[2];
+	double level[2];
+	double err;
+	double mag;
+	double kp;
+	double ki;
+
+	if( state == SYMSYNC_SYNC ) {
+		cur = modem->demod_prev;
+		mag = cur[0]*cur[0] + cur[1]*cur[1];
+		z[0] = cur[0]*cos(modem->demod_phase) + cur[1]*sin(modem->demod_phase);
+		z[1] = cur[1]*cos(modem->demod_phase) - cur[0]*sin(modem->demod_phase);
+		err = 0.0;
+		if( mag > 0.0 ) {
+			err = (z[0] >= 0.0 ? z[1] : -z[1]) / sqrt(mag);
+		}
+		symsync_loop_gains(QAM_CARRIER_ACQ,&kp,&ki);
+		modem->demod_freq = modem->demod_freq + ki*err;
+		//Half a turn per symbol looks the same as the alternating
+		//preamble, so keep the loop well away from it
+		if( modem->demod_freq > QAM_MAX_FREQ ) {
+			modem->demod_freq = QAM_MAX_FREQ;
+		}
+		else if( modem->demod_freq < -QAM_MAX_FREQ ) {
+			modem->demod_freq = -QAM_MAX_FREQ;
+		}
+		modem->demod_phase = modem->demod_phase + kp*err + modem->demod_freq;
+		soft[0] = z[0] / sqrt(modem->demod_amp);
+		return 0;
+	}
+
+	if( state == SYMSYNC_TRAINING ) {
+		qam_demodulate_eq(modem,z,modem->train+2*idx,1,QAM_EQ_MU_TRAIN);
+		if( idx+1 == modem->trainlen && modem->verbose ) {
+			printf("  Trained, error %0.4lf\n",modem->demod_mse);
+		}
+		return 0;
+	}
+
+	if( state == SYMSYNC_HEADER ) {
+		qam_demodulate_eq(modem,z,0,0,0.0);
+		level[0] = z[0] >= 0.0 ? 1.0 : -1.0;
+		level[1] = 0.0;
+		qam_demodulate_eq(modem,z,level,1,QAM_EQ_MU_DD);
+		return level[0] > 0.0;
+	}
+
+	qam_demodulate_eq(modem,z,0,1,QAM_EQ_MU_DD);
+	if( modem->demod_bits.softon ) {
+		qam_slice_llr(modem,z[0],soft);
+		qam_slice_llr(modem,z[1],soft+modem->bit_per_symbol/2);
+	}
+	return (qam_slice(modem,z[0],&level[0]) << (modem->bit_per_symbol/2)) |
+	        qam_slice(modem,z[1],&level[1]);
+}
+
+static int qam_demodulate_symbol(qam_t *modem) {
+	//One symbol at the frame's symbol instant: timing, then the framing
+	double cur[2];
+	double mid[2];
+	double err;
+	double mag;
+	size_t j;
+	int lost;
+	int ret;
+
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,2,modem->demod_frame.time,cur);
+	symsync_interp(modem->demod_mf,modem->demod_mfalloc,2,modem->demod_frame.time-modem->samp_per_sym/2.0,mid);
+	mag = cur[0]*cur[0] + cur[1]*cur[1];
+	modem->demod_amp = modem->demod_amp + (mag - modem->demod_amp) / 8.0;
+
+	//Gardner works on the matched filter output, before the equalizer
+	err = ((modem->demod_prev[0]-cur[0])*mid[0] + (modem->demod_prev[1]-cur[1])*mid[1]) / modem->demod_amp;
+	modem->demod_prev[0] = cur[0];
+	modem->demod_prev[1] = cur[1];
+	symsync_frame_timing(&modem->demod_frame,err,QAM_TIMING_ACQ,QAM_TIMING_TRK,modem->samp_per_sym);
+
+	//Half symbol spaced equalizer input
+	memmove(modem->demod_eqin,modem->demod_eqin+4,sizeof(double)*2*(QAM_EQ_TAPS-2));
+	modem->demod_eqin[2*QAM_EQ_TAPS-4] = mid[0];
+	modem->demod_eqin[2*QAM_EQ_TAPS-3] = mid[1];
+	modem->demod_eqin[2*QAM_EQ_TAPS-2] = cur[0];
+	modem->demod_eqin[2*QAM_EQ_TAPS-1] = cur[1];
+
+	//The symbol being decided is in the middle of the equalizer, so look
+	//at the power there rather than at the newest samples (the equalizer
+	//only fills up after the sync word)
+	lost = 0;
+	if( modem->demod_frame.state != SYMSYNC_SYNC ) {
+		mag = 0.0;
+		for( j=0; j<2*QAM_EQ_TAPS; j++ ) {
+			mag = mag + modem->demod_eqin[j]*modem->demod_eqin[j];
+		}
+		lost = mag < QAM_EQ_TAPS*modem->demod_detect/2.0;
+	}
+
+	ret = symsync_frame_symbol(&modem->demod_frame,&modem->demod_bits,lost,qam_demodulate_decide,modem);
+	if( ret < 0 ) {
+		return -1;
+	}
+	if( ret > 0 ) {
+		if( modem->demod_frame.corr < 0.0 ) {
+			modem->demod_phase = modem->demod_phase + M_PI;
+		}
+		//Hand the phase and gain to the equalizer's center tap; the
+		//loop keeps the frequency it has learned
+		memset(modem->demod_eq,0,sizeof(modem->demod_eq));
+		modem->demod_eq[2*(QAM_EQ_TAPS/2)]   =  cos(modem->demod_phase) / sqrt(modem->demod_amp);
+		modem->demod_eq[2*(QAM_EQ_TAPS/2)+1] = -sin(modem->demod_phase) / sqrt(modem->demod_amp);
+		modem->demod_phase = 0.0;
+		modem->demod_mse = 0.0;
+	}
+	return 0;
+}
+
+int qam_demodulate(qam_t *modem, uint8_t **data, size_t *datalen, double *samples, size_t sampleslen) {
+	size_t ii;
+	size_t j;
+
+	if( !modem ) { return -1; }
+	if( !data ) { return -1; }
+	if( !datalen ) { return -1; }
+	if( !samples ) { return -1; }
+
+	if( modem->verbose ) {
+		printf("qam_demodulate(...)\n");
+	}
+
+	bitstream_rewind(&modem->demod_bits);
+	*data = modem->demod_bits.data;
+	*datalen = 0;
+
+	for( ii=0; ii<sampleslen; ii++ ) {
+		qam_demodulate_sample(modem,samples[ii]);
+
+		if( modem->demod_frame.state == SYMSYNC_SEARCH ) {
+			if( modem->demod_power >= modem->demod_detect ) {
+				symsync_frame_start(&modem->demod_frame,(double)modem->demod_count + modem->samp_per_sym);
+				modem->demod_phase = 0.0;
+				modem->demod_freq = 0.0;
+				modem->demod_prev[0] = 0.0;
+				modem->demod_prev[1] = 0.0;
+				modem->demod_amp = modem->demod_power;
+				memset(modem->demod_eqin,0,sizeof(modem->demod_eqin));
+			}
+			continue;
+		}
+
+		if( symsync_frame_ready(&modem->demod_frame,modem->demod_count) ) {
+			if( qam_demodulate_symbol(modem) ) {
+				return -1;
+			}
+		}
+	}
+
+	if( bitstream_drain(&modem->demod_bits) ) { return -1; }
+	*data = modem->demod_bits.data;
+	*datalen = modem->demod_bits.byte_idx;
+	if( modem->verbose ) {
+		printf("  Data: ");
+		for( j=0; j<*datalen; j++ ) {
+			printf("%02x ",(*data)[j]);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+#endif //QAM_IMPLEMENTATION
\ No newline at end of file
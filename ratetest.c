@@ -41,7 +41,19 @@
 #define FSK_IMPLEMENTATION
 #define OOK_IMPLEMENTATION
 #define PSKCLK_IMPLEMENTATION
+#define TCM_IMPLEMENTATION
 #define CORR_IMPLEMENTATION
+#define OFDM_IMPLEMENTATION
+#define PULSE_IMPLEMENTATION
+#define SYMSYNC_IMPLEMENTATION
+#define PSK_IMPLEMENTATION
+#define QAM_IMPLEMENTATION
+#define NCFSK_IMPLEMENTATION
+#define CPFSK_IMPLEMENTATION
+#define CSS_IMPLEMENTATION
+#define CONV_IMPLEMENTATION
+#define RS_IMPLEMENTATION
+#define CRC_IMPLEMENTATION
 #define PKT_IMPLEMENTATION
 #define AUDIOMODEM_IMPLEMENTATION
 #include "audiomodem.h"
@@ -53,9 +65,10 @@
 #define DEFAULT_TEST_SIZE 512
 #define DEFAULT_NOISE_AMPLITUDE 0
 
-typedef enum {OPT_NONE,OPT_FSK,OPT_FSKCLK,OPT_OOK,OPT_PSKCLK,OPT_CORRFSK,OPT_CORRPSK,OPT_CORRFPSKCLK} modemopt_t;
-
 void usage(char* cmd) {
+	const audiomodem_ops_t **ops;
+	size_t opslen;
+	size_t j;
 	char* filename = cmd+strlen(cmd);
 	while( filename > cmd ) {
 		if( *(filename-1) == '/' ) {
@@ -63,8 +76,13 @@ void usage(char* cmd) {
 		}
 		filename--;
 	}
-	printf("Usage: %s [-h] [-v] [-p] [-fsk | -fskclk | -ook | -pskclk | -cfsk | -cpsk | -cfpsk]\n",filename);
-	printf("  [-s samplerate] [-r bitrate] [-bw bandwidth] [-c symbol_count] [-f frequency]\n");
+	opslen = audiomodem_registered(&ops);
+	printf("Usage: %s [-h] [-v] [-p [-e fec]] [",filename);
+	for( j=0; j<opslen; j++ ) {
+		printf("%s-%s",j ? " | " : "",ops[j]->name);
+	}
+	printf("]\n");
+	printf("  [-s samplerate] [-r bitrate] [-bw bandwidth] [-c symbol_count] [-f frequency] [-ro rolloff]\n");
 	printf("  [-z test_size] [-n noise_amplitude]\n");
 	printf("\n");
 	printf("Defaults:\n");
@@ -73,6 +91,8 @@ void usage(char* cmd) {
 	printf("  bandwidth      : %d\n",DEFAULT_BANDWIDTH);
 	printf("  symbol_count     : %d\n",DEFAULT_SYMBOL_COUNT);
 	printf("  frequency      : %d\n",DEFAULT_FREQUENCY);
+	printf("  rolloff        : none (default symbol envelope)\n");
+	printf("  fec            : none (conv12, conv23, conv34, rs)\n");
 	printf("  test_size      : %d\n",DEFAULT_TEST_SIZE);
 	printf("  noise_amplitude: %0.1lf\n",(double)DEFAULT_NOISE_AMPLITUDE);
 	printf("\n");
@@ -93,7 +113,9 @@ int main(int argc, char** argv) {
 	size_t next_bitrate;
 	int verbose = 0;
 	int use_pkt = 0;
-	modemopt_t modemopt = OPT_NONE;
+	pkt_fec_t fec = PKT_FEC_NONE;
+	const audiomodem_ops_t *modemops = 0;
+	audiomodem_config_t config;
 	size_t samplerate = 0;
 	size_t bitrate = 0;
 	size_t bandwidth = 0;
@@ -101,6 +123,7 @@ int main(int argc, char** argv) {
 	size_t frequency = 0;
 	size_t test_size = 0;
 	double noise_amp = -1;
+	double rolloff = 0.0;
 	int i = 1;
 	size_t ii;
 	struct timespec ts;
@@ -118,47 +141,26 @@ int main(int argc, char** argv) {
 			}
 			use_pkt = 1;
 		}
-		else if( !strcmp(argv[i],"-fsk") ) {
-			if( modemopt != OPT_NONE ) {
+		else if( !strcmp(argv[i],"-e") ) {
+			++i;
+			if( i >= argc || fec != PKT_FEC_NONE ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_FSK;
-		}
-		else if( !strcmp(argv[i],"-fskclk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			if( !strcmp(argv[i],"conv12") ) {
+				fec = PKT_FEC_CONV_1_2;
 			}
-			modemopt = OPT_FSKCLK;
-		}
-		else if( !strcmp(argv[i],"-ook") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"conv23") ) {
+				fec = PKT_FEC_CONV_2_3;
 			}
-			modemopt = OPT_OOK;
-		}
-		else if( !strcmp(argv[i],"-pskclk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"conv34") ) {
+				fec = PKT_FEC_CONV_3_4;
 			}
-			modemopt = OPT_PSKCLK;
-		}
-		else if( !strcmp(argv[i],"-cfsk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
+			else if( !strcmp(argv[i],"rs") ) {
+				fec = PKT_FEC_RS;
 			}
-			modemopt = OPT_CORRFSK;
-		}
-		else if( !strcmp(argv[i],"-cpsk") ) {
-			if( modemopt != OPT_NONE ) {
-				usage(argv[0]);
-			}
-			modemopt = OPT_CORRPSK;
-		}
-		else if( !strcmp(argv[i],"-cfpsk") ) {
-			if( modemopt != OPT_NONE ) {
+			else if( strcmp(argv[i],"none") ) {
 				usage(argv[0]);
 			}
-			modemopt = OPT_CORRFPSKCLK;
 		}
 		else if( !strcmp(argv[i],"-s") ) {
 			++i;
@@ -220,6 +222,16 @@ int main(int argc, char** argv) {
 				usage(argv[0]);
 			}
 		}
+		else if( !strcmp(argv[i],"-ro") ) {
+			++i;
+			if( i >= argc || rolloff > 0.0 ) {
+				usage(argv[0]);
+			}
+			rolloff = strtod(argv[i],0);
+			if( rolloff <= 0.0 || rolloff > 1.0 ) {
+				usage(argv[0]);
+			}
+		}
 		else if( !strcmp(argv[i],"-n") ) {
 			++i;
 			if( i >= argc || noise_amp >= 0 ) {
@@ -230,13 +242,22 @@ int main(int argc, char** argv) {
 				usage(argv[0]);
 			}
 		}
+		else if( argv[i][0] == '-' && audiomodem_lookup(argv[i]+1) ) {
+			if( modemops ) {
+				usage(argv[0]);
+			}
+			modemops = audiomodem_lookup(argv[i]+1);
+		}
 		else {
 			usage(argv[0]);
 		}
 		++i;
 	}
 
-	if( modemopt == OPT_NONE ) {
+	if( !modemops ) {
+		usage(argv[0]);
+	}
+	if( fec != PKT_FEC_NONE && !use_pkt ) {
 		usage(argv[0]);
 	}
 	if( !bitrate ) {
@@ -304,36 +325,29 @@ int main(int argc, char** argv) {
 	
 	for(;;) {
 		printf("Testing %zu bps  ",bitrate);
-		if( modemopt == OPT_FSKCLK ) {
-			modem = audiomodem_fskclk_init(samplerate, bitrate, bandwidth, symbol_count);
-		}
-		else if( modemopt == OPT_FSK ) {
-			modem = audiomodem_fsk_init(samplerate, bitrate, bandwidth, symbol_count);
-		}
-		else if( modemopt == OPT_OOK ) {
-			modem = audiomodem_ook_init(samplerate,bitrate,bandwidth,frequency);
-		}
-		else if( modemopt == OPT_PSKCLK ) {
-			modem = audiomodem_pskclk_init(samplerate,bitrate,bandwidth,frequency,symbol_count);
-		}
-		else if( modemopt == OPT_CORRFSK ) {
-			modem = audiomodem_corrfsk_init(samplerate, bitrate, bandwidth, symbol_count);
-		}
-		else if( modemopt == OPT_CORRPSK ) {
-			modem = audiomodem_corrpsk_init(samplerate,bitrate,frequency,symbol_count);
-		}
-		else if( modemopt == OPT_CORRFPSKCLK ) {
-			modem = audiomodem_corrfpsk_init(samplerate, bitrate, bandwidth, symbol_count);
-		}
+		config.samplerate = samplerate;
+		config.bitrate = bitrate;
+		config.bandwidth = bandwidth;
+		config.freq = frequency;
+		config.symbol_count = symbol_count;
+		modem = audiomodem_ops_init(modemops,&config);
 		if( !modem ) {
 			printf("Create modem ");
 			goto bitrate_failed;
 		}
+		if( rolloff > 0.0 && audiomodem_set_pulse(modem,rolloff) ) {
+			printf("Set pulse shaping ");
+			goto bitrate_failed;
+		}
 		if( use_pkt ) {
 			if( audiomodem_pkt_init(modem) ) {
 				printf("Create packet framer ");
 				goto bitrate_failed;
 			}
+			if( pkt_set_fec(modem->pkt,fec) ) {
+				printf("Set packet fec ");
+				goto bitrate_failed;
+			}
 		}
 		if( verbose ) {
 			audiomodem_printinfo(modem);
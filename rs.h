@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __RS_H__
+#define __RS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Reed-Solomon over GF(256) (primitive polynomial x^8+x^4+x^3+x^2+1), 
+//codewords of up to 255 bytes with nsym parity bytes (first root alpha^0)
+#define RS_POLY         0x11D
+#define RS_MAX_LEN      255
+
+typedef struct {
+	size_t  nsym;
+	uint8_t genpoly[RS_MAX_LEN+1];
+} rs_t;
+
+rs_t *rs_init(size_t nsym);
+void  rs_destroy(rs_t *rs);
+int   rs_encode(rs_t *rs, uint8_t *parity, uint8_t *data, size_t datalen);
+int   rs_decode(rs_t *rs, uint8_t *codeword, size_t len);
+void  rs_interleave(uint8_t *dst, uint8_t *src, size_t len, size_t ncw);
+void  rs_deinterleave(uint8_t *dst, uint8_t *src, size_t len, size_t ncw);
+
+#endif //__RS_H__
+
+#ifdef RS_IMPLEMENTATION
+#undef RS_IMPLEMENTATION
+
+//GF(256) exp and log tables for RS_POLY.  The exp table is doubled so that
+//the sum of two logs never needs a modulo.  They are constant so that 
+//codecs can be created from any thread.
+static const uint8_t rs_exp[512] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26,
+	0x4c, 0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0,
+	0x9d, 0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23,
+	0x46, 0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1,
+	0x5f, 0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0,
+	0xfd, 0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2,
+	0xd9, 0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce,
+	0x81, 0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc,
+	0x85, 0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54,
+	0xa8, 0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73,
+	0xe6, 0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff,
+	0xe3, 0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41,
+	0x82, 0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6,
+	0x51, 0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09,
+	0x12, 0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16,
+	0x2c, 0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01,
+	0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1d, 0x3a, 0x74, 0xe8, 0xcd, 0x87, 0x13, 0x26, 0x4c,
+	0x98, 0x2d, 0x5a, 0xb4, 0x75, 0xea, 0xc9, 0x8f, 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0xc0, 0x9d,
+	0x27, 0x4e, 0x9c, 0x25, 0x4a, 0x94, 0x35, 0x6a, 0xd4, 0xb5, 0x77, 0xee, 0xc1, 0x9f, 0x23, 0x46,
+	0x8c, 0x05, 0x0a, 0x14, 0x28, 0x50, 0xa0, 0x5d, 0xba, 0x69, 0xd2, 0xb9, 0x6f, 0xde, 0xa1, 0x5f,
+	0xbe, 0x61, 0xc2, 0x99, 0x2f, 0x5e, 0xbc, 0x65, 0xca, 0x89, 0x0f, 0x1e, 0x3c, 0x78, 0xf0, 0xfd,
+	0xe7, 0xd3, 0xbb, 0x6b, 0xd6, 0xb1, 0x7f, 0xfe, 0xe1, 0xdf, 0xa3, 0x5b, 0xb6, 0x71, 0xe2, 0xd9,
+	0xaf, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0d, 0x1a, 0x34, 0x68, 0xd0, 0xbd, 0x67, 0xce, 0x81,
+	0x1f, 0x3e, 0x7c, 0xf8, 0xed, 0xc7, 0x93, 0x3b, 0x76, 0xec, 0xc5, 0x97, 0x33, 0x66, 0xcc, 0x85,
+	0x17, 0x2e, 0x5c, 0xb8, 0x6d, 0xda, 0xa9, 0x4f, 0x9e, 0x21, 0x42, 0x84, 0x15, 0x2a, 0x54, 0xa8,
+	0x4d, 0x9a, 0x29, 0x52, 0xa4, 0x55, 0xaa, 0x49, 0x92, 0x39, 0x72, 0xe4, 0xd5, 0xb7, 0x73, 0xe6,
+	0xd1, 0xbf, 0x63, 0xc6, 0x91, 0x3f, 0x7e, 0xfc, 0xe5, 0xd7, 0xb3, 0x7b, 0xf6, 0xf1, 0xff, 0xe3,
+	0xdb, 0xab, 0x4b, 0x96, 0x31, 0x62, 0xc4, 0x95, 0x37, 0x6e, 0xdc, 0xa5, 0x57, 0xae, 0x41, 0x82,
+	0x19, 0x32, 0x64, 0xc8, 0x8d, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0xe0, 0xdd, 0xa7, 0x53, 0xa6, 0x51,
+	0xa2, 0x59, 0xb2, 0x79, 0xf2, 0xf9, 0xef, 0xc3, 0x9b, 0x2b, 0x56, 0xac, 0x45, 0x8a, 0x09, 0x12,
+	0x24, 0x48, 0x90, 0x3d, 0x7a, 0xf4, 0xf5, 0xf7, 0xf3, 0xfb, 0xeb, 0xcb, 0x8b, 0x0b, 0x16, 0x2c,
+	0x58, 0xb0, 0x7d, 0xfa, 0xe9, 0xcf, 0x83, 0x1b, 0x36, 0x6c, 0xd8, 0xad, 0x47, 0x8e, 0x01, 0x02
+};
+
+static const uint8_t rs_log[256] = {
+	0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1a, 0xc6, 0x03, 0xdf, 0x33, 0xee, 0x1b, 0x68, 0xc7, 0x4b,
+	0x04, 0x64, 0xe0, 0x0e, 0x34, 0x8d, 0xef, 0x81, 0x1c, 0xc1, 0x69, 0xf8, 0xc8, 0x08, 0x4c, 0x71,
+	0x05, 0x8a, 0x65, 0x2f, 0xe1, 0x24, 0x0f, 0x21, 0x35, 0x93, 0x8e, 0xda, 0xf0, 0x12, 0x82, 0x45,
+	0x1d, 0xb5, 0xc2, 0x7d, 0x6a, 0x27, 0xf9, 0xb9, 0xc9, 0x9a, 0x09, 0x78, 0x4d, 0xe4, 0x72, 0xa6,
+	0x06, 0xbf, 0x8b, 0x62, 0x66, 0xdd, 0x30, 0xfd, 0xe2, 0x98, 0x25, 0xb3, 0x10, 0x91, 0x22, 0x88,
+	0x36, 0xd0, 0x94, 0xce, 0x8f, 0x96, 0xdb, 0xbd, 0xf1, 0xd2, 0x13, 0x5c, 0x83, 0x38, 0x46, 0x40,
+	0x1e, 0x42, 0xb6, 0xa3, 0xc3, 0x48, 0x7e, 0x6e, 0x6b, 0x3a, 0x28, 0x54, 0xfa, 0x85, 0xba, 0x3d,
+	0xca, 0x5e, 0x9b, 0x9f, 0x0a, 0x15, 0x79, 0x2b, 0x4e, 0xd4, 0xe5, 0xac, 0x73, 0xf3, 0xa7, 0x57,
+	0x07, 0x70, 0xc0, 0xf7, 0x8c, 0x80, 0x63, 0x0d, 0x67, 0x4a, 0xde, 0xed, 0x31, 0xc5, 0xfe, 0x18,
+	0xe3, 0xa5, 0x99, 0x77, 0x26, 0xb8, 0xb4, 0x7c, 0x11, 0x44, 0x92, 0xd9, 0x23, 0x20, 0x89, 0x2e,
+	0x37, 0x3f, 0xd1, 0x5b, 0x95, 0xbc, 0xcf, 0xcd, 0x90, 0x87, 0x97, 0xb2, 0xdc, 0xfc, 0xbe, 0x61,
+	0xf2, 0x56, 0xd3, 0xab, 0x14, 0x2a, 0x5d, 0x9e, 0x84, 0x3c, 0x39, 0x53, 0x47, 0x6d, 0x41, 0xa2,
+	0x1f, 0x2d, 0x43, 0xd8, 0xb7, 0x7b, 0xa4, 0x76, 0xc4, 0x17, 0x49, 0xec, 0x7f, 0x0c, 0x6f, 0xf6,
+	0x6c, 0xa1, 0x3b, 0x52, 0x29, 0x9d, 0x55, 0xaa, 0xfb, 0x60, 0x86, 0xb1, 0xbb, 0xcc, 0x3e, 0x5a,
+	0xcb, 0x59, 0x5f, 0xb0, 0x9c, 0xa9, 0xa0, 0x51, 0x0b, 0xf5, 0x16, 0xeb, 0x7a, 0x75, 0x2c, 0xd7,
+	0x4f, 0xae, 0xd5, 0xe9, 0xe6, 0xe7, 0xad, 0xe8, 0x74, 0xd6, 0xf4, 0xea, 0xa8, 0x50, 0x58, 0xaf
+};
+
+static uint8_t rs_mul(uint8_t a, uint8_t b) {
+	if( a == 0 || b == 0 ) { return 0; }
+	return rs_exp[rs_log[a]+rs_log[b]];
+}
+
+static uint8_t rs_div(uint8_t a, uint8_t b) {
+	if( a == 0 ) { return 0; }
+	return rs_exp[rs_log[a]+255-rs_log[b]];
+}
+
+rs_t *rs_init(size_t nsym) {
+	rs_t *rs;
+	size_t i,j;
+	
+	if( nsym == 0 || nsym >= RS_MAX_LEN ) { return 0; }
+	
+	rs = (rs_t*)malloc(sizeof(rs_t));
+	if( !rs ) { return 0; }
+	memset(rs,0,sizeof(rs_t));
+	rs->nsym = nsym;
+	
+	//Generator polynomial (genpoly[i] is the coefficient of x^i)
+	//g(x) = (x-alpha^0)(x-alpha^1)...(x-alpha^(nsym-1))
+	rs->genpoly[0] = 1;
+	for( i=0; i<nsym; i++ ) {
+		for( j=i+1; j>0; j-- ) {
+			rs->genpoly[j] = rs->genpoly[j-1] ^ rs_mul(rs->genpoly[j],rs_exp[i]);
+		}
+		rs->genpoly[0] = rs_mul(rs->genpoly[0],rs_exp[i]);
+	}
+	return rs;
+}
+
+void rs_destroy(rs_t *rs) {
+	if( rs ) {
+		memset(rs,0,sizeof(rs_t));
+		free(rs);
+	}
+}
+
+int rs_encode(rs_t *rs, uint8_t *parity, uint8_t *data, size_t datalen) {
+	size_t i,j;
+	uint8_t fb;
+	uint8_t fblog;
+	size_t nsym;
+	
+	if( !rs ) { return -1; }
+	if( !parity ) { return -1; }
+	if( !data && datalen ) { return -1; }
+	if( datalen+rs->nsym > RS_MAX_LEN ) { return -1; }
+	
+	//Systematic encoding: the parity is the remainder of data(x)*x^nsym / g(x).
+	//parity[0] holds the highest order coefficient, matching the transmit order.
+	nsym = rs->nsym;
+	memset(parity,0,nsym);
+	for( i=0; i<datalen; i++ ) {
+		fb = data[i] ^ parity[0];
+		memmove(parity,parity+1,nsym-1);
+		parity[nsym-1] = 0;
+		if( fb ) {
+			fblog = rs_log[fb];
+			for( j=0; j<nsym; j++ ) {
+				if( rs->genpoly[nsym-1-j] ) {
+					parity[j] = parity[j] ^ rs_exp[fblog+rs_log[rs->genpoly[nsym-1-j]]];
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+int rs_decode(rs_t *rs, uint8_t *codeword, size_t len) {
+	uint8_t synd[RS_MAX_LEN];
+	uint8_t lambda[RS_MAX_LEN+1];
+	uint8_t prev[RS_MAX_LEN+1];
+	uint8_t tmp[RS_MAX_LEN+1];
+	uint8_t omega[RS_MAX_LEN];
+	size_t  errpos[RS_MAX_LEN];
+	size_t  nerr;
+	size_t  nsym;
+	size_t  i,j,n;
+	size_t  L;
+	size_t  m;
+	uint8_t s;
+	uint8_t d;
+	uint8_t b;
+	uint8_t coef;
+	uint8_t x;
+	uint8_t xinv;
+	uint8_t num;
+	uint8_t den;
+	int     err;
+	
+	if( !rs ) { return -1; }
+	if( !codeword ) { return -1; }
+	if( len <= rs->nsym || len > RS_MAX_LEN ) { return -1; }
+	nsym = rs->nsym;
+	
+	//Syndromes: S_i = r(alpha^i), evaluated with Horner's rule
+	err = 0;
+	for( i=0; i<nsym; i++ ) {
+		s = 0;
+		for( j=0; j<len; j++ ) {
+			s = codeword[j] ^ (s ? rs_exp[rs_log[s]+i] : 0);
+		}
+		synd[i] = s;
+		err = err | s;
+	}
+	if( !err ) { return 0; }
+	
+	//Berlekamp-Massey for the error locator polynomial
+	memset(lambda,0,sizeof(lambda));
+	memset(prev,0,sizeof(prev));
+	lambda[0] = 1;
+	prev[0] = 1;
+	L = 0;
+	m = 1;
+	b = 1;
+	for( n=0; n<nsym; n++ ) {
+		d = synd[n];
+		for( i=1; i<=L; i++ ) {
+			d = d ^ rs_mul(lambda[i],synd[n-i]);
+		}
+		if( d == 0 ) {
+			m++;
+			continue;
+		}
+		coef = rs_div(d,b);
+		memcpy(tmp,lambda,sizeof(lambda));
+		for( i=0; i+m<=nsym; i++ ) {
+			lambda[i+m] = lambda[i+m] ^ rs_mul(coef,prev[i]);
+		}
+		if( 2*L <= n ) {
+			L = n+1-L;
+			memcpy(prev,tmp,sizeof(prev));
+			b = d;
+			m = 1;
+		}
+		else {
+			m++;
+		}
+	}
+	if( L == 0 || 2*L > nsym ) { return -1; }
+	
+	//Chien search: byte j sits at power len-1-j, so its locator is 
+	//alpha^(len-1-j) and it is in error if lambda(alpha^-(len-1-j)) == 0
+	nerr = 0;
+	for( j=0; j<len; j++ ) {
+		xinv = rs_exp[255-(len-1-j)];
+		s = 0;
+		for( i=L+1; i>0; i-- ) {
+			s = rs_mul(s,xinv) ^ lambda[i-1];
+		}
+		if( s == 0 ) {
+			if( nerr == L ) { return -1; }
+			errpos[nerr++] = j;
+		}
+	}
+	if( nerr != L ) { return -1; }
+	
+	//Error evaluator: omega(x) = S(x)*lambda(x) mod x^nsym
+	for( i=0; i<nsym; i++ ) {
+		omega[i] = 0;
+		for( j=0; j<=i && j<=L; j++ ) {
+			omega[i] = omega[i] ^ rs_mul(lambda[j],synd[i-j]);
+		}
+	}
+	
+	//Forney: e = X * omega(X^-1) / lambda'(X^-1)
+	for( n=0; n<nerr; n++ ) {
+		x    = rs_exp[len-1-errpos[n]];
+		xinv = rs_exp[255-(len-1-errpos[n])];
+		num = 0;
+		for( i=nsym; i>0; i-- ) {
+			num = rs_mul(num,xinv) ^ omega[i-1];
+		}
+		//The formal derivative only keeps the odd powers
+		den = 0;
+		for( i=L+1; i>0; i-- ) {
+			den = rs_mul(den,xinv) ^ (((i-1) & 1) ? lambda[i-1] : 0);
+		}
+		//den currently holds sum(lambda_i * X^-i) for odd i; drop one power of X^-1
+		den = rs_mul(den,x);
+		if( den == 0 ) { return -1; }
+		codeword[errpos[n]] = codeword[errpos[n]] ^ rs_mul(x,rs_div(num,den));
+	}
+	return (int)nerr;
+}
+
+static size_t rs_interleave_offset(size_t len, size_t ncw, size_t cw) {
+	//Codewords are stored back to back, with the first len%ncw of them 
+	//one byte longer than the rest
+	return cw*(len/ncw) + (cw < len%ncw ? cw : len%ncw);
+}
+
+void rs_interleave(uint8_t *dst, uint8_t *src, size_t len, size_t ncw) {
+	size_t cw,j;
+	size_t cwlen;
+	size_t out;
+	
+	//src holds ncw codewords back to back.  Byte j of every codeword is 
+	//sent before byte j+1 of any of them (byte j of codeword i lands at 
+	//j*ncw+i), so a burst of up to ncw bytes costs each codeword at 
+	//most one byte.  A single codeword gets no added protection.
+	if( len == 0 ) { return; }
+	if( ncw == 0 ) { ncw = 1; }
+	if( ncw > len ) { ncw = len; }
+	out = 0;
+	for( j=0; out<len; j++ ) {
+		for( cw=0; cw<ncw; cw++ ) {
+			cwlen = len/ncw + (cw < len%ncw ? 1 : 0);
+			if( j < cwlen ) {
+				dst[out++] = src[rs_interleave_offset(len,ncw,cw)+j];
+			}
+		}
+	}
+}
+
+void rs_deinterleave(uint8_t *dst, uint8_t *src, size_t len, size_t ncw) {
+	size_t cw,j;
+	size_t cwlen;
+	size_t in;
+	
+	if( len == 0 ) { return; }
+	if( ncw == 0 ) { ncw = 1; }
+	if( ncw > len ) { ncw = len; }
+	in = 0;
+	for( j=0; in<len; j++ ) {
+		for( cw=0; cw<ncw; cw++ ) {
+			cwlen = len/ncw + (cw < len%ncw ? 1 : 0);
+			if( j < cwlen ) {
+				dst[rs_interleave_offset(len,ncw,cw)+j] = src[in++];
+			}
+		}
+	}
+}
+
+#endif //RS_IMPLEMENTATION
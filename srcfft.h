@@ -30,9 +30,15 @@
 #include <samplerate.h>
 #include <fftw3.h>
 
+#include "pulse.h"
+
 typedef enum{ SRCFFT_ERROR=-1, SRCFFT_RESULT=0, SRCFFT_NEED_MORE=1 } srcfft_status_t;
 
 typedef struct {
+	//Configuration
+	size_t     samplerate;
+	size_t     bandwidth;
+	
 	//Samplerate Conversion Internals
 	SRC_STATE *src;
 	float      srcratio;
@@ -47,6 +53,8 @@ typedef struct {
 	fftw_plan     fftplan;
 	double       *fftin;
 	fftw_complex *fftout;
+	double        taper;
+	double       *window;
 	double        thresh;
 	double        norm_thresh;
 	size_t        magalloc;
@@ -75,8 +83,12 @@ int              srcfft_reset(srcfft_t *srcfft);
 void             srcfft_printresult(srcfft_t *srcfft);
 int              srcfft_set_thresh(srcfft_t *srcfft, double thresh);
 int              srcfft_set_norm_thresh(srcfft_t *srcfft, double thresh);
+int              srcfft_set_taper(srcfft_t *srcfft, double rolloff);
 int              srcfft_sync(srcfft_t *srcfft, size_t skip_sampleslen);
 srcfft_status_t  srcfft_process(srcfft_t *srcfft, double *samples, size_t sampleslen);
+srcfft_status_t  srcfft_transform(srcfft_t *srcfft, double *samples, size_t sampleslen);
+srcfft_status_t  srcfft_reduce(srcfft_t *srcfft, fftw_complex *spectrum);
+size_t           srcfft_spectrum_len(srcfft_t *srcfft);
 
 #endif //__SRCFFT_H__
 
@@ -99,6 +111,9 @@ srcfft_t *srcfft_init(size_t input_samplerate, size_t input_size, size_t output_
 	if( !srcfft ) { goto srcfft_init_error; }
 	memset(srcfft,0,sizeof(srcfft_t));
 	
+	srcfft->samplerate = input_samplerate;
+	srcfft->bandwidth = output_bandwidth;
+	
 	//Samplerate Rate
 	srcfft->srcratio =  (double)(output_bandwidth*2) / (double)input_samplerate;
 	srcfft->src = src_new(SRC_SINC_MEDIUM_QUALITY,1,0);
@@ -155,6 +170,7 @@ void srcfft_destroy(srcfft_t *srcfft) {
 		if( srcfft->srcout ) { free(srcfft->srcout); }
 		if( srcfft->fftin ) { fftw_free(srcfft->fftin); }
 		if( srcfft->fftout ) { fftw_free(srcfft->fftout); }
+		if( srcfft->window ) { free(srcfft->window); }
 		if( srcfft->mag ) { free(srcfft->mag); }
 		if( srcfft->norm ) { free(srcfft->norm); }
 		if( srcfft->detect ) { free(srcfft->detect); }
@@ -242,6 +258,51 @@ int srcfft_set_norm_thresh(srcfft_t *srcfft, double thresh) {
 	return 0;
 }
 
+int srcfft_set_taper(srcfft_t *srcfft, double rolloff) {
+	//Window each FFT with a raised cosine taper fitted to the FFT length,
+	//to match modulators that shape their symbols, or remove the window if
+	//rolloff is 0.  The window is scaled to unity coherent gain, so the 
+	//magnitude of a steady tone (and any threshold calibrated against one)
+	//is unchanged.
+	pulse_t *taper;
+	double  *window;
+	double   sum;
+	size_t   i;
+	
+	if( !srcfft ) { return -1; }
+	if( rolloff == 0.0 ) {
+		if( srcfft->window ) { free(srcfft->window); }
+		srcfft->window = 0;
+		srcfft->taper = 0.0;
+		return 0;
+	}
+	if( srcfft->fftalloc < 2*(1.0+rolloff) ) {
+		//Too few points to window
+		if( srcfft->window ) { free(srcfft->window); }
+		srcfft->window = 0;
+		srcfft->taper = rolloff;
+		return 0;
+	}
+	taper = pulse_taper_fit(srcfft->fftalloc,rolloff);
+	if( !taper ) { return -1; }
+	window = (double*)realloc(srcfft->window,sizeof(double)*srcfft->fftalloc);
+	if( !window ) {
+		pulse_destroy(taper);
+		return -1;
+	}
+	sum = 0.0;
+	for( i=0; i<taper->len; i++ ) {
+		sum = sum + taper->taps[i];
+	}
+	for( i=0; i<srcfft->fftalloc; i++ ) {
+		window[i] = (i < taper->len) ? taper->taps[i] * (double)srcfft->fftalloc / sum : 0.0;
+	}
+	pulse_destroy(taper);
+	srcfft->window = window;
+	srcfft->taper = rolloff;
+	return 0;
+}
+
 int srcfft_sync(srcfft_t *srcfft, size_t skip_sampleslen) {
 	size_t i;
 	if( !srcfft ) { return -1; }
@@ -250,14 +311,28 @@ int srcfft_sync(srcfft_t *srcfft, size_t skip_sampleslen) {
 }
 
 srcfft_status_t srcfft_process(srcfft_t *srcfft, double *samples, size_t sampleslen) {
+	srcfft_status_t result;
+	
+	result = srcfft_transform(srcfft,samples,sampleslen);
+	if( result != SRCFFT_RESULT ) {
+		return result;
+	}
+	return srcfft_reduce(srcfft,srcfft->fftout);
+}
+
+size_t srcfft_spectrum_len(srcfft_t *srcfft) {
+	//Number of complex bins (DC up to nyquist) that srcfft_reduce reads
+	return srcfft->fftalloc/2;
+}
+
+srcfft_status_t srcfft_transform(srcfft_t *srcfft, double *samples, size_t sampleslen) {
+	//Resample and FFT only, leaving the spectrum in srcfft->fftout.  This 
+	//lets one front-end feed several srcfft_reduce calls.
 	SRC_DATA src_data;
 	size_t i;
-	double mag;
-	double ang;
-	size_t binidx;
 	
-	if( !srcfft ) { goto srcfft_process_error; }
-	if( !samples && sampleslen ) { goto srcfft_process_error; }
+	if( !srcfft ) { goto srcfft_transform_error; }
+	if( !samples && sampleslen ) { goto srcfft_transform_error; }
 		
 	srcfft->used_samples = 0;
 	for(;;) {
@@ -280,7 +355,7 @@ srcfft_status_t srcfft_process(srcfft_t *srcfft, double *samples, size_t samples
 		src_data.end_of_input  = 0;
 		if( src_process(srcfft->src, &src_data) ) {
 			//printf("src_process failed\n");
-			goto srcfft_process_error;
+			goto srcfft_transform_error;
 		}
 		if( src_data.input_frames_used == srcfft->srcinlen ) {
 			srcfft->srcinlen = 0;
@@ -320,13 +395,37 @@ srcfft_status_t srcfft_process(srcfft_t *srcfft, double *samples, size_t samples
 	}
 	
 	//Move resampled data to fft input
-	for( i=0; i<srcfft->fftalloc; i++ ) {
-		srcfft->fftin[i] = (double)srcfft->srcout[i];
+	if( srcfft->window ) {
+		for( i=0; i<srcfft->fftalloc; i++ ) {
+			srcfft->fftin[i] = (double)srcfft->srcout[i] * srcfft->window[i];
+		}
+	}
+	else {
+		for( i=0; i<srcfft->fftalloc; i++ ) {
+			srcfft->fftin[i] = (double)srcfft->srcout[i];
+		}
 	}
 	srcfft->srcoutlen = 0;
 	
 	//Perform an FFT on audio
 	fftw_execute(srcfft->fftplan);
+	return SRCFFT_RESULT;
+	
+	srcfft_transform_error:
+	(void)srcfft_reset(srcfft);
+	return SRCFFT_ERROR;
+}
+
+srcfft_status_t srcfft_reduce(srcfft_t *srcfft, fftw_complex *spectrum) {
+	//Reduce srcfft_spectrum_len bins of spectrum into the output bins, 
+	//applying this srcfft's thresholds
+	size_t i;
+	double mag;
+	double ang;
+	size_t binidx;
+	
+	if( !srcfft ) { goto srcfft_reduce_error; }
+	if( !spectrum ) { goto srcfft_reduce_error; }
 	
 	//For most configurations, the FFT will produce more
 	//bins that the desired out.  We'll reduce the bins
@@ -347,11 +446,11 @@ srcfft_status_t srcfft_process(srcfft_t *srcfft, double *samples, size_t samples
 	for( i=0; i<(srcfft->fftalloc/2); i++ ) {
 		binidx = (size_t)((double)i * (double)srcfft->magalloc / (double)(srcfft->fftalloc/2));
 		
-		mag = sqrt(srcfft->fftout[i][0] * srcfft->fftout[i][0] + srcfft->fftout[i][1] * srcfft->fftout[i][1]);
+		mag = sqrt(spectrum[i][0] * spectrum[i][0] + spectrum[i][1] * spectrum[i][1]);
 		//printf("%02.1f[%zu] ",mag,binidx);
 		mag = mag + srcfft->mag[binidx];
 		if( isnan(mag) || isinf(mag) ) {
-			goto srcfft_process_error;
+			goto srcfft_reduce_error;
 		}
 		
 		srcfft->mag[binidx] = mag;
@@ -362,10 +461,10 @@ srcfft_status_t srcfft_process(srcfft_t *srcfft, double *samples, size_t samples
 		
 		srcfft->avgmag = srcfft->avgmag + mag;
 		
-		ang = atan2(srcfft->fftout[i][1],srcfft->fftout[i][0]);
+		ang = atan2(spectrum[i][1],spectrum[i][0]);
 		ang = ang + srcfft->ang[binidx];
 		if( isnan(ang) || isinf(ang) ) {
-			goto srcfft_process_error;
+			goto srcfft_reduce_error;
 		}
 		while( ang < 0 ) {
 			ang = ang + 2*M_PI;
@@ -408,7 +507,7 @@ srcfft_status_t srcfft_process(srcfft_t *srcfft, double *samples, size_t samples
 	srcfft->len = srcfft->magalloc;
 	return SRCFFT_RESULT;
 	
-	srcfft_process_error:
+	srcfft_reduce_error:
 	(void)srcfft_reset(srcfft);
 	return SRCFFT_ERROR;
 }
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SYMSYNC_H__
+#define __SYMSYNC_H__
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitops.h"
+
+//Framing and symbol timing shared by the single carrier stream modems.
+//A transmission starts with an alternating preamble for the timing loop,
+//a Barker sync word and a byte count sent twice, one bit per symbol.  The
+//receivers keep their filter outputs in a power of two ring, interpolate
+//it at the symbol instant picked by a Gardner loop, and steer that loop 
+//(and any carrier loop) with the second order loop gains below.  The
+//receive side of the framing (sync word hunt, header check and counting
+//down the data) is a symsync_frame_t, which asks the modem for its
+//decisions through a symsync_decide_t.
+
+#define SYMSYNC_PREAMBLE_LEN   32
+#define SYMSYNC_BARKER_LEN     13
+//Symbols before the length header
+#define SYMSYNC_SYNC_LEN       (SYMSYNC_PREAMBLE_LEN+SYMSYNC_BARKER_LEN)
+//Fraction of a perfect sync word correlation needed to start a frame
+#define SYMSYNC_SYNC_MIN       0.7
+//Byte count, sent twice
+#define SYMSYNC_HEADER_BITS    24
+#define SYMSYNC_HEADER_LEN     (2*SYMSYNC_HEADER_BITS)
+//Most bits a data symbol can carry
+#define SYMSYNC_MAX_BITS       8
+
+typedef enum{
+	SYMSYNC_SEARCH,
+	SYMSYNC_SYNC,
+	SYMSYNC_TRAINING,
+	SYMSYNC_HEADER,
+	SYMSYNC_DATA,
+} symsync_state_t;
+
+//The modem's decision on the symbol just timed.  In SYMSYNC_SYNC it puts
+//the symbol (+/-1 nominal) for the sync word correlator in soft[0], in
+//SYMSYNC_TRAINING it is handed training symbol idx, in SYMSYNC_HEADER it
+//returns the header bit, and in SYMSYNC_DATA it returns the symbol (bits
+//MSB first) with their confidences in soft when soft output is on.
+typedef int (*symsync_decide_t)(void *arg, symsync_state_t state, size_t idx, double *soft);
+
+typedef struct {
+	int      verbose;
+	symsync_state_t state;
+	size_t   bit_per_symbol;
+	//Accept the sync word upside down (a 180 degree phase ambiguity)
+	int      inverted;
+	//Symbols after the sync word before the decisions come out, then the
+	//number of them that are training rather than header
+	size_t   delay;
+	size_t   trainlen;
+
+	double   time;
+	double   time_int;
+	double   sync[SYMSYNC_BARKER_LEN];
+	double   corr;
+	size_t   symbols;
+	uint64_t header;
+	size_t   datalen;
+	size_t   bitsleft;
+} symsync_frame_t;
+
+int    symsync_sync_bit(size_t idx);
+int    symsync_header_bit(size_t datalen, size_t idx);
+double symsync_barker_corr(double *hist, double x);
+int    symsync_header_check(uint64_t header, size_t *datalen);
+void   symsync_loop_gains(double bandwidth, double *kp, double *ki);
+void   symsync_interp(double *ring, size_t ringalloc, size_t width, double t, double *y);
+size_t symsync_ring_len(size_t samp_per_sym);
+void   symsync_frame_start(symsync_frame_t *frame, double time);
+int    symsync_frame_ready(symsync_frame_t *frame, size_t count);
+void   symsync_frame_timing(symsync_frame_t *frame, double err, double acq, double trk, size_t samp_per_sym);
+int    symsync_frame_symbol(symsync_frame_t *frame, bitstream_t *bits, int lost, symsync_decide_t decide, void *arg);
+
+#endif //__SYMSYNC_H__
+
+#ifdef SYMSYNC_IMPLEMENTATION
+#undef SYMSYNC_IMPLEMENTATION
+
+static const double symsync_barker[SYMSYNC_BARKER_LEN] = { 1, 1, 1, 1, 1,-1,-1, 1, 1,-1, 1,-1, 1 };
+
+int symsync_sync_bit(size_t idx) {
+	//Bit idx of the preamble and sync word (idx < SYMSYNC_SYNC_LEN)
+	if( idx < SYMSYNC_PREAMBLE_LEN ) {
+		return (idx & 1) ? 0 : 1;
+	}
+	return symsync_barker[idx-SYMSYNC_PREAMBLE_LEN] > 0.0;
+}
+
+int symsync_header_bit(size_t datalen, size_t idx) {
+	//Bit idx of the length header (idx < SYMSYNC_HEADER_LEN), MSB first
+	return (datalen >> (SYMSYNC_HEADER_BITS-1-(idx%SYMSYNC_HEADER_BITS))) & 1;
+}
+
+double symsync_barker_corr(double *hist, double x) {
+	//Shift a soft symbol (+/-1 nominal) into the last SYMSYNC_BARKER_LEN 
+	//and correlate them with the sync word
+	double corr;
+	size_t j;
+
+	memmove(hist,hist+1,sizeof(double)*(SYMSYNC_BARKER_LEN-1));
+	hist[SYMSYNC_BARKER_LEN-1] = x;
+	corr = 0.0;
+	for( j=0; j<SYMSYNC_BARKER_LEN; j++ ) {
+		corr = corr + symsync_barker[j]*hist[j];
+	}
+	return corr;
+}
+
+int symsync_header_check(uint64_t header, size_t *datalen) {
+	//Both copies of the byte count have to agree, and a frame is never empty
+	*datalen = header & ((1 << SYMSYNC_HEADER_BITS)-1);
+	if( (header >> SYMSYNC_HEADER_BITS) != *datalen || !*datalen ) {
+		return -1;
+	}
+	return 0;
+}
+
+void symsync_loop_gains(double bandwidth, double *kp, double *ki) {
+	//Proportional and integral gains of a second order loop with a 
+	//damping factor of 0.707 (slightly underdamped, for a fast settle 
+	//with little overshoot) and the given noise bandwidth (times the 
+	//update period)
+	double zeta = 0.707;
+	double theta;
+	double den;
+
+	theta = bandwidth / (zeta + 1.0/(4.0*zeta));
+	den = 1.0 + 2.0*zeta*theta + theta*theta;
+	*kp = 4.0*zeta*theta / den;
+	*ki = 4.0*theta*theta / den;
+}
+
+void symsync_interp(double *ring, size_t ringalloc, size_t width, double t, double *y) {
+	//Cubic Lagrange interpolation at time t of a ring of ringalloc (a power
+	//of two) entries, each width values wide
+	size_t n;
+	size_t j;
+	size_t k;
+	double mu;
+	double c[4];
+	double *v;
+
+	n = (size_t)floor(t);
+	mu = t - (double)n;
+	c[0] = -mu*(mu-1.0)*(mu-2.0)/6.0;
+	c[1] = (mu+1.0)*(mu-1.0)*(mu-2.0)/2.0;
+	c[2] = -(mu+1.0)*mu*(mu-2.0)/2.0;
+	c[3] = (mu+1.0)*mu*(mu-1.0)/6.0;
+	memset(y,0,sizeof(double)*width);
+	for( j=0; j<4; j++ ) {
+		v = ring + width*((n+j-1) & (ringalloc-1));
+		for( k=0; k<width; k++ ) {
+			y[k] = y[k] + c[j]*v[k];
+		}
+	}
+}
+
+size_t symsync_ring_len(size_t samp_per_sym) {
+	//Power of two ring holding a symbol of filter outputs and the reach of
+	//the interpolator around both ends of it
+	size_t len;
+
+	len = 16;
+	while( len < samp_per_sym+8 ) {
+		len *= 2;
+	}
+	return len;
+}
+
+void symsync_frame_start(symsync_frame_t *frame, double time) {
+	//Signal detected: hunt for the sync word, first symbol at time
+	if( frame->verbose ) {
+		printf("  Signal detected\n");
+	}
+	frame->time = time;
+	frame->time_int = 0.0;
+	memset(frame->sync,0,sizeof(frame->sync));
+	frame->symbols = 0;
+	frame->state = SYMSYNC_SYNC;
+}
+
+int symsync_frame_ready(symsync_frame_t *frame, size_t count) {
+	//Interpolation needs one sample past the one after the symbol instant,
+	//with count samples in the ring so far
+	return (double)count >= floor(frame->time)+3.0;
+}
+
+void symsync_frame_timing(symsync_frame_t *frame, double err, double acq, double trk, size_t samp_per_sym) {
+	//Step the symbol instant on by one symbol, steered by the Gardner error
+	//err with a loop bandwidth of acq until the sync word and trk after it.
+	//Acquisition is proportional only, so that a wandering integrator does
+	//not leave the tracking loop with a drift to undo
+	double kp;
+	double ki;
+
+	symsync_loop_gains(frame->state == SYMSYNC_SYNC ? acq : trk,&kp,&ki);
+	if( frame->state == SYMSYNC_SYNC ) {
+		ki = 0.0;
+	}
+	frame->time_int = frame->time_int + ki*err;
+	frame->time = frame->time + samp_per_sym*(1.0 + kp*err + frame->time_int);
+}
+
+int symsync_frame_symbol(symsync_frame_t *frame, bitstream_t *bits, int lost, symsync_decide_t decide, void *arg) {
+	//Run the framing on the symbol just timed, with lost set once the
+	//modem has lost the signal.  Returns 1 when the sync word is found
+	//(frame->corr has its correlation), -1 on error and 0 otherwise.
+	double soft[SYMSYNC_MAX_BITS];
+	double corr;
+	size_t idx;
+	size_t n;
+	int sym;
+
+	frame->symbols++;
+
+	//Also stops the sync word hunt on the tail of a frame, so that it
+	//does not run on into silence
+	if( lost ) {
+		if( frame->verbose ) {
+			printf("  Signal lost\n");
+		}
+		frame->state = SYMSYNC_SEARCH;
+		return 0;
+	}
+
+	if( frame->state == SYMSYNC_SYNC ) {
+		decide(arg,frame->state,0,soft);
+		corr = symsync_barker_corr(frame->sync,soft[0]);
+		if( frame->symbols >= SYMSYNC_BARKER_LEN && (frame->inverted ? fabs(corr) : corr) >= SYMSYNC_SYNC_MIN*SYMSYNC_BARKER_LEN ) {
+			if( frame->verbose ) {
+				printf("  Sync (%0.1lf) after %zu symbols\n",corr,frame->symbols);
+			}
+			frame->corr = corr;
+			frame->header = 0;
+			frame->symbols = 0;
+			frame->state = frame->trainlen ? SYMSYNC_TRAINING : SYMSYNC_HEADER;
+			return 1;
+		}
+		if( frame->symbols > SYMSYNC_PREAMBLE_LEN+2*SYMSYNC_BARKER_LEN ) {
+			if( frame->verbose ) {
+				printf("  No sync\n");
+			}
+			frame->state = SYMSYNC_SEARCH;
+		}
+		return 0;
+	}
+
+	//Decisions lag the sync word by delay symbols
+	if( frame->symbols <= frame->delay ) {
+		return 0;
+	}
+	idx = frame->symbols - frame->delay - 1;
+
+	if( frame->state == SYMSYNC_TRAINING ) {
+		decide(arg,frame->state,idx,soft);
+		if( idx+1 == frame->trainlen ) {
+			frame->state = SYMSYNC_HEADER;
+		}
+		return 0;
+	}
+
+	if( frame->state == SYMSYNC_HEADER ) {
+		idx = idx - frame->trainlen;
+		frame->header = (frame->header << 1) | (decide(arg,frame->state,idx,soft) & 1);
+		if( idx+1 == SYMSYNC_HEADER_LEN ) {
+			if( symsync_header_check(frame->header,&frame->datalen) ) {
+				if( frame->verbose ) {
+					printf("  Bad header\n");
+				}
+				frame->state = SYMSYNC_SEARCH;
+				return 0;
+			}
+			if( frame->verbose ) {
+				printf("  Frame of %zu bytes\n",frame->datalen);
+			}
+			//Frames are whole bytes; drop into line after one that was cut off
+			if( bitstream_flush(bits) ) { return -1; }
+			frame->bitsleft = frame->datalen*8;
+			frame->state = SYMSYNC_DATA;
+		}
+		return 0;
+	}
+
+	sym = decide(arg,frame->state,idx,soft);
+	if( frame->verbose ) {
+		printf("----->Symbol: 0x%02x\n",sym);
+	}
+	//The last symbol may be padded past the end of the data
+	n = frame->bit_per_symbol;
+	if( n > frame->bitsleft ) {
+		sym = sym >> (n - frame->bitsleft);
+		n = frame->bitsleft;
+	}
+	if( bitstream_write_soft(bits, n, sym, soft) ) {
+		if( frame->verbose ) {
+			printf("    Failed to grow data buffer\n");
+		}
+		return -1;
+	}
+	frame->bitsleft = frame->bitsleft - n;
+	if( !frame->bitsleft ) {
+		if( frame->verbose ) {
+			printf("  End of frame\n");
+		}
+		frame->state = SYMSYNC_SEARCH;
+	}
+	return 0;
+}
+
+#endif //SYMSYNC_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2026, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __TCM_H__
+#define __TCM_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitops.h"
+
+//Trellis coded modulation for the symbol sets numbered around the circle
+//(pskclk phases, the corr fpsk templates).  Set partitioning splits the
+//symbols into four subsets of every fourth symbol, the furthest apart 
+//the set has.  One data bit per symbol goes through a 4 state rate 1/2 
+//code (generators 5,2 octal) that picks the subset, and the rest pick 
+//the symbol within it uncoded.  So a set of 2^m symbols carries m-1 bits,
+//the same as the uncoded set half its size, but the distance between 
+//sequences is about 3 dB more.
+#define TCM_MEMORY      2
+#define TCM_STATES      4
+#define TCM_POLY_1      0x5
+#define TCM_POLY_0      0x2
+
+//The demodulator fills dist with the distance (smaller is closer) of what 
+//it measured to each of the symbols, then calls tcm_decode
+typedef struct {
+	size_t    bit_per_symbol;
+	double   *dist;
+	double    metric[TCM_STATES];
+	uint16_t *decisions;
+	size_t    decisionslen;
+	size_t    decisionsalloc;
+} tcm_t;
+
+int    tcm_init(tcm_t *tcm, size_t symbol_count);
+void   tcm_destroy(tcm_t *tcm);
+size_t tcm_symbol_count(size_t data_bits, size_t bit_per_symbol);
+int    tcm_encode(unsigned int *state, size_t bit_per_symbol, int bits);
+int    tcm_decode(tcm_t *tcm);
+int    tcm_flush(tcm_t *tcm, bitstream_t *bits);
+
+#endif //__TCM_H__
+
+#ifdef TCM_IMPLEMENTATION
+#undef TCM_IMPLEMENTATION
+
+static int tcm_parity(unsigned int x) {
+	x = x ^ (x >> 2);
+	x = x ^ (x >> 1);
+	return x & 1;
+}
+
+static void tcm_reset(tcm_t *tcm) {
+	//Every transmission starts in state 0
+	size_t i;
+	
+	for( i=0; i<TCM_STATES; i++ ) {
+		tcm->metric[i] = 1e30;
+	}
+	tcm->metric[0] = 0.0;
+	tcm->decisionslen = 0;
+}
+
+int tcm_init(tcm_t *tcm, size_t symbol_count) {
+	memset(tcm,0,sizeof(tcm_t));
+	tcm->bit_per_symbol = 1;
+	while( ((size_t)1 << tcm->bit_per_symbol) < symbol_count ) {
+		tcm->bit_per_symbol++;
+	}
+	//Needs at least the four subsets, and the decisions hold the 
+	//uncoded bits
+	if( tcm->bit_per_symbol < 2 || tcm->bit_per_symbol > 16 ) { return -1; }
+	tcm->dist = (double*)malloc(sizeof(double)*((size_t)1 << tcm->bit_per_symbol));
+	if( !tcm->dist ) { return -1; }
+	tcm_reset(tcm);
+	return 0;
+}
+
+void tcm_destroy(tcm_t *tcm) {
+	if( tcm->dist ) { free(tcm->dist); }
+	if( tcm->decisions ) { free(tcm->decisions); }
+	memset(tcm,0,sizeof(tcm_t));
+}
+
+size_t tcm_symbol_count(size_t data_bits, size_t bit_per_symbol) {
+	//Symbols for data_bits of data, and the tail that flushes the encoder
+	return (data_bits + bit_per_symbol-2) / (bit_per_symbol-1) + TCM_MEMORY;
+}
+
+int tcm_encode(unsigned int *state, size_t bit_per_symbol, int bits) {
+	//Symbol for the next bit_per_symbol-1 data bits, the first of which 
+	//is coded.  Zeros for the last TCM_MEMORY symbols return to state 0.
+	unsigned int reg;
+	unsigned int c;
+	
+	reg = (((bits >> (bit_per_symbol-2)) & 1) << TCM_MEMORY) | *state;
+	c = (tcm_parity(reg & TCM_POLY_1) << 1) | tcm_parity(reg & TCM_POLY_0);
+	*state = reg >> 1;
+	return ((bits & ((1 << (bit_per_symbol-2))-1)) << 2) | c;
+}
+
+int tcm_decode(tcm_t *tcm) {
+	//One Viterbi step from the symbol distances in tcm->dist
+	double next[TCM_STATES];
+	double best;
+	double m;
+	unsigned int ns;
+	unsigned int ps;
+	unsigned int b;
+	unsigned int c;
+	size_t u;
+	size_t nu = (size_t)1 << (tcm->bit_per_symbol-2);
+	uint16_t *dec;
+	void *tmp;
+	
+	if( tcm->decisionslen >= tcm->decisionsalloc ) {
+		tmp = realloc(tcm->decisions,sizeof(uint16_t)*TCM_STATES*(tcm->decisionsalloc+256));
+		if( !tmp ) { return -1; }
+		tcm->decisions = (uint16_t*)tmp;
+		tcm->decisionsalloc = tcm->decisionsalloc+256;
+	}
+	dec = tcm->decisions + tcm->decisionslen*TCM_STATES;
+	
+	//The two states leading to ns differ in the oldest bit b; every 
+	//branch is really nu parallel ones, of which the closest is kept
+	for( ns=0; ns<TCM_STATES; ns++ ) {
+		next[ns] = 1e30;
+		dec[ns] = 0;
+		for( b=0; b<2; b++ ) {
+			ps = ((ns & 1) << 1) | b;
+			c = (tcm_parity((((ns >> 1) << TCM_MEMORY) | ps) & TCM_POLY_1) << 1) |
+			    tcm_parity((((ns >> 1) << TCM_MEMORY) | ps) & TCM_POLY_0);
+			for( u=0; u<nu; u++ ) {
+				m = tcm->metric[ps] + tcm->dist[(u << 2) | c];
+				if( m < next[ns] ) {
+					next[ns] = m;
+					dec[ns] = (uint16_t)((u << 1) | b);
+				}
+			}
+		}
+	}
+	tcm->decisionslen++;
+	
+	best = next[0];
+	for( ns=1; ns<TCM_STATES; ns++ ) {
+		if( next[ns] < best ) { best = next[ns]; }
+	}
+	for( ns=0; ns<TCM_STATES; ns++ ) {
+		tcm->metric[ns] = next[ns] - best;
+	}
+	return 0;
+}
+
+int tcm_flush(tcm_t *tcm, bitstream_t *bits) {
+	//End of a transmission: trace back from state 0, where the tail left
+	//the encoder, and write out the data bits.  The decoder starts over.
+	unsigned int state;
+	uint16_t d;
+	size_t step;
+	
+	state = 0;
+	for( step=tcm->decisionslen; step>0; step-- ) {
+		d = tcm->decisions[(step-1)*TCM_STATES+state];
+		//Each step is only read once, so keep its data bits in place
+		tcm->decisions[(step-1)*TCM_STATES] = (uint16_t)(((state >> 1) << (tcm->bit_per_symbol-2)) | (d >> 1));
+		state = ((state & 1) << 1) | (d & 1);
+	}
+	for( step=0; step+TCM_MEMORY<tcm->decisionslen; step++ ) {
+		if( bitstream_write(bits,tcm->bit_per_symbol-1,tcm->decisions[step*TCM_STATES]) ) { 
+			tcm_reset(tcm);
+			return -1; 
+		}
+	}
+	tcm_reset(tcm);
+	return 0;
+}
+
+#endif //TCM_IMPLEMENTATION
\ No newline at end of file